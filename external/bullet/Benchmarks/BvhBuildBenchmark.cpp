@@ -0,0 +1,187 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///BvhBuildBenchmark compares the btQuantizedBvh build modes on meshes of 10k to 1M triangles.
+///For every mode it reports the build time, the SAH cost of the tree (the summed area of the internal nodes relative to the root),
+///and the time of 20000 closest hit rays and 20000 AABB queries against the binary tree.
+///The mesh is a heightfield with clusters of small props, in shuffled triangle order.
+///It is a standalone program, build it with the library sources, for example
+///g++ -O2 -I.. BvhBuildBenchmark.cpp `find ../BulletCollision ../LinearMath -name '*.cpp'` -lpthread
+
+#include "btBulletCollisionCommon.h"
+#include "LinearMath/btQuickprof.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+static const char*	gBuildModeNames[] = {"mean split","binned sah fast","binned sah quality"};
+
+struct btTriangleCounter : public btTriangleCallback
+{
+	int	m_numTriangles;
+
+	btTriangleCounter() : m_numTriangles(0)
+	{
+	}
+
+	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+	{
+		m_numTriangles++;
+	}
+};
+
+static void	createBenchmarkMesh(int numTriangles,btAlignedObjectArray<btScalar>& vertices,btAlignedObjectArray<int>& indices,int& gridSize)
+{
+	srand(7);
+	//about a third of the triangles form the terrain
+	gridSize = int(btSqrt(btScalar(numTriangles)*btScalar(0.35)));
+	int i,j;
+	for (i=0;i<=gridSize;i++)
+	{
+		for (j=0;j<=gridSize;j++)
+		{
+			vertices.push_back(btScalar(i));
+			vertices.push_back(btSin(btScalar(i)*btScalar(0.1))*btCos(btScalar(j)*btScalar(0.13))*btScalar(6.));
+			vertices.push_back(btScalar(j));
+		}
+	}
+	for (i=0;i<gridSize;i++)
+	{
+		for (j=0;j<gridSize;j++)
+		{
+			int a = i*(gridSize+1)+j;
+			int c = a+gridSize+1;
+			indices.push_back(a);	indices.push_back(a+1);	indices.push_back(c);
+			indices.push_back(a+1);	indices.push_back(c+1);	indices.push_back(c);
+		}
+	}
+	//the rest are dense clusters of small triangles, scattered over the terrain
+	while (indices.size()/3 < numTriangles)
+	{
+		btScalar x = btScalar(rand()%gridSize);
+		btScalar y = btScalar(rand()%8);
+		btScalar z = btScalar(rand()%gridSize);
+		int base = vertices.size()/3;
+		for (i=0;i<12;i++)
+		{
+			vertices.push_back(x+btScalar(rand()%100)*btScalar(0.01));
+			vertices.push_back(y+btScalar(rand()%100)*btScalar(0.03));
+			vertices.push_back(z+btScalar(rand()%100)*btScalar(0.01));
+		}
+		for (i=0;i<20 && indices.size()/3 < numTriangles;i++)
+		{
+			indices.push_back(base+rand()%12);
+			indices.push_back(base+rand()%12);
+			indices.push_back(base+rand()%12);
+		}
+	}
+	//meshes rarely come in a spatial order
+	for (i=indices.size()/3-1;i>0;i--)
+	{
+		int k = rand()%(i+1);
+		for (j=0;j<3;j++)
+		{
+			btSwap(indices[i*3+j],indices[k*3+j]);
+		}
+	}
+}
+
+static btScalar	computeSahCost(const btOptimizedBvh* bvh)
+{
+	const QuantizedNodeArray& nodes = bvh->getQuantizedNodeArray();
+	int numNodes = nodes[0].isLeafNode() ? 1 : nodes[0].getEscapeIndex();
+	btScalar rootArea(0.);
+	btScalar internalArea(0.);
+	for (int i=0;i<numNodes;i++)
+	{
+		btVector3 extent = bvh->unQuantize(nodes[i].m_quantizedAabbMax) - bvh->unQuantize(nodes[i].m_quantizedAabbMin);
+		btScalar area = extent.x()*extent.y()+extent.y()*extent.z()+extent.z()*extent.x();
+		if (!i)
+			rootArea = area;
+		if (!nodes[i].isLeafNode())
+			internalArea += area;
+	}
+	return internalArea/rootArea;
+}
+
+int main()
+{
+	const int meshSizes[] = {10000,100000,1000000};
+	const int numQueries = 20000;
+
+	printf("%-8s %-20s %10s %10s %12s %12s\n","tris","mode","build ms","sah cost","rays ms","aabbs ms");
+	for (int s=0;s<3;s++)
+	{
+		btAlignedObjectArray<btScalar> vertices;
+		btAlignedObjectArray<int> indices;
+		int gridSize;
+		createBenchmarkMesh(meshSizes[s],vertices,indices,gridSize);
+		btTriangleIndexVertexArray mesh(indices.size()/3,&indices[0],3*sizeof(int),vertices.size()/3,&vertices[0],3*sizeof(btScalar));
+
+		for (int mode=btQuantizedBvh::BUILD_MEAN_SPLIT;mode<=btQuantizedBvh::BUILD_BINNED_SAH_QUALITY;mode++)
+		{
+			btBvhTriangleMeshShape shape(&mesh,true,false);
+			//measure the binary tree that the build mode produced
+			shape.setUseWideBvh(false);
+			shape.setBvhBuildMode(btQuantizedBvh::btBuildMode(mode));
+
+			btClock clock;
+			shape.buildOptimizedBvh();
+			unsigned long int buildMicroseconds = clock.getTimeMicroseconds();
+
+			btDefaultCollisionConfiguration collisionConfiguration;
+			btCollisionDispatcher dispatcher(&collisionConfiguration);
+			btDbvtBroadphase broadphase;
+			btCollisionWorld world(&dispatcher,&broadphase,&collisionConfiguration);
+			btCollisionObject object;
+			object.setCollisionShape(&shape);
+			world.addCollisionObject(&object);
+
+			//half of the rays come down from above, the other half skim along the terrain
+			srand(3);
+			int numHits = 0;
+			clock.reset();
+			for (int i=0;i<numQueries;i++)
+			{
+				btVector3 from(btScalar(rand()%gridSize),btScalar(30.),btScalar(rand()%gridSize));
+				btVector3 to(btScalar(rand()%gridSize),btScalar(-30.),btScalar(rand()%gridSize));
+				if (i&1)
+				{
+					from.setValue(btScalar(-1.),btScalar(3.),btScalar(rand()%gridSize));
+					to.setValue(btScalar(gridSize+1),btScalar(2.),btScalar(rand()%gridSize));
+				}
+				btCollisionWorld::ClosestRayResultCallback resultCallback(from,to);
+				world.rayTest(from,to,resultCallback);
+				numHits += resultCallback.hasHit();
+			}
+			unsigned long int rayMicroseconds = clock.getTimeMicroseconds();
+
+			srand(5);
+			btTriangleCounter counter;
+			clock.reset();
+			for (int i=0;i<numQueries;i++)
+			{
+				btVector3 center(btScalar(rand()%gridSize),btScalar(rand()%8),btScalar(rand()%gridSize));
+				btVector3 extent(btScalar(1.5),btScalar(1.5),btScalar(1.5));
+				shape.processAllTriangles(&counter,center-extent,center+extent);
+			}
+			unsigned long int aabbMicroseconds = clock.getTimeMicroseconds();
+
+			world.removeCollisionObject(&object);
+			printf("%-8d %-20s %10.1f %10.1f %12.1f %12.1f\n",meshSizes[s],gBuildModeNames[mode],
+				buildMicroseconds*0.001,computeSahCost(shape.getOptimizedBvh()),rayMicroseconds*0.001,aabbMicroseconds*0.001);
+		}
+	}
+	return 0;
+}
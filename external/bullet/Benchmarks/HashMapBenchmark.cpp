@@ -0,0 +1,130 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///HashMapBenchmark compares the chained btHashMap with the open addressing btOpenHashMap.
+///For int keys (the btTriangleInfoMap case) and pointer keys (the btDefaultSerializer case) it reports the nanoseconds per
+///insert, per lookup of a stored key, per lookup of a missing key and per remove, the best of several runs.
+///The keys are looked up in a different order than they were inserted in.
+///It is a standalone program, build it with the library sources, for example
+///g++ -O2 -I.. HashMapBenchmark.cpp ../LinearMath/btAlignedAllocator.cpp ../LinearMath/btQuickprof.cpp
+
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btMinMax.h"
+#include "LinearMath/btQuickprof.h"
+#include <stdio.h>
+
+struct btHashMapBenchmarkResult
+{
+	double	m_insert;
+	double	m_hit;
+	double	m_miss;
+	double	m_remove;
+};
+
+template <class Map,class Key>
+static bool	runHashMapBenchmark(const btAlignedObjectArray<Key>& keys,const btAlignedObjectArray<Key>& missingKeys,int numRuns,btHashMapBenchmarkResult& result)
+{
+	int numKeys = keys.size();
+	//a stride that is coprime with the number of keys visits every key once, in a scattered order
+	const int lookupStride = 7919;
+	bool valid = true;
+	result.m_insert = result.m_hit = result.m_miss = result.m_remove = 1e30;
+	for (int run=0;run<numRuns;run++)
+	{
+		Map map;
+		btClock clock;
+		int i;
+		for (i=0;i<numKeys;i++)
+		{
+			map.insert(keys[i],i);
+		}
+		btSetMin(result.m_insert,clock.getTimeMicroseconds()*1000.0/numKeys);
+
+		int sum = 0;
+		clock.reset();
+		for (i=0;i<numKeys;i++)
+		{
+			int k = int((i*(long long)lookupStride)%numKeys);
+			const int* value = map.find(keys[k]);
+			sum += value ? *value-k : 1;
+		}
+		btSetMin(result.m_hit,clock.getTimeMicroseconds()*1000.0/numKeys);
+
+		int numFound = 0;
+		clock.reset();
+		for (i=0;i<numKeys;i++)
+		{
+			numFound += map.find(missingKeys[i]) != 0;
+		}
+		btSetMin(result.m_miss,clock.getTimeMicroseconds()*1000.0/numKeys);
+
+		clock.reset();
+		for (i=0;i<numKeys;i+=2)
+		{
+			map.remove(keys[i]);
+		}
+		btSetMin(result.m_remove,clock.getTimeMicroseconds()*2000.0/numKeys);
+
+		valid = valid && !sum && !numFound && map.size() == numKeys/2;
+	}
+	return valid;
+}
+
+template <class Key>
+static void	compareHashMaps(const char* name,const btAlignedObjectArray<Key>& keys,const btAlignedObjectArray<Key>& missingKeys,int numRuns)
+{
+	btHashMapBenchmarkResult chained,open;
+	bool valid = runHashMapBenchmark<btHashMap<Key,int> >(keys,missingKeys,numRuns,chained);
+	valid = runHashMapBenchmark<btOpenHashMap<Key,int> >(keys,missingKeys,numRuns,open) && valid;
+	printf("%-12s %-8s %8.1f %8.1f %8.1f %8.1f\n",name,"chained",chained.m_insert,chained.m_hit,chained.m_miss,chained.m_remove);
+	printf("%-12s %-8s %8.1f %8.1f %8.1f %8.1f%s\n","","open",open.m_insert,open.m_hit,open.m_miss,open.m_remove,valid ? "" : "  FAILED");
+}
+
+int main()
+{
+	const int numRuns = 7;
+	const int numIntKeys[] = {100000,1000000};
+	const int numPointerKeys = 1000000;
+
+	printf("best of %d runs, ns per operation\n",numRuns);
+	printf("%-12s %-8s %8s %8s %8s %8s\n","keys","map","insert","hit","miss","remove");
+	for (int s=0;s<2;s++)
+	{
+		//the triangle info map is keyed by triangle index, every other index is stored
+		btAlignedObjectArray<btHashInt> keys,missingKeys;
+		for (int i=0;i<numIntKeys[s];i++)
+		{
+			keys.push_back(btHashInt(i*2));
+			missingKeys.push_back(btHashInt(i*2+1));
+		}
+		char name[32];
+		sprintf(name,"%dk int",numIntKeys[s]/1000);
+		compareHashMaps(name,keys,missingKeys,numRuns);
+	}
+
+	//serializer keys are pointers to 16 byte aligned objects
+	char* memory = (char*)btAlignedAlloc(numPointerKeys*64,16);
+	btAlignedObjectArray<btHashPtr> keys,missingKeys;
+	for (int i=0;i<numPointerKeys;i++)
+	{
+		keys.push_back(btHashPtr(memory+i*64));
+		missingKeys.push_back(btHashPtr(memory+i*64+32));
+	}
+	char name[32];
+	sprintf(name,"%dk ptr",numPointerKeys/1000);
+	compareHashMaps(name,keys,missingKeys,numRuns);
+	btAlignedFree(memory);
+	return 0;
+}
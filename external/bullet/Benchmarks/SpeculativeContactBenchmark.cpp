@@ -0,0 +1,152 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+///SpeculativeContactBenchmark compares the swept ccd of integrateTransforms with SOLVER_USE_SPECULATIVE_CONTACTS.
+///Fast spheres are shot at a thin wall. For every mode it reports the time per step, the spheres that tunnelled through the wall,
+///and the spheres that bounced back without coming within 2cm of the wall.
+///It is a standalone program, build it with the library sources, for example
+///g++ -O2 -I.. SpeculativeContactBenchmark.cpp `find ../BulletCollision ../BulletDynamics ../LinearMath -name '*.cpp'` -lpthread
+
+#include "btBulletDynamicsCommon.h"
+#include "LinearMath/btQuickprof.h"
+#include <stdio.h>
+
+enum btCcdBenchmarkMode
+{
+	CCD_BENCHMARK_NONE,
+	CCD_BENCHMARK_SWEEP,
+	CCD_BENCHMARK_BATCHED_SWEEP,
+	CCD_BENCHMARK_SPECULATIVE
+};
+
+static const char*	gModeNames[] = {"no ccd","sweep","batched sweep","speculative"};
+
+struct btCcdBenchmarkResult
+{
+	double	m_microsecondsPerStep;
+	int		m_numTunnelled;
+	int		m_numEarlyBounces;
+};
+
+static void	runCcdBenchmark(btCcdBenchmarkMode mode,int numSpheres,btScalar speed,btScalar restitution,btCcdBenchmarkResult& result)
+{
+	const btScalar radius = btScalar(0.1);
+	const btScalar wallZ = btScalar(5.);
+	const btScalar wallHalfThickness = btScalar(0.05);
+	const int numSteps = 30;
+
+	btDefaultCollisionConfiguration collisionConfiguration;
+	btCollisionDispatcher dispatcher(&collisionConfiguration);
+	btDbvtBroadphase broadphase;
+	btSequentialImpulseConstraintSolver solver;
+	btDiscreteDynamicsWorld world(&dispatcher,&broadphase,&solver,&collisionConfiguration);
+	world.setGravity(btVector3(0,0,0));
+	world.setBatchedCcd(mode == CCD_BENCHMARK_BATCHED_SWEEP);
+	if (mode == CCD_BENCHMARK_SPECULATIVE)
+	{
+		world.getSolverInfo().m_solverMode |= SOLVER_USE_SPECULATIVE_CONTACTS;
+	}
+
+	btBoxShape wallShape(btVector3(10,10,wallHalfThickness));
+	btTransform trans;
+	trans.setIdentity();
+	trans.setOrigin(btVector3(0,0,wallZ));
+	btRigidBody wall(0,0,&wallShape);
+	wall.setWorldTransform(trans);
+	wall.setRestitution(restitution);
+	world.addRigidBody(&wall);
+
+	btSphereShape sphereShape(radius);
+	btVector3 localInertia;
+	sphereShape.calculateLocalInertia(1,localInertia);
+	btAlignedObjectArray<btRigidBody*> spheres;
+	btAlignedObjectArray<btScalar> closestFronts;
+	int i;
+	for (i=0;i<numSpheres;i++)
+	{
+		btRigidBody::btRigidBodyConstructionInfo info(1,0,&sphereShape,localInertia);
+		info.m_restitution = restitution;
+		btRigidBody* body = new btRigidBody(info);
+		//the spheres start at different distances, so they reach the wall at different points of a step
+		trans.setOrigin(btVector3((i%40)*btScalar(0.4)-8,((i/40)%40)*btScalar(0.4)-8,btScalar(-(i%7))*btScalar(0.37)));
+		body->setWorldTransform(trans);
+		body->setLinearVelocity(btVector3(0,0,speed));
+		body->setActivationState(DISABLE_DEACTIVATION);
+		if (mode == CCD_BENCHMARK_SWEEP || mode == CCD_BENCHMARK_BATCHED_SWEEP)
+		{
+			body->setCcdMotionThreshold(radius*btScalar(0.5));
+			body->setCcdSweptSphereRadius(radius);
+		}
+		world.addRigidBody(body);
+		spheres.push_back(body);
+		closestFronts.push_back(trans.getOrigin().z()+radius);
+	}
+
+	btClock clock;
+	unsigned long int microseconds = 0;
+	for (int step=0;step<numSteps;step++)
+	{
+		clock.reset();
+		world.stepSimulation(btScalar(1.)/btScalar(60.),1);
+		microseconds += clock.getTimeMicroseconds();
+
+		for (i=0;i<numSpheres;i++)
+		{
+			btSetMax(closestFronts[i],spheres[i]->getWorldTransform().getOrigin().z()+radius);
+		}
+	}
+
+	//a sphere that moves away from the wall without having come close to it bounced before the contact
+	result.m_numTunnelled = 0;
+	result.m_numEarlyBounces = 0;
+	for (i=0;i<numSpheres;i++)
+	{
+		if (spheres[i]->getLinearVelocity().z() < btScalar(0.) && closestFronts[i] < wallZ-wallHalfThickness-btScalar(0.02))
+		{
+			result.m_numEarlyBounces++;
+		}
+		if (spheres[i]->getWorldTransform().getOrigin().z() > wallZ)
+		{
+			result.m_numTunnelled++;
+		}
+		world.removeRigidBody(spheres[i]);
+		delete spheres[i];
+	}
+	world.removeRigidBody(&wall);
+	result.m_microsecondsPerStep = double(microseconds)/double(numSteps);
+}
+
+int main()
+{
+	const int numSpheres = 1600;
+	const btScalar speeds[] = {btScalar(30.),btScalar(300.)};
+	const btScalar restitutions[] = {btScalar(0.),btScalar(0.8)};
+
+	printf("%d spheres against a 0.1m wall, 30 steps at 60Hz\n",numSpheres);
+	printf("%-14s %8s %12s %12s %10s %14s\n","mode","speed","restitution","us/step","tunnelled","early bounces");
+	for (int s=0;s<2;s++)
+	{
+		for (int r=0;r<2;r++)
+		{
+			for (int mode=CCD_BENCHMARK_NONE;mode<=CCD_BENCHMARK_SPECULATIVE;mode++)
+			{
+				btCcdBenchmarkResult result;
+				runCcdBenchmark(btCcdBenchmarkMode(mode),numSpheres,speeds[s],restitutions[r],result);
+				printf("%-14s %8.0f %12.1f %12.0f %10d %14d\n",gModeNames[mode],speeds[s],restitutions[r],result.m_microsecondsPerStep,result.m_numTunnelled,result.m_numEarlyBounces);
+			}
+		}
+	}
+	return 0;
+}
@@ -167,6 +167,15 @@ extern "C" {
 	// needed for source/blender/blenkernel/intern/collision.c
 	double plNearestPoints(float p1[3], float p2[3], float p3[3], float q1[3], float q2[3], float q3[3], float *pa, float *pb, float normal[3]);
 
+	/* Profiling API, adds scopes from C and Objective-C code (for example the render phases) to the profile tree and the recorded timeline of the calling thread */
+	/* the names must be static strings, the pointers are stored */
+
+	extern	void	plProfileBegin(const char* name);
+	extern	void	plProfileEnd();
+	extern	void	plProfileSetThreadName(const char* name);
+	extern	void	plProfileSetEventRecording(int enable, int eventsPerThread);
+	extern	int		plProfileWriteChromeTrace(const char* fileName);
+
 #ifdef __cplusplus
 }
 #endif
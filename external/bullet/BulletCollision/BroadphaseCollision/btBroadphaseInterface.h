@@ -21,6 +21,7 @@ subject to the following restrictions:
 struct btDispatcherInfo;
 class btDispatcher;
 #include "btBroadphaseProxy.h"
+#include "btRayPacket.h"
 
 class btOverlappingPairCache;
 
@@ -43,6 +44,40 @@ struct	btBroadphaseRayCallback : public btBroadphaseAabbCallback
 	virtual ~btBroadphaseRayCallback() {}
 };
 
+///btBroadphaseRayPacketCallback is used by rayPacketTest to report the proxies that are hit by a packet of rays
+struct	btBroadphaseRayPacketCallback
+{
+	///the packet is read while the broadphase is traversed, so process can shorten rays and clear bits of m_activeMask
+	btRayPacket	m_packet;
+
+	virtual ~btBroadphaseRayPacketCallback() {}
+
+	///process is called with the rays of the packet that hit the proxy aabb
+	virtual void	process(const btBroadphaseProxy* proxy,unsigned int rayMask) = 0;
+};
+
+///btBroadphaseRayPacketAabbTester implements rayPacketTest using the aabbTest of a broadphase
+struct	btBroadphaseRayPacketAabbTester : public btBroadphaseAabbCallback
+{
+	btBroadphaseRayPacketCallback&	m_packetCallback;
+
+	btBroadphaseRayPacketAabbTester(btBroadphaseRayPacketCallback& packetCallback)
+		:m_packetCallback(packetCallback)
+	{
+	}
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		const btRayPacket& packet = m_packetCallback.m_packet;
+		unsigned int rayMask = packet.testAabb(proxy->m_aabbMin,proxy->m_aabbMax,packet.m_activeMask);
+		if (rayMask)
+		{
+			m_packetCallback.process(proxy,rayMask);
+		}
+		return true;
+	}
+};
+
 #include "LinearMath/btVector3.h"
 
 ///The btBroadphaseInterface class provides an interface to detect aabb-overlapping object pairs.
@@ -62,6 +97,31 @@ public:
 
 	virtual void	aabbTest(const btVector3& aabbMin, const btVector3& aabbMax, btBroadphaseAabbCallback& callback) = 0;
 
+	///rayPacketTest reports the proxies hit by any active ray of callback.m_packet. The default implementation tests the proxies that overlap the bounds of the packet.
+	virtual void	rayPacketTest(btBroadphaseRayPacketCallback& callback)
+	{
+		const btRayPacket& packet = callback.m_packet;
+		btVector3 packetMin(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+		btVector3 packetMax(-btScalar(BT_LARGE_FLOAT),-btScalar(BT_LARGE_FLOAT),-btScalar(BT_LARGE_FLOAT));
+		for (int i=0;i<packet.m_numRays;i++)
+		{
+			if (packet.m_activeMask & (1u<<i))
+			{
+				btVector3 rayFrom = packet.getRayFrom(i);
+				btVector3 rayTo = rayFrom + (packet.getRayTo(i)-rayFrom)*packet.m_maxFraction[i];
+				packetMin.setMin(rayFrom);
+				packetMin.setMin(rayTo);
+				packetMax.setMax(rayFrom);
+				packetMax.setMax(rayTo);
+			}
+		}
+		if (packet.m_activeMask)
+		{
+			btBroadphaseRayPacketAabbTester tester(callback);
+			aabbTest(packetMin,packetMax,tester);
+		}
+	}
+
 	///calculateOverlappingPairs is optional: incremental algorithms (sweep and prune) might do it during the set aabb
 	virtual void	calculateOverlappingPairs(btDispatcher* dispatcher)=0;
 
@@ -276,6 +276,56 @@ void	btDbvtBroadphase::aabbTest(const btVector3& aabbMin,const btVector3& aabbMa
 
 }
 
+//the packet traversal recurses, unlike rayTestInternal it uses no shared stack, so several threads can trace packets at the same time
+static void	btRayPacketTestNode(const btDbvtNode* node,unsigned int rayMask,btBroadphaseRayPacketCallback& callback)
+{
+	if(node->isleaf())
+	{
+		callback.process((btDbvtProxy*)node->data,rayMask);
+		return;
+	}
+	const btRayPacket&	packet=callback.m_packet;
+	btScalar			entry[2];
+	unsigned int		childMask[2];
+	childMask[0]=packet.testAabb(node->childs[0]->volume.Mins(),node->childs[0]->volume.Maxs(),rayMask,&entry[0]);
+	childMask[1]=packet.testAabb(node->childs[1]->volume.Mins(),node->childs[1]->volume.Maxs(),rayMask,&entry[1]);
+	const int			first=(entry[1]<entry[0])?1:0;
+	if(childMask[first])
+	{
+		btRayPacketTestNode(node->childs[first],childMask[first],callback);
+	}
+	if(childMask[1-first])
+	{
+		const btDbvtNode*	second=node->childs[1-first];
+		//hits found in the nearer child may have shortened or finished some rays
+		if(childMask[first])
+		{
+			childMask[1-first]=packet.testAabb(second->volume.Mins(),second->volume.Maxs(),childMask[1-first]&packet.m_activeMask);
+		}
+		if(childMask[1-first])
+		{
+			btRayPacketTestNode(second,childMask[1-first],callback);
+		}
+	}
+}
+
+void	btDbvtBroadphase::rayPacketTest(btBroadphaseRayPacketCallback& callback)
+{
+	const btRayPacket&	packet=callback.m_packet;
+	for(int i=0;i<2;++i)
+	{
+		const btDbvtNode*	root=m_sets[i].m_root;
+		if(root)
+		{
+			unsigned int	rayMask=packet.testAabb(root->volume.Mins(),root->volume.Maxs(),packet.m_activeMask);
+			if(rayMask)
+			{
+				btRayPacketTestNode(root,rayMask,callback);
+			}
+		}
+	}
+}
+
 
 
 //
@@ -27,6 +27,7 @@ class btOverlappingPairCache;
 
 class btPersistentManifold;
 class btStackAlloc;
+class btManifoldRestoreCallback;
 
 struct btDispatcherInfo
 {
@@ -49,7 +50,10 @@ struct btDispatcherInfo
 		m_useConvexConservativeDistanceUtil(false),
 		m_convexConservativeDistanceThreshold(0.0f),
 		m_convexMaxDistanceUseCPT(false),
-		m_stackAllocator(0)
+		m_useSpeculativeContacts(false),
+		m_deterministic(false),
+		m_stackAllocator(0),
+		m_manifoldRestoreCallback(0)
 	{
 
 	}
@@ -66,7 +70,13 @@ struct btDispatcherInfo
 	bool		m_useConvexConservativeDistanceUtil;
 	btScalar	m_convexConservativeDistanceThreshold;
 	bool		m_convexMaxDistanceUseCPT;
+	///keep contacts with positive distance up to the predicted approach of both objects, see btManifoldResult::updateSpeculativeDistance
+	bool		m_useSpeculativeContacts;
+	///collision algorithms only keep state that follows from the current transforms and contact points, see btDiscreteDynamicsWorld::setDeterministic
+	bool		m_deterministic;
 	btStackAlloc*	m_stackAllocator;
+	///when set, every new persistent manifold is passed to this callback once it is bound, see btManifoldResult::setPersistentManifold
+	btManifoldRestoreCallback*	m_manifoldRestoreCallback;
 };
 
 ///The btDispatcher interface class can be used in combination with broadphase to dispatch calculations for overlapping pairs.
@@ -18,9 +18,104 @@ subject to the following restrictions:
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btTaskPool.h"
 
 #define RAYAABB2
 
+///maximum number of bins used by the binned SAH builders
+#define BT_BVH_MAX_BINS 32
+///deeper nodes use a balanced split instead of the SAH split, this bounds the recursion depth for degenerate meshes
+#define BT_BVH_MAX_SAH_DEPTH 48
+///trees with fewer leaves are built on the calling thread only
+#define BT_BVH_MIN_THREADED_LEAVES 16384
+
+///btBvhBuildPrimitive is a temporary copy of the leaf AABB, so the SAH builders can partition it without touching the leaf nodes
+struct btBvhBuildPrimitive
+{
+	btScalar	m_aabbMin[3];
+	btScalar	m_aabbMax[3];
+	int			m_leafIndex;
+};
+
+///btBvhBuildBounds is the AABB of a range of primitives, and the bounds of their (doubled) centers
+struct btBvhBuildBounds
+{
+	btScalar	m_aabbMin[3];
+	btScalar	m_aabbMax[3];
+	btScalar	m_centerMin[3];
+	btScalar	m_centerMax[3];
+
+	void	setEmpty()
+	{
+		for (int axis=0;axis<3;axis++)
+		{
+			m_aabbMin[axis] = m_centerMin[axis] = btScalar(BT_LARGE_FLOAT);
+			m_aabbMax[axis] = m_centerMax[axis] = btScalar(-BT_LARGE_FLOAT);
+		}
+	}
+
+	void	merge(const btBvhBuildPrimitive& primitive)
+	{
+		for (int axis=0;axis<3;axis++)
+		{
+			btScalar center = primitive.m_aabbMin[axis]+primitive.m_aabbMax[axis];
+			m_aabbMin[axis] = btMin(m_aabbMin[axis],primitive.m_aabbMin[axis]);
+			m_aabbMax[axis] = btMax(m_aabbMax[axis],primitive.m_aabbMax[axis]);
+			m_centerMin[axis] = btMin(m_centerMin[axis],center);
+			m_centerMax[axis] = btMax(m_centerMax[axis],center);
+		}
+	}
+
+	void	merge(const btBvhBuildBounds& other)
+	{
+		for (int axis=0;axis<3;axis++)
+		{
+			m_aabbMin[axis] = btMin(m_aabbMin[axis],other.m_aabbMin[axis]);
+			m_aabbMax[axis] = btMax(m_aabbMax[axis],other.m_aabbMax[axis]);
+			m_centerMin[axis] = btMin(m_centerMin[axis],other.m_centerMin[axis]);
+			m_centerMax[axis] = btMax(m_centerMax[axis],other.m_centerMax[axis]);
+		}
+	}
+
+	btScalar	getHalfArea() const
+	{
+		btScalar dx = m_aabbMax[0]-m_aabbMin[0];
+		btScalar dy = m_aabbMax[1]-m_aabbMin[1];
+		btScalar dz = m_aabbMax[2]-m_aabbMin[2];
+		return dx*dy+dy*dz+dz*dx;
+	}
+
+	int		getWidestCenterAxis() const
+	{
+		btScalar dx = m_centerMax[0]-m_centerMin[0];
+		btScalar dy = m_centerMax[1]-m_centerMin[1];
+		btScalar dz = m_centerMax[2]-m_centerMin[2];
+		return dx < dy ? (dy < dz ? 2 : 1) : (dx < dz ? 2 : 0);
+	}
+};
+
+///btBvhBuildTask describes a subtree, it writes into the node range [m_nodeIndex,m_nodeIndex+2*(m_endIndex-m_startIndex)-1)
+///Subtrees that are deferred during a threaded build are picked up by the build threads.
+struct btBvhBuildTask
+{
+	int	m_startIndex;
+	int	m_endIndex;
+	int	m_nodeIndex;
+	int	m_depth;
+	btBvhBuildBounds	m_bounds;
+};
+
+struct btBvhBuildContext
+{
+	btBvhBuildPrimitive*	m_primitives;
+	int						m_numBins;
+	bool					m_allAxes;
+
+	btQuantizedBvh*			m_bvh;
+	const btBvhBuildTask*	m_tasks;
+	int						m_maxTaskSize;
+};
+
 btQuantizedBvh::btQuantizedBvh() : 
 					m_bulletVersion(BT_BULLET_VERSION),
 					m_useQuantization(false), 
@@ -37,7 +132,7 @@ btQuantizedBvh::btQuantizedBvh() :
 
 
 
-void btQuantizedBvh::buildInternal()
+void btQuantizedBvh::buildInternal(btBuildMode buildMode)
 {
 	///assumes that caller filled in the m_quantizedLeafNodes
 	m_useQuantization = true;
@@ -52,9 +147,7 @@ void btQuantizedBvh::buildInternal()
 
 	}
 
-	m_curNodeIndex = 0;
-
-	buildTree(0,numLeafNodes);
+	buildTreeNodes(numLeafNodes,buildMode);
 
 	///if the entire tree is small then subtree size, we need to create a header info for the tree
 	if(m_useQuantization && !m_SubtreeHeaders.size())
@@ -310,6 +403,328 @@ int	btQuantizedBvh::calcSplittingAxis(int startIndex,int endIndex)
 
 
 
+class btBvhBuildTaskSortPredicate
+{
+	public:
+
+		bool operator() ( const btBvhBuildTask& a, const btBvhBuildTask& b ) const
+		{
+			return (a.m_endIndex-a.m_startIndex) > (b.m_endIndex-b.m_startIndex);
+		}
+};
+
+static SIMD_FORCE_INLINE void btBvhSwapPrimitives(btBvhBuildPrimitive* primitives,int i,int j)
+{
+	btBvhBuildPrimitive tmp = primitives[i];
+	primitives[i] = primitives[j];
+	primitives[j] = tmp;
+}
+
+static void btBvhCalculateBounds(const btBvhBuildPrimitive* primitives,int startIndex,int endIndex,btBvhBuildBounds& bounds)
+{
+	bounds.setEmpty();
+	for (int i=startIndex;i<endIndex;i++)
+	{
+		bounds.merge(primitives[i]);
+	}
+}
+
+///btBvhPartitionBinnedSah sorts the primitives into bins along the candidate axes, and partitions them at the bin boundary with the lowest surface area cost.
+///The bounds of both sides are merged from the bins, so every node only takes one binning and one partitioning pass. Returns -1 if the centers cannot be separated.
+static int btBvhPartitionBinnedSah(btBvhBuildPrimitive* primitives,const btBvhBuildTask& subtree,int maxBins,bool allAxes,btBvhBuildBounds& leftBounds,btBvhBuildBounds& rightBounds)
+{
+	const btBvhBuildBounds& bounds = subtree.m_bounds;
+	//small ranges don't need more bins than primitives
+	int numBins = btMin(maxBins,subtree.m_endIndex-subtree.m_startIndex);
+
+	int bestAxis = -1;
+	int bestBin = -1;
+	btScalar bestScale = btScalar(0.);
+	btScalar bestCost = btScalar(BT_LARGE_FLOAT);
+
+	int firstAxis = 0;
+	int lastAxis = 2;
+	if (!allAxes)
+	{
+		firstAxis = lastAxis = bounds.getWidestCenterAxis();
+	}
+
+	int binCount[3][BT_BVH_MAX_BINS];
+	btBvhBuildBounds binBounds[3][BT_BVH_MAX_BINS];
+
+	for (int axis=firstAxis;axis<=lastAxis;axis++)
+	{
+		btScalar extent = bounds.m_centerMax[axis]-bounds.m_centerMin[axis];
+		if (!(extent > btScalar(0.)))
+			continue;
+		btScalar scale = btScalar(numBins)*(btScalar(1.)-SIMD_EPSILON)/extent;
+
+		int* count = binCount[axis];
+		btBvhBuildBounds* bins = binBounds[axis];
+		int b;
+		for (b=0;b<numBins;b++)
+		{
+			count[b] = 0;
+			bins[b].setEmpty();
+		}
+
+		for (int i=subtree.m_startIndex;i<subtree.m_endIndex;i++)
+		{
+			const btBvhBuildPrimitive& primitive = primitives[i];
+			int bin = int((primitive.m_aabbMin[axis]+primitive.m_aabbMax[axis]-bounds.m_centerMin[axis])*scale);
+			bin = btMin(btMax(bin,0),numBins-1);
+			count[bin]++;
+			bins[bin].merge(primitive);
+		}
+
+		//sweep from the right to find the area and count of the right side of every split
+		btScalar rightArea[BT_BVH_MAX_BINS];
+		int rightCount[BT_BVH_MAX_BINS];
+		btBvhBuildBounds accum;
+		accum.setEmpty();
+		int accumCount = 0;
+		for (b=numBins-1;b>0;b--)
+		{
+			accumCount += count[b];
+			accum.merge(bins[b]);
+			rightCount[b] = accumCount;
+			rightArea[b] = accumCount ? accum.getHalfArea() : btScalar(0.);
+		}
+
+		//sweep from the left and evaluate the cost of splitting after bin b
+		accum.setEmpty();
+		accumCount = 0;
+		for (b=0;b<numBins-1;b++)
+		{
+			accumCount += count[b];
+			accum.merge(bins[b]);
+			if (!accumCount || !rightCount[b+1])
+				continue;
+			btScalar cost = accum.getHalfArea()*btScalar(accumCount) + rightArea[b+1]*btScalar(rightCount[b+1]);
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestAxis = axis;
+				bestBin = b;
+				bestScale = scale;
+			}
+		}
+	}
+
+	if (bestAxis < 0)
+		return -1;
+
+	leftBounds.setEmpty();
+	rightBounds.setEmpty();
+	for (int b=0;b<numBins;b++)
+	{
+		if (b <= bestBin)
+			leftBounds.merge(binBounds[bestAxis][b]);
+		else
+			rightBounds.merge(binBounds[bestAxis][b]);
+	}
+
+	int i = subtree.m_startIndex;
+	int j = subtree.m_endIndex-1;
+	while (i <= j)
+	{
+		const btBvhBuildPrimitive& primitive = primitives[i];
+		int bin = int((primitive.m_aabbMin[bestAxis]+primitive.m_aabbMax[bestAxis]-bounds.m_centerMin[bestAxis])*bestScale);
+		bin = btMin(btMax(bin,0),numBins-1);
+		if (bin <= bestBin)
+		{
+			i++;
+		} else
+		{
+			btBvhSwapPrimitives(primitives,i,j);
+			j--;
+		}
+	}
+	return i;
+}
+
+///btBvhPartitionBalanced is the fallback split, similar to sortAndCalcSplittingIndex it never creates a child with less than a third of the primitives
+static int btBvhPartitionBalanced(btBvhBuildPrimitive* primitives,const btBvhBuildTask& subtree,btBvhBuildBounds& leftBounds,btBvhBuildBounds& rightBounds)
+{
+	int startIndex = subtree.m_startIndex;
+	int endIndex = subtree.m_endIndex;
+	int numIndices = endIndex-startIndex;
+	int axis = subtree.m_bounds.getWidestCenterAxis();
+	btScalar splitValue = btScalar(0.5)*(subtree.m_bounds.m_centerMin[axis]+subtree.m_bounds.m_centerMax[axis]);
+
+	int splitIndex = startIndex;
+	for (int i=startIndex;i<endIndex;i++)
+	{
+		if (primitives[i].m_aabbMin[axis]+primitives[i].m_aabbMax[axis] > splitValue)
+		{
+			btBvhSwapPrimitives(primitives,i,splitIndex);
+			splitIndex++;
+		}
+	}
+
+	int rangeBalancedIndices = numIndices/3;
+	bool unbalanced = ((splitIndex<=(startIndex+rangeBalancedIndices)) || (splitIndex >=(endIndex-1-rangeBalancedIndices)));
+	if (unbalanced)
+	{
+		splitIndex = startIndex+ (numIndices>>1);
+	}
+
+	btBvhCalculateBounds(primitives,startIndex,splitIndex,leftBounds);
+	btBvhCalculateBounds(primitives,splitIndex,endIndex,rightBounds);
+	return splitIndex;
+}
+
+void	btQuantizedBvh::buildTreeNodes(int numLeafNodes,btBuildMode buildMode)
+{
+	if (buildMode == BUILD_MEAN_SPLIT)
+	{
+		m_curNodeIndex = 0;
+		buildTree(0,numLeafNodes);
+	} else
+	{
+		buildTreeBinnedSah(numLeafNodes,buildMode);
+	}
+}
+
+void	btQuantizedBvh::buildTreeBinnedSah(int numLeafNodes,btBuildMode buildMode)
+{
+	btAssert(numLeafNodes>0);
+
+	btAlignedObjectArray<btBvhBuildPrimitive> primitives;
+	primitives.resize(numLeafNodes);
+	for (int i=0;i<numLeafNodes;i++)
+	{
+		btVector3 aabbMin = getAabbMin(i);
+		btVector3 aabbMax = getAabbMax(i);
+		btBvhBuildPrimitive& primitive = primitives[i];
+		for (int axis=0;axis<3;axis++)
+		{
+			primitive.m_aabbMin[axis] = aabbMin[axis];
+			primitive.m_aabbMax[axis] = aabbMax[axis];
+		}
+		primitive.m_leafIndex = i;
+	}
+
+	btBvhBuildContext context;
+	context.m_primitives = &primitives[0];
+	context.m_numBins = (buildMode == BUILD_BINNED_SAH_QUALITY) ? BT_BVH_MAX_BINS : 8;
+	context.m_allAxes = (buildMode == BUILD_BINNED_SAH_QUALITY);
+	context.m_bvh = this;
+	context.m_tasks = 0;
+	context.m_maxTaskSize = 0;
+
+	btBvhBuildTask root;
+	root.m_startIndex = 0;
+	root.m_endIndex = numLeafNodes;
+	root.m_nodeIndex = 0;
+	root.m_depth = 0;
+	btBvhCalculateBounds(context.m_primitives,0,numLeafNodes,root.m_bounds);
+
+	int numThreads = (numLeafNodes >= BT_BVH_MIN_THREADED_LEAVES) ? btGetTaskThreadCount() : 1;
+	if (numThreads > 1)
+	{
+		//build the top of the tree on this thread, and defer subtrees of at most m_maxTaskSize leaves
+		context.m_maxTaskSize = btMax(numLeafNodes/(numThreads*8),BT_BVH_MIN_THREADED_LEAVES/16);
+		btAlignedObjectArray<btBvhBuildTask> tasks;
+		buildSubtreeBinnedSah(context,root,&tasks);
+
+		if (tasks.size())
+		{
+			//largest subtrees first, for better load balancing
+			tasks.quickSort(btBvhBuildTaskSortPredicate());
+			context.m_tasks = &tasks[0];
+			btParallelFor(tasks.size(),buildTask,&context,numThreads);
+		}
+	} else
+	{
+		buildSubtreeBinnedSah(context,root,0);
+	}
+
+	m_curNodeIndex = 2*numLeafNodes-1;
+
+	if (m_useQuantization)
+	{
+		buildSubtreeHeaders(0);
+	}
+}
+
+void	btQuantizedBvh::buildTask(void* userPtr, int taskIndex)
+{
+	BT_ALLOC_TAG(BT_ALLOC_TAG_SHAPES);
+	btBvhBuildContext& context = *(btBvhBuildContext*)userPtr;
+	context.m_bvh->buildSubtreeBinnedSah(context,context.m_tasks[taskIndex],0);
+}
+
+///buildSubtreeBinnedSah writes the subtree into 2*(m_endIndex-m_startIndex)-1 nodes starting at m_nodeIndex.
+///Subtrees don't share any nodes, so they can be built in parallel.
+void	btQuantizedBvh::buildSubtreeBinnedSah(btBvhBuildContext& context,const btBvhBuildTask& subtree,btAlignedObjectArray<btBvhBuildTask>* deferredTasks)
+{
+	btBvhBuildPrimitive* primitives = context.m_primitives;
+	int numIndices = subtree.m_endIndex-subtree.m_startIndex;
+	btAssert(numIndices>0);
+
+	if (numIndices==1)
+	{
+		assignInternalNodeFromLeafNode(subtree.m_nodeIndex,primitives[subtree.m_startIndex].m_leafIndex);
+		return;
+	}
+
+	if (deferredTasks && numIndices <= context.m_maxTaskSize)
+	{
+		deferredTasks->push_back(subtree);
+		return;
+	}
+
+	const btBvhBuildBounds& bounds = subtree.m_bounds;
+	setInternalNodeAabbMin(subtree.m_nodeIndex,btVector3(bounds.m_aabbMin[0],bounds.m_aabbMin[1],bounds.m_aabbMin[2]));
+	setInternalNodeAabbMax(subtree.m_nodeIndex,btVector3(bounds.m_aabbMax[0],bounds.m_aabbMax[1],bounds.m_aabbMax[2]));
+	setInternalNodeEscapeIndex(subtree.m_nodeIndex,2*numIndices-1);
+
+	btBvhBuildTask left;
+	btBvhBuildTask right;
+	int splitIndex = -1;
+	if (subtree.m_depth < BT_BVH_MAX_SAH_DEPTH)
+	{
+		splitIndex = btBvhPartitionBinnedSah(primitives,subtree,context.m_numBins,context.m_allAxes,left.m_bounds,right.m_bounds);
+	}
+	if (splitIndex <= subtree.m_startIndex || splitIndex >= subtree.m_endIndex)
+	{
+		splitIndex = btBvhPartitionBalanced(primitives,subtree,left.m_bounds,right.m_bounds);
+	}
+
+	//the left subtree of n leaves takes 2n-1 nodes, the right subtree follows it
+	left.m_startIndex = subtree.m_startIndex;
+	left.m_endIndex = splitIndex;
+	left.m_nodeIndex = subtree.m_nodeIndex+1;
+	left.m_depth = subtree.m_depth+1;
+	right.m_startIndex = splitIndex;
+	right.m_endIndex = subtree.m_endIndex;
+	right.m_nodeIndex = subtree.m_nodeIndex+2*(splitIndex-subtree.m_startIndex);
+	right.m_depth = subtree.m_depth+1;
+
+	buildSubtreeBinnedSah(context,left,deferredTasks);
+	buildSubtreeBinnedSah(context,right,deferredTasks);
+}
+
+///buildSubtreeHeaders adds the same subtree headers as buildTree does, once all nodes are known
+void	btQuantizedBvh::buildSubtreeHeaders(int nodeIndex)
+{
+	const btQuantizedBvhNode& node = m_quantizedContiguousNodes[nodeIndex];
+	if (node.isLeafNode())
+		return;
+	if (node.getEscapeIndex()*int(sizeof(btQuantizedBvhNode)) <= MAX_SUBTREE_SIZE_IN_BYTES)
+		return;
+
+	int leftChildNodexIndex = nodeIndex+1;
+	const btQuantizedBvhNode& leftChildNode = m_quantizedContiguousNodes[leftChildNodexIndex];
+	int rightChildNodexIndex = leftChildNodexIndex + (leftChildNode.isLeafNode() ? 1 : leftChildNode.getEscapeIndex());
+
+	buildSubtreeHeaders(leftChildNodexIndex);
+	buildSubtreeHeaders(rightChildNodexIndex);
+	updateSubtreeHeaders(leftChildNodexIndex,rightChildNodexIndex);
+}
+
+
 void	btQuantizedBvh::reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const
 {
 	//either choose recursive traversal (walkTree) or stackless (walkStacklessTree)
@@ -787,6 +1202,46 @@ void	btQuantizedBvh::reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCa
 }
 
 
+static SIMD_FORCE_INLINE btScalar btBvhSurfaceArea(const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	btVector3 extent = aabbMax-aabbMin;
+	return extent.getX()*extent.getY()+extent.getY()*extent.getZ()+extent.getZ()*extent.getX();
+}
+
+btScalar	btQuantizedBvh::calculateSahCost() const
+{
+	if (m_curNodeIndex < 1)
+		return btScalar(0.);
+
+	btScalar rootArea;
+	btScalar totalArea = btScalar(0.);
+	int i;
+	if (m_useQuantization)
+	{
+		const btQuantizedBvhNode* nodes = &m_quantizedContiguousNodes[0];
+		rootArea = btBvhSurfaceArea(unQuantize(nodes[0].m_quantizedAabbMin),unQuantize(nodes[0].m_quantizedAabbMax));
+		for (i=0;i<m_curNodeIndex;i++)
+		{
+			if (!nodes[i].isLeafNode())
+			{
+				totalArea += btBvhSurfaceArea(unQuantize(nodes[i].m_quantizedAabbMin),unQuantize(nodes[i].m_quantizedAabbMax));
+			}
+		}
+	} else
+	{
+		const btOptimizedBvhNode* nodes = &m_contiguousNodes[0];
+		rootArea = btBvhSurfaceArea(nodes[0].m_aabbMinOrg,nodes[0].m_aabbMaxOrg);
+		for (i=0;i<m_curNodeIndex;i++)
+		{
+			if (nodes[i].m_escapeIndex != -1)
+			{
+				totalArea += btBvhSurfaceArea(nodes[i].m_aabbMinOrg,nodes[i].m_aabbMaxOrg);
+			}
+		}
+	}
+	return rootArea > SIMD_EPSILON ? totalArea/rootArea : btScalar(0.);
+}
+
 void	btQuantizedBvh::swapLeafNodes(int i,int splitIndex)
 {
 	if (m_useQuantization)
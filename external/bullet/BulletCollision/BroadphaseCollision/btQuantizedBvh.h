@@ -79,7 +79,7 @@ ATTRIBUTE_ALIGNED16	(struct) btQuantizedBvhNode
 	{
 		btAssert(isLeafNode());
 		// Get only the lower bits where the triangle index is stored
-		return (m_escapeIndexOrTriangleIndex&~((~0)<<(31-MAX_NUM_PARTS_IN_BITS)));
+		return (m_escapeIndexOrTriangleIndex&~((~0u)<<(31-MAX_NUM_PARTS_IN_BITS)));
 	}
 	int	getPartId() const
 	{
@@ -147,6 +147,9 @@ public:
 ;
 
 
+struct btBvhBuildTask;
+struct btBvhBuildContext;
+
 class btNodeOverlapCallback
 {
 public:
@@ -179,6 +182,14 @@ public:
 		TRAVERSAL_RECURSIVE
 	};
 
+	///btBuildMode chooses between build speed and tree quality. BUILD_MEAN_SPLIT is the default, the opt-in binned SAH builders give faster queries and split the work across threads for large trees.
+	enum btBuildMode
+	{
+		BUILD_MEAN_SPLIT = 0,		//split at the mean of the axis with largest variance
+		BUILD_BINNED_SAH_FAST,		//surface area heuristic, 8 bins along the widest axis
+		BUILD_BINNED_SAH_QUALITY	//surface area heuristic, 32 bins along all three axes
+	};
+
 protected:
 
 
@@ -306,6 +317,16 @@ protected:
 	int	calcSplittingAxis(int startIndex,int endIndex);
 
 	int	sortAndCalcSplittingIndex(int startIndex,int endIndex,int splitAxis);
+
+	void	buildTreeNodes(int numLeafNodes,btBuildMode buildMode);
+
+	void	buildTreeBinnedSah(int numLeafNodes,btBuildMode buildMode);
+
+	void	buildSubtreeBinnedSah(btBvhBuildContext& context,const btBvhBuildTask& subtree,btAlignedObjectArray<btBvhBuildTask>* deferredTasks);
+
+	void	buildSubtreeHeaders(int nodeIndex);
+
+	static void	buildTask(void* userPtr, int taskIndex);
 	
 	void	walkStacklessTree(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
@@ -340,13 +361,17 @@ public:
 	void	setQuantizationValues(const btVector3& bvhAabbMin,const btVector3& bvhAabbMax,btScalar quantizationMargin=btScalar(1.0));
 	QuantizedNodeArray&	getLeafNodeArray() {			return	m_quantizedLeafNodes;	}
 	///buildInternal is expert use only: assumes that setQuantizationValues and LeafNodeArray are initialized
-	void	buildInternal();
+	void	buildInternal(btBuildMode buildMode=BUILD_MEAN_SPLIT);
 	///***************************************** expert/internal use only *************************
 
 	void	reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 	void	reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget) const;
 	void	reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin,const btVector3& aabbMax) const;
 
+	///calculateSahCost returns the summed surface area of the internal nodes relative to the root, the expected number of nodes a random ray visits.
+	///It grows when a refit makes the nodes overlap more, and can be used to decide when a tree needs to be rebuilt.
+	btScalar	calculateSahCost() const;
+
 		SIMD_FORCE_INLINE void quantize(unsigned short* out, const btVector3& point,int isMax) const
 	{
 
@@ -438,6 +463,16 @@ public:
 			return vecOut;
 	}
 
+	const btVector3&	getBvhAabbMin() const
+	{
+		return m_bvhAabbMin;
+	}
+
+	const btVector3&	getQuantization() const
+	{
+		return m_bvhQuantization;
+	}
+
 	///setTraversalMode let's you choose between stackless, recursive or stackless cache friendly tree traversal. Note this is only implemented for quantized trees.
 	void	setTraversalMode(btTraversalMode	traversalMode)
 	{
@@ -450,6 +485,11 @@ public:
 		return	m_quantizedContiguousNodes;
 	}
 
+	SIMD_FORCE_INLINE const QuantizedNodeArray&	getQuantizedNodeArray() const
+	{	
+		return	m_quantizedContiguousNodes;
+	}
+
 
 	SIMD_FORCE_INLINE BvhSubtreeInfoArray&	getSubtreeInfoArray()
 	{
@@ -0,0 +1,136 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef BT_RAY_PACKET_H
+#define BT_RAY_PACKET_H
+
+#include "LinearMath/btVector3.h"
+#include "LinearMath/btTransform.h"
+#include "LinearMath/btMinMax.h"
+
+#define BT_RAY_PACKET_SIZE 4
+
+///btRayPacket holds up to BT_RAY_PACKET_SIZE ray segments as structure of arrays, so a box is tested against all rays with one loop per axis that compiles to SIMD code.
+///The ray parameter runs from 0 at the ray source to 1 at the ray target, so a box entry parameter can be compared with the hit fraction of the ray directly.
+struct btRayPacket
+{
+	btScalar	m_origin[3][BT_RAY_PACKET_SIZE];
+	btScalar	m_direction[3][BT_RAY_PACKET_SIZE];
+	btScalar	m_directionInverse[3][BT_RAY_PACKET_SIZE];
+	///boxes that a ray enters beyond its m_maxFraction are not reported for that ray, lower it when a closer hit is found
+	btScalar	m_maxFraction[BT_RAY_PACKET_SIZE];
+	int			m_numRays;
+	///bit i is set while ray i still needs to be traced
+	unsigned int	m_activeMask;
+
+	btRayPacket()
+		:m_numRays(0),
+		m_activeMask(0)
+	{
+		//unused lanes are tested as well, they never hit anything
+		for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+		{
+			for (int axis=0;axis<3;axis++)
+			{
+				m_origin[axis][i] = btScalar(0.);
+				m_direction[axis][i] = btScalar(0.);
+				m_directionInverse[axis][i] = btScalar(BT_LARGE_FLOAT);
+			}
+			m_maxFraction[i] = btScalar(-1.);
+		}
+	}
+
+	void	setRay(int i,const btVector3& rayFrom,const btVector3& rayTo,btScalar maxFraction=btScalar(1.))
+	{
+		btAssert(i < BT_RAY_PACKET_SIZE);
+		btVector3 direction = rayTo-rayFrom;
+		for (int axis=0;axis<3;axis++)
+		{
+			m_origin[axis][i] = rayFrom[axis];
+			m_direction[axis][i] = direction[axis];
+			///what about division by zero? --> just set rayDirection[i] to BT_LARGE_FLOAT
+			m_directionInverse[axis][i] = direction[axis] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / direction[axis];
+		}
+		m_maxFraction[i] = maxFraction;
+		m_numRays = btMax(m_numRays,i+1);
+		m_activeMask |= (1u<<i);
+	}
+
+	btVector3	getRayFrom(int i) const
+	{
+		return btVector3(m_origin[0][i],m_origin[1][i],m_origin[2][i]);
+	}
+
+	btVector3	getRayTo(int i) const
+	{
+		return btVector3(m_origin[0][i]+m_direction[0][i],m_origin[1][i]+m_direction[1][i],m_origin[2][i]+m_direction[2][i]);
+	}
+
+	///transformPacket stores the rays transformed by transform in packet, the ray parameters are unchanged
+	void	transformPacket(const btTransform& transform,btRayPacket& packet) const
+	{
+		packet.m_numRays = 0;
+		packet.m_activeMask = 0;
+		for (int i=0;i<m_numRays;i++)
+		{
+			packet.setRay(i,transform(getRayFrom(i)),transform(getRayTo(i)),m_maxFraction[i]);
+		}
+		packet.m_activeMask = m_activeMask;
+	}
+
+	///testAabb returns the rays of rayMask that enter the box before their m_maxFraction.
+	///If entryFraction is not null, it receives the smallest entry parameter of these rays.
+	unsigned int	testAabb(const btVector3& aabbMin,const btVector3& aabbMax,unsigned int rayMask,btScalar* entryFraction=0) const
+	{
+		btScalar tmin[BT_RAY_PACKET_SIZE];
+		btScalar tmax[BT_RAY_PACKET_SIZE];
+		int lane;
+		for (lane=0;lane<BT_RAY_PACKET_SIZE;lane++)
+		{
+			tmin[lane] = btScalar(0.);
+			tmax[lane] = m_maxFraction[lane];
+		}
+		for (int axis=0;axis<3;axis++)
+		{
+			const btScalar boxMin = aabbMin[axis];
+			const btScalar boxMax = aabbMax[axis];
+			for (lane=0;lane<BT_RAY_PACKET_SIZE;lane++)
+			{
+				btScalar t0 = (boxMin - m_origin[axis][lane]) * m_directionInverse[axis][lane];
+				btScalar t1 = (boxMax - m_origin[axis][lane]) * m_directionInverse[axis][lane];
+				tmin[lane] = btMax(tmin[lane],btMin(t0,t1));
+				tmax[lane] = btMin(tmax[lane],btMax(t0,t1));
+			}
+		}
+		unsigned int hitMask = 0;
+		btScalar entry = btScalar(BT_LARGE_FLOAT);
+		for (lane=0;lane<m_numRays;lane++)
+		{
+			if ((rayMask & (1u<<lane)) && tmin[lane] <= tmax[lane])
+			{
+				hitMask |= (1u<<lane);
+				entry = btMin(entry,tmin[lane]);
+			}
+		}
+		if (entryFraction)
+		{
+			*entryFraction = entry;
+		}
+		return hitMask;
+	}
+};
+
+#endif //BT_RAY_PACKET_H
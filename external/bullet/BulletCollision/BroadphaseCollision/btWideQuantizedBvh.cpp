@@ -0,0 +1,651 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btWideQuantizedBvh.h"
+
+#include "LinearMath/btAabbUtil2.h"
+
+#include <string.h>
+
+#if defined (__ARM_NEON__)
+#include <arm_neon.h>
+#elif defined (BT_USE_SSE)
+#include <emmintrin.h>
+#endif
+
+
+///returns a bit mask of the children of the wide node that overlap the quantized query AABB
+static SIMD_FORCE_INLINE unsigned	testQuantizedAabbAgainstWideNode(const unsigned short int* quantizedQueryAabbMin,const unsigned short int* quantizedQueryAabbMax,const btWideQuantizedBvhNode& node)
+{
+#if defined (__ARM_NEON__)
+	uint16x4_t overlap = vand_u16(
+		vcle_u16(vdup_n_u16(quantizedQueryAabbMin[0]),vld1_u16(node.m_quantizedAabbMax[0])),
+		vcge_u16(vdup_n_u16(quantizedQueryAabbMax[0]),vld1_u16(node.m_quantizedAabbMin[0])));
+	overlap = vand_u16(overlap,vand_u16(
+		vcle_u16(vdup_n_u16(quantizedQueryAabbMin[1]),vld1_u16(node.m_quantizedAabbMax[1])),
+		vcge_u16(vdup_n_u16(quantizedQueryAabbMax[1]),vld1_u16(node.m_quantizedAabbMin[1]))));
+	overlap = vand_u16(overlap,vand_u16(
+		vcle_u16(vdup_n_u16(quantizedQueryAabbMin[2]),vld1_u16(node.m_quantizedAabbMax[2])),
+		vcge_u16(vdup_n_u16(quantizedQueryAabbMax[2]),vld1_u16(node.m_quantizedAabbMin[2]))));
+	static const unsigned short int laneBits[BT_WIDE_BVH_WIDTH] = {1,2,4,8};
+	uint16x4_t bits = vand_u16(overlap,vld1_u16(laneBits));
+	bits = vpadd_u16(bits,bits);
+	bits = vpadd_u16(bits,bits);
+	return vget_lane_u16(bits,0);
+#elif defined (BT_USE_SSE)
+	//SSE2 only has signed 16 bit compares, flip the sign bit to compare unsigned values
+	const __m128i signBit = _mm_set1_epi16((short)0x8000);
+	__m128i queryMin01 = _mm_xor_si128(_mm_set_epi16(
+		quantizedQueryAabbMin[1],quantizedQueryAabbMin[1],quantizedQueryAabbMin[1],quantizedQueryAabbMin[1],
+		quantizedQueryAabbMin[0],quantizedQueryAabbMin[0],quantizedQueryAabbMin[0],quantizedQueryAabbMin[0]),signBit);
+	__m128i queryMax01 = _mm_xor_si128(_mm_set_epi16(
+		quantizedQueryAabbMax[1],quantizedQueryAabbMax[1],quantizedQueryAabbMax[1],quantizedQueryAabbMax[1],
+		quantizedQueryAabbMax[0],quantizedQueryAabbMax[0],quantizedQueryAabbMax[0],quantizedQueryAabbMax[0]),signBit);
+	__m128i queryMin2 = _mm_xor_si128(_mm_set1_epi16(quantizedQueryAabbMin[2]),signBit);
+	__m128i queryMax2 = _mm_xor_si128(_mm_set1_epi16(quantizedQueryAabbMax[2]),signBit);
+
+	__m128i nodeMin01 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&node.m_quantizedAabbMin[0][0]),signBit);
+	__m128i nodeMax01 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)&node.m_quantizedAabbMax[0][0]),signBit);
+	__m128i nodeMin2 = _mm_xor_si128(_mm_loadl_epi64((const __m128i*)&node.m_quantizedAabbMin[2][0]),signBit);
+	__m128i nodeMax2 = _mm_xor_si128(_mm_loadl_epi64((const __m128i*)&node.m_quantizedAabbMax[2][0]),signBit);
+
+	__m128i separated01 = _mm_or_si128(_mm_cmpgt_epi16(queryMin01,nodeMax01),_mm_cmpgt_epi16(nodeMin01,queryMax01));
+	__m128i separated = _mm_or_si128(separated01,_mm_srli_si128(separated01,8));
+	separated = _mm_or_si128(separated,_mm_or_si128(_mm_cmpgt_epi16(queryMin2,nodeMax2),_mm_cmpgt_epi16(nodeMin2,queryMax2)));
+	unsigned separatedMask = unsigned(_mm_movemask_epi8(_mm_packs_epi16(separated,_mm_setzero_si128()))) & 0xf;
+	return (~separatedMask) & 0xf;
+#else
+	unsigned mask = 0;
+	for (int i=0;i<BT_WIDE_BVH_WIDTH;i++)
+	{
+		unsigned overlap = (quantizedQueryAabbMin[0] <= node.m_quantizedAabbMax[0][i]) & (quantizedQueryAabbMax[0] >= node.m_quantizedAabbMin[0][i])
+			& (quantizedQueryAabbMin[1] <= node.m_quantizedAabbMax[1][i]) & (quantizedQueryAabbMax[1] >= node.m_quantizedAabbMin[1][i])
+			& (quantizedQueryAabbMin[2] <= node.m_quantizedAabbMax[2][i]) & (quantizedQueryAabbMax[2] >= node.m_quantizedAabbMin[2][i]);
+		mask |= overlap << i;
+	}
+	return mask;
+#endif
+}
+
+
+///per ray constants of testRayAgainstWideNode. On every axis a child bound, unquantized, grown by the box cast extents and
+///relative to the ray source, is quantized*m_invQuantization+m_minBoundOffset for the minimum and +m_maxBoundOffset for the maximum
+struct	btWideRaySlabs
+{
+	btScalar	m_invQuantization[3];
+	btScalar	m_minBoundOffset[3];
+	btScalar	m_maxBoundOffset[3];
+	btScalar	m_invDirection[3];
+};
+
+#if defined (__ARM_NEON__) && !defined (BT_USE_DOUBLE_PRECISION)
+static SIMD_FORCE_INLINE void	computeWideSlab(const btWideRaySlabs& slabs,const btWideQuantizedBvhNode& node,int axis,float32x4_t& entry,float32x4_t& exit)
+{
+	float32x4_t quantizedMin = vcvtq_f32_u32(vmovl_u16(vld1_u16(node.m_quantizedAabbMin[axis])));
+	float32x4_t quantizedMax = vcvtq_f32_u32(vmovl_u16(vld1_u16(node.m_quantizedAabbMax[axis])));
+	float32x4_t t0 = vmulq_n_f32(vmlaq_n_f32(vdupq_n_f32(slabs.m_minBoundOffset[axis]),quantizedMin,slabs.m_invQuantization[axis]),slabs.m_invDirection[axis]);
+	float32x4_t t1 = vmulq_n_f32(vmlaq_n_f32(vdupq_n_f32(slabs.m_maxBoundOffset[axis]),quantizedMax,slabs.m_invQuantization[axis]),slabs.m_invDirection[axis]);
+	entry = vminq_f32(t0,t1);
+	exit = vmaxq_f32(t0,t1);
+}
+#elif defined (BT_USE_SSE)
+static SIMD_FORCE_INLINE void	computeWideSlab(const btWideRaySlabs& slabs,const btWideQuantizedBvhNode& node,int axis,__m128& entry,__m128& exit)
+{
+	const __m128i zero = _mm_setzero_si128();
+	__m128 quantizedMin = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)&node.m_quantizedAabbMin[axis][0]),zero));
+	__m128 quantizedMax = _mm_cvtepi32_ps(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)&node.m_quantizedAabbMax[axis][0]),zero));
+	__m128 invQuantization = _mm_set1_ps(slabs.m_invQuantization[axis]);
+	__m128 invDirection = _mm_set1_ps(slabs.m_invDirection[axis]);
+	__m128 t0 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(quantizedMin,invQuantization),_mm_set1_ps(slabs.m_minBoundOffset[axis])),invDirection);
+	__m128 t1 = _mm_mul_ps(_mm_add_ps(_mm_mul_ps(quantizedMax,invQuantization),_mm_set1_ps(slabs.m_maxBoundOffset[axis])),invDirection);
+	entry = _mm_min_ps(t0,t1);
+	exit = _mm_max_ps(t0,t1);
+}
+#endif
+
+///slab test of the ray against the four children of the wide node at once, the same test as btRayAabb2.
+///returns a bit mask of the children that the ray enters before lambdaMax, entryLambdas receives their entry distances
+static SIMD_FORCE_INLINE unsigned	testRayAgainstWideNode(const btWideRaySlabs& slabs,btScalar lambdaMax,const btWideQuantizedBvhNode& node,btScalar* entryLambdas)
+{
+#if defined (__ARM_NEON__) && !defined (BT_USE_DOUBLE_PRECISION)
+	float32x4_t entry,exit,axisEntry,axisExit;
+	computeWideSlab(slabs,node,0,entry,exit);
+	computeWideSlab(slabs,node,1,axisEntry,axisExit);
+	entry = vmaxq_f32(entry,axisEntry);
+	exit = vminq_f32(exit,axisExit);
+	computeWideSlab(slabs,node,2,axisEntry,axisExit);
+	entry = vmaxq_f32(entry,axisEntry);
+	exit = vminq_f32(exit,axisExit);
+	const float32x4_t zero = vdupq_n_f32(0.f);
+	uint32x4_t hit = vandq_u32(vcleq_f32(entry,exit),vandq_u32(vcltq_f32(entry,vdupq_n_f32(lambdaMax)),vcgtq_f32(exit,zero)));
+	//the ray may start inside the box
+	vst1q_f32(entryLambdas,vmaxq_f32(entry,zero));
+	static const unsigned int laneBits[BT_WIDE_BVH_WIDTH] = {1,2,4,8};
+	uint32x4_t bits = vandq_u32(hit,vld1q_u32(laneBits));
+	uint32x2_t sum = vadd_u32(vget_low_u32(bits),vget_high_u32(bits));
+	sum = vpadd_u32(sum,sum);
+	return vget_lane_u32(sum,0);
+#elif defined (BT_USE_SSE)
+	__m128 entry,exit,axisEntry,axisExit;
+	computeWideSlab(slabs,node,0,entry,exit);
+	computeWideSlab(slabs,node,1,axisEntry,axisExit);
+	entry = _mm_max_ps(entry,axisEntry);
+	exit = _mm_min_ps(exit,axisExit);
+	computeWideSlab(slabs,node,2,axisEntry,axisExit);
+	entry = _mm_max_ps(entry,axisEntry);
+	exit = _mm_min_ps(exit,axisExit);
+	const __m128 zero = _mm_setzero_ps();
+	__m128 hit = _mm_and_ps(_mm_cmple_ps(entry,exit),_mm_and_ps(_mm_cmplt_ps(entry,_mm_set1_ps(lambdaMax)),_mm_cmpgt_ps(exit,zero)));
+	//the ray may start inside the box
+	_mm_storeu_ps(entryLambdas,_mm_max_ps(entry,zero));
+	return unsigned(_mm_movemask_ps(hit));
+#else
+	unsigned mask = 0;
+	for (int i=0;i<BT_WIDE_BVH_WIDTH;i++)
+	{
+		btScalar entry = -SIMD_INFINITY;
+		btScalar exit = SIMD_INFINITY;
+		for (int axis=0;axis<3;axis++)
+		{
+			btScalar t0 = (btScalar(node.m_quantizedAabbMin[axis][i])*slabs.m_invQuantization[axis] + slabs.m_minBoundOffset[axis]) * slabs.m_invDirection[axis];
+			btScalar t1 = (btScalar(node.m_quantizedAabbMax[axis][i])*slabs.m_invQuantization[axis] + slabs.m_maxBoundOffset[axis]) * slabs.m_invDirection[axis];
+			btSetMax(entry,btMin(t0,t1));
+			btSetMin(exit,btMax(t0,t1));
+		}
+		unsigned hit = (entry <= exit) & (entry < lambdaMax) & (exit > btScalar(0.));
+		mask |= hit << i;
+		//the ray may start inside the box
+		entryLambdas[i] = btMax(entry,btScalar(0.));
+	}
+	return mask;
+#endif
+}
+
+
+btWideQuantizedBvh::btWideQuantizedBvh()
+:m_bvh(0),
+m_maxDepth(0)
+{
+}
+
+btWideQuantizedBvh::~btWideQuantizedBvh()
+{
+}
+
+bool	btWideQuantizedBvh::build(btQuantizedBvh* bvh)
+{
+	m_bvh = bvh;
+	m_wideNodes.resize(0);
+	m_binaryNodeIndices.resize(0);
+	m_maxDepth = 0;
+
+	if (!bvh->isQuantized())
+		return false;
+
+	QuantizedNodeArray& nodes = bvh->getQuantizedNodeArray();
+	if (!nodes.size())
+		return false;
+
+	int numNodes = nodes[0].isLeafNode() ? 1 : nodes[0].getEscapeIndex();
+	//every wide node absorbs at least one internal binary node
+	m_wideNodes.reserve(numNodes/2+1);
+	m_binaryNodeIndices.reserve((numNodes/2+1)*BT_WIDE_BVH_WIDTH);
+
+	collapseNode(&nodes[0],0,1);
+
+	if ((BT_WIDE_BVH_WIDTH-1)*m_maxDepth + BT_WIDE_BVH_WIDTH > BT_WIDE_BVH_STACK_SIZE)
+	{
+		m_wideNodes.clear();
+		m_binaryNodeIndices.clear();
+		return false;
+	}
+	return true;
+}
+
+bool	btWideQuantizedBvh::refit()
+{
+	if (!m_bvh || !m_wideNodes.size() || (m_binaryNodeIndices.size() != m_wideNodes.size()*BT_WIDE_BVH_WIDTH))
+		return false;
+
+	const QuantizedNodeArray& nodes = m_bvh->getQuantizedNodeArray();
+	for (int nodeIndex=0;nodeIndex<m_wideNodes.size();nodeIndex++)
+	{
+		btWideQuantizedBvhNode& wideNode = m_wideNodes[nodeIndex];
+		const int* binaryNodeIndices = &m_binaryNodeIndices[nodeIndex*BT_WIDE_BVH_WIDTH];
+		for (int i=0;i<BT_WIDE_BVH_WIDTH;i++)
+		{
+			if (binaryNodeIndices[i] < 0)
+				continue;
+			const btQuantizedBvhNode& child = nodes[binaryNodeIndices[i]];
+			for (int axis=0;axis<3;axis++)
+			{
+				wideNode.m_quantizedAabbMin[axis][i] = child.m_quantizedAabbMin[axis];
+				wideNode.m_quantizedAabbMax[axis][i] = child.m_quantizedAabbMax[axis];
+			}
+		}
+	}
+	return true;
+}
+
+///collapseNode turns a binary subtree into a wide node, by repeatedly opening the internal child with the largest AABB
+int	btWideQuantizedBvh::collapseNode(const btQuantizedBvhNode* nodes,int binaryNodeIndex,int depth)
+{
+	if (depth > m_maxDepth)
+		m_maxDepth = depth;
+
+	int children[BT_WIDE_BVH_WIDTH];
+	int numChildren = 0;
+
+	const btQuantizedBvhNode& binaryNode = nodes[binaryNodeIndex];
+	if (binaryNode.isLeafNode())
+	{
+		children[numChildren++] = binaryNodeIndex;
+	} else
+	{
+		int leftChild = binaryNodeIndex+1;
+		int rightChild = nodes[leftChild].isLeafNode() ? leftChild+1 : leftChild+nodes[leftChild].getEscapeIndex();
+		children[numChildren++] = leftChild;
+		children[numChildren++] = rightChild;
+
+		while (numChildren < BT_WIDE_BVH_WIDTH)
+		{
+			int bestChild = -1;
+			int bestSize = -1;
+			for (int i=0;i<numChildren;i++)
+			{
+				const btQuantizedBvhNode& child = nodes[children[i]];
+				if (child.isLeafNode())
+					continue;
+				int size = (child.m_quantizedAabbMax[0]-child.m_quantizedAabbMin[0])
+					+ (child.m_quantizedAabbMax[1]-child.m_quantizedAabbMin[1])
+					+ (child.m_quantizedAabbMax[2]-child.m_quantizedAabbMin[2]);
+				if (size > bestSize)
+				{
+					bestSize = size;
+					bestChild = i;
+				}
+			}
+			if (bestChild < 0)
+				break;
+
+			int openIndex = children[bestChild];
+			leftChild = openIndex+1;
+			rightChild = nodes[leftChild].isLeafNode() ? leftChild+1 : leftChild+nodes[leftChild].getEscapeIndex();
+			children[bestChild] = leftChild;
+			children[numChildren++] = rightChild;
+		}
+	}
+
+	int wideNodeIndex = m_wideNodes.size();
+	{
+		btWideQuantizedBvhNode& wideNode = m_wideNodes.expandNonInitializing();
+		for (int i=0;i<BT_WIDE_BVH_WIDTH;i++)
+		{
+			if (i < numChildren)
+			{
+				const btQuantizedBvhNode& child = nodes[children[i]];
+				for (int axis=0;axis<3;axis++)
+				{
+					wideNode.m_quantizedAabbMin[axis][i] = child.m_quantizedAabbMin[axis];
+					wideNode.m_quantizedAabbMax[axis][i] = child.m_quantizedAabbMax[axis];
+				}
+				wideNode.m_childIndexOrTriangleIndex[i] = child.isLeafNode() ? child.m_escapeIndexOrTriangleIndex : BT_WIDE_BVH_EMPTY_CHILD;
+				m_binaryNodeIndices.push_back(children[i]);
+			} else
+			{
+				for (int axis=0;axis<3;axis++)
+				{
+					wideNode.m_quantizedAabbMin[axis][i] = 0xffff;
+					wideNode.m_quantizedAabbMax[axis][i] = 0;
+				}
+				wideNode.m_childIndexOrTriangleIndex[i] = BT_WIDE_BVH_EMPTY_CHILD;
+				m_binaryNodeIndices.push_back(-1);
+			}
+		}
+	}
+
+	//the node array may grow during recursion, so only index it afterwards
+	for (int i=0;i<numChildren;i++)
+	{
+		if (!nodes[children[i]].isLeafNode())
+		{
+			int childWideNodeIndex = collapseNode(nodes,children[i],depth+1);
+			m_wideNodes[wideNodeIndex].m_childIndexOrTriangleIndex[i] = -childWideNodeIndex;
+		}
+	}
+	return wideNodeIndex;
+}
+
+void	btWideQuantizedBvh::serialize(void* o_alignedDataBuffer) const
+{
+	if (m_wideNodes.size())
+	{
+		memcpy(o_alignedDataBuffer,&m_wideNodes[0],calculateSerializeBufferSize());
+	}
+}
+
+bool	btWideQuantizedBvh::deSerializeInPlace(const btQuantizedBvh* bvh, void* i_alignedDataBuffer, int numNodes, int maxDepth, const int* numTrianglesPerPart, int numParts)
+{
+	m_bvh = bvh;
+	m_wideNodes.resize(0);
+	m_binaryNodeIndices.clear();
+	m_maxDepth = 0;
+
+	if (!i_alignedDataBuffer || numNodes <= 0 || maxDepth <= 0 ||
+		(BT_WIDE_BVH_WIDTH-1)*maxDepth + BT_WIDE_BVH_WIDTH > BT_WIDE_BVH_STACK_SIZE)
+	{
+		return false;
+	}
+
+	//children are always stored after their parent, this also rules out cycles.
+	//Every node below the root has exactly one parent, so the depth of each node is known when it is reached and bounds the traversal stack.
+	const btWideQuantizedBvhNode* nodes = (const btWideQuantizedBvhNode*)i_alignedDataBuffer;
+	btAlignedObjectArray<int> depths;
+	depths.resize(numNodes,0);
+	depths[0] = 1;
+	for (int nodeIndex=0;nodeIndex<numNodes;nodeIndex++)
+	{
+		if (!depths[nodeIndex])
+			return false;
+		for (int i=0;i<BT_WIDE_BVH_WIDTH;i++)
+		{
+			int child = nodes[nodeIndex].m_childIndexOrTriangleIndex[i];
+			if (child == BT_WIDE_BVH_EMPTY_CHILD)
+				continue;
+			if (btWideQuantizedBvhNode::isLeafChild(child))
+			{
+				int partId = btWideQuantizedBvhNode::getPartId(child);
+				if ((partId >= numParts) || (btWideQuantizedBvhNode::getTriangleIndex(child) >= numTrianglesPerPart[partId]))
+					return false;
+				continue;
+			}
+			if (-child <= nodeIndex || -child >= numNodes || depths[-child] || (depths[nodeIndex] >= maxDepth))
+				return false;
+			depths[-child] = depths[nodeIndex]+1;
+		}
+	}
+
+	m_wideNodes.initializeFromBuffer(i_alignedDataBuffer,numNodes,numNodes);
+	m_maxDepth = maxDepth;
+	return true;
+}
+
+void	btWideQuantizedBvh::reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const
+{
+	if (!m_wideNodes.size())
+		return;
+
+	unsigned short int quantizedQueryAabbMin[3];
+	unsigned short int quantizedQueryAabbMax[3];
+	m_bvh->quantizeWithClamp(quantizedQueryAabbMin,aabbMin,0);
+	m_bvh->quantizeWithClamp(quantizedQueryAabbMax,aabbMax,1);
+
+	int stack[BT_WIDE_BVH_STACK_SIZE];
+	int stackSize = 0;
+	stack[stackSize++] = 0;
+
+	while (stackSize)
+	{
+		const btWideQuantizedBvhNode& node = m_wideNodes[stack[--stackSize]];
+		unsigned overlapMask = testQuantizedAabbAgainstWideNode(quantizedQueryAabbMin,quantizedQueryAabbMax,node);
+		for (int i=0;overlapMask;i++,overlapMask>>=1)
+		{
+			if (!(overlapMask & 1))
+				continue;
+			int child = node.m_childIndexOrTriangleIndex[i];
+			if (child == BT_WIDE_BVH_EMPTY_CHILD)
+				continue;
+			if (btWideQuantizedBvhNode::isLeafChild(child))
+			{
+				nodeCallback->processNode(btWideQuantizedBvhNode::getPartId(child),btWideQuantizedBvhNode::getTriangleIndex(child));
+			} else
+			{
+				btAssert(stackSize < BT_WIDE_BVH_STACK_SIZE);
+				stack[stackSize++] = btWideQuantizedBvhNode::getChildNodeIndex(child);
+			}
+		}
+	}
+}
+
+void	btWideQuantizedBvh::reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btScalar* closestHitFraction) const
+{
+	walkWideTreeAgainstRay(nodeCallback,raySource,rayTarget,btVector3(0,0,0),btVector3(0,0,0),closestHitFraction);
+}
+
+void	btWideQuantizedBvh::reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin,const btVector3& aabbMax, const btScalar* closestHitFraction) const
+{
+	walkWideTreeAgainstRay(nodeCallback,raySource,rayTarget,aabbMin,aabbMax,closestHitFraction);
+}
+
+void	btWideQuantizedBvh::walkWideTreeAgainstRay(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax, const btScalar* closestHitFraction) const
+{
+	if (!m_wideNodes.size())
+		return;
+
+	btVector3 rayDirection = (rayTarget-raySource);
+	btScalar lambda_max = rayDirection.length();
+	if (lambda_max < SIMD_EPSILON)
+	{
+		reportAabbOverlappingNodex(nodeCallback,raySource+aabbMin,raySource+aabbMax);
+		return;
+	}
+	rayDirection /= lambda_max;
+	///what about division by zero? --> just set rayDirection[i] to 1.0
+	rayDirection[0] = rayDirection[0] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[0];
+	rayDirection[1] = rayDirection[1] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[1];
+	rayDirection[2] = rayDirection[2] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[2];
+
+	//the child bounds are grown by the box cast extents, minimum by aabbMax and maximum by aabbMin
+	btWideRaySlabs slabs;
+	const btVector3& bvhAabbMin = m_bvh->getBvhAabbMin();
+	for (int axis=0;axis<3;axis++)
+	{
+		slabs.m_invQuantization[axis] = btScalar(1.) / m_bvh->getQuantization()[axis];
+		slabs.m_minBoundOffset[axis] = bvhAabbMin[axis] - aabbMax[axis] - raySource[axis];
+		slabs.m_maxBoundOffset[axis] = bvhAabbMin[axis] - aabbMin[axis] - raySource[axis];
+		slabs.m_invDirection[axis] = rayDirection[axis];
+	}
+
+	/* Quick pruning by quantized box */
+	btVector3 rayAabbMin = raySource;
+	btVector3 rayAabbMax = raySource;
+	rayAabbMin.setMin(rayTarget);
+	rayAabbMax.setMax(rayTarget);
+
+	/* Add box cast extents to bounding box */
+	rayAabbMin += aabbMin;
+	rayAabbMax += aabbMax;
+
+	unsigned short int quantizedQueryAabbMin[3];
+	unsigned short int quantizedQueryAabbMax[3];
+	m_bvh->quantizeWithClamp(quantizedQueryAabbMin,rayAabbMin,0);
+	m_bvh->quantizeWithClamp(quantizedQueryAabbMax,rayAabbMax,1);
+
+	struct	btWideStackEntry
+	{
+		int			m_child;
+		btScalar	m_lambda;
+	};
+	btWideStackEntry stack[BT_WIDE_BVH_STACK_SIZE];
+	int stackSize = 0;
+
+	int nodeIndex = 0;
+	while (nodeIndex >= 0)
+	{
+		const btWideQuantizedBvhNode& node = m_wideNodes[nodeIndex];
+		btScalar lambdaLimit = closestHitFraction ? (*closestHitFraction) * lambda_max : lambda_max;
+
+		btWideStackEntry hits[BT_WIDE_BVH_WIDTH];
+		int numHits = 0;
+
+		btScalar entryLambdas[BT_WIDE_BVH_WIDTH];
+		unsigned hitMask = testQuantizedAabbAgainstWideNode(quantizedQueryAabbMin,quantizedQueryAabbMax,node);
+		if (hitMask)
+		{
+			hitMask &= testRayAgainstWideNode(slabs,lambdaLimit,node,entryLambdas);
+		}
+		for (int i=0;hitMask;i++,hitMask>>=1)
+		{
+			if (!(hitMask & 1))
+				continue;
+			int child = node.m_childIndexOrTriangleIndex[i];
+			if (child == BT_WIDE_BVH_EMPTY_CHILD)
+				continue;
+
+			btScalar param = entryLambdas[i];
+			//insertion sort, nearest child first
+			int j = numHits++;
+			while (j > 0 && hits[j-1].m_lambda > param)
+			{
+				hits[j] = hits[j-1];
+				j--;
+			}
+			hits[j].m_child = child;
+			hits[j].m_lambda = param;
+		}
+
+		//push farthest first, so the nearest child is visited next
+		btAssert(stackSize + numHits <= BT_WIDE_BVH_STACK_SIZE);
+		while (numHits)
+		{
+			stack[stackSize++] = hits[--numHits];
+		}
+
+		nodeIndex = -1;
+		while (stackSize)
+		{
+			const btWideStackEntry& entry = stack[--stackSize];
+			//the callback may have found a closer hit since this child was pushed
+			if (closestHitFraction && entry.m_lambda > (*closestHitFraction) * lambda_max)
+				continue;
+			if (btWideQuantizedBvhNode::isLeafChild(entry.m_child))
+			{
+				nodeCallback->processNode(btWideQuantizedBvhNode::getPartId(entry.m_child),btWideQuantizedBvhNode::getTriangleIndex(entry.m_child));
+			} else
+			{
+				nodeIndex = btWideQuantizedBvhNode::getChildNodeIndex(entry.m_child);
+				break;
+			}
+		}
+	}
+}
+
+void	btWideQuantizedBvh::reportRayPacketOverlappingNodex(btNodeRayPacketOverlapCallback* nodeCallback, const btRayPacket& packet) const
+{
+	if (!m_wideNodes.size() || !packet.m_activeMask)
+		return;
+
+	/* Quick pruning by the quantized box of the packet */
+	btVector3 packetAabbMin(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	btVector3 packetAabbMax(-btScalar(BT_LARGE_FLOAT),-btScalar(BT_LARGE_FLOAT),-btScalar(BT_LARGE_FLOAT));
+	int i;
+	for (i=0;i<packet.m_numRays;i++)
+	{
+		if (packet.m_activeMask & (1u<<i))
+		{
+			btVector3 rayFrom = packet.getRayFrom(i);
+			btVector3 rayTo = rayFrom + (packet.getRayTo(i)-rayFrom)*packet.m_maxFraction[i];
+			packetAabbMin.setMin(rayFrom);
+			packetAabbMin.setMin(rayTo);
+			packetAabbMax.setMax(rayFrom);
+			packetAabbMax.setMax(rayTo);
+		}
+	}
+	unsigned short int quantizedQueryAabbMin[3];
+	unsigned short int quantizedQueryAabbMax[3];
+	m_bvh->quantizeWithClamp(quantizedQueryAabbMin,packetAabbMin,0);
+	m_bvh->quantizeWithClamp(quantizedQueryAabbMax,packetAabbMax,1);
+
+	struct	btWidePacketStackEntry
+	{
+		int			m_child;
+		unsigned int	m_rayMask;
+		btScalar	m_entry;
+	};
+	btWidePacketStackEntry stack[BT_WIDE_BVH_STACK_SIZE];
+	int stackSize = 0;
+
+	int nodeIndex = 0;
+	unsigned int nodeRayMask = packet.m_activeMask;
+	while (nodeIndex >= 0)
+	{
+		const btWideQuantizedBvhNode& node = m_wideNodes[nodeIndex];
+
+		btWidePacketStackEntry hits[BT_WIDE_BVH_WIDTH];
+		int numHits = 0;
+
+		unsigned overlapMask = testQuantizedAabbAgainstWideNode(quantizedQueryAabbMin,quantizedQueryAabbMax,node);
+		for (i=0;overlapMask;i++,overlapMask>>=1)
+		{
+			if (!(overlapMask & 1))
+				continue;
+			int child = node.m_childIndexOrTriangleIndex[i];
+			if (child == BT_WIDE_BVH_EMPTY_CHILD)
+				continue;
+
+			unsigned short int quantizedChildMin[3] = {node.m_quantizedAabbMin[0][i],node.m_quantizedAabbMin[1][i],node.m_quantizedAabbMin[2][i]};
+			unsigned short int quantizedChildMax[3] = {node.m_quantizedAabbMax[0][i],node.m_quantizedAabbMax[1][i],node.m_quantizedAabbMax[2][i]};
+			btScalar entry;
+			unsigned int rayMask = packet.testAabb(m_bvh->unQuantize(quantizedChildMin),m_bvh->unQuantize(quantizedChildMax),nodeRayMask,&entry);
+			if (rayMask)
+			{
+				//insertion sort, nearest child first
+				int j = numHits++;
+				while (j > 0 && hits[j-1].m_entry > entry)
+				{
+					hits[j] = hits[j-1];
+					j--;
+				}
+				hits[j].m_child = child;
+				hits[j].m_rayMask = rayMask;
+				hits[j].m_entry = entry;
+			}
+		}
+
+		//push farthest first, so the nearest child is visited next
+		btAssert(stackSize + numHits <= BT_WIDE_BVH_STACK_SIZE);
+		while (numHits)
+		{
+			stack[stackSize++] = hits[--numHits];
+		}
+
+		nodeIndex = -1;
+		while (stackSize)
+		{
+			const btWidePacketStackEntry& entry = stack[--stackSize];
+			//the callback may have shortened or finished rays since this child was pushed
+			unsigned int rayMask = entry.m_rayMask & packet.m_activeMask;
+			for (i=0;i<packet.m_numRays;i++)
+			{
+				if ((rayMask & (1u<<i)) && entry.m_entry > packet.m_maxFraction[i])
+				{
+					//m_entry is the nearest entry of all rays, so this ray enters the child even later
+					rayMask &= ~(1u<<i);
+				}
+			}
+			if (!rayMask)
+				continue;
+			if (btWideQuantizedBvhNode::isLeafChild(entry.m_child))
+			{
+				nodeCallback->processNode(btWideQuantizedBvhNode::getPartId(entry.m_child),btWideQuantizedBvhNode::getTriangleIndex(entry.m_child),rayMask);
+			} else
+			{
+				nodeIndex = btWideQuantizedBvhNode::getChildNodeIndex(entry.m_child);
+				nodeRayMask = rayMask;
+				break;
+			}
+		}
+	}
+}
@@ -0,0 +1,149 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef WIDE_QUANTIZED_BVH_H
+#define WIDE_QUANTIZED_BVH_H
+
+#include "btQuantizedBvh.h"
+#include "btRayPacket.h"
+
+#define BT_WIDE_BVH_WIDTH 4
+
+///traversal stack size, a tree deeper than (BT_WIDE_BVH_STACK_SIZE-BT_WIDE_BVH_WIDTH)/(BT_WIDE_BVH_WIDTH-1) levels is rejected at build time
+#define BT_WIDE_BVH_STACK_SIZE 256
+
+///child slots that are not used contain this value, it is neither a triangle nor a node index
+#define BT_WIDE_BVH_EMPTY_CHILD (-0x7fffffff-1)
+
+///btWideQuantizedBvhNode stores the quantized AABBs of up to 4 children, 64 bytes.
+///The AABBs are stored as structure of arrays, so all children can be tested against a query with a single SIMD compare per axis.
+ATTRIBUTE_ALIGNED16	(struct) btWideQuantizedBvhNode
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	//48 bytes, [axis][child]
+	unsigned short int	m_quantizedAabbMin[3][BT_WIDE_BVH_WIDTH];
+	unsigned short int	m_quantizedAabbMax[3][BT_WIDE_BVH_WIDTH];
+	//16 bytes, leaf children (>=0) use the part/triangle encoding of btQuantizedBvhNode, internal children (<0) store the negated wide node index
+	int	m_childIndexOrTriangleIndex[BT_WIDE_BVH_WIDTH];
+
+	static bool isLeafChild(int child)
+	{
+		return (child >= 0);
+	}
+	static int getChildNodeIndex(int child)
+	{
+		btAssert(child < 0 && child != BT_WIDE_BVH_EMPTY_CHILD);
+		return -child;
+	}
+	static int getTriangleIndex(int child)
+	{
+		btAssert(isLeafChild(child));
+		return (child&~((~0u)<<(31-MAX_NUM_PARTS_IN_BITS)));
+	}
+	static int getPartId(int child)
+	{
+		btAssert(isLeafChild(child));
+		return (child>>(31-MAX_NUM_PARTS_IN_BITS));
+	}
+}
+;
+
+typedef btAlignedObjectArray<btWideQuantizedBvhNode>	WideQuantizedNodeArray;
+
+///btNodeRayPacketOverlapCallback receives the triangles found by reportRayPacketOverlappingNodex, rayMask has a bit for each ray of the packet that hits the triangle aabb
+class btNodeRayPacketOverlapCallback
+{
+public:
+	virtual ~btNodeRayPacketOverlapCallback() {};
+
+	virtual void processNode(int subPart, int triangleIndex, unsigned int rayMask) = 0;
+};
+
+///The btWideQuantizedBvh is a 4-ary layout of a quantized btQuantizedBvh, used by btBvhTriangleMeshShape for large meshes.
+///It is collapsed from the binary tree, so it shares the quantization and triangle encoding, and every node visit tests 4 children at once.
+///Ray and box cast queries visit children front to back, and can stop early using the closest hit fraction of the caller.
+ATTRIBUTE_ALIGNED16(class) btWideQuantizedBvh
+{
+	const btQuantizedBvh*	m_bvh;
+
+	WideQuantizedNodeArray	m_wideNodes;
+
+	///the binary node of each child slot, BT_WIDE_BVH_WIDTH entries per wide node, -1 for empty slots. It is empty for a deserialized tree.
+	btAlignedObjectArray<int>	m_binaryNodeIndices;
+
+	int		m_maxDepth;
+
+	int		collapseNode(const btQuantizedBvhNode* nodes,int binaryNodeIndex,int depth);
+
+	void	walkWideTreeAgainstRay(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax, const btScalar* closestHitFraction) const;
+
+public:
+
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btWideQuantizedBvh();
+
+	virtual ~btWideQuantizedBvh();
+
+	///build collapses the quantized nodes of bvh, it returns false if the tree is not quantized or too deep for the traversal stack
+	///the bvh needs to stay alive, its quantization is used for queries, and refit or build needs to be called again after a refit of the bvh
+	bool	build(btQuantizedBvh* bvh);
+
+	///refit copies the child AABBs from the binary nodes after the bvh was refit, the layout of the tree stays the same.
+	///It returns false for a deserialized tree, which doesn't know its binary nodes, build needs to be called instead.
+	bool	refit();
+
+	void	reportAabbOverlappingNodex(btNodeOverlapCallback* nodeCallback,const btVector3& aabbMin,const btVector3& aabbMax) const;
+
+	///if closestHitFraction is not null, children that the ray enters beyond *closestHitFraction are skipped. The callback may lower it while the tree is walked.
+	void	reportRayOverlappingNodex (btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btScalar* closestHitFraction=0) const;
+
+	void	reportBoxCastOverlappingNodex(btNodeOverlapCallback* nodeCallback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin,const btVector3& aabbMax, const btScalar* closestHitFraction=0) const;
+
+	///reportRayPacketOverlappingNodex walks the tree once for all active rays of the packet, nearest children first.
+	///The callback may lower m_maxFraction and clear bits of m_activeMask of the packet while the tree is walked.
+	void	reportRayPacketOverlappingNodex(btNodeRayPacketOverlapCallback* nodeCallback, const btRayPacket& packet) const;
+
+	///the wide nodes can be stored next to a serialized btQuantizedBvh, see btBvhTriangleMeshBlob
+	unsigned int	calculateSerializeBufferSize() const
+	{
+		return m_wideNodes.size()*sizeof(btWideQuantizedBvhNode);
+	}
+
+	void	serialize(void* o_alignedDataBuffer) const;
+
+	///deSerializeInPlace uses the nodes in the 16 byte aligned buffer without copying them.
+	///It returns false if the nodes don't form a tree of at most maxDepth levels, or if a leaf refers to a part or triangle that is not in numTrianglesPerPart.
+	bool	deSerializeInPlace(const btQuantizedBvh* bvh, void* i_alignedDataBuffer, int numNodes, int maxDepth, const int* numTrianglesPerPart, int numParts);
+
+	int		getNumNodes() const
+	{
+		return m_wideNodes.size();
+	}
+
+	int		getMaxDepth() const
+	{
+		return m_maxDepth;
+	}
+
+	const WideQuantizedNodeArray&	getWideNodeArray() const
+	{
+		return m_wideNodes;
+	}
+}
+;
+
+#endif //WIDE_QUANTIZED_BVH_H
@@ -69,6 +69,7 @@ btCollisionDispatcher::~btCollisionDispatcher()
 
 btPersistentManifold*	btCollisionDispatcher::getNewManifold(void* b0,void* b1) 
 { 
+	BT_ALLOC_TAG(BT_ALLOC_TAG_MANIFOLDS);
 	gNumManifold++;
 	
 	//btAssert(gNumManifold < 65535);
@@ -261,6 +262,7 @@ void btCollisionDispatcher::defaultNearCallback(btBroadphasePair& collisionPair,
 			if (collisionPair.m_algorithm)
 			{
 				btManifoldResult contactPointResult(colObj0,colObj1);
+				contactPointResult.setRestoreCallback(dispatchInfo.m_manifoldRestoreCallback);
 				
 				if (dispatchInfo.m_dispatchFunc == 		btDispatcherInfo::DISPATCH_DISCRETE)
 				{
@@ -21,19 +21,36 @@ subject to the following restrictions:
 #include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
 #include "BulletCollision/CollisionShapes/btSphereShape.h" //for raycasting
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h" //for raycasting
+#include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h" //for raycasting
 #include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "BulletCollision/CollisionShapes/btTriangleShape.h"
 #include "BulletCollision/NarrowPhaseCollision/btSubSimplexConvexCast.h"
 #include "BulletCollision/NarrowPhaseCollision/btGjkConvexCast.h"
 #include "BulletCollision/NarrowPhaseCollision/btContinuousConvexCollision.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h"
+#include "BulletCollision/NarrowPhaseCollision/btPointCollector.h"
 #include "BulletCollision/BroadphaseCollision/btCollisionAlgorithm.h"
 #include "BulletCollision/BroadphaseCollision/btBroadphaseInterface.h"
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btQuickprof.h"
 #include "LinearMath/btStackAlloc.h"
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btHashMap.h"
+#include "LinearMath/btTaskPool.h"
 
 //#define USE_BRUTEFORCE_RAYBROADPHASE 1
+
+///smaller batches are traced on the calling thread only
+#define BT_RAY_BATCH_MIN_THREADED_RAYS 256
+#define BT_RAY_BATCH_RAYS_PER_TASK 64
+#define BT_SWEEP_BATCH_MIN_THREADED_SWEEPS 64
+#define BT_OVERLAP_BATCH_MIN_THREADED_QUERIES 64
+///a task of a threaded sweep or overlap batch evaluates this many clusters
+#define BT_QUERY_BATCH_CLUSTERS_PER_TASK 4
+///a cluster of batched queries shares one broadphase query, a query only joins a cluster if the cluster aabb stays compact
+#define BT_QUERY_BATCH_MAX_CLUSTER_SIZE 16
+#define BT_QUERY_BATCH_MAX_AREA_RATIO btScalar(2.)
 //RECALCULATE_AABB is slower, but benefit is that you don't need to call 'stepSimulation'  or 'updateAabbs' before using a rayTest
 //#define RECALCULATE_AABB_RAYCAST 1
 
@@ -123,6 +140,7 @@ void	btCollisionWorld::addCollisionObject(btCollisionObject* collisionObject,sho
 	collisionObject->getCollisionShape()->getAabb(trans,minAabb,maxAabb);
 
 	int type = collisionObject->getCollisionShape()->getShapeType();
+	BT_ALLOC_TAG(BT_ALLOC_TAG_BROADPHASE);
 	collisionObject->setBroadphaseHandle( getBroadphase()->createProxy(
 		minAabb,
 		maxAabb,
@@ -145,6 +163,14 @@ void	btCollisionWorld::updateSingleAabb(btCollisionObject* colObj)
 {
 	btVector3 minAabb,maxAabb;
 	colObj->getCollisionShape()->getAabb(colObj->getWorldTransform(), minAabb,maxAabb);
+	//speculative contacts need the pairs that can touch during this step, so include the predicted transform
+	if (m_dispatchInfo.m_useSpeculativeContacts && !colObj->isStaticOrKinematicObject())
+	{
+		btVector3 minAabb2,maxAabb2;
+		colObj->getCollisionShape()->getAabb(colObj->getInterpolationWorldTransform(),minAabb2,maxAabb2);
+		minAabb.setMin(minAabb2);
+		maxAabb.setMax(maxAabb2);
+	}
 	//need to increase the aabb for contact thresholds
 	btVector3 contactThreshold(gContactBreakingThreshold,gContactBreakingThreshold,gContactBreakingThreshold);
 	minAabb -= contactThreshold;
@@ -177,6 +203,7 @@ void	btCollisionWorld::updateSingleAabb(btCollisionObject* colObj)
 void	btCollisionWorld::updateAabbs()
 {
 	BT_PROFILE("updateAabbs");
+	BT_ALLOC_TAG(BT_ALLOC_TAG_BROADPHASE);
 
 	btTransform predictedTrans;
 	for ( int i=0;i<m_collisionObjects.size();i++)
@@ -203,6 +230,7 @@ void	btCollisionWorld::performDiscreteCollisionDetection()
 
 	{
 		BT_PROFILE("calculateOverlappingPairs");
+		BT_ALLOC_TAG(BT_ALLOC_TAG_BROADPHASE);
 		m_broadphasePairCache->calculateOverlappingPairs(m_dispatcher1);
 	}
 
@@ -210,6 +238,7 @@ void	btCollisionWorld::performDiscreteCollisionDetection()
 	btDispatcher* dispatcher = getDispatcher();
 	{
 		BT_PROFILE("dispatchAllCollisionPairs");
+		BT_ALLOC_TAG(BT_ALLOC_TAG_MANIFOLDS);
 		if (dispatcher)
 			dispatcher->dispatchAllCollisionPairs(m_broadphasePairCache->getOverlappingPairCache(),dispatchInfo,m_dispatcher1);
 	}
@@ -354,7 +383,7 @@ void	btCollisionWorld::rayTestSingle(const btTransform& rayFromTrans,const btTra
 
 				BridgeTriangleRaycastCallback rcb(rayFromLocal,rayToLocal,&resultCallback,collisionObject,triangleMesh,colObjWorldTransform);
 				rcb.m_hitFraction = resultCallback.m_closestHitFraction;
-				triangleMesh->performRaycast(&rcb,rayFromLocal,rayToLocal);
+				triangleMesh->performRaycast(&rcb,rayFromLocal,rayToLocal,&rcb.m_hitFraction);
 			} else
 			{
 				//generic (slower) case
@@ -411,12 +440,20 @@ void	btCollisionWorld::rayTestSingle(const btTransform& rayFromTrans,const btTra
 				BridgeTriangleRaycastCallback	rcb(rayFromLocal,rayToLocal,&resultCallback,collisionObject,concaveShape, colObjWorldTransform);
 				rcb.m_hitFraction = resultCallback.m_closestHitFraction;
 
-				btVector3 rayAabbMinLocal = rayFromLocal;
-				rayAabbMinLocal.setMin(rayToLocal);
-				btVector3 rayAabbMaxLocal = rayFromLocal;
-				rayAabbMaxLocal.setMax(rayToLocal);
+				if (collisionShape->getShapeType()==TERRAIN_SHAPE_PROXYTYPE)
+				{
+					///grid walk for btHeightfieldTerrainShape
+					btHeightfieldTerrainShape* heightfield = (btHeightfieldTerrainShape*)collisionShape;
+					heightfield->performRaycast(&rcb,rayFromLocal,rayToLocal,&rcb.m_hitFraction);
+				} else
+				{
+					btVector3 rayAabbMinLocal = rayFromLocal;
+					rayAabbMinLocal.setMin(rayToLocal);
+					btVector3 rayAabbMaxLocal = rayFromLocal;
+					rayAabbMaxLocal.setMax(rayToLocal);
 
-				concaveShape->processAllTriangles(&rcb,rayAabbMinLocal,rayAabbMaxLocal);
+					concaveShape->processAllTriangles(&rcb,rayAabbMinLocal,rayAabbMaxLocal);
+				}
 			}
 		} else {
 			//			BT_PROFILE("rayTestCompound");
@@ -578,7 +615,7 @@ void	btCollisionWorld::objectQuerySingle(const btConvexShape* castShape,const bt
 				tccb.m_hitFraction = resultCallback.m_closestHitFraction;
 				btVector3 boxMinLocal, boxMaxLocal;
 				castShape->getAabb(rotationXform, boxMinLocal, boxMaxLocal);
-				triangleMesh->performConvexcast(&tccb,convexFromLocal,convexToLocal,boxMinLocal, boxMaxLocal);
+				triangleMesh->performConvexcast(&tccb,convexFromLocal,convexToLocal,boxMinLocal, boxMaxLocal,&tccb.m_hitFraction);
 			} else
 			{
 				//BT_PROFILE("convexSweepConcave");
@@ -794,6 +831,392 @@ void	btCollisionWorld::rayTest(const btVector3& rayFromWorld, const btVector3& r
 
 }
 
+///rays of a batch are sorted by direction octant and then along a Morton curve of their sources, so the rays of a packet are close together and point the same way
+struct btRayBatchKey
+{
+	unsigned int	m_key;
+	int				m_rayIndex;
+};
+
+struct btRayBatchKeySortPredicate
+{
+	bool operator() ( const btRayBatchKey& a, const btRayBatchKey& b ) const
+	{
+		return a.m_key < b.m_key || (a.m_key == b.m_key && a.m_rayIndex < b.m_rayIndex);
+	}
+};
+
+static SIMD_FORCE_INLINE unsigned int	btSpreadMortonBits(unsigned int x)
+{
+	x &= 0x1ff;
+	x = (x | (x << 16)) & 0x030000FF;
+	x = (x | (x << 8)) & 0x0300F00F;
+	x = (x | (x << 4)) & 0x030C30C3;
+	x = (x | (x << 2)) & 0x09249249;
+	return x;
+}
+
+struct btBatchedRayResultCallback : public btCollisionWorld::RayResultCallback
+{
+	const btCollisionWorld::BatchedRay*	m_ray;
+	btCollisionWorld::BatchedRayResult*	m_result;
+	bool	m_anyHit;
+
+	btBatchedRayResultCallback()
+		:m_ray(0),
+		m_result(0),
+		m_anyHit(false)
+	{
+	}
+
+	void	init(const btCollisionWorld::BatchedRay* ray,btCollisionWorld::BatchedRayResult* result,bool anyHit)
+	{
+		m_ray = ray;
+		m_result = result;
+		m_anyHit = anyHit;
+		m_closestHitFraction = btScalar(1.);
+		m_collisionObject = 0;
+		m_collisionFilterGroup = ray->m_collisionFilterGroup;
+		m_collisionFilterMask = ray->m_collisionFilterMask;
+		m_flags = ray->m_flags;
+
+		m_result->m_collisionObject = 0;
+		m_result->m_hitFraction = btScalar(1.);
+		m_result->m_shapePart = -1;
+		m_result->m_triangleIndex = -1;
+	}
+
+	virtual bool needsCollision(btBroadphaseProxy* proxy0) const
+	{
+		if (proxy0->m_clientObject == m_ray->m_ignoreObject)
+			return false;
+		return RayResultCallback::needsCollision(proxy0);
+	}
+
+	virtual	btScalar	addSingleResult(btCollisionWorld::LocalRayResult& rayResult,bool normalInWorldSpace)
+	{
+		btAssert(rayResult.m_hitFraction <= m_closestHitFraction);
+
+		m_collisionObject = rayResult.m_collisionObject;
+		m_result->m_collisionObject = rayResult.m_collisionObject;
+		m_result->m_hitFraction = rayResult.m_hitFraction;
+		if (normalInWorldSpace)
+		{
+			m_result->m_hitNormalWorld = rayResult.m_hitNormalLocal;
+		} else
+		{
+			///need to transform normal into worldspace
+			m_result->m_hitNormalWorld = m_collisionObject->getWorldTransform().getBasis()*rayResult.m_hitNormalLocal;
+		}
+		m_result->m_hitPointWorld.setInterpolate3(m_ray->m_rayFromWorld,m_ray->m_rayToWorld,rayResult.m_hitFraction);
+		if (rayResult.m_localShapeInfo)
+		{
+			m_result->m_shapePart = rayResult.m_localShapeInfo->m_shapePart;
+			m_result->m_triangleIndex = rayResult.m_localShapeInfo->m_triangleIndex;
+		} else
+		{
+			m_result->m_shapePart = -1;
+			m_result->m_triangleIndex = -1;
+		}
+		//a hit fraction of zero terminates the ray
+		m_closestHitFraction = m_anyHit ? btScalar(0.) : rayResult.m_hitFraction;
+		return m_closestHitFraction;
+	}
+};
+
+///btBatchedCompoundChildCallback reports the child index of compound shapes, like rayTestSingle does
+struct btBatchedCompoundChildCallback : public btCollisionWorld::RayResultCallback
+{
+	btCollisionWorld::RayResultCallback*	m_userCallback;
+	int		m_childIndex;
+
+	btBatchedCompoundChildCallback(int childIndex,btCollisionWorld::RayResultCallback* userCallback)
+		:m_userCallback(userCallback),
+		m_childIndex(childIndex)
+	{
+		m_closestHitFraction = m_userCallback->m_closestHitFraction;
+		m_flags = m_userCallback->m_flags;
+	}
+
+	virtual	btScalar	addSingleResult(btCollisionWorld::LocalRayResult& rayResult,bool normalInWorldSpace)
+	{
+		btCollisionWorld::LocalShapeInfo	shapeInfo;
+		shapeInfo.m_shapePart = -1;
+		shapeInfo.m_triangleIndex = m_childIndex;
+		if (rayResult.m_localShapeInfo == NULL)
+			rayResult.m_localShapeInfo = &shapeInfo;
+
+		const btScalar result = m_userCallback->addSingleResult(rayResult,normalInWorldSpace);
+		m_closestHitFraction = m_userCallback->m_closestHitFraction;
+		return result;
+	}
+};
+
+///btRayTestBatchedObject is rayTestSingle, except that compound children are traced without replacing the shape of the collision object, so several threads can trace rays against the same object
+static void	btRayTestBatchedObject(const btTransform& rayFromTrans,const btTransform& rayToTrans,
+					  btCollisionObject* collisionObject,
+					  const btCollisionShape* collisionShape,
+					  const btTransform& colObjWorldTransform,
+					  btCollisionWorld::RayResultCallback& resultCallback)
+{
+	if (collisionShape->isCompound())
+	{
+		const btCompoundShape* compoundShape = static_cast<const btCompoundShape*>(collisionShape);
+		for (int i=0;i<compoundShape->getNumChildShapes();i++)
+		{
+			if (resultCallback.m_closestHitFraction == btScalar(0.))
+				break;
+			btTransform childWorldTrans = colObjWorldTransform * compoundShape->getChildTransform(i);
+			btBatchedCompoundChildCallback childCallback(i,&resultCallback);
+			btRayTestBatchedObject(rayFromTrans,rayToTrans,collisionObject,compoundShape->getChildShape(i),childWorldTrans,childCallback);
+		}
+		return;
+	}
+	btCollisionWorld::rayTestSingle(rayFromTrans,rayToTrans,collisionObject,collisionShape,colObjWorldTransform,resultCallback);
+}
+
+struct btBatchedTriangleRaycastCallback : public btTriangleRaycastCallback
+{
+	btCollisionWorld::RayResultCallback* m_resultCallback;
+	btCollisionObject*	m_collisionObject;
+	const btTransform*	m_colObjWorldTransform;
+
+	btBatchedTriangleRaycastCallback()
+		:btTriangleRaycastCallback(btVector3(0,0,0),btVector3(0,0,0)),
+		m_resultCallback(0),
+		m_collisionObject(0),
+		m_colObjWorldTransform(0)
+	{
+	}
+
+	virtual btScalar reportHit(const btVector3& hitNormalLocal, btScalar hitFraction, int partId, int triangleIndex )
+	{
+		btCollisionWorld::LocalShapeInfo	shapeInfo;
+		shapeInfo.m_shapePart = partId;
+		shapeInfo.m_triangleIndex = triangleIndex;
+
+		btVector3 hitNormalWorld = m_colObjWorldTransform->getBasis() * hitNormalLocal;
+
+		btCollisionWorld::LocalRayResult rayResult
+			(m_collisionObject,
+			&shapeInfo,
+			hitNormalWorld,
+			hitFraction);
+
+		bool	normalInWorldSpace = true;
+		return m_resultCallback->addSingleResult(rayResult,normalInWorldSpace);
+	}
+};
+
+struct btRayBatchPacketCallback : public btBroadphaseRayPacketCallback
+{
+	btTransform		m_rayFromTrans[BT_RAY_PACKET_SIZE];
+	btTransform		m_rayToTrans[BT_RAY_PACKET_SIZE];
+	btBatchedRayResultCallback	m_resultCallbacks[BT_RAY_PACKET_SIZE];
+
+	btRayBatchPacketCallback()
+	{
+		for (int i=0;i<BT_RAY_PACKET_SIZE;i++)
+		{
+			m_rayFromTrans[i].setIdentity();
+			m_rayToTrans[i].setIdentity();
+		}
+	}
+
+	virtual void	process(const btBroadphaseProxy* proxy,unsigned int rayMask)
+	{
+		btCollisionObject*	collisionObject = (btCollisionObject*)proxy->m_clientObject;
+		int i;
+		int numRays = 0;
+		for (i=0;i<m_packet.m_numRays;i++)
+		{
+			if (!(rayMask & (1u<<i)))
+				continue;
+			//only perform raycast if filterMask matches
+			if (m_resultCallbacks[i].needsCollision(collisionObject->getBroadphaseHandle()))
+			{
+				numRays++;
+			} else
+			{
+				rayMask &= ~(1u<<i);
+			}
+		}
+		if (!rayMask)
+			return;
+
+		const btCollisionShape* collisionShape = collisionObject->getCollisionShape();
+		const btTransform& colObjWorldTransform = collisionObject->getWorldTransform();
+		bool traced = false;
+		if (numRays > 1 && collisionShape->getShapeType()==TRIANGLE_MESH_SHAPE_PROXYTYPE)
+		{
+			///trace the rays together through the wide tree of the mesh
+			btBvhTriangleMeshShape* triangleMesh = (btBvhTriangleMeshShape*)collisionShape;
+			btRayPacket localPacket;
+			m_packet.transformPacket(colObjWorldTransform.inverse(),localPacket);
+			localPacket.m_activeMask = rayMask;
+
+			btBatchedTriangleRaycastCallback triangleCallbacks[BT_RAY_PACKET_SIZE];
+			btTriangleRaycastCallback* callbacks[BT_RAY_PACKET_SIZE];
+			for (i=0;i<m_packet.m_numRays;i++)
+			{
+				btBatchedTriangleRaycastCallback& rcb = triangleCallbacks[i];
+				rcb.m_from = localPacket.getRayFrom(i);
+				rcb.m_to = localPacket.getRayTo(i);
+				rcb.m_flags = m_resultCallbacks[i].m_flags;
+				rcb.m_hitFraction = m_resultCallbacks[i].m_closestHitFraction;
+				rcb.m_resultCallback = &m_resultCallbacks[i];
+				rcb.m_collisionObject = collisionObject;
+				rcb.m_colObjWorldTransform = &colObjWorldTransform;
+				callbacks[i] = &rcb;
+			}
+			traced = triangleMesh->performRaycastPacket(callbacks,localPacket);
+		}
+		if (!traced)
+		{
+			for (i=0;i<m_packet.m_numRays;i++)
+			{
+				if (rayMask & (1u<<i))
+				{
+					btRayTestBatchedObject(m_rayFromTrans[i],m_rayToTrans[i],collisionObject,collisionShape,colObjWorldTransform,m_resultCallbacks[i]);
+				}
+			}
+		}
+
+		//shorten the rays to their closest hit, and finish the rays that can't find a closer one
+		for (i=0;i<m_packet.m_numRays;i++)
+		{
+			if (rayMask & (1u<<i))
+			{
+				m_packet.m_maxFraction[i] = m_resultCallbacks[i].m_closestHitFraction;
+				if (m_resultCallbacks[i].m_closestHitFraction == btScalar(0.))
+				{
+					m_packet.m_activeMask &= ~(1u<<i);
+				}
+			}
+		}
+	}
+};
+
+struct btRayBatchContext
+{
+	btBroadphaseInterface*	m_broadphase;
+	const btCollisionWorld::BatchedRay*	m_rays;
+	btCollisionWorld::BatchedRayResult*	m_results;
+	const btRayBatchKey*	m_sortedRays;
+	int		m_numRays;
+	bool	m_anyHit;
+};
+
+static void	btRayTestBatchPackets(const btRayBatchContext& context,int firstRay,int endRay)
+{
+	btRayBatchPacketCallback packetCallback;
+	for (int packetStart=firstRay;packetStart<endRay;packetStart+=BT_RAY_PACKET_SIZE)
+	{
+		int count = btMin(BT_RAY_PACKET_SIZE,endRay-packetStart);
+		packetCallback.m_packet = btRayPacket();
+		for (int i=0;i<count;i++)
+		{
+			int rayIndex = context.m_sortedRays[packetStart+i].m_rayIndex;
+			const btCollisionWorld::BatchedRay& ray = context.m_rays[rayIndex];
+			packetCallback.m_packet.setRay(i,ray.m_rayFromWorld,ray.m_rayToWorld);
+			packetCallback.m_rayFromTrans[i].setOrigin(ray.m_rayFromWorld);
+			packetCallback.m_rayToTrans[i].setOrigin(ray.m_rayToWorld);
+			packetCallback.m_resultCallbacks[i].init(&ray,&context.m_results[rayIndex],context.m_anyHit);
+		}
+		context.m_broadphase->rayPacketTest(packetCallback);
+	}
+}
+
+static void	btRayBatchTask(void* userPtr, int taskIndex)
+{
+	BT_PROFILE("rayTestBatchTask");
+	const btRayBatchContext& context = *(const btRayBatchContext*)userPtr;
+	int firstRay = taskIndex*BT_RAY_BATCH_RAYS_PER_TASK;
+	int endRay = btMin(firstRay+BT_RAY_BATCH_RAYS_PER_TASK,context.m_numRays);
+	btRayTestBatchPackets(context,firstRay,endRay);
+}
+
+///GImpact mesh parts lock their mesh through an unsynchronised lock count in every query, see btGImpactMeshShapePart::TrimeshPrimitiveManager::lock
+static bool	btShapeSupportsConcurrentQueries(const btCollisionShape* shape)
+{
+	if (shape->getShapeType() == GIMPACT_SHAPE_PROXYTYPE)
+		return false;
+	if (shape->isCompound())
+	{
+		const btCompoundShape* compoundShape = static_cast<const btCompoundShape*>(shape);
+		for (int i=0;i<compoundShape->getNumChildShapes();i++)
+		{
+			if (!btShapeSupportsConcurrentQueries(compoundShape->getChildShape(i)))
+				return false;
+		}
+	}
+	return true;
+}
+
+bool	btCollisionWorld::supportsConcurrentQueries() const
+{
+	for (int i=0;i<m_collisionObjects.size();i++)
+	{
+		if (!btShapeSupportsConcurrentQueries(m_collisionObjects[i]->getCollisionShape()))
+			return false;
+	}
+	return true;
+}
+
+void	btCollisionWorld::rayTestBatch(const BatchedRay* rays, int numRays, BatchedRayResult* results, RayBatchMode mode, int maxThreads) const
+{
+	BT_PROFILE("rayTestBatch");
+	if (numRays <= 0)
+		return;
+
+	//sort the rays into coherent packets
+	btVector3 sourceMin = rays[0].m_rayFromWorld;
+	btVector3 sourceMax = rays[0].m_rayFromWorld;
+	int i;
+	for (i=1;i<numRays;i++)
+	{
+		sourceMin.setMin(rays[i].m_rayFromWorld);
+		sourceMax.setMax(rays[i].m_rayFromWorld);
+	}
+	btVector3 sourceExtent = sourceMax-sourceMin;
+	btVector3 quantization;
+	for (int axis=0;axis<3;axis++)
+	{
+		quantization[axis] = sourceExtent[axis] > SIMD_EPSILON ? btScalar(511.)/sourceExtent[axis] : btScalar(0.);
+	}
+
+	btAlignedObjectArray<btRayBatchKey> sortedRays;
+	sortedRays.resize(numRays);
+	for (i=0;i<numRays;i++)
+	{
+		btVector3 direction = rays[i].m_rayToWorld-rays[i].m_rayFromWorld;
+		btVector3 cell = (rays[i].m_rayFromWorld-sourceMin)*quantization;
+		unsigned int octant = (direction.getX() < btScalar(0.) ? 4 : 0) | (direction.getY() < btScalar(0.) ? 2 : 0) | (direction.getZ() < btScalar(0.) ? 1 : 0);
+		sortedRays[i].m_key = (octant<<27) |
+			(btSpreadMortonBits((unsigned int)cell.getX())<<2) |
+			(btSpreadMortonBits((unsigned int)cell.getY())<<1) |
+			btSpreadMortonBits((unsigned int)cell.getZ());
+		sortedRays[i].m_rayIndex = i;
+	}
+	sortedRays.quickSort(btRayBatchKeySortPredicate());
+
+	btRayBatchContext context;
+	context.m_broadphase = m_broadphasePairCache;
+	context.m_rays = rays;
+	context.m_results = results;
+	context.m_sortedRays = &sortedRays[0];
+	context.m_numRays = numRays;
+	context.m_anyHit = (mode == RAY_BATCH_ANY_HIT);
+
+	int numTasks = (numRays+BT_RAY_BATCH_RAYS_PER_TASK-1)/BT_RAY_BATCH_RAYS_PER_TASK;
+	int numThreads = 1;
+	if (maxThreads > 1 && numRays >= BT_RAY_BATCH_MIN_THREADED_RAYS && supportsConcurrentQueries())
+	{
+		numThreads = maxThreads;
+	}
+	btParallelFor(numTasks,btRayBatchTask,&context,numThreads);
+}
+
 
 struct btSingleSweepCallback : public btBroadphaseRayCallback
 {
@@ -917,6 +1340,369 @@ void	btCollisionWorld::convexSweepTest(const btConvexShape* castShape, const btT
 
 
 
+///the aabb and angular motion disc of a cast shape, convexSweepTest recomputes them for every sweep
+struct btSweepBatchShapeInfo
+{
+	btVector3	m_localAabbMin;
+	btVector3	m_localAabbMax;
+	btScalar	m_angularMotionDisc;
+};
+
+///btQueryBatchItem is the world space aabb of one query of convexSweepTestBatch or overlapTestBatch
+struct btQueryBatchItem
+{
+	int			m_queryIndex;
+	unsigned int	m_key;
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+};
+
+struct btQueryBatchItemSortPredicate
+{
+	bool operator() ( const btQueryBatchItem& a, const btQueryBatchItem& b ) const
+	{
+		return a.m_key < b.m_key || (a.m_key == b.m_key && a.m_queryIndex < b.m_queryIndex);
+	}
+};
+
+struct btQueryBatchCluster
+{
+	int			m_firstItem;
+	int			m_numItems;
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+};
+
+static SIMD_FORCE_INLINE btScalar	btAabbSurfaceArea(const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	btVector3 extent = aabbMax-aabbMin;
+	return btScalar(2.)*(extent.getX()*extent.getY()+extent.getY()*extent.getZ()+extent.getZ()*extent.getX());
+}
+
+///btBuildQueryBatchClusters sorts the items along a Morton curve of their aabb centers, and clusters neighbours with compact bounds
+static void	btBuildQueryBatchClusters(btAlignedObjectArray<btQueryBatchItem>& items,btAlignedObjectArray<btQueryBatchCluster>& clusters)
+{
+	btVector3 centerMin(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	btVector3 centerMax(-btScalar(BT_LARGE_FLOAT),-btScalar(BT_LARGE_FLOAT),-btScalar(BT_LARGE_FLOAT));
+	int i;
+	for (i=0;i<items.size();i++)
+	{
+		btVector3 center = (items[i].m_aabbMin+items[i].m_aabbMax)*btScalar(0.5);
+		centerMin.setMin(center);
+		centerMax.setMax(center);
+	}
+	btVector3 centerExtent = centerMax-centerMin;
+	btVector3 quantization;
+	for (int axis=0;axis<3;axis++)
+	{
+		quantization[axis] = centerExtent[axis] > SIMD_EPSILON ? btScalar(511.)/centerExtent[axis] : btScalar(0.);
+	}
+	for (i=0;i<items.size();i++)
+	{
+		btVector3 cell = ((items[i].m_aabbMin+items[i].m_aabbMax)*btScalar(0.5)-centerMin)*quantization;
+		items[i].m_key = (btSpreadMortonBits((unsigned int)cell.getX())<<2) |
+			(btSpreadMortonBits((unsigned int)cell.getY())<<1) |
+			btSpreadMortonBits((unsigned int)cell.getZ());
+	}
+	items.quickSort(btQueryBatchItemSortPredicate());
+
+	clusters.resize(0);
+	btScalar clusterItemArea = btScalar(0.);
+	for (i=0;i<items.size();i++)
+	{
+		const btQueryBatchItem& item = items[i];
+		btScalar itemArea = btAabbSurfaceArea(item.m_aabbMin,item.m_aabbMax);
+		if (clusters.size())
+		{
+			btQueryBatchCluster& cluster = clusters[clusters.size()-1];
+			btVector3 mergedMin = cluster.m_aabbMin;
+			btVector3 mergedMax = cluster.m_aabbMax;
+			mergedMin.setMin(item.m_aabbMin);
+			mergedMax.setMax(item.m_aabbMax);
+			if (cluster.m_numItems < BT_QUERY_BATCH_MAX_CLUSTER_SIZE &&
+				btAabbSurfaceArea(mergedMin,mergedMax) <= BT_QUERY_BATCH_MAX_AREA_RATIO*(clusterItemArea+itemArea))
+			{
+				cluster.m_aabbMin = mergedMin;
+				cluster.m_aabbMax = mergedMax;
+				cluster.m_numItems++;
+				clusterItemArea += itemArea;
+				continue;
+			}
+		}
+		btQueryBatchCluster& cluster = clusters.expand();
+		cluster.m_firstItem = i;
+		cluster.m_numItems = 1;
+		cluster.m_aabbMin = item.m_aabbMin;
+		cluster.m_aabbMax = item.m_aabbMax;
+		clusterItemArea = itemArea;
+	}
+}
+
+struct btSweepBatchCandidate
+{
+	btScalar	m_entryFraction;
+	int			m_candidateIndex;
+};
+
+struct btSweepBatchCandidateSortPredicate
+{
+	bool operator() ( const btSweepBatchCandidate& a, const btSweepBatchCandidate& b ) const
+	{
+		return a.m_entryFraction < b.m_entryFraction || (a.m_entryFraction == b.m_entryFraction && a.m_candidateIndex < b.m_candidateIndex);
+	}
+};
+
+struct btQueryBatchCandidateCollector : public btBroadphaseAabbCallback
+{
+	btAlignedObjectArray<btCollisionObject*>&	m_candidates;
+
+	btQueryBatchCandidateCollector(btAlignedObjectArray<btCollisionObject*>& candidates)
+		:m_candidates(candidates)
+	{
+	}
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		m_candidates.push_back((btCollisionObject*)proxy->m_clientObject);
+		return true;
+	}
+};
+
+struct btBatchedSweepResultCallback : public btCollisionWorld::ConvexResultCallback
+{
+	btCollisionWorld::BatchedSweepResult*	m_result;
+
+	btBatchedSweepResultCallback(const btCollisionWorld::BatchedSweep& sweep,btCollisionWorld::BatchedSweepResult* result)
+		:m_result(result)
+	{
+		m_collisionFilterGroup = sweep.m_collisionFilterGroup;
+		m_collisionFilterMask = sweep.m_collisionFilterMask;
+		m_result->m_hitCollisionObject = 0;
+		m_result->m_hitFraction = btScalar(1.);
+	}
+
+	virtual	btScalar	addSingleResult(btCollisionWorld::LocalConvexResult& convexResult,bool normalInWorldSpace)
+	{
+		//caller already does the filter on the m_closestHitFraction
+		btAssert(convexResult.m_hitFraction <= m_closestHitFraction);
+
+		m_closestHitFraction = convexResult.m_hitFraction;
+		m_result->m_hitFraction = convexResult.m_hitFraction;
+		m_result->m_hitCollisionObject = convexResult.m_hitCollisionObject;
+		if (normalInWorldSpace)
+		{
+			m_result->m_hitNormalWorld = convexResult.m_hitNormalLocal;
+		} else
+		{
+			///need to transform normal into worldspace
+			m_result->m_hitNormalWorld = convexResult.m_hitCollisionObject->getWorldTransform().getBasis()*convexResult.m_hitNormalLocal;
+		}
+		m_result->m_hitPointWorld = convexResult.m_hitPointLocal;
+		return convexResult.m_hitFraction;
+	}
+};
+
+///btConvexSweepBatchedObject is objectQuerySingle, except that compound children are swept without replacing the shape of the collision object, so several threads can sweep against the same object
+static void	btConvexSweepBatchedObject(const btConvexShape* castShape,const btTransform& convexFromTrans,const btTransform& convexToTrans,
+					  btCollisionObject* collisionObject,
+					  const btCollisionShape* collisionShape,
+					  const btTransform& colObjWorldTransform,
+					  btCollisionWorld::ConvexResultCallback& resultCallback, btScalar allowedPenetration)
+{
+	if (collisionShape->isCompound())
+	{
+		const btCompoundShape* compoundShape = static_cast<const btCompoundShape*>(collisionShape);
+		for (int i=0;i<compoundShape->getNumChildShapes();i++)
+		{
+			btTransform childWorldTrans = colObjWorldTransform * compoundShape->getChildTransform(i);
+			btConvexSweepBatchedObject(castShape,convexFromTrans,convexToTrans,collisionObject,compoundShape->getChildShape(i),childWorldTrans,resultCallback,allowedPenetration);
+		}
+		return;
+	}
+	btCollisionWorld::objectQuerySingle(castShape,convexFromTrans,convexToTrans,collisionObject,collisionShape,colObjWorldTransform,resultCallback,allowedPenetration);
+}
+
+struct btSweepBatchContext
+{
+	btBroadphaseInterface*	m_broadphase;
+	const btCollisionWorld::BatchedSweep*	m_sweeps;
+	btCollisionWorld::BatchedSweepResult*	m_results;
+	///the bounds of each cast shape around its origin, including the rotation of the sweep
+	const btVector3*	m_castAabbMin;
+	const btVector3*	m_castAabbMax;
+	const btQueryBatchItem*	m_items;
+	const btQueryBatchCluster*	m_clusters;
+	int		m_numClusters;
+	int		m_clustersPerTask;
+};
+
+static void	btConvexSweepBatchCluster(const btSweepBatchContext& context,const btQueryBatchCluster& cluster,
+										btAlignedObjectArray<btCollisionObject*>& candidates,btAlignedObjectArray<btSweepBatchCandidate>& sortedCandidates)
+{
+	//one broadphase query for all sweeps of the cluster
+	candidates.resize(0);
+	btQueryBatchCandidateCollector collector(candidates);
+	context.m_broadphase->aabbTest(cluster.m_aabbMin,cluster.m_aabbMax,collector);
+	if (!candidates.size())
+		return;
+
+	for (int i=0;i<cluster.m_numItems;i++)
+	{
+		const int sweepIndex = context.m_items[cluster.m_firstItem+i].m_queryIndex;
+		const btCollisionWorld::BatchedSweep& sweep = context.m_sweeps[sweepIndex];
+		btBatchedSweepResultCallback resultCallback(sweep,&context.m_results[sweepIndex]);
+
+		const btVector3& rayFrom = sweep.m_convexFromWorld.getOrigin();
+		btVector3 rayDirection = sweep.m_convexToWorld.getOrigin()-rayFrom;
+		btVector3 rayDirectionInverse;
+		int axis;
+		for (axis=0;axis<3;axis++)
+		{
+			rayDirectionInverse[axis] = rayDirection[axis] == btScalar(0.0) ? btScalar(BT_LARGE_FLOAT) : btScalar(1.0) / rayDirection[axis];
+		}
+
+		//the origin of the cast shape needs to enter the candidate aabb grown by the cast shape aabb, where it enters is the earliest possible hit fraction
+		sortedCandidates.resize(0);
+		for (int j=0;j<candidates.size();j++)
+		{
+			btBroadphaseProxy* proxy = candidates[j]->getBroadphaseHandle();
+			if (!resultCallback.needsCollision(proxy))
+				continue;
+			btVector3 boxMin = proxy->m_aabbMin;
+			btVector3 boxMax = proxy->m_aabbMax;
+			AabbExpand(boxMin,boxMax,context.m_castAabbMin[sweepIndex],context.m_castAabbMax[sweepIndex]);
+			btScalar tmin = btScalar(0.);
+			btScalar tmax = btScalar(1.);
+			for (axis=0;axis<3;axis++)
+			{
+				btScalar t0 = (boxMin[axis]-rayFrom[axis])*rayDirectionInverse[axis];
+				btScalar t1 = (boxMax[axis]-rayFrom[axis])*rayDirectionInverse[axis];
+				tmin = btMax(tmin,btMin(t0,t1));
+				tmax = btMin(tmax,btMax(t0,t1));
+			}
+			if (tmin <= tmax)
+			{
+				btSweepBatchCandidate candidate;
+				candidate.m_entryFraction = tmin;
+				candidate.m_candidateIndex = j;
+				sortedCandidates.push_back(candidate);
+			}
+		}
+		sortedCandidates.quickSort(btSweepBatchCandidateSortPredicate());
+
+		for (int k=0;k<sortedCandidates.size();k++)
+		{
+			//a hit needs to be closer than the closest hit so far, the remaining candidates are entered even later
+			if (sortedCandidates[k].m_entryFraction >= resultCallback.m_closestHitFraction)
+				break;
+			btCollisionObject* collisionObject = candidates[sortedCandidates[k].m_candidateIndex];
+			btConvexSweepBatchedObject(sweep.m_castShape,sweep.m_convexFromWorld,sweep.m_convexToWorld,
+				collisionObject,
+				collisionObject->getCollisionShape(),
+				collisionObject->getWorldTransform(),
+				resultCallback,
+				sweep.m_allowedCcdPenetration);
+		}
+	}
+}
+
+static void	btSweepBatchTask(void* userPtr, int taskIndex)
+{
+	BT_PROFILE("convexSweepTestBatchTask");
+	const btSweepBatchContext& context = *(const btSweepBatchContext*)userPtr;
+	btAlignedObjectArray<btCollisionObject*> candidates;
+	btAlignedObjectArray<btSweepBatchCandidate> sortedCandidates;
+	int firstCluster = taskIndex*context.m_clustersPerTask;
+	int endCluster = btMin(firstCluster+context.m_clustersPerTask,context.m_numClusters);
+	for (int i=firstCluster;i<endCluster;i++)
+	{
+		btConvexSweepBatchCluster(context,context.m_clusters[i],candidates,sortedCandidates);
+	}
+}
+
+void	btCollisionWorld::convexSweepTestBatch(const BatchedSweep* sweeps, int numSweeps, BatchedSweepResult* results, int maxThreads) const
+{
+	BT_PROFILE("convexSweepTestBatch");
+	if (numSweeps <= 0)
+		return;
+
+	//the bounds of each cast shape are computed once, they are rotated with the sweeps
+	btHashMap<btHashPtr,int> shapeInfoIndices;
+	btAlignedObjectArray<btSweepBatchShapeInfo> shapeInfos;
+	btAlignedObjectArray<btVector3> castAabbMin;
+	btAlignedObjectArray<btVector3> castAabbMax;
+	btAlignedObjectArray<btQueryBatchItem> items;
+	castAabbMin.resize(numSweeps);
+	castAabbMax.resize(numSweeps);
+	items.resize(numSweeps);
+	int i;
+	for (i=0;i<numSweeps;i++)
+	{
+		const BatchedSweep& sweep = sweeps[i];
+		const int* shapeInfoIndex = shapeInfoIndices.find(btHashPtr(sweep.m_castShape));
+		int infoIndex;
+		if (shapeInfoIndex)
+		{
+			infoIndex = *shapeInfoIndex;
+		} else
+		{
+			infoIndex = shapeInfos.size();
+			btSweepBatchShapeInfo& info = shapeInfos.expand();
+			btTransform identity;
+			identity.setIdentity();
+			sweep.m_castShape->getAabb(identity,info.m_localAabbMin,info.m_localAabbMax);
+			info.m_angularMotionDisc = sweep.m_castShape->getAngularMotionDisc();
+			shapeInfoIndices.insert(btHashPtr(sweep.m_castShape),infoIndex);
+		}
+		const btSweepBatchShapeInfo& info = shapeInfos[infoIndex];
+
+		/* Compute AABB that encompasses angular movement, like convexSweepTest */
+		btVector3 linVel, angVel;
+		btTransformUtil::calculateVelocity (sweep.m_convexFromWorld, sweep.m_convexToWorld, 1.0, linVel, angVel);
+		btTransform R;
+		R.setIdentity ();
+		R.setRotation (sweep.m_convexFromWorld.getRotation());
+		btTransformAabb(info.m_localAabbMin,info.m_localAabbMax,btScalar(0.),R,castAabbMin[i],castAabbMax[i]);
+		btScalar angularMotion = angVel.length() * info.m_angularMotionDisc;
+		btVector3 angularMotion3d(angularMotion,angularMotion,angularMotion);
+		castAabbMin[i] -= angularMotion3d;
+		castAabbMax[i] += angularMotion3d;
+
+		btQueryBatchItem& item = items[i];
+		item.m_queryIndex = i;
+		item.m_aabbMin = sweep.m_convexFromWorld.getOrigin();
+		item.m_aabbMax = sweep.m_convexFromWorld.getOrigin();
+		item.m_aabbMin.setMin(sweep.m_convexToWorld.getOrigin());
+		item.m_aabbMax.setMax(sweep.m_convexToWorld.getOrigin());
+		item.m_aabbMin += castAabbMin[i];
+		item.m_aabbMax += castAabbMax[i];
+	}
+
+	btAlignedObjectArray<btQueryBatchCluster> clusters;
+	btBuildQueryBatchClusters(items,clusters);
+
+	btSweepBatchContext context;
+	context.m_broadphase = m_broadphasePairCache;
+	context.m_sweeps = sweeps;
+	context.m_results = results;
+	context.m_castAabbMin = &castAabbMin[0];
+	context.m_castAabbMax = &castAabbMax[0];
+	context.m_items = &items[0];
+	context.m_clusters = &clusters[0];
+	context.m_numClusters = clusters.size();
+	context.m_clustersPerTask = clusters.size();
+
+	int numThreads = 1;
+	if (maxThreads > 1 && numSweeps >= BT_SWEEP_BATCH_MIN_THREADED_SWEEPS && supportsConcurrentQueries())
+	{
+		numThreads = maxThreads;
+		context.m_clustersPerTask = BT_QUERY_BATCH_CLUSTERS_PER_TASK;
+	}
+	int numTasks = (context.m_numClusters+context.m_clustersPerTask-1)/context.m_clustersPerTask;
+	btParallelFor(numTasks,btSweepBatchTask,&context,numThreads);
+}
+
+
 struct btBridgedManifoldResult : public btManifoldResult
 {
 
@@ -1044,6 +1830,267 @@ void	btCollisionWorld::contactPairTest(btCollisionObject* colObjA, btCollisionOb
 }
 
 
+///btConvexShapesOverlap returns true when the GJK distance between the shapes, including their margins, is negative
+static bool	btConvexShapesOverlap(const btConvexShape* shapeA,const btTransform& transformA,const btConvexShape* shapeB,const btTransform& transformB)
+{
+	btVoronoiSimplexSolver	simplexSolver;
+	btGjkEpaPenetrationDepthSolver	gjkEpaPenetrationSolver;
+	btGjkPairDetector	gjkPairDetector(shapeA,shapeB,&simplexSolver,&gjkEpaPenetrationSolver);
+	btGjkPairDetector::ClosestPointInput input;
+	input.m_transformA = transformA;
+	input.m_transformB = transformB;
+	//only the sign of the distance matters, so GJK can stop as soon as the shapes are separated by more than their margins
+	btScalar marginSum = shapeA->getMargin() + shapeB->getMargin();
+	input.m_maximumDistanceSquared = marginSum * marginSum;
+	btPointCollector	pointCollector;
+	gjkPairDetector.getClosestPoints(input,pointCollector,0);
+	return pointCollector.m_hasResult && pointCollector.m_distance < btScalar(0.);
+}
+
+///btOverlapTriangleCallback tests the triangles of a concave shape until one of them overlaps the query shape
+struct btOverlapTriangleCallback : public btTriangleCallback
+{
+	const btConvexShape*	m_shape;
+	btTransform	m_shapeTransform;
+	btScalar	m_triangleMargin;
+	bool		m_overlaps;
+
+	btOverlapTriangleCallback(const btConvexShape* shape,const btTransform& shapeTransform,btScalar triangleMargin)
+		:m_shape(shape),
+		m_shapeTransform(shapeTransform),
+		m_triangleMargin(triangleMargin),
+		m_overlaps(false)
+	{
+	}
+
+	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+	{
+		(void)partId;
+		(void)triangleIndex;
+		if (m_overlaps)
+			return;
+		btTriangleShape triangleShape(triangle[0],triangle[1],triangle[2]);
+		triangleShape.setMargin(m_triangleMargin);
+		btTransform identity;
+		identity.setIdentity();
+		m_overlaps = btConvexShapesOverlap(m_shape,m_shapeTransform,&triangleShape,identity);
+	}
+};
+
+///btShapeOverlapsQuery is the narrowphase of the overlap queries, compound children and triangles are only tested when they overlap the query aabb
+static bool	btShapeOverlapsQuery(const btConvexShape* shape,const btTransform& shapeTransform,const btVector3& queryAabbMin,const btVector3& queryAabbMax,
+								 const btCollisionShape* collisionShape,const btTransform& colObjWorldTransform)
+{
+	if (collisionShape->isConvex())
+	{
+		return btConvexShapesOverlap(shape,shapeTransform,static_cast<const btConvexShape*>(collisionShape),colObjWorldTransform);
+	}
+	if (collisionShape->isCompound())
+	{
+		const btCompoundShape* compoundShape = static_cast<const btCompoundShape*>(collisionShape);
+		for (int i=0;i<compoundShape->getNumChildShapes();i++)
+		{
+			btTransform childWorldTrans = colObjWorldTransform * compoundShape->getChildTransform(i);
+			const btCollisionShape* childShape = compoundShape->getChildShape(i);
+			btVector3 childAabbMin,childAabbMax;
+			childShape->getAabb(childWorldTrans,childAabbMin,childAabbMax);
+			if (TestAabbAgainstAabb2(queryAabbMin,queryAabbMax,childAabbMin,childAabbMax) &&
+				btShapeOverlapsQuery(shape,shapeTransform,queryAabbMin,queryAabbMax,childShape,childWorldTrans))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+	if (collisionShape->isConcave())
+	{
+		const btConcaveShape* concaveShape = static_cast<const btConcaveShape*>(collisionShape);
+		btTransform shapeTransformLocal = colObjWorldTransform.inverse() * shapeTransform;
+		btVector3 localAabbMin,localAabbMax;
+		shape->getAabb(shapeTransformLocal,localAabbMin,localAabbMax);
+		btOverlapTriangleCallback triangleCallback(shape,shapeTransformLocal,concaveShape->getMargin());
+		concaveShape->processAllTriangles(&triangleCallback,localAabbMin,localAabbMax);
+		return triangleCallback.m_overlaps;
+	}
+	return false;
+}
+
+struct btSingleOverlapCallback : public btBroadphaseAabbCallback
+{
+	const btConvexShape*	m_shape;
+	btTransform	m_shapeTransform;
+	btVector3	m_aabbMin;
+	btVector3	m_aabbMax;
+	btCollisionWorld::OverlapResultCallback&	m_resultCallback;
+	bool	m_exactTest;
+	bool	m_stopped;
+
+	btSingleOverlapCallback(const btConvexShape* shape,const btTransform& shapeTransform,const btVector3& aabbMin,const btVector3& aabbMax,
+		btCollisionWorld::OverlapResultCallback& resultCallback,bool exactTest)
+		:m_shape(shape),
+		m_shapeTransform(shapeTransform),
+		m_aabbMin(aabbMin),
+		m_aabbMax(aabbMax),
+		m_resultCallback(resultCallback),
+		m_exactTest(exactTest),
+		m_stopped(false)
+	{
+	}
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		if (m_stopped)
+			return false;
+		btCollisionObject* collisionObject = (btCollisionObject*)proxy->m_clientObject;
+		if (!m_resultCallback.needsCollision(collisionObject->getBroadphaseHandle()))
+			return true;
+		if (m_exactTest && !btShapeOverlapsQuery(m_shape,m_shapeTransform,m_aabbMin,m_aabbMax,collisionObject->getCollisionShape(),collisionObject->getWorldTransform()))
+			return true;
+		m_stopped = !m_resultCallback.addOverlappingObject(collisionObject);
+		return !m_stopped;
+	}
+};
+
+void	btCollisionWorld::overlapTest(const btConvexShape* shape, const btTransform& transform, OverlapResultCallback& resultCallback, bool exactTest) const
+{
+	BT_PROFILE("overlapTest");
+	btVector3 aabbMin,aabbMax;
+	shape->getAabb(transform,aabbMin,aabbMax);
+	btSingleOverlapCallback overlapCallback(shape,transform,aabbMin,aabbMax,resultCallback,exactTest);
+	m_broadphasePairCache->aabbTest(aabbMin,aabbMax,overlapCallback);
+}
+
+void	btCollisionWorld::sphereOverlapTest(const btVector3& center, btScalar radius, OverlapResultCallback& resultCallback, bool exactTest) const
+{
+	btSphereShape sphere(radius);
+	btTransform transform;
+	transform.setIdentity();
+	transform.setOrigin(center);
+	overlapTest(&sphere,transform,resultCallback,exactTest);
+}
+
+void	btCollisionWorld::boxOverlapTest(const btVector3& boxHalfExtents, const btTransform& transform, OverlapResultCallback& resultCallback, bool exactTest) const
+{
+	btBoxShape box(boxHalfExtents);
+	overlapTest(&box,transform,resultCallback,exactTest);
+}
+
+struct btBatchedOverlapPairSortPredicate
+{
+	bool operator() ( const btCollisionWorld::BatchedOverlapPair& a, const btCollisionWorld::BatchedOverlapPair& b ) const
+	{
+		return a.m_queryIndex < b.m_queryIndex || (a.m_queryIndex == b.m_queryIndex &&
+			a.m_collisionObject->getBroadphaseHandle()->getUid() < b.m_collisionObject->getBroadphaseHandle()->getUid());
+	}
+};
+
+struct btOverlapBatchContext
+{
+	btBroadphaseInterface*	m_broadphase;
+	const btCollisionWorld::BatchedOverlap*	m_queries;
+	const btQueryBatchItem*	m_items;
+	const btQueryBatchCluster*	m_clusters;
+	int		m_numClusters;
+	int		m_clustersPerTask;
+	///each task collects its overlaps separately, overlapTestBatch merges and sorts them
+	btAlignedObjectArray<btCollisionWorld::BatchedOverlapPair>*	m_taskOverlaps;
+};
+
+static void	btOverlapTestBatchCluster(const btOverlapBatchContext& context,const btQueryBatchCluster& cluster,
+										btAlignedObjectArray<btCollisionObject*>& candidates,btAlignedObjectArray<btCollisionWorld::BatchedOverlapPair>& overlaps)
+{
+	//one broadphase query for all queries of the cluster
+	candidates.resize(0);
+	btQueryBatchCandidateCollector collector(candidates);
+	context.m_broadphase->aabbTest(cluster.m_aabbMin,cluster.m_aabbMax,collector);
+	if (!candidates.size())
+		return;
+
+	for (int i=0;i<cluster.m_numItems;i++)
+	{
+		const btQueryBatchItem& item = context.m_items[cluster.m_firstItem+i];
+		const btCollisionWorld::BatchedOverlap& query = context.m_queries[item.m_queryIndex];
+		for (int j=0;j<candidates.size();j++)
+		{
+			btCollisionObject* collisionObject = candidates[j];
+			const btBroadphaseProxy* proxy = collisionObject->getBroadphaseHandle();
+			bool collides = (proxy->m_collisionFilterGroup & query.m_collisionFilterMask) != 0;
+			collides = collides && (query.m_collisionFilterGroup & proxy->m_collisionFilterMask);
+			if (!collides || !TestAabbAgainstAabb2(item.m_aabbMin,item.m_aabbMax,proxy->m_aabbMin,proxy->m_aabbMax))
+				continue;
+			if (btShapeOverlapsQuery(query.m_shape,query.m_transform,item.m_aabbMin,item.m_aabbMax,collisionObject->getCollisionShape(),collisionObject->getWorldTransform()))
+			{
+				btCollisionWorld::BatchedOverlapPair& pair = overlaps.expand();
+				pair.m_queryIndex = item.m_queryIndex;
+				pair.m_collisionObject = collisionObject;
+			}
+		}
+	}
+}
+
+static void	btOverlapBatchTask(void* userPtr, int taskIndex)
+{
+	BT_PROFILE("overlapTestBatchTask");
+	const btOverlapBatchContext& context = *(const btOverlapBatchContext*)userPtr;
+	btAlignedObjectArray<btCollisionObject*> candidates;
+	int firstCluster = taskIndex*context.m_clustersPerTask;
+	int endCluster = btMin(firstCluster+context.m_clustersPerTask,context.m_numClusters);
+	for (int i=firstCluster;i<endCluster;i++)
+	{
+		btOverlapTestBatchCluster(context,context.m_clusters[i],candidates,context.m_taskOverlaps[taskIndex]);
+	}
+}
+
+void	btCollisionWorld::overlapTestBatch(const BatchedOverlap* queries, int numQueries, btAlignedObjectArray<BatchedOverlapPair>& overlaps, int maxThreads) const
+{
+	BT_PROFILE("overlapTestBatch");
+	overlaps.resize(0);
+	if (numQueries <= 0)
+		return;
+
+	btAlignedObjectArray<btQueryBatchItem> items;
+	items.resize(numQueries);
+	int i;
+	for (i=0;i<numQueries;i++)
+	{
+		items[i].m_queryIndex = i;
+		queries[i].m_shape->getAabb(queries[i].m_transform,items[i].m_aabbMin,items[i].m_aabbMax);
+	}
+	btAlignedObjectArray<btQueryBatchCluster> clusters;
+	btBuildQueryBatchClusters(items,clusters);
+
+	btOverlapBatchContext context;
+	context.m_broadphase = m_broadphasePairCache;
+	context.m_queries = queries;
+	context.m_items = &items[0];
+	context.m_clusters = &clusters[0];
+	context.m_numClusters = clusters.size();
+	context.m_clustersPerTask = clusters.size();
+	context.m_taskOverlaps = &overlaps;
+
+	if (maxThreads > 1 && numQueries >= BT_OVERLAP_BATCH_MIN_THREADED_QUERIES && supportsConcurrentQueries())
+	{
+		context.m_clustersPerTask = BT_QUERY_BATCH_CLUSTERS_PER_TASK;
+		int numTasks = (context.m_numClusters+context.m_clustersPerTask-1)/context.m_clustersPerTask;
+		btAlignedObjectArray<btAlignedObjectArray<BatchedOverlapPair> > taskOverlaps;
+		taskOverlaps.resize(numTasks);
+		context.m_taskOverlaps = &taskOverlaps[0];
+		btParallelFor(numTasks,btOverlapBatchTask,&context,maxThreads);
+		for (i=0;i<numTasks;i++)
+		{
+			for (int j=0;j<taskOverlaps[i].size();j++)
+			{
+				overlaps.push_back(taskOverlaps[i][j]);
+			}
+		}
+	} else
+	{
+		btOverlapBatchTask(&context,0);
+	}
+
+	overlaps.quickSort(btBatchedOverlapPairSortPredicate());
+}
+
 
 
 class DebugDrawcallback : public btTriangleCallback, public btInternalTriangleIndexCallback
@@ -303,6 +303,61 @@ public:
 		}
 	};
 
+	///BatchedRay is one ray of rayTestBatch, the filter and the flags are used like the ones of RayResultCallback
+	///m_ignoreObject is skipped by the ray, for example the body the ray starts from
+	struct	BatchedRay
+	{
+		btVector3	m_rayFromWorld;
+		btVector3	m_rayToWorld;
+		const btCollisionObject*	m_ignoreObject;
+		short int	m_collisionFilterGroup;
+		short int	m_collisionFilterMask;
+		unsigned int	m_flags;
+
+		BatchedRay()
+			:m_ignoreObject(0),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter),
+			m_flags(0)
+		{
+		}
+
+		BatchedRay(const btVector3& rayFromWorld,const btVector3& rayToWorld)
+			:m_rayFromWorld(rayFromWorld),
+			m_rayToWorld(rayToWorld),
+			m_ignoreObject(0),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter),
+			m_flags(0)
+		{
+		}
+	};
+
+	///BatchedRayResult is the hit of one ray of rayTestBatch, m_collisionObject is 0 when the ray hits nothing
+	struct	BatchedRayResult
+	{
+		btCollisionObject*	m_collisionObject;
+		btVector3	m_hitPointWorld;
+		btVector3	m_hitNormalWorld;
+		btScalar	m_hitFraction;
+		///the part and triangle index of mesh shapes, or -1 and the child index for compound shapes
+		int			m_shapePart;
+		int			m_triangleIndex;
+
+		bool	hasHit() const
+		{
+			return (m_collisionObject != 0);
+		}
+	};
+
+	enum	RayBatchMode
+	{
+		///find the closest hit of each ray
+		RAY_BATCH_CLOSEST_HIT,
+		///stop each ray at the first hit that is found, for visibility tests. It is not necessarily the closest hit.
+		RAY_BATCH_ANY_HIT
+	};
+
 
 	struct LocalConvexResult
 	{
@@ -398,6 +453,49 @@ public:
 		}
 	};
 
+	///BatchedSweep is one sweep of convexSweepTestBatch, the arguments have the same meaning as the ones of convexSweepTest
+	struct	BatchedSweep
+	{
+		const btConvexShape*	m_castShape;
+		btTransform	m_convexFromWorld;
+		btTransform	m_convexToWorld;
+		short int	m_collisionFilterGroup;
+		short int	m_collisionFilterMask;
+		btScalar	m_allowedCcdPenetration;
+
+		BatchedSweep()
+			:m_castShape(0),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter),
+			m_allowedCcdPenetration(btScalar(0.))
+		{
+		}
+
+		BatchedSweep(const btConvexShape* castShape,const btTransform& convexFromWorld,const btTransform& convexToWorld)
+			:m_castShape(castShape),
+			m_convexFromWorld(convexFromWorld),
+			m_convexToWorld(convexToWorld),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter),
+			m_allowedCcdPenetration(btScalar(0.))
+		{
+		}
+	};
+
+	///BatchedSweepResult is the closest hit of one sweep of convexSweepTestBatch, m_hitCollisionObject is 0 when the sweep hits nothing
+	struct	BatchedSweepResult
+	{
+		btCollisionObject*	m_hitCollisionObject;
+		btVector3	m_hitPointWorld;
+		btVector3	m_hitNormalWorld;
+		btScalar	m_hitFraction;
+
+		bool	hasHit() const
+		{
+			return (m_hitCollisionObject != 0);
+		}
+	};
+
 	///ContactResultCallback is used to report contact points
 	struct	ContactResultCallback
 	{
@@ -424,6 +522,75 @@ public:
 		virtual	btScalar	addSingleResult(btManifoldPoint& cp,	const btCollisionObject* colObj0,int partId0,int index0,const btCollisionObject* colObj1,int partId1,int index1) = 0;
 	};
 
+	///OverlapResultCallback receives the collision objects that overlap the query shape of overlapTest
+	struct	OverlapResultCallback
+	{
+		short int	m_collisionFilterGroup;
+		short int	m_collisionFilterMask;
+
+		OverlapResultCallback()
+			:m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter)
+		{
+		}
+
+		virtual ~OverlapResultCallback()
+		{
+		}
+
+		virtual bool needsCollision(btBroadphaseProxy* proxy0) const
+		{
+			bool collides = (proxy0->m_collisionFilterGroup & m_collisionFilterMask) != 0;
+			collides = collides && (m_collisionFilterGroup & proxy0->m_collisionFilterMask);
+			return collides;
+		}
+
+		///return false to stop the query
+		virtual	bool	addOverlappingObject(btCollisionObject* collisionObject) = 0;
+	};
+
+	struct	AllOverlapsResultCallback : public OverlapResultCallback
+	{
+		btAlignedObjectArray<btCollisionObject*>	m_collisionObjects;
+
+		virtual	bool	addOverlappingObject(btCollisionObject* collisionObject)
+		{
+			m_collisionObjects.push_back(collisionObject);
+			return true;
+		}
+	};
+
+	///BatchedOverlap is one query of overlapTestBatch, for example a trigger volume
+	struct	BatchedOverlap
+	{
+		const btConvexShape*	m_shape;
+		btTransform	m_transform;
+		short int	m_collisionFilterGroup;
+		short int	m_collisionFilterMask;
+
+		BatchedOverlap()
+			:m_shape(0),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter)
+		{
+		}
+
+		BatchedOverlap(const btConvexShape* shape,const btTransform& transform)
+			:m_shape(shape),
+			m_transform(transform),
+			m_collisionFilterGroup(btBroadphaseProxy::DefaultFilter),
+			m_collisionFilterMask(btBroadphaseProxy::AllFilter)
+		{
+		}
+	};
+
+	///BatchedOverlapPair is one overlapping collision object of the query m_queryIndex
+	struct	BatchedOverlapPair
+	{
+		int	m_queryIndex;
+		btCollisionObject*	m_collisionObject;
+	};
+
 
 
 	int	getNumCollisionObjects() const
@@ -431,14 +598,29 @@ public:
 		return int(m_collisionObjects.size());
 	}
 
+	///supportsConcurrentQueries returns false if a shape in the world can't be queried from several threads at once, the batched queries then run on the calling thread.
+	///This is the case for GImpact shapes, also as children of a btCompoundShape, because every query locks and unlocks their mesh.
+	bool	supportsConcurrentQueries() const;
+
 	/// rayTest performs a raycast on all objects in the btCollisionWorld, and calls the resultCallback
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value returned by the callback.
 	virtual void rayTest(const btVector3& rayFromWorld, const btVector3& rayToWorld, RayResultCallback& resultCallback) const; 
 
+	/// rayTestBatch traces numRays rays and writes one result per ray. The rays are sorted into coherent packets of BT_RAY_PACKET_SIZE rays,
+	/// and each packet walks the broadphase and the wide trees of btBvhTriangleMeshShape together, see btBroadphaseInterface::rayPacketTest.
+	/// With maxThreads > 1 large batches are split across the threads of the task pool, see btParallelFor. The mesh interfaces then need to support concurrent reads.
+	/// Worlds with GImpact shapes are queried on the calling thread only, see supportsConcurrentQueries.
+	void	rayTestBatch(const BatchedRay* rays, int numRays, BatchedRayResult* results, RayBatchMode mode=RAY_BATCH_CLOSEST_HIT, int maxThreads=1) const;
+
 	/// convexTest performs a swept convex cast on all objects in the btCollisionWorld, and calls the resultCallback
 	/// This allows for several queries: first hit, all hits, any hit, dependent on the value return by the callback.
 	void    convexSweepTest (const btConvexShape* castShape, const btTransform& from, const btTransform& to, ConvexResultCallback& resultCallback,  btScalar allowedCcdPenetration = btScalar(0.)) const;
 
+	/// convexSweepTestBatch finds the closest hit of each of numSweeps sweeps. Sweeps with nearby swept aabbs are clustered and share one broadphase query,
+	/// and the aabb and angular motion disc of each cast shape are computed once per batch. Each sweep tests its candidates nearest first and stops at its closest hit.
+	/// With maxThreads > 1 the clusters of large batches are evaluated on the threads of the task pool, unless the world contains GImpact shapes, see supportsConcurrentQueries.
+	void	convexSweepTestBatch(const BatchedSweep* sweeps, int numSweeps, BatchedSweepResult* results, int maxThreads=1) const;
+
 	///contactTest performs a discrete collision test between colObj against all objects in the btCollisionWorld, and calls the resultCallback.
 	///it reports one or more contact points for every overlapping object (including the one with deepest penetration)
 	void	contactTest(btCollisionObject* colObj, ContactResultCallback& resultCallback);
@@ -447,6 +629,20 @@ public:
 	///it reports one or more contact points (including the one with deepest penetration)
 	void	contactPairTest(btCollisionObject* colObjA, btCollisionObject* colObjB, ContactResultCallback& resultCallback);
 
+	///overlapTest reports all collision objects that overlap the convex shape at the given transform. It queries the broadphase tree directly,
+	///so trigger volumes don't need a btPairCachingGhostObject with a pair cache that is updated every simulation step.
+	///With exactTest the candidates of the broadphase are filtered by a GJK test against their (child) shapes and triangles, otherwise aabb overlap is enough.
+	void	overlapTest(const btConvexShape* shape, const btTransform& transform, OverlapResultCallback& resultCallback, bool exactTest=true) const;
+
+	void	sphereOverlapTest(const btVector3& center, btScalar radius, OverlapResultCallback& resultCallback, bool exactTest=true) const;
+
+	void	boxOverlapTest(const btVector3& boxHalfExtents, const btTransform& transform, OverlapResultCallback& resultCallback, bool exactTest=true) const;
+
+	///overlapTestBatch runs the exact overlapTest for numQueries queries, queries with nearby aabbs share one broadphase query.
+	///The overlaps are returned sorted by query index, and for each query in the order the collision objects were added to the broadphase.
+	///With maxThreads > 1 large batches are evaluated on the threads of the task pool, unless the world contains GImpact shapes, see supportsConcurrentQueries.
+	void	overlapTestBatch(const BatchedOverlap* queries, int numQueries, btAlignedObjectArray<BatchedOverlapPair>& overlaps, int maxThreads=1) const;
+
 
 	/// rayTestSingle performs a raycast call and calls the resultCallback. It is used internally by rayTest.
 	/// In a future implementation, we consider moving the ray test as a virtual method in btCollisionShape.
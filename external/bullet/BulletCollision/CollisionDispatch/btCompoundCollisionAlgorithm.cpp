@@ -19,12 +19,14 @@ subject to the following restrictions:
 #include "BulletCollision/BroadphaseCollision/btDbvt.h"
 #include "LinearMath/btIDebugDraw.h"
 #include "LinearMath/btAabbUtil2.h"
+#include "LinearMath/btHashMap.h"
 #include "btManifoldResult.h"
 
 btCompoundCollisionAlgorithm::btCompoundCollisionAlgorithm( const btCollisionAlgorithmConstructionInfo& ci,btCollisionObject* body0,btCollisionObject* body1,bool isSwapped)
 :btActivatingCollisionAlgorithm(ci,body0,body1),
 m_isSwapped(isSwapped),
-m_sharedManifold(ci.m_manifold)
+m_sharedManifold(ci.m_manifold),
+m_processCounter(0)
 {
 	m_ownsManifold = false;
 
@@ -49,8 +51,11 @@ void	btCompoundCollisionAlgorithm::preallocateChildAlgorithms(btCollisionObject*
 	int i;
 	
 	m_childCollisionAlgorithms.resize(numChildren);
+	m_childUniqueIds.resize(numChildren);
+	m_childLastUsed.resize(numChildren,-1);
 	for (i=0;i<numChildren;i++)
 	{
+		m_childUniqueIds[i] = compoundShape->getChildUniqueId(i);
 		if (compoundShape->getDynamicAabbTree())
 		{
 			m_childCollisionAlgorithms[i] = 0;
@@ -65,6 +70,75 @@ void	btCompoundCollisionAlgorithm::preallocateChildAlgorithms(btCollisionObject*
 	}
 }
 
+void	btCompoundCollisionAlgorithm::updateChildAlgorithms(btCollisionObject* body0,btCollisionObject* body1)
+{
+	btCollisionObject* colObj = m_isSwapped? body1 : body0;
+	btCollisionObject* otherObj = m_isSwapped? body0 : body1;
+	btCompoundShape* compoundShape = static_cast<btCompoundShape*>(colObj->getCollisionShape());
+
+	btAlignedObjectArray<btCollisionAlgorithm*> oldAlgorithms;
+	btAlignedObjectArray<int> oldUniqueIds;
+	oldAlgorithms.copyFromArray(m_childCollisionAlgorithms);
+	oldUniqueIds.copyFromArray(m_childUniqueIds);
+
+	//children that didn't move keep their index, the others are found by their unique id
+	btHashMap<btHashInt,int> oldIndices;
+	bool oldIndicesBuilt = false;
+
+	int numChildren = compoundShape->getNumChildShapes();
+	m_childCollisionAlgorithms.resize(numChildren);
+	m_childUniqueIds.resize(numChildren);
+	m_childLastUsed.resize(numChildren,-1);
+	int i;
+	for (i=0;i<numChildren;i++)
+	{
+		int uniqueId = compoundShape->getChildUniqueId(i);
+		int oldIndex = -1;
+		if (i < oldUniqueIds.size() && oldUniqueIds[i] == uniqueId)
+		{
+			oldIndex = i;
+		} else
+		{
+			if (!oldIndicesBuilt)
+			{
+				for (int j=0;j<oldUniqueIds.size();j++)
+					oldIndices.insert(oldUniqueIds[j],j);
+				oldIndicesBuilt = true;
+			}
+			int* found = oldIndices.find(uniqueId);
+			if (found)
+				oldIndex = *found;
+		}
+
+		m_childUniqueIds[i] = uniqueId;
+		if (oldIndex >= 0)
+		{
+			m_childCollisionAlgorithms[i] = oldAlgorithms[oldIndex];
+			oldAlgorithms[oldIndex] = 0;
+		} else if (compoundShape->getDynamicAabbTree())
+		{
+			m_childCollisionAlgorithms[i] = 0;
+		} else
+		{
+			btCollisionShape* tmpShape = colObj->getCollisionShape();
+			colObj->internalSetTemporaryCollisionShape( compoundShape->getChildShape(i) );
+			m_childCollisionAlgorithms[i] = m_dispatcher->findAlgorithm(colObj,otherObj,m_sharedManifold);
+			colObj->internalSetTemporaryCollisionShape( tmpShape );
+		}
+	}
+
+	//release the algorithms of removed children
+	for (i=0;i<oldAlgorithms.size();i++)
+	{
+		if (oldAlgorithms[i])
+		{
+			oldAlgorithms[i]->~btCollisionAlgorithm();
+			m_dispatcher->freeCollisionAlgorithm(oldAlgorithms[i]);
+		}
+	}
+	m_compoundShapeRevision = compoundShape->getUpdateRevision();
+}
+
 void	btCompoundCollisionAlgorithm::removeChildAlgorithms()
 {
 	int numChildren = m_childCollisionAlgorithms.size();
@@ -99,14 +173,18 @@ public:
 	btManifoldResult*	m_resultOut;
 	btCollisionAlgorithm**	m_childCollisionAlgorithms;
 	btPersistentManifold*	m_sharedManifold;
+	int*	m_childLastUsed;
+	int		m_processCounter;
 
 
 
 
-	btCompoundLeafCallback (btCollisionObject* compoundObj,btCollisionObject* otherObj,btDispatcher* dispatcher,const btDispatcherInfo& dispatchInfo,btManifoldResult*	resultOut,btCollisionAlgorithm**	childCollisionAlgorithms,btPersistentManifold*	sharedManifold)
+	btCompoundLeafCallback (btCollisionObject* compoundObj,btCollisionObject* otherObj,btDispatcher* dispatcher,const btDispatcherInfo& dispatchInfo,btManifoldResult*	resultOut,btCollisionAlgorithm**	childCollisionAlgorithms,btPersistentManifold*	sharedManifold,int* childLastUsed,int processCounter)
 		:m_compoundColObj(compoundObj),m_otherObj(otherObj),m_dispatcher(dispatcher),m_dispatchInfo(dispatchInfo),m_resultOut(resultOut),
 		m_childCollisionAlgorithms(childCollisionAlgorithms),
-		m_sharedManifold(sharedManifold)
+		m_sharedManifold(sharedManifold),
+		m_childLastUsed(childLastUsed),
+		m_processCounter(processCounter)
 	{
 
 	}
@@ -142,6 +220,7 @@ public:
 
 			if (!m_childCollisionAlgorithms[index])
 				m_childCollisionAlgorithms[index] = m_dispatcher->findAlgorithm(m_compoundColObj,m_otherObj,m_sharedManifold);
+			m_childLastUsed[index] = m_processCounter;
 
 			///detect swapping case
 			if (m_resultOut->getBody0Internal() == m_compoundColObj)
@@ -203,16 +282,15 @@ void btCompoundCollisionAlgorithm::processCollision (btCollisionObject* body0,bt
 	////make sure the internal child collision algorithm caches are still valid
 	if (compoundShape->getUpdateRevision() != m_compoundShapeRevision)
 	{
-		///clear and update all
-		removeChildAlgorithms();
-		
-		preallocateChildAlgorithms(body0,body1);
+		updateChildAlgorithms(body0,body1);
 	}
 
 
+	m_processCounter++;
+
 	btDbvt* tree = compoundShape->getDynamicAabbTree();
 	//use a dynamic aabb tree to cull potential child-overlaps
-	btCompoundLeafCallback  callback(colObj,otherObj,m_dispatcher,dispatchInfo,resultOut,&m_childCollisionAlgorithms[0],m_sharedManifold);
+	btCompoundLeafCallback  callback(colObj,otherObj,m_dispatcher,dispatchInfo,resultOut,&m_childCollisionAlgorithms[0],m_sharedManifold,&m_childLastUsed[0],m_processCounter);
 
 	///we need to refresh all contact manifolds
 	///note that we should actually recursively traverse all children, btCompoundShape can nested more then 1 level deep
@@ -288,7 +366,9 @@ void btCompoundCollisionAlgorithm::processCollision (btCollisionObject* body0,bt
 				childShape->getAabb(newChildWorldTrans,aabbMin0,aabbMax0);
 				otherObj->getCollisionShape()->getAabb(otherObj->getWorldTransform(),aabbMin1,aabbMax1);
 
-				if (!TestAabbAgainstAabb2(aabbMin0,aabbMax0,aabbMin1,aabbMax1))
+				//in deterministic mode children that were culled by the tree are removed as well, a contact manifold can't outlive the processing of its child
+				if (!TestAabbAgainstAabb2(aabbMin0,aabbMax0,aabbMin1,aabbMax1) ||
+					(dispatchInfo.m_deterministic && (m_childLastUsed[i] != m_processCounter)))
 				{
 					m_childCollisionAlgorithms[i]->~btCollisionAlgorithm();
 					m_dispatcher->freeCollisionAlgorithm(m_childCollisionAlgorithms[i]);
@@ -32,17 +32,26 @@ class btCollisionObject;
 class btCompoundCollisionAlgorithm  : public btActivatingCollisionAlgorithm
 {
 	btAlignedObjectArray<btCollisionAlgorithm*> m_childCollisionAlgorithms;
+	///the unique id of the child each algorithm was created for, see btCompoundShape::getChildUniqueId
+	btAlignedObjectArray<int>	m_childUniqueIds;
 	bool m_isSwapped;
 
 	class btPersistentManifold*	m_sharedManifold;
 	bool					m_ownsManifold;
 
 	int	m_compoundShapeRevision;//to keep track of changes, so that childAlgorithm array can be updated
+
+	///the last processCollision that processed each child, in deterministic mode the algorithms of the other children are removed
+	btAlignedObjectArray<int>	m_childLastUsed;
+	int	m_processCounter;
 	
 	void	removeChildAlgorithms();
 	
 	void	preallocateChildAlgorithms(btCollisionObject* body0,btCollisionObject* body1);
 
+	///updateChildAlgorithms keeps the algorithms (and contact manifolds) of the children that are still in the compound shape
+	void	updateChildAlgorithms(btCollisionObject* body0,btCollisionObject* body1);
+
 public:
 
 	btCompoundCollisionAlgorithm( const btCollisionAlgorithmConstructionInfo& ci,btCollisionObject* body0,btCollisionObject* body1,bool isSwapped);
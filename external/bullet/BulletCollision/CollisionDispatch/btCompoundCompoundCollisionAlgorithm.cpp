@@ -0,0 +1,325 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "BulletCollision/CollisionDispatch/btCompoundCompoundCollisionAlgorithm.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "LinearMath/btAabbUtil2.h"
+#include "btManifoldResult.h"
+
+btCompoundCompoundCollisionAlgorithm::btCompoundCompoundCollisionAlgorithm( const btCollisionAlgorithmConstructionInfo& ci,btCollisionObject* body0,btCollisionObject* body1)
+:btActivatingCollisionAlgorithm(ci,body0,body1),
+m_sharedManifold(ci.m_manifold),
+m_processCounter(0)
+{
+	btAssert (body0->getCollisionShape()->isCompound() && body1->getCollisionShape()->isCompound());
+}
+
+btCompoundCompoundCollisionAlgorithm::~btCompoundCompoundCollisionAlgorithm()
+{
+	removeChildAlgorithms();
+}
+
+void	btCompoundCompoundCollisionAlgorithm::removeChildAlgorithms()
+{
+	int i;
+	for (i=0;i<m_childPairs.size();i++)
+	{
+		btCollisionAlgorithm* algorithm = m_childPairs.getAtIndex(i)->m_algorithm;
+		algorithm->~btCollisionAlgorithm();
+		m_dispatcher->freeCollisionAlgorithm(algorithm);
+	}
+	m_childPairs.clear();
+}
+
+void	btCompoundCompoundCollisionAlgorithm::processChildPair(btCollisionObject* body0,btCollisionObject* body1,int childIndex0,int childIndex1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut)
+{
+	btCompoundShape* compoundShape0 = static_cast<btCompoundShape*>(body0->getCollisionShape());
+	btCompoundShape* compoundShape1 = static_cast<btCompoundShape*>(body1->getCollisionShape());
+	btCollisionShape* childShape0 = compoundShape0->getChildShape(childIndex0);
+	btCollisionShape* childShape1 = compoundShape1->getChildShape(childIndex1);
+
+	//backup
+	btTransform	orgTrans0 = body0->getWorldTransform();
+	btTransform	orgInterpolationTrans0 = body0->getInterpolationWorldTransform();
+	btTransform	orgTrans1 = body1->getWorldTransform();
+	btTransform	orgInterpolationTrans1 = body1->getInterpolationWorldTransform();
+	btTransform	newChildWorldTrans0 = orgTrans0*compoundShape0->getChildTransform(childIndex0);
+	btTransform	newChildWorldTrans1 = orgTrans1*compoundShape1->getChildTransform(childIndex1);
+
+	//the trees are tested in the space of body0, check the children in world space like btCompoundCollisionAlgorithm
+	btVector3 aabbMin0,aabbMax0,aabbMin1,aabbMax1;
+	childShape0->getAabb(newChildWorldTrans0,aabbMin0,aabbMax0);
+	childShape1->getAabb(newChildWorldTrans1,aabbMin1,aabbMax1);
+	if (!TestAabbAgainstAabb2(aabbMin0,aabbMax0,aabbMin1,aabbMax1))
+		return;
+
+	body0->setWorldTransform(newChildWorldTrans0);
+	body0->setInterpolationWorldTransform(newChildWorldTrans0);
+	body1->setWorldTransform(newChildWorldTrans1);
+	body1->setInterpolationWorldTransform(newChildWorldTrans1);
+
+	//the contactpoint is still projected back using the original inverted worldtrans
+	btCollisionShape* tmpShape0 = body0->getCollisionShape();
+	btCollisionShape* tmpShape1 = body1->getCollisionShape();
+	body0->internalSetTemporaryCollisionShape( childShape0 );
+	body1->internalSetTemporaryCollisionShape( childShape1 );
+
+	int childUniqueId0 = compoundShape0->getChildUniqueId(childIndex0);
+	int childUniqueId1 = compoundShape1->getChildUniqueId(childIndex1);
+	btCompoundChildPairKey key(childUniqueId0,childUniqueId1);
+	btCompoundChildPair* pair = m_childPairs.find(key);
+	if (!pair)
+	{
+		btCompoundChildPair newPair;
+		newPair.m_algorithm = m_dispatcher->findAlgorithm(body0,body1,m_sharedManifold);
+		newPair.m_childUniqueId0 = childUniqueId0;
+		newPair.m_childUniqueId1 = childUniqueId1;
+		newPair.m_lastUsed = m_processCounter;
+		m_childPairs.insert(key,newPair);
+		pair = m_childPairs.find(key);
+	}
+	pair->m_lastUsed = m_processCounter;
+
+	resultOut->setShapeIdentifiersA(-1,childIndex0);
+	resultOut->setShapeIdentifiersB(-1,childIndex1);
+	pair->m_algorithm->processCollision(body0,body1,dispatchInfo,resultOut);
+
+	//revert back transform
+	body0->internalSetTemporaryCollisionShape( tmpShape0 );
+	body1->internalSetTemporaryCollisionShape( tmpShape1 );
+	body0->setWorldTransform( orgTrans0 );
+	body0->setInterpolationWorldTransform( orgInterpolationTrans0 );
+	body1->setWorldTransform( orgTrans1 );
+	body1->setInterpolationWorldTransform( orgInterpolationTrans1 );
+}
+
+void btCompoundCompoundCollisionAlgorithm::processCollision (btCollisionObject* body0,btCollisionObject* body1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut)
+{
+	btAssert (body0->getCollisionShape()->isCompound() && body1->getCollisionShape()->isCompound());
+	btCompoundShape* compoundShape0 = static_cast<btCompoundShape*>(body0->getCollisionShape());
+	btCompoundShape* compoundShape1 = static_cast<btCompoundShape*>(body1->getCollisionShape());
+
+	m_processCounter++;
+
+	///we need to refresh all contact manifolds, see btCompoundCollisionAlgorithm
+	{
+		int i;
+		btManifoldArray manifoldArray;
+		for (i=0;i<m_childPairs.size();i++)
+		{
+			m_childPairs.getAtIndex(i)->m_algorithm->getAllContactManifolds(manifoldArray);
+			for (int m=0;m<manifoldArray.size();m++)
+			{
+				if (manifoldArray[m]->getNumContacts())
+				{
+					resultOut->setPersistentManifold(manifoldArray[m]);
+					resultOut->refreshContactPoints();
+					resultOut->setPersistentManifold(0);
+				}
+			}
+			manifoldArray.clear();
+		}
+	}
+
+	const btDbvt* tree0 = compoundShape0->getDynamicAabbTree();
+	const btDbvt* tree1 = compoundShape1->getDynamicAabbTree();
+	if (tree0 && tree1)
+	{
+		if (tree0->m_root && tree1->m_root)
+		{
+			//traverse both trees at once, the nodes of tree1 are transformed into the space of body0
+			btTransform xform = body0->getWorldTransform().inverse() * body1->getWorldTransform();
+			int depth = 1;
+			m_stack.resize(btDbvt::DOUBLE_STACKSIZE);
+			m_stack[0] = btDbvt::sStkNN(tree0->m_root,tree1->m_root);
+			do
+			{
+				btDbvt::sStkNN p = m_stack[--depth];
+				btVector3 aabbMin1,aabbMax1;
+				btTransformAabb(p.b->volume.Mins(),p.b->volume.Maxs(),btScalar(0.),xform,aabbMin1,aabbMax1);
+				if (!TestAabbAgainstAabb2(p.a->volume.Mins(),p.a->volume.Maxs(),aabbMin1,aabbMax1))
+					continue;
+
+				if (depth+2 > m_stack.size())
+				{
+					m_stack.resize(m_stack.size()*2);
+				}
+				if (p.a->isinternal() && (p.b->isleaf() || p.a->volume.Lengths().length2() >= (aabbMax1-aabbMin1).length2()))
+				{
+					//split the larger node
+					m_stack[depth++] = btDbvt::sStkNN(p.a->childs[0],p.b);
+					m_stack[depth++] = btDbvt::sStkNN(p.a->childs[1],p.b);
+				} else if (p.b->isinternal())
+				{
+					m_stack[depth++] = btDbvt::sStkNN(p.a,p.b->childs[0]);
+					m_stack[depth++] = btDbvt::sStkNN(p.a,p.b->childs[1]);
+				} else
+				{
+					processChildPair(body0,body1,p.a->dataAsInt,p.b->dataAsInt,dispatchInfo,resultOut);
+				}
+			} while (depth);
+		}
+	} else
+	{
+		//without trees, all children are tested against each other
+		int i,j;
+		for (i=0;i<compoundShape0->getNumChildShapes();i++)
+		{
+			for (j=0;j<compoundShape1->getNumChildShapes();j++)
+			{
+				processChildPair(body0,body1,i,j,dispatchInfo,resultOut);
+			}
+		}
+	}
+
+	//remove the algorithms of child pairs that no longer overlap, or whose children were removed
+	btAlignedObjectArray<btCompoundChildPairKey> removedPairs;
+	int i;
+	for (i=0;i<m_childPairs.size();i++)
+	{
+		btCompoundChildPair* pair = m_childPairs.getAtIndex(i);
+		if (pair->m_lastUsed != m_processCounter)
+		{
+			pair->m_algorithm->~btCollisionAlgorithm();
+			m_dispatcher->freeCollisionAlgorithm(pair->m_algorithm);
+			removedPairs.push_back(btCompoundChildPairKey(pair->m_childUniqueId0,pair->m_childUniqueId1));
+		}
+	}
+	for (i=0;i<removedPairs.size();i++)
+	{
+		m_childPairs.remove(removedPairs[i]);
+	}
+}
+
+///btSweptAabb returns the bounds of a local box over the motion of a body, from its world transform to its interpolation world transform
+static void	btSweptAabb(const btVector3& localAabbMin,const btVector3& localAabbMax,const btCollisionObject* body,btVector3& aabbMin,btVector3& aabbMax)
+{
+	btVector3 endAabbMin,endAabbMax;
+	btTransformAabb(localAabbMin,localAabbMax,btScalar(0.),body->getWorldTransform(),aabbMin,aabbMax);
+	btTransformAabb(localAabbMin,localAabbMax,btScalar(0.),body->getInterpolationWorldTransform(),endAabbMin,endAabbMax);
+	aabbMin.setMin(endAabbMin);
+	aabbMax.setMax(endAabbMax);
+}
+
+btScalar	btCompoundCompoundCollisionAlgorithm::calculateChildPairTimeOfImpact(btCollisionObject* body0,btCollisionObject* body1,int childIndex0,int childIndex1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut)
+{
+	btCompoundShape* compoundShape0 = static_cast<btCompoundShape*>(body0->getCollisionShape());
+	btCompoundShape* compoundShape1 = static_cast<btCompoundShape*>(body1->getCollisionShape());
+	const btTransform& childTrans0 = compoundShape0->getChildTransform(childIndex0);
+	const btTransform& childTrans1 = compoundShape1->getChildTransform(childIndex1);
+
+	//backup
+	btTransform	orgTrans0 = body0->getWorldTransform();
+	btTransform	orgInterpolationTrans0 = body0->getInterpolationWorldTransform();
+	btTransform	orgTrans1 = body1->getWorldTransform();
+	btTransform	orgInterpolationTrans1 = body1->getInterpolationWorldTransform();
+	btCollisionShape* tmpShape0 = body0->getCollisionShape();
+	btCollisionShape* tmpShape1 = body1->getCollisionShape();
+
+	body0->setWorldTransform(orgTrans0*childTrans0);
+	body0->setInterpolationWorldTransform(orgInterpolationTrans0*childTrans0);
+	body1->setWorldTransform(orgTrans1*childTrans1);
+	body1->setInterpolationWorldTransform(orgInterpolationTrans1*childTrans1);
+	body0->internalSetTemporaryCollisionShape( compoundShape0->getChildShape(childIndex0) );
+	body1->internalSetTemporaryCollisionShape( compoundShape1->getChildShape(childIndex1) );
+
+	//children that don't touch yet have no algorithm, a temporary one is used for them
+	btCompoundChildPair* pair = m_childPairs.find(btCompoundChildPairKey(compoundShape0->getChildUniqueId(childIndex0),compoundShape1->getChildUniqueId(childIndex1)));
+	btCollisionAlgorithm* algorithm = pair ? pair->m_algorithm : m_dispatcher->findAlgorithm(body0,body1,0);
+	btScalar frac = algorithm->calculateTimeOfImpact(body0,body1,dispatchInfo,resultOut);
+	if (!pair)
+	{
+		algorithm->~btCollisionAlgorithm();
+		m_dispatcher->freeCollisionAlgorithm(algorithm);
+	}
+
+	//revert back
+	body0->internalSetTemporaryCollisionShape( tmpShape0 );
+	body1->internalSetTemporaryCollisionShape( tmpShape1 );
+	body0->setWorldTransform( orgTrans0 );
+	body0->setInterpolationWorldTransform( orgInterpolationTrans0 );
+	body1->setWorldTransform( orgTrans1 );
+	body1->setInterpolationWorldTransform( orgInterpolationTrans1 );
+	return frac;
+}
+
+btScalar	btCompoundCompoundCollisionAlgorithm::calculateTimeOfImpact(btCollisionObject* body0,btCollisionObject* body1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut)
+{
+	btAssert (body0->getCollisionShape()->isCompound() && body1->getCollisionShape()->isCompound());
+	btCompoundShape* compoundShape0 = static_cast<btCompoundShape*>(body0->getCollisionShape());
+	btCompoundShape* compoundShape1 = static_cast<btCompoundShape*>(body1->getCollisionShape());
+
+	btScalar hitFraction = btScalar(1.);
+	btScalar frac;
+
+	const btDbvt* tree0 = compoundShape0->getDynamicAabbTree();
+	const btDbvt* tree1 = compoundShape1->getDynamicAabbTree();
+	if (tree0 && tree1)
+	{
+		if (tree0->m_root && tree1->m_root)
+		{
+			//the nodes are moved along with their body, so the traversal is done in world space
+			int depth = 1;
+			m_stack.resize(btDbvt::DOUBLE_STACKSIZE);
+			m_stack[0] = btDbvt::sStkNN(tree0->m_root,tree1->m_root);
+			do
+			{
+				btDbvt::sStkNN p = m_stack[--depth];
+				btVector3 aabbMin0,aabbMax0,aabbMin1,aabbMax1;
+				btSweptAabb(p.a->volume.Mins(),p.a->volume.Maxs(),body0,aabbMin0,aabbMax0);
+				btSweptAabb(p.b->volume.Mins(),p.b->volume.Maxs(),body1,aabbMin1,aabbMax1);
+				if (!TestAabbAgainstAabb2(aabbMin0,aabbMax0,aabbMin1,aabbMax1))
+					continue;
+
+				if (depth+2 > m_stack.size())
+				{
+					m_stack.resize(m_stack.size()*2);
+				}
+				if (p.a->isinternal() && (p.b->isleaf() || (aabbMax0-aabbMin0).length2() >= (aabbMax1-aabbMin1).length2()))
+				{
+					m_stack[depth++] = btDbvt::sStkNN(p.a->childs[0],p.b);
+					m_stack[depth++] = btDbvt::sStkNN(p.a->childs[1],p.b);
+				} else if (p.b->isinternal())
+				{
+					m_stack[depth++] = btDbvt::sStkNN(p.a,p.b->childs[0]);
+					m_stack[depth++] = btDbvt::sStkNN(p.a,p.b->childs[1]);
+				} else
+				{
+					frac = calculateChildPairTimeOfImpact(body0,body1,p.a->dataAsInt,p.b->dataAsInt,dispatchInfo,resultOut);
+					if (frac<hitFraction)
+					{
+						hitFraction = frac;
+					}
+				}
+			} while (depth);
+		}
+	} else
+	{
+		int i,j;
+		for (i=0;i<compoundShape0->getNumChildShapes();i++)
+		{
+			for (j=0;j<compoundShape1->getNumChildShapes();j++)
+			{
+				frac = calculateChildPairTimeOfImpact(body0,body1,i,j,dispatchInfo,resultOut);
+				if (frac<hitFraction)
+				{
+					hitFraction = frac;
+				}
+			}
+		}
+	}
+	return hitFraction;
+}
@@ -0,0 +1,119 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef COMPOUND_COMPOUND_COLLISION_ALGORITHM_H
+#define COMPOUND_COMPOUND_COLLISION_ALGORITHM_H
+
+#include "btActivatingCollisionAlgorithm.h"
+#include "BulletCollision/BroadphaseCollision/btDispatcher.h"
+#include "BulletCollision/BroadphaseCollision/btDbvt.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include "btCollisionCreateFunc.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+class btDispatcher;
+class btCollisionObject;
+class btCollisionShape;
+
+///btCompoundChildPairKey identifies a pair of children by their unique ids, see btCompoundShape::getChildUniqueId
+class btCompoundChildPairKey
+{
+	int	m_childUniqueId0;
+	int	m_childUniqueId1;
+public:
+	btCompoundChildPairKey(int childUniqueId0,int childUniqueId1)
+		:m_childUniqueId0(childUniqueId0),m_childUniqueId1(childUniqueId1)
+	{
+	}
+
+	bool equals(const btCompoundChildPairKey& other) const
+	{
+		return (m_childUniqueId0 == other.m_childUniqueId0) && (m_childUniqueId1 == other.m_childUniqueId1);
+	}
+
+	SIMD_FORCE_INLINE	unsigned int getHash()const
+	{
+		int key = m_childUniqueId0 ^ (m_childUniqueId1 << 16) ^ (m_childUniqueId1 >> 16);
+		// Thomas Wang's hash
+		key += ~(key << 15);	key ^=  (key >> 10);	key +=  (key << 3);	key ^=  (key >> 6);	key += ~(key << 11);	key ^=  (key >> 16);
+		return key;
+	}
+};
+
+struct btCompoundChildPair
+{
+	btCollisionAlgorithm*	m_algorithm;
+	int		m_childUniqueId0;
+	int		m_childUniqueId1;
+	int		m_lastUsed;
+};
+
+/// btCompoundCompoundCollisionAlgorithm supports collision between two btCompoundShapes.
+/// The dynamic aabb trees of both compounds are traversed against each other, and a collision algorithm is kept for each pair of overlapping children.
+/// The pairs are keyed by the unique ids of the children, so their algorithms and contact manifolds survive when other children are added or removed.
+class btCompoundCompoundCollisionAlgorithm  : public btActivatingCollisionAlgorithm
+{
+	btHashMap<btCompoundChildPairKey,btCompoundChildPair>	m_childPairs;
+
+	btAlignedObjectArray<btDbvt::sStkNN>	m_stack;
+
+	class btPersistentManifold*	m_sharedManifold;
+
+	int		m_processCounter;
+
+	void	removeChildAlgorithms();
+
+	void	processChildPair(btCollisionObject* body0,btCollisionObject* body1,int childIndex0,int childIndex1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut);
+
+	btScalar	calculateChildPairTimeOfImpact(btCollisionObject* body0,btCollisionObject* body1,int childIndex0,int childIndex1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut);
+
+public:
+
+	btCompoundCompoundCollisionAlgorithm( const btCollisionAlgorithmConstructionInfo& ci,btCollisionObject* body0,btCollisionObject* body1);
+
+	virtual ~btCompoundCompoundCollisionAlgorithm();
+
+	virtual void processCollision (btCollisionObject* body0,btCollisionObject* body1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut);
+
+	///calculateTimeOfImpact returns the smallest time of impact of the child pairs whose bounds overlap during the motion.
+	///The bounds of a node are the union of its bounds at the world transform and at the interpolation world transform.
+	btScalar	calculateTimeOfImpact(btCollisionObject* body0,btCollisionObject* body1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut);
+
+	virtual	void	getAllContactManifolds(btManifoldArray&	manifoldArray)
+	{
+		int i;
+		for (i=0;i<m_childPairs.size();i++)
+		{
+			m_childPairs.getAtIndex(i)->m_algorithm->getAllContactManifolds(manifoldArray);
+		}
+	}
+
+	int		getNumChildPairs() const
+	{
+		return m_childPairs.size();
+	}
+
+	struct CreateFunc :public 	btCollisionAlgorithmCreateFunc
+	{
+		virtual	btCollisionAlgorithm* CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& ci, btCollisionObject* body0,btCollisionObject* body1)
+		{
+			void* mem = ci.m_dispatcher1->allocateCollisionAlgorithm(sizeof(btCompoundCompoundCollisionAlgorithm));
+			return new(mem) btCompoundCompoundCollisionAlgorithm(ci,body0,body1);
+		}
+	};
+
+};
+
+#endif //COMPOUND_COMPOUND_COLLISION_ALGORITHM_H
@@ -296,6 +296,7 @@ void btConvexConvexAlgorithm ::processCollision (btCollisionObject* body0,btColl
 		m_ownManifold = true;
 	}
 	resultOut->setPersistentManifold(m_manifoldPtr);
+	resultOut->updateSpeculativeDistance(dispatchInfo);
 
 	//comment-out next line to test multi-contact generation
 	//resultOut->getPersistentManifold()->clearManifold();
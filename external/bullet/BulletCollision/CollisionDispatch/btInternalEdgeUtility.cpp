@@ -5,6 +5,7 @@
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
 #include "BulletCollision/NarrowPhaseCollision/btManifoldPoint.h"
 #include "LinearMath/btIDebugDraw.h"
+#include "LinearMath/btTaskPool.h"
 
 
 //#define DEBUG_INTERNAL_EDGE
@@ -49,24 +50,17 @@ static btScalar btGetAngle(const btVector3& edgeA, const btVector3& normalA,cons
 }
 
 
-struct btConnectivityProcessor : public btTriangleCallback
+///btConnectivityProcessor compares triangle A with a neighbouring triangle B. If they share exactly one edge, the angle between them is stored in m_triangleInfo.
+struct btConnectivityProcessor
 {
-	int				m_partIdA;
-	int				m_triangleIndexA;
-	btVector3*		m_triangleVerticesA;
-	btTriangleInfoMap*	m_triangleInfoMap;
+	const btVector3*			m_triangleVerticesA;
+	const btTriangleInfoMap*	m_triangleInfoMap;
+	btTriangleInfo*				m_triangleInfo;
 
 
-	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+	///returns true if the triangles share an edge
+	bool processTriangle(const btVector3* triangle)
 	{
-		//skip self-collisions
-		if ((m_partIdA == partId) && (m_triangleIndexA == triangleIndex))
-			return;
-
-		//skip duplicates (disabled for now)
-		//if ((m_partIdA <= partId) && (m_triangleIndexA <= triangleIndex))
-		//	return;
-
 		//search for shared vertices and edges
 		int numshared = 0;
 		int sharedVertsA[3]={-1,-1,-1};
@@ -75,13 +69,13 @@ struct btConnectivityProcessor : public btTriangleCallback
 		///skip degenerate triangles
 		btScalar crossBSqr = ((triangle[1]-triangle[0]).cross(triangle[2]-triangle[0])).length2();
 		if (crossBSqr < m_triangleInfoMap->m_equalVertexThreshold)
-			return;
+			return false;
 
 
 		btScalar crossASqr = ((m_triangleVerticesA[1]-m_triangleVerticesA[0]).cross(m_triangleVerticesA[2]-m_triangleVerticesA[0])).length2();
 		///skip degenerate triangles
 		if (crossASqr< m_triangleInfoMap->m_equalVertexThreshold)
-			return;
+			return false;
 
 #if 0
 		printf("triangle A[0]	=	(%f,%f,%f)\ntriangle A[1]	=	(%f,%f,%f)\ntriangle A[2]	=	(%f,%f,%f)\n",
@@ -89,7 +83,6 @@ struct btConnectivityProcessor : public btTriangleCallback
 			m_triangleVerticesA[1].getX(),m_triangleVerticesA[1].getY(),m_triangleVerticesA[1].getZ(),
 			m_triangleVerticesA[2].getX(),m_triangleVerticesA[2].getY(),m_triangleVerticesA[2].getZ());
 
-		printf("partId=%d, triangleIndex=%d\n",partId,triangleIndex);
 		printf("triangle B[0]	=	(%f,%f,%f)\ntriangle B[1]	=	(%f,%f,%f)\ntriangle B[2]	=	(%f,%f,%f)\n",
 			triangle[0].getX(),triangle[0].getY(),triangle[0].getZ(),
 			triangle[1].getX(),triangle[1].getY(),triangle[1].getZ(),
@@ -107,12 +100,12 @@ struct btConnectivityProcessor : public btTriangleCallback
 					numshared++;
 					///degenerate case
 					if(numshared >= 3)
-						return;
+						return false;
 				}
 			}
 			///degenerate case
 			if(numshared >= 3)
-				return;
+				return false;
 		}
 		switch (numshared)
 		{
@@ -138,15 +131,7 @@ struct btConnectivityProcessor : public btTriangleCallback
 					sharedVertsB[0] = tmp;
 				}
 
-				int hash = btGetHash(m_partIdA,m_triangleIndexA);
-
-				btTriangleInfo* info = m_triangleInfoMap->find(hash);
-				if (!info)
-				{
-					btTriangleInfo tmp;
-					m_triangleInfoMap->insert(hash,tmp);
-					info = m_triangleInfoMap->find(hash);
-				}
+				btTriangleInfo* info = m_triangleInfo;
 
 				int sumvertsA = sharedVertsA[0]+sharedVertsA[1];
 				int otherIndexA = 3-sumvertsA;
@@ -154,16 +139,13 @@ struct btConnectivityProcessor : public btTriangleCallback
 				
 				btVector3 edge(m_triangleVerticesA[sharedVertsA[1]]-m_triangleVerticesA[sharedVertsA[0]]);
 
-				btTriangleShape tA(m_triangleVerticesA[0],m_triangleVerticesA[1],m_triangleVerticesA[2]);
 				int otherIndexB = 3-(sharedVertsB[0]+sharedVertsB[1]);
 
-				btTriangleShape tB(triangle[sharedVertsB[1]],triangle[sharedVertsB[0]],triangle[otherIndexB]);
-				//btTriangleShape tB(triangle[0],triangle[1],triangle[2]);
-
-				btVector3 normalA;
-				btVector3 normalB;
-				tA.calcNormal(normalA);
-				tB.calcNormal(normalB);
+				//same as btTriangleShape::calcNormal, without constructing the shapes. Triangle B is ordered as (sharedB1,sharedB0,otherB)
+				btVector3 normalA = (m_triangleVerticesA[1]-m_triangleVerticesA[0]).cross(m_triangleVerticesA[2]-m_triangleVerticesA[0]);
+				btVector3 normalB = (triangle[sharedVertsB[0]]-triangle[sharedVertsB[1]]).cross(triangle[otherIndexB]-triangle[sharedVertsB[1]]);
+				normalA.normalize();
+				normalB.normalize();
 				edge.normalize();
 				btVector3 edgeCrossA = edge.cross(normalA).normalize();
 
@@ -193,7 +175,6 @@ struct btConnectivityProcessor : public btTriangleCallback
 				btScalar len2 = calculatedEdge.length2();
 
 				btScalar correctedAngle(0);
-				btVector3 calculatedNormalB = normalA;
 				bool isConvex = false;
 
 				if (len2<m_triangleInfoMap->m_planarEpsilon)
@@ -213,8 +194,6 @@ struct btConnectivityProcessor : public btTriangleCallback
 					isConvex = (dotA<0.);
 
 					correctedAngle = isConvex ? ang4 : -ang4;
-					btQuaternion orn2(calculatedEdge,-correctedAngle);
-					calculatedNormalB = btMatrix3x3(orn2)*normalA;
 
 
 				}
@@ -299,7 +278,7 @@ struct btConnectivityProcessor : public btTriangleCallback
 					}
 				}
 
-				break;
+				return true;
 			}
 		default:
 			{
@@ -307,13 +286,257 @@ struct btConnectivityProcessor : public btTriangleCallback
 			}
 
 		}
+		return false;
 	}
 };
+
+///btEdgeSortKey is sorted with a radix sort, m_value is the vertex or edge slot that belongs to the key
+struct btEdgeSortKey
+{
+	unsigned long long int	m_key;
+	int						m_value;
+};
+
+#define BT_EDGE_RADIX_BITS 11
+#define BT_EDGE_RADIX_SIZE (1<<BT_EDGE_RADIX_BITS)
+
+///btRadixSortEdgeKeys sorts the lowest numKeyBits bits of the keys. The sort is stable, so keys that are added in order of their value stay in that order.
+static void btRadixSortEdgeKeys(btAlignedObjectArray<btEdgeSortKey>& keys, int numKeyBits)
+{
+	int numKeys = keys.size();
+	btAlignedObjectArray<btEdgeSortKey> tmp;
+	tmp.resize(numKeys);
+	btAlignedObjectArray<int> offsets;
+	offsets.resize(BT_EDGE_RADIX_SIZE);
+	btEdgeSortKey* src = numKeys ? &keys[0] : 0;
+	btEdgeSortKey* dst = numKeys ? &tmp[0] : 0;
+	for (int shift=0;shift<numKeyBits;shift+=BT_EDGE_RADIX_BITS)
+	{
+		int i;
+		for (i=0;i<BT_EDGE_RADIX_SIZE;i++)
+			offsets[i] = 0;
+		for (i=0;i<numKeys;i++)
+			offsets[int(src[i].m_key>>shift)&(BT_EDGE_RADIX_SIZE-1)]++;
+		int sum = 0;
+		for (i=0;i<BT_EDGE_RADIX_SIZE;i++)
+		{
+			int count = offsets[i];
+			offsets[i] = sum;
+			sum += count;
+		}
+		for (i=0;i<numKeys;i++)
+			dst[offsets[int(src[i].m_key>>shift)&(BT_EDGE_RADIX_SIZE-1)]++] = src[i];
+		btSwap(src,dst);
+	}
+	if (numKeys && src != &keys[0])
+	{
+		for (int i=0;i<numKeys;i++)
+			keys[i] = src[i];
+	}
+}
+
+static int btGetNumKeyBits(int maxValue)
+{
+	int numBits = 1;
+	while (numBits < 31 && (maxValue>>numBits))
+		numBits++;
+	return numBits;
+}
+
+static SIMD_FORCE_INLINE void btAddCloseVertexPair(btAlignedObjectArray<btEdgeSortKey>& closePairs, int vertexA, int vertexB)
+{
+	btEdgeSortKey& pair = closePairs.expand();
+	pair.m_key = (unsigned long long int)btMax(vertexA,vertexB);
+	pair.m_value = btMin(vertexA,vertexB);
+}
+
+///the welding grid has at most 2^21 cells along each axis, so a cell key fits into 64 bits with z in the lowest bits
+#define BT_EDGE_WELD_CELL_BITS 21
+#define BT_EDGE_WELD_MAX_CELL ((1<<BT_EDGE_WELD_CELL_BITS)-2)
+
+static SIMD_FORCE_INLINE unsigned long long int btGetWeldCellKey(int x, int y, int z)
+{
+	return ((unsigned long long int)x<<(2*BT_EDGE_WELD_CELL_BITS)) | ((unsigned long long int)y<<BT_EDGE_WELD_CELL_BITS) | (unsigned long long int)z;
+}
+
+///btWeldEdgeVertices gives each vertex the id of the first vertex, in index order, that is closer than the equal vertex threshold and isn't welded to an earlier vertex itself.
+///Every vertex of a group is within the threshold of the first vertex of the group, so a chain of vertices that are each close to the next one is not merged into one group.
+///The grid cells are at least as large as the equal vertex distance, so shared vertices are in the same or in neighbouring cells.
+static void btWeldEdgeVertices(const btAlignedObjectArray<btVector3>& vertices, btScalar equalVertexThreshold, btAlignedObjectArray<int>& weldedIds)
+{
+	int numVertices = vertices.size();
+	weldedIds.resize(numVertices);
+	if (!numVertices)
+		return;
+
+	btVector3 aabbMin = vertices[0];
+	btVector3 aabbMax = vertices[0];
+	int i;
+	for (i=1;i<numVertices;i++)
+	{
+		aabbMin.setMin(vertices[i]);
+		aabbMax.setMax(vertices[i]);
+	}
+
+	//the cells are slightly larger than the equal vertex distance, to stay on the safe side of rounding
+	btScalar cellSize = btSqrt(equalVertexThreshold)*btScalar(1.01);
+	btVector3 extent = aabbMax-aabbMin;
+	btScalar maxExtent = extent[extent.maxAxis()];
+	if (maxExtent > cellSize*btScalar(BT_EDGE_WELD_MAX_CELL))
+		cellSize = maxExtent/btScalar(BT_EDGE_WELD_MAX_CELL);
+	btScalar invCellSize = btScalar(1.)/cellSize;
+
+	btAlignedObjectArray<btEdgeSortKey> cellKeys;
+	cellKeys.resize(numVertices);
+	for (i=0;i<numVertices;i++)
+	{
+		btVector3 cell = (vertices[i]-aabbMin)*invCellSize;
+		cellKeys[i].m_key = btGetWeldCellKey(
+			btMin(int(cell.getX()),BT_EDGE_WELD_MAX_CELL),
+			btMin(int(cell.getY()),BT_EDGE_WELD_MAX_CELL),
+			btMin(int(cell.getZ()),BT_EDGE_WELD_MAX_CELL));
+		cellKeys[i].m_value = i;
+	}
+	btRadixSortEdgeKeys(cellKeys,3*BT_EDGE_WELD_CELL_BITS);
+
+	//the pairs of close vertices, keyed by the higher vertex index
+	btAlignedObjectArray<btEdgeSortKey> closePairs;
+
+	//compare each cell with itself and with the 13 neighbouring cells that come after it in sort order.
+	//The 3 cells of a row along z are contiguous in the sorted array, and the start of each neighbouring row
+	//only moves forward while the cells are visited in order, so a cursor per row replaces a search.
+	static const int neighbourRows[4][2] = {{0,1},{1,-1},{1,0},{1,1}};
+	int rowCursors[4] = {0,0,0,0};
+	unsigned long long int cellMask = (1<<BT_EDGE_WELD_CELL_BITS)-1;
+	int cellStart = 0;
+	while (cellStart < numVertices)
+	{
+		unsigned long long int cellKey = cellKeys[cellStart].m_key;
+		int cell[3] = {int(cellKey>>(2*BT_EDGE_WELD_CELL_BITS)),int((cellKey>>BT_EDGE_WELD_CELL_BITS)&cellMask),int(cellKey&cellMask)};
+		int cellEnd = cellStart+1;
+		while (cellEnd < numVertices && cellKeys[cellEnd].m_key == cellKey)
+			cellEnd++;
+
+		//the same cell and the next cell along z
+		int rowEnd = cellEnd;
+		while (rowEnd < numVertices && cellKeys[rowEnd].m_key == cellKey+1)
+			rowEnd++;
+		int j,k;
+		for (j=cellStart;j<cellEnd;j++)
+		{
+			const btVector3& vertex = vertices[cellKeys[j].m_value];
+			for (k=j+1;k<rowEnd;k++)
+			{
+				if ((vertex-vertices[cellKeys[k].m_value]).length2() < equalVertexThreshold)
+					btAddCloseVertexPair(closePairs,cellKeys[j].m_value,cellKeys[k].m_value);
+			}
+		}
+
+		for (int row=0;row<4;row++)
+		{
+			int y = cell[1]+neighbourRows[row][1];
+			if (y < 0)
+				continue;
+			unsigned long long int firstKey = btGetWeldCellKey(cell[0]+neighbourRows[row][0],y,btMax(cell[2]-1,0));
+			unsigned long long int lastKey = btGetWeldCellKey(cell[0]+neighbourRows[row][0],y,cell[2]+1);
+			int& cursor = rowCursors[row];
+			while (cursor < numVertices && cellKeys[cursor].m_key < firstKey)
+				cursor++;
+			for (j=cellStart;j<cellEnd;j++)
+			{
+				const btVector3& vertex = vertices[cellKeys[j].m_value];
+				for (k=cursor;k<numVertices && cellKeys[k].m_key <= lastKey;k++)
+				{
+					if ((vertex-vertices[cellKeys[k].m_value]).length2() < equalVertexThreshold)
+						btAddCloseVertexPair(closePairs,cellKeys[j].m_value,cellKeys[k].m_value);
+				}
+			}
+		}
+		cellStart = cellEnd;
+	}
+
+	//the pairs are visited in order of their higher vertex, so the id of the lower vertex is already known
+	btRadixSortEdgeKeys(closePairs,btGetNumKeyBits(numVertices-1));
+	for (i=0;i<numVertices;i++)
+	{
+		weldedIds[i] = i;
+	}
+	for (i=0;i<closePairs.size();i++)
+	{
+		int vertexIndex = int(closePairs[i].m_key);
+		int lowerIndex = closePairs[i].m_value;
+		if (weldedIds[lowerIndex] == lowerIndex && lowerIndex < weldedIds[vertexIndex])
+			weldedIds[vertexIndex] = lowerIndex;
+	}
+}
+
+
+///meshes with fewer triangles are processed on the calling thread only
+#define BT_INTERNAL_EDGE_MIN_THREADED_TRIANGLES 8192
+#define BT_INTERNAL_EDGE_TASK_TRIANGLES 1024
+
+struct btEdgeConnectivityContext
+{
+	const btVector3*			m_vertices;
+	const int*					m_triangleVertices;
+	const btEdgeSortKey*		m_edges;
+	const int*					m_edgeRuns;
+	const btTriangleInfoMap*	m_triangleInfoMap;
+	btTriangleInfo*				m_triangleInfos;
+	unsigned char*				m_connected;
+	int							m_numTriangles;
+};
+
+///each task is a range of triangles A, and writes only the info of those triangles, so the tasks don't need to synchronize
+static void	btProcessEdgeConnectivity(const btEdgeConnectivityContext& context, int firstTriangle, int endTriangle)
+{
+	for (int triangleA=firstTriangle;triangleA<endTriangle;triangleA++)
+	{
+		const int* indicesA = &context.m_triangleVertices[triangleA*3];
+		btVector3 triangleVerticesA[3] = {context.m_vertices[indicesA[0]],context.m_vertices[indicesA[1]],context.m_vertices[indicesA[2]]};
+		btTriangleInfo info;
+		btConnectivityProcessor connectivityProcessor;
+		connectivityProcessor.m_triangleVerticesA = &triangleVerticesA[0];
+		connectivityProcessor.m_triangleInfoMap = context.m_triangleInfoMap;
+		connectivityProcessor.m_triangleInfo = &info;
+		bool connected = false;
+		for (int edge=0;edge<3;edge++)
+		{
+			const int* run = &context.m_edgeRuns[(triangleA*3+edge)*2];
+			//the triangles sharing this edge are sorted by index, so the last one wins for non-manifold edges
+			for (int k=run[0];k<run[1];k++)
+			{
+				int triangleB = context.m_edges[k].m_value/3;
+				if (triangleB == triangleA)
+					continue;
+				const int* indicesB = &context.m_triangleVertices[triangleB*3];
+				btVector3 triangleVerticesB[3] = {context.m_vertices[indicesB[0]],context.m_vertices[indicesB[1]],context.m_vertices[indicesB[2]]};
+				if (connectivityProcessor.processTriangle(triangleVerticesB))
+					connected = true;
+			}
+		}
+		context.m_connected[triangleA] = connected ? 1 : 0;
+		if (connected)
+			context.m_triangleInfos[triangleA] = info;
+	}
+}
+
+static void	btEdgeConnectivityTask(void* userPtr, int taskIndex)
+{
+	const btEdgeConnectivityContext& context = *(const btEdgeConnectivityContext*)userPtr;
+	int firstTriangle = taskIndex*BT_INTERNAL_EDGE_TASK_TRIANGLES;
+	btProcessEdgeConnectivity(context,firstTriangle,btMin(firstTriangle+BT_INTERNAL_EDGE_TASK_TRIANGLES,context.m_numTriangles));
+}
+
 /////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////
 
+///btGenerateInternalEdgeInfo finds the neighbours of all triangles at once: the vertices are welded using the equal vertex threshold,
+///and the triangle edges are sorted by their welded vertex ids, so triangles sharing an edge end up next to each other.
+///This replaces an aabb query per triangle, and the neighbours are processed in parallel.
 void btGenerateInternalEdgeInfo (btBvhTriangleMeshShape*trimeshShape, btTriangleInfoMap* triangleInfoMap)
 {
+	BT_ALLOC_TAG(BT_ALLOC_TAG_SHAPES);
 	//the user pointer shouldn't already be used for other purposes, we intend to store connectivity info there!
 	if (trimeshShape->getTriangleInfoMap())
 		return;
@@ -322,8 +545,15 @@ void btGenerateInternalEdgeInfo (btBvhTriangleMeshShape*trimeshShape, btTriangle
 
 	btStridingMeshInterface* meshInterface = trimeshShape->getMeshInterface();
 	const btVector3& meshScaling = meshInterface->getScaling();
-
-	for (int partId = 0; partId< meshInterface->getNumSubParts();partId++)
+	int numParts = meshInterface->getNumSubParts();
+
+	//gather the scaled vertices and the triangles of all parts
+	btAlignedObjectArray<btVector3> vertices;
+	btAlignedObjectArray<int> triangleVertices;
+	btAlignedObjectArray<int> partTriangleOffsets;
+	partTriangleOffsets.resize(numParts+1);
+	int partId;
+	for (partId = 0; partId< numParts;partId++)
 	{
 		const unsigned char *vertexbase = 0;
 		int numverts = 0;
@@ -333,59 +563,132 @@ void btGenerateInternalEdgeInfo (btBvhTriangleMeshShape*trimeshShape, btTriangle
 		int indexstride = 0;
 		int numfaces = 0;
 		PHY_ScalarType indicestype = PHY_INTEGER;
-		//PHY_ScalarType indexType=0;
 
-		btVector3 triangleVerts[3];
 		meshInterface->getLockedReadOnlyVertexIndexBase(&vertexbase,numverts,	type,stride,&indexbase,indexstride,numfaces,indicestype,partId);
-		btVector3 aabbMin,aabbMax;
 
+		int vertexOffset = vertices.size();
+		vertices.resize(vertexOffset+numverts);
+		for (int vertexIndex=0;vertexIndex<numverts;vertexIndex++)
+		{
+			if (type == PHY_FLOAT)
+			{
+				float* graphicsbase = (float*)(vertexbase+vertexIndex*stride);
+				vertices[vertexOffset+vertexIndex] = btVector3(
+					graphicsbase[0]*meshScaling.getX(),
+					graphicsbase[1]*meshScaling.getY(),
+					graphicsbase[2]*meshScaling.getZ());
+			}
+			else
+			{
+				double* graphicsbase = (double*)(vertexbase+vertexIndex*stride);
+				vertices[vertexOffset+vertexIndex] = btVector3( btScalar(graphicsbase[0]*meshScaling.getX()), btScalar(graphicsbase[1]*meshScaling.getY()), btScalar(graphicsbase[2]*meshScaling.getZ()));
+			}
+		}
+
+		int triangleOffset = triangleVertices.size()/3;
+		partTriangleOffsets[partId] = triangleOffset;
+		triangleVertices.resize((triangleOffset+numfaces)*3);
 		for (int triangleIndex = 0 ; triangleIndex < numfaces;triangleIndex++)
 		{
 			unsigned int* gfxbase = (unsigned int*)(indexbase+triangleIndex*indexstride);
-
-			for (int j=2;j>=0;j--)
+			for (int j=0;j<3;j++)
 			{
-
 				int graphicsindex = indicestype==PHY_SHORT?((unsigned short*)gfxbase)[j]:gfxbase[j];
-				if (type == PHY_FLOAT)
-				{
-					float* graphicsbase = (float*)(vertexbase+graphicsindex*stride);
-					triangleVerts[j] = btVector3(
-						graphicsbase[0]*meshScaling.getX(),
-						graphicsbase[1]*meshScaling.getY(),
-						graphicsbase[2]*meshScaling.getZ());
-				}
-				else
-				{
-					double* graphicsbase = (double*)(vertexbase+graphicsindex*stride);
-					triangleVerts[j] = btVector3( btScalar(graphicsbase[0]*meshScaling.getX()), btScalar(graphicsbase[1]*meshScaling.getY()), btScalar(graphicsbase[2]*meshScaling.getZ()));
-				}
+				triangleVertices[(triangleOffset+triangleIndex)*3+j] = vertexOffset+graphicsindex;
 			}
-			aabbMin.setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
-			aabbMax.setValue(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT)); 
-			aabbMin.setMin(triangleVerts[0]);
-			aabbMax.setMax(triangleVerts[0]);
-			aabbMin.setMin(triangleVerts[1]);
-			aabbMax.setMax(triangleVerts[1]);
-			aabbMin.setMin(triangleVerts[2]);
-			aabbMax.setMax(triangleVerts[2]);
-
-			btConnectivityProcessor connectivityProcessor;
-			connectivityProcessor.m_partIdA = partId;
-			connectivityProcessor.m_triangleIndexA = triangleIndex;
-			connectivityProcessor.m_triangleVerticesA = &triangleVerts[0];
-			connectivityProcessor.m_triangleInfoMap  = triangleInfoMap;
-
-			trimeshShape->processAllTriangles(&connectivityProcessor,aabbMin,aabbMax);
 		}
 
+		meshInterface->unLockReadOnlyVertexBase(partId);
+	}
+	int numTriangles = triangleVertices.size()/3;
+	partTriangleOffsets[numParts] = numTriangles;
+
+	//with a zero threshold no vertices are shared
+	if (!numTriangles || triangleInfoMap->m_equalVertexThreshold <= btScalar(0.))
+		return;
+
+	btAlignedObjectArray<int> weldedIds;
+	btWeldEdgeVertices(vertices,triangleInfoMap->m_equalVertexThreshold,weldedIds);
+
+	//the edge key is made of the two welded vertex ids, the smaller one in the high bits
+	int numVertexBits = btGetNumKeyBits(vertices.size()-1);
+	btAlignedObjectArray<btEdgeSortKey> edges;
+	edges.reserve(numTriangles*3);
+	int triangle;
+	for (triangle=0;triangle<numTriangles;triangle++)
+	{
+		for (int edge=0;edge<3;edge++)
+		{
+			int vertex0 = weldedIds[triangleVertices[triangle*3+edge]];
+			int vertex1 = weldedIds[triangleVertices[triangle*3+(edge+1)%3]];
+			//collapsed edges of degenerate triangles
+			if (vertex0 == vertex1)
+				continue;
+			btEdgeSortKey key;
+			key.m_key = ((unsigned long long int)btMin(vertex0,vertex1)<<numVertexBits) | (unsigned long long int)btMax(vertex0,vertex1);
+			key.m_value = triangle*3+edge;
+			edges.push_back(key);
+		}
+	}
+	//the edges are added in triangle order and the sort is stable, so the triangles sharing an edge are sorted by index
+	btRadixSortEdgeKeys(edges,2*numVertexBits);
+
+	//for each edge slot, the range of edges in the sorted array with the same key. Edges without neighbours keep an empty range
+	btAlignedObjectArray<int> edgeRuns;
+	edgeRuns.resize(numTriangles*3*2,0);
+	int runStart = 0;
+	while (runStart < edges.size())
+	{
+		int runEnd = runStart+1;
+		while (runEnd < edges.size() && edges[runEnd].m_key==edges[runStart].m_key)
+			runEnd++;
+		if (runEnd-runStart > 1)
+		{
+			for (int k=runStart;k<runEnd;k++)
+			{
+				edgeRuns[edges[k].m_value*2] = runStart;
+				edgeRuns[edges[k].m_value*2+1] = runEnd;
+			}
+		}
+		runStart = runEnd;
 	}
 
+	btAlignedObjectArray<btTriangleInfo> triangleInfos;
+	triangleInfos.resize(numTriangles);
+	btAlignedObjectArray<unsigned char> connected;
+	connected.resize(numTriangles,0);
+
+	btEdgeConnectivityContext context;
+	context.m_vertices = &vertices[0];
+	context.m_triangleVertices = &triangleVertices[0];
+	context.m_edges = edges.size() ? &edges[0] : 0;
+	context.m_edgeRuns = &edgeRuns[0];
+	context.m_triangleInfoMap = triangleInfoMap;
+	context.m_triangleInfos = &triangleInfos[0];
+	context.m_connected = &connected[0];
+	context.m_numTriangles = numTriangles;
+
+	int numTasks = (numTriangles+BT_INTERNAL_EDGE_TASK_TRIANGLES-1)/BT_INTERNAL_EDGE_TASK_TRIANGLES;
+	int numThreads = (numTriangles >= BT_INTERNAL_EDGE_MIN_THREADED_TRIANGLES) ? btGetTaskThreadCount() : 1;
+	btParallelFor(numTasks,btEdgeConnectivityTask,&context,numThreads);
+
+	//insert in triangle order, so the map doesn't depend on the number of threads
+	for (partId = 0; partId< numParts;partId++)
+	{
+		for (triangle=partTriangleOffsets[partId];triangle<partTriangleOffsets[partId+1];triangle++)
+		{
+			if (connected[triangle])
+			{
+				triangleInfoMap->insert(btGetHash(partId,triangle-partTriangleOffsets[partId]),triangleInfos[triangle]);
+			}
+		}
+	}
 }
 
 
 
 
+
 // Given a point and a line segment (defined by two points), compute the closest point
 // in the line.  Cap the point at the endpoints of the line segment.
 void btNearestPointInLineSegment(const btVector3 &point, const btVector3& line0, const btVector3& line1, btVector3& nearestPoint)
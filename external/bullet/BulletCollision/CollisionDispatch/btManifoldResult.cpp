@@ -17,6 +17,9 @@ subject to the following restrictions:
 #include "btManifoldResult.h"
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 #include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+#include "BulletCollision/CollisionShapes/btCollisionShape.h"
+#include "BulletCollision/BroadphaseCollision/btDispatcher.h"
+#include "LinearMath/btTransformUtil.h"
 
 
 ///This is to allow MaterialCombiner/Custom Friction/Restitution values
@@ -46,19 +49,43 @@ inline btScalar	calculateCombinedRestitution(const btCollisionObject* body0,cons
 btManifoldResult::btManifoldResult(btCollisionObject* body0,btCollisionObject* body1)
 		:m_manifoldPtr(0),
 		m_body0(body0),
-		m_body1(body1)
-#ifdef DEBUG_PART_INDEX
-		,m_partId0(-1),
-	m_partId1(-1),
-	m_index0(-1),
-	m_index1(-1)
-#endif //DEBUG_PART_INDEX
+		m_body1(body1),
+		m_partId0(-1),
+		m_partId1(-1),
+		m_index0(-1),
+		m_index1(-1),
+		m_restoreCallback(0)
 {
 	m_rootTransA = body0->getWorldTransform();
 	m_rootTransB = body1->getWorldTransform();
 }
 
 
+///compound algorithms set the shape identifiers to (-1,childIndex) before they process a child, so a manifold created by a child algorithm is bound to that child
+void	btManifoldResult::bindPersistentManifold()
+{
+	int childIndex0 = (m_partId0 == -1) ? m_index0 : -1;
+	int childIndex1 = (m_partId1 == -1) ? m_index1 : -1;
+
+	bool isSwapped = m_manifoldPtr->getBody0() != m_body0;
+	if (isSwapped)
+	{
+		btSwap(childIndex0,childIndex1);
+	}
+	m_manifoldPtr->m_childIndex0 = childIndex0;
+	m_manifoldPtr->m_childIndex1 = childIndex1;
+
+	if (m_restoreCallback && m_restoreCallback->restoreManifold(m_manifoldPtr))
+	{
+		///compound algorithms refresh the manifolds of their children before processing them, a restored child manifold needs the same refresh
+		if ((childIndex0 >= 0) || (childIndex1 >= 0))
+		{
+			refreshContactPoints();
+		}
+	}
+}
+
+
 void btManifoldResult::addContactPoint(const btVector3& normalOnBInWorld,const btVector3& pointInWorld,btScalar depth)
 {
 	btAssert(m_manifoldPtr);
@@ -132,3 +159,36 @@ void btManifoldResult::addContactPoint(const btVector3& normalOnBInWorld,const b
 
 }
 
+///predicted motion of a collision object this step, from its root transform towards its interpolation world transform
+///compound children are temporarily placed at their child transform, so the angular motion includes their offset from the root
+static btScalar	predictedMotion(const btCollisionObject* colObj,const btTransform& rootTrans,btVector3& linearMotion)
+{
+	if (colObj->isStaticOrKinematicObject())
+	{
+		linearMotion.setValue(btScalar(0.),btScalar(0.),btScalar(0.));
+		return btScalar(0.);
+	}
+	const btTransform& predictedTrans = colObj->getInterpolationWorldTransform();
+	linearMotion = predictedTrans.getOrigin() - rootTrans.getOrigin();
+
+	btVector3 axis;
+	btScalar angle;
+	btTransformUtil::calculateDiffAxisAngle(rootTrans,predictedTrans,axis,angle);
+	btScalar childOffset = (colObj->getWorldTransform().getOrigin() - rootTrans.getOrigin()).length();
+	return angle * (colObj->getCollisionShape()->getAngularMotionDisc() + childOffset);
+}
+
+void	btManifoldResult::updateSpeculativeDistance(const btDispatcherInfo& dispatchInfo)
+{
+	btAssert(m_manifoldPtr);
+
+	btScalar speculativeDistance = btScalar(0.);
+	if (dispatchInfo.m_useSpeculativeContacts)
+	{
+		btVector3 linearMotion0,linearMotion1;
+		btScalar angularMotion0 = predictedMotion(m_body0,m_rootTransA,linearMotion0);
+		btScalar angularMotion1 = predictedMotion(m_body1,m_rootTransB,linearMotion1);
+		speculativeDistance = (linearMotion0-linearMotion1).length() + angularMotion0 + angularMotion1;
+	}
+	m_manifoldPtr->setSpeculativeDistance(speculativeDistance);
+}
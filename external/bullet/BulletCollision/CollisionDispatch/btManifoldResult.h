@@ -18,6 +18,7 @@ subject to the following restrictions:
 #define MANIFOLD_RESULT_H
 
 class btCollisionObject;
+struct btDispatcherInfo;
 #include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
 class btManifoldPoint;
 
@@ -30,6 +31,16 @@ extern ContactAddedCallback		gContactAddedCallback;
 
 //#define DEBUG_PART_INDEX 1
 
+///btManifoldRestoreCallback is called once for every new persistent manifold, when it is bound to its pair and compound children.
+///It allows restoring cached contact points, see btDynamicsWorldSnapshot. restoreManifold returns true when it added points.
+class btManifoldRestoreCallback
+{
+public:
+	virtual ~btManifoldRestoreCallback() {}
+
+	virtual bool	restoreManifold(btPersistentManifold* manifold) = 0;
+};
+
 
 ///btManifoldResult is a helper class to manage  contact results.
 class btManifoldResult : public btDiscreteCollisionDetectorInterface::Result
@@ -48,18 +59,21 @@ protected:
 	int m_partId1;
 	int m_index0;
 	int m_index1;
+
+	btManifoldRestoreCallback*	m_restoreCallback;
+
+	void	bindPersistentManifold();
 	
 
 public:
 
 	btManifoldResult()
-#ifdef DEBUG_PART_INDEX
-		:
+		:m_manifoldPtr(0),
 	m_partId0(-1),
 	m_partId1(-1),
 	m_index0(-1),
-	m_index1(-1)
-#endif //DEBUG_PART_INDEX
+	m_index1(-1),
+	m_restoreCallback(0)
 	{
 	}
 
@@ -70,6 +84,15 @@ public:
 	void	setPersistentManifold(btPersistentManifold* manifoldPtr)
 	{
 		m_manifoldPtr = manifoldPtr;
+		if (manifoldPtr && manifoldPtr->m_childIndex0 == BT_MANIFOLD_UNBOUND_CHILD)
+		{
+			bindPersistentManifold();
+		}
+	}
+
+	void	setRestoreCallback(btManifoldRestoreCallback* restoreCallback)
+	{
+		m_restoreCallback = restoreCallback;
 	}
 
 	const btPersistentManifold*	getPersistentManifold() const
@@ -96,6 +119,10 @@ public:
 
 	virtual void addContactPoint(const btVector3& normalOnBInWorld,const btVector3& pointInWorld,btScalar depth);
 
+	///updateSpeculativeDistance grows the contact breaking threshold of the manifold by the predicted approach of both objects during this step
+	///it uses the interpolation world transform, so predictUnconstraintMotion needs to run before the collision detection
+	void	updateSpeculativeDistance(const btDispatcherInfo& dispatchInfo);
+
 	SIMD_FORCE_INLINE	void refreshContactPoints()
 	{
 		btAssert(m_manifoldPtr);
@@ -26,7 +26,8 @@ subject to the following restrictions:
 #include "LinearMath/btQuickprof.h"
 
 btSimulationIslandManager::btSimulationIslandManager():
-m_splitIslands(true)
+m_splitIslands(true),
+m_deterministicOrder(false)
 {
 }
 
@@ -41,9 +42,29 @@ void btSimulationIslandManager::initUnionFind(int n)
 }
 		
 
-void btSimulationIslandManager::findUnions(btDispatcher* /* dispatcher */,btCollisionWorld* colWorld)
+void btSimulationIslandManager::findUnions(btDispatcher* dispatcher,btCollisionWorld* colWorld)
 {
-	
+	if (m_deterministicOrder)
+	{
+		///the pair cache can hold different pairs for the same state, for example after a snapshot restore, so only touching objects are merged
+		const int numManifolds = dispatcher->getNumManifolds();
+		for (int i=0;i<numManifolds;i++)
+		{
+			const btPersistentManifold* manifold = dispatcher->getManifoldByIndexInternal(i);
+			if (!manifold->getNumContacts())
+				continue;
+
+			const btCollisionObject* colObj0 = static_cast<const btCollisionObject*>(manifold->getBody0());
+			const btCollisionObject* colObj1 = static_cast<const btCollisionObject*>(manifold->getBody1());
+
+			if (colObj0->mergesSimulationIslands() && colObj1->mergesSimulationIslands())
+			{
+				m_unionFind.unite(colObj0->getIslandTag(),colObj1->getIslandTag());
+			}
+		}
+		return;
+	}
+
 	{
 		btOverlappingPairCache* pairCachePtr = colWorld->getPairCache();
 		const int numOverlappingPairs = pairCachePtr->getNumOverlappingPairs();
@@ -196,6 +217,34 @@ class btPersistentManifoldSortPredicate
 		}
 };
 
+///total order on the island id, the broadphase unique ids of both objects and the compound children
+class btPersistentManifoldDeterministicSortPredicate
+{
+	public:
+
+		SIMD_FORCE_INLINE bool operator() ( const btPersistentManifold* lhs, const btPersistentManifold* rhs )
+		{
+			int lhsIslandId = getIslandId(lhs);
+			int rhsIslandId = getIslandId(rhs);
+			if (lhsIslandId != rhsIslandId)
+				return lhsIslandId < rhsIslandId;
+
+			int lhsUid0 = static_cast<const btCollisionObject*>(lhs->getBody0())->getBroadphaseHandle()->m_uniqueId;
+			int rhsUid0 = static_cast<const btCollisionObject*>(rhs->getBody0())->getBroadphaseHandle()->m_uniqueId;
+			if (lhsUid0 != rhsUid0)
+				return lhsUid0 < rhsUid0;
+
+			int lhsUid1 = static_cast<const btCollisionObject*>(lhs->getBody1())->getBroadphaseHandle()->m_uniqueId;
+			int rhsUid1 = static_cast<const btCollisionObject*>(rhs->getBody1())->getBroadphaseHandle()->m_uniqueId;
+			if (lhsUid1 != rhsUid1)
+				return lhsUid1 < rhsUid1;
+
+			if (lhs->m_childIndex0 != rhs->m_childIndex0)
+				return lhs->m_childIndex0 < rhs->m_childIndex0;
+			return lhs->m_childIndex1 < rhs->m_childIndex1;
+		}
+};
+
 
 void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisionWorld* collisionWorld)
 {
@@ -319,6 +368,9 @@ void btSimulationIslandManager::buildIslands(btDispatcher* dispatcher,btCollisio
 		 btCollisionObject* colObj0 = static_cast<btCollisionObject*>(manifold->getBody0());
 		 btCollisionObject* colObj1 = static_cast<btCollisionObject*>(manifold->getBody1());
 		
+		 if (m_deterministicOrder && !manifold->getNumContacts())
+			 continue;
+
 		 ///@todo: check sleeping conditions!
 		 if (((colObj0) && colObj0->getActivationState() != ISLAND_SLEEPING) ||
 			((colObj1) && colObj1->getActivationState() != ISLAND_SLEEPING))
@@ -360,9 +412,23 @@ void btSimulationIslandManager::buildAndProcessIslands(btDispatcher* dispatcher,
 
 	if(!m_splitIslands)
 	{
-		btPersistentManifold** manifold = dispatcher->getInternalManifoldPointer();
-		int maxNumManifolds = dispatcher->getNumManifolds();
-		callback->ProcessIsland(&collisionObjects[0],collisionObjects.size(),manifold,maxNumManifolds, -1);
+		if (m_deterministicOrder)
+		{
+			//the dispatcher array is in creation order, and releaseManifold relies on its indices
+			m_islandmanifold.resize(0);
+			for (int i=0;i<dispatcher->getNumManifolds();i++)
+			{
+				m_islandmanifold.push_back(dispatcher->getManifoldByIndexInternal(i));
+			}
+			m_islandmanifold.quickSort(btPersistentManifoldDeterministicSortPredicate());
+			btPersistentManifold** manifold = m_islandmanifold.size() ? &m_islandmanifold[0] : 0;
+			callback->ProcessIsland(&collisionObjects[0],collisionObjects.size(),manifold,m_islandmanifold.size(), -1);
+		} else
+		{
+			btPersistentManifold** manifold = dispatcher->getInternalManifoldPointer();
+			int maxNumManifolds = dispatcher->getNumManifolds();
+			callback->ProcessIsland(&collisionObjects[0],collisionObjects.size(),manifold,maxNumManifolds, -1);
+		}
 	}
 	else
 	{
@@ -373,7 +439,13 @@ void btSimulationIslandManager::buildAndProcessIslands(btDispatcher* dispatcher,
 		int numManifolds = int (m_islandmanifold.size());
 
 		//we should do radix sort, it it much faster (O(n) instead of O (n log2(n))
-		m_islandmanifold.quickSort(btPersistentManifoldSortPredicate());
+		if (m_deterministicOrder)
+		{
+			m_islandmanifold.quickSort(btPersistentManifoldDeterministicSortPredicate());
+		} else
+		{
+			m_islandmanifold.quickSort(btPersistentManifoldSortPredicate());
+		}
 
 		//now process all active islands (sets of manifolds for now)
 
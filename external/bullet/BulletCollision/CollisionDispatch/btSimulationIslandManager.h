@@ -36,6 +36,7 @@ class btSimulationIslandManager
 	btAlignedObjectArray<btCollisionObject* >  m_islandBodies;
 	
 	bool m_splitIslands;
+	bool m_deterministicOrder;
 	
 public:
 	btSimulationIslandManager();
@@ -75,6 +76,18 @@ public:
 		m_splitIslands = doSplitIslands;
 	}
 
+	///with a deterministic order, islands are built from the manifolds that have contact points instead of the broadphase pairs,
+	///and the island ids and the manifold order passed to the IslandCallback don't depend on the pair cache or manifold creation order
+	bool getDeterministicOrder() const
+	{
+		return m_deterministicOrder;
+	}
+	void setDeterministicOrder(bool deterministicOrder)
+	{
+		m_deterministicOrder = deterministicOrder;
+		m_unionFind.setOrderedUnion(deterministicOrder);
+	}
+
 };
 
 #endif //SIMULATION_ISLAND_MANAGER_H
@@ -41,12 +41,11 @@ btSphereSphereCollisionAlgorithm::~btSphereSphereCollisionAlgorithm()
 
 void btSphereSphereCollisionAlgorithm::processCollision (btCollisionObject* col0,btCollisionObject* col1,const btDispatcherInfo& dispatchInfo,btManifoldResult* resultOut)
 {
-	(void)dispatchInfo;
-
 	if (!m_manifoldPtr)
 		return;
 
 	resultOut->setPersistentManifold(m_manifoldPtr);
+	resultOut->updateSpeculativeDistance(dispatchInfo);
 
 	btSphereShape* sphere0 = (btSphereShape*)col0->getCollisionShape();
 	btSphereShape* sphere1 = (btSphereShape*)col1->getCollisionShape();
@@ -60,8 +59,8 @@ void btSphereSphereCollisionAlgorithm::processCollision (btCollisionObject* col0
 	m_manifoldPtr->clearManifold(); //don't do this, it disables warmstarting
 #endif
 
-	///iff distance positive, don't generate a new contact
-	if ( len > (radius0+radius1))
+	///iff distance positive (beyond the speculative distance), don't generate a new contact
+	if ( len > (radius0+radius1+m_manifoldPtr->getSpeculativeDistance()))
 	{
 #ifndef CLEAR_MANIFOLD
 		resultOut->refreshContactPoints();
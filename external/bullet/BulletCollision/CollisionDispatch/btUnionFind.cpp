@@ -24,6 +24,7 @@ btUnionFind::~btUnionFind()
 }
 
 btUnionFind::btUnionFind()
+:m_orderedUnion(false)
 { 
 
 }
@@ -36,6 +36,7 @@ class btUnionFind
   {
     private:
 		btAlignedObjectArray<btElement>	m_elements;
+		bool	m_orderedUnion;
 
     public:
 	  
@@ -49,6 +50,16 @@ class btUnionFind
 
 	  void	reset(int N);
 
+	  ///with an ordered union the root of each subset is its smallest element, so the island ids don't depend on the order of the unite calls
+	  void	setOrderedUnion(bool orderedUnion)
+	  {
+		  m_orderedUnion = orderedUnion;
+	  }
+	  bool	getOrderedUnion() const
+	  {
+		  return m_orderedUnion;
+	  }
+
 	  SIMD_FORCE_INLINE int	getNumElements() const
 	  {
 		  return int(m_elements.size());
@@ -84,6 +95,16 @@ class btUnionFind
 			if (i == j) 
 				return;
 
+			if (m_orderedUnion)
+			{
+				if (j < i)
+				{
+					btSwap(i,j);
+				}
+				m_elements[j].m_id = i; m_elements[i].m_sz += m_elements[j].m_sz;
+				return;
+			}
+
 #ifndef USE_PATH_COMPRESSION
 			//weighted quick union, this keeps the 'trees' balanced, and keeps performance of unite O( log(n) )
 			if (m_elements[i].m_sz < m_elements[j].m_sz)
@@ -0,0 +1,555 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btBvhTriangleMeshBlob.h"
+#include "btOptimizedBvh.h"
+
+#include <new>
+
+#include <stdio.h>
+#include <string.h>
+
+#if !defined (_WIN32) && !defined (__SPU__)
+#define BT_BVH_BLOB_USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif //_WIN32
+
+static const char btBvhMeshBlobMagic[8] = {'B','T','B','V','H','M','S','H'};
+static const int btBvhMeshBlobEndianMarker = 0x01020304;
+
+static SIMD_FORCE_INLINE unsigned int btAlignBlobOffset(unsigned int offset)
+{
+	return (offset+15) & ~15u;
+}
+
+static int btGetBlobIndexSize(PHY_ScalarType indexType)
+{
+	switch (indexType)
+	{
+	case PHY_INTEGER:
+		return 4;
+	case PHY_SHORT:
+		return 2;
+	default:
+		//btBvhTriangleMeshShape only supports 16 and 32 bit indices
+		return 0;
+	}
+}
+
+static int btGetBlobVertexSize(PHY_ScalarType vertexType)
+{
+	switch (vertexType)
+	{
+	case PHY_FLOAT:
+		return 4;
+	case PHY_DOUBLE:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+///btHasValidBlobIndices returns true if all triangles of the part refer to vertices of the part
+static bool btHasValidBlobIndices(const unsigned char* blob,const btBvhMeshBlobPart& blobPart)
+{
+	int numIndices = 3*blobPart.m_numTriangles;
+	unsigned int numVertices = unsigned(blobPart.m_numVertices);
+	int i;
+	if (blobPart.m_indexType == PHY_SHORT)
+	{
+		const unsigned short int* indices = (const unsigned short int*)(blob+blobPart.m_indexOffset);
+		for (i=0;i<numIndices;i++)
+		{
+			if (indices[i] >= numVertices)
+				return false;
+		}
+	} else
+	{
+		const unsigned int* indices = (const unsigned int*)(blob+blobPart.m_indexOffset);
+		for (i=0;i<numIndices;i++)
+		{
+			if (indices[i] >= numVertices)
+				return false;
+		}
+	}
+	return true;
+}
+
+btBvhTriangleMeshBlob::btBvhTriangleMeshBlob()
+:m_buffer(0),
+m_bufferSize(0),
+m_bufferOwnership(BUFFER_EXTERNAL),
+m_meshInterface(0),
+m_bvh(0),
+m_shape(0),
+m_triangleInfoMap(0)
+{
+}
+
+btBvhTriangleMeshBlob::~btBvhTriangleMeshBlob()
+{
+	unload();
+}
+
+unsigned int	btBvhTriangleMeshBlob::calculateBlobSize(const btBvhTriangleMeshShape* shape)
+{
+	const btOptimizedBvh* bvh = shape->getOptimizedBvh();
+	if (!bvh)
+		return 0;
+
+	const btStridingMeshInterface* meshInterface = shape->getMeshInterface();
+	int numParts = meshInterface->getNumSubParts();
+
+	unsigned int offset = btAlignBlobOffset(sizeof(btBvhMeshBlobHeader));
+	offset = btAlignBlobOffset(offset + numParts*sizeof(btBvhMeshBlobPart));
+
+	for (int part=0;part<numParts;part++)
+	{
+		const unsigned char *vertexbase;
+		int numverts;
+		PHY_ScalarType type;
+		int stride;
+		const unsigned char *indexbase;
+		int indexstride;
+		int numfaces;
+		PHY_ScalarType indicestype;
+
+		meshInterface->getLockedReadOnlyVertexIndexBase(&vertexbase,numverts,type,stride,&indexbase,indexstride,numfaces,indicestype,part);
+		meshInterface->unLockReadOnlyVertexBase(part);
+
+		int indexSize = btGetBlobIndexSize(indicestype);
+		int vertexSize = btGetBlobVertexSize(type);
+		if (!indexSize || !vertexSize)
+			return 0;
+
+		offset = btAlignBlobOffset(offset + numfaces*3*indexSize);
+		offset = btAlignBlobOffset(offset + numverts*3*vertexSize);
+	}
+
+	offset = btAlignBlobOffset(offset + bvh->calculateSerializeBufferSize());
+	if (shape->getWideBvh())
+	{
+		offset = btAlignBlobOffset(offset + shape->getWideBvh()->calculateSerializeBufferSize());
+	}
+	const btTriangleInfoMap* triangleInfoMap = shape->getTriangleInfoMap();
+	if (triangleInfoMap)
+	{
+		offset += btAlignBlobOffset(sizeof(btBvhMeshBlobTriangleInfoMap)) + triangleInfoMap->size()*sizeof(btBvhMeshBlobTriangleInfo);
+	}
+	return btAlignBlobOffset(offset);
+}
+
+unsigned int	btBvhTriangleMeshBlob::writeBlob(const btBvhTriangleMeshShape* shape,void* alignedBuffer,unsigned int bufferSize)
+{
+	unsigned int blobSize = calculateBlobSize(shape);
+	if (!blobSize || !alignedBuffer || bufferSize < blobSize || ((size_t)alignedBuffer & 15))
+		return 0;
+
+	unsigned char* blob = (unsigned char*)alignedBuffer;
+	memset(blob,0,blobSize);
+
+	const btOptimizedBvh* bvh = shape->getOptimizedBvh();
+	const btStridingMeshInterface* meshInterface = shape->getMeshInterface();
+	int numParts = meshInterface->getNumSubParts();
+
+	btBvhMeshBlobHeader* header = (btBvhMeshBlobHeader*)blob;
+	memcpy(header->m_magic,btBvhMeshBlobMagic,sizeof(btBvhMeshBlobMagic));
+	header->m_blobVersion = BT_BVH_MESH_BLOB_VERSION;
+	header->m_bulletVersion = BT_BULLET_VERSION;
+	header->m_endianMarker = btBvhMeshBlobEndianMarker;
+	header->m_sizeofPointer = sizeof(void*);
+	header->m_sizeofScalar = sizeof(btScalar);
+	header->m_sizeofBvh = sizeof(btQuantizedBvh);
+	header->m_blobSize = blobSize;
+	header->m_numParts = numParts;
+	header->m_useQuantizedAabbCompression = shape->usesQuantizedAabbCompression() ? 1 : 0;
+	header->m_useWideBvh = shape->getUseWideBvh() ? 1 : 0;
+	for (int i=0;i<3;i++)
+	{
+		header->m_scaling[i] = shape->getLocalScaling()[i];
+		header->m_localAabbMin[i] = shape->getLocalAabbMin()[i];
+		header->m_localAabbMax[i] = shape->getLocalAabbMax()[i];
+	}
+	header->m_collisionMargin = shape->getMargin();
+
+	unsigned int offset = btAlignBlobOffset(sizeof(btBvhMeshBlobHeader));
+	header->m_partsOffset = offset;
+	btBvhMeshBlobPart* parts = (btBvhMeshBlobPart*)(blob+offset);
+	offset = btAlignBlobOffset(offset + numParts*sizeof(btBvhMeshBlobPart));
+
+	for (int part=0;part<numParts;part++)
+	{
+		const unsigned char *vertexbase;
+		int numverts;
+		PHY_ScalarType type;
+		int stride;
+		const unsigned char *indexbase;
+		int indexstride;
+		int numfaces;
+		PHY_ScalarType indicestype;
+
+		meshInterface->getLockedReadOnlyVertexIndexBase(&vertexbase,numverts,type,stride,&indexbase,indexstride,numfaces,indicestype,part);
+
+		btBvhMeshBlobPart& blobPart = parts[part];
+		blobPart.m_numTriangles = numfaces;
+		blobPart.m_triangleIndexStride = 3*btGetBlobIndexSize(indicestype);
+		blobPart.m_indexType = indicestype;
+		blobPart.m_numVertices = numverts;
+		blobPart.m_vertexStride = 3*btGetBlobVertexSize(type);
+		blobPart.m_vertexType = type;
+
+		//pack the arrays, the source may use larger strides
+		blobPart.m_indexOffset = offset;
+		int i;
+		for (i=0;i<numfaces;i++)
+		{
+			memcpy(blob+offset+i*blobPart.m_triangleIndexStride,indexbase+i*indexstride,blobPart.m_triangleIndexStride);
+		}
+		offset = btAlignBlobOffset(offset + numfaces*blobPart.m_triangleIndexStride);
+
+		blobPart.m_vertexOffset = offset;
+		for (i=0;i<numverts;i++)
+		{
+			memcpy(blob+offset+i*blobPart.m_vertexStride,vertexbase+i*stride,blobPart.m_vertexStride);
+		}
+		offset = btAlignBlobOffset(offset + numverts*blobPart.m_vertexStride);
+
+		meshInterface->unLockReadOnlyVertexBase(part);
+	}
+
+	header->m_bvhOffset = offset;
+	header->m_bvhSize = bvh->calculateSerializeBufferSize();
+	if (!bvh->serializeInPlace(blob+offset,header->m_bvhSize,false))
+		return 0;
+	offset = btAlignBlobOffset(offset + header->m_bvhSize);
+
+	const btWideQuantizedBvh* wideBvh = shape->getWideBvh();
+	if (wideBvh)
+	{
+		header->m_wideOffset = offset;
+		header->m_wideNumNodes = wideBvh->getNumNodes();
+		header->m_wideMaxDepth = wideBvh->getMaxDepth();
+		wideBvh->serialize(blob+offset);
+		offset = btAlignBlobOffset(offset + wideBvh->calculateSerializeBufferSize());
+	}
+
+	const btTriangleInfoMap* triangleInfoMap = shape->getTriangleInfoMap();
+	if (triangleInfoMap)
+	{
+		header->m_triangleInfoOffset = offset;
+		btBvhMeshBlobTriangleInfoMap* blobMap = (btBvhMeshBlobTriangleInfoMap*)(blob+offset);
+		blobMap->m_convexEpsilon = triangleInfoMap->m_convexEpsilon;
+		blobMap->m_planarEpsilon = triangleInfoMap->m_planarEpsilon;
+		blobMap->m_equalVertexThreshold = triangleInfoMap->m_equalVertexThreshold;
+		blobMap->m_edgeDistanceThreshold = triangleInfoMap->m_edgeDistanceThreshold;
+		blobMap->m_zeroAreaThreshold = triangleInfoMap->m_zeroAreaThreshold;
+		blobMap->m_numTriangleInfos = triangleInfoMap->size();
+		btBvhMeshBlobTriangleInfo* blobInfos = (btBvhMeshBlobTriangleInfo*)(blob+offset+btAlignBlobOffset(sizeof(btBvhMeshBlobTriangleInfoMap)));
+		for (int i=0;i<triangleInfoMap->size();i++)
+		{
+			const btTriangleInfo* info = triangleInfoMap->getAtIndex(i);
+			blobInfos[i].m_key = triangleInfoMap->getKeyAtIndex(i).getUid1();
+			blobInfos[i].m_flags = info->m_flags;
+			blobInfos[i].m_edgeV0V1Angle = info->m_edgeV0V1Angle;
+			blobInfos[i].m_edgeV1V2Angle = info->m_edgeV1V2Angle;
+			blobInfos[i].m_edgeV2V0Angle = info->m_edgeV2V0Angle;
+		}
+	}
+
+	return blobSize;
+}
+
+bool	btBvhTriangleMeshBlob::writeBlobToFile(const btBvhTriangleMeshShape* shape,const char* fileName)
+{
+	unsigned int blobSize = calculateBlobSize(shape);
+	if (!blobSize)
+		return false;
+
+	void* buffer = btAlignedAlloc(blobSize,16);
+	bool written = false;
+	if (writeBlob(shape,buffer,blobSize))
+	{
+		FILE* file = fopen(fileName,"wb");
+		if (file)
+		{
+			written = (fwrite(buffer,1,blobSize,file) == blobSize);
+			written = (fclose(file) == 0) && written;
+		}
+	}
+	btAlignedFree(buffer);
+	return written;
+}
+
+bool	btBvhTriangleMeshBlob::loadBlob(void* alignedBuffer,unsigned int bufferSize)
+{
+	unload();
+
+	if (!alignedBuffer || ((size_t)alignedBuffer & 15) || bufferSize < sizeof(btBvhMeshBlobHeader))
+		return false;
+
+	unsigned char* blob = (unsigned char*)alignedBuffer;
+	const btBvhMeshBlobHeader* header = (const btBvhMeshBlobHeader*)blob;
+
+	if (memcmp(header->m_magic,btBvhMeshBlobMagic,sizeof(btBvhMeshBlobMagic)) ||
+		header->m_blobVersion != BT_BVH_MESH_BLOB_VERSION ||
+		header->m_bulletVersion != BT_BULLET_VERSION ||
+		header->m_endianMarker != btBvhMeshBlobEndianMarker ||
+		header->m_sizeofPointer != int(sizeof(void*)) ||
+		header->m_sizeofScalar != int(sizeof(btScalar)) ||
+		header->m_sizeofBvh != int(sizeof(btQuantizedBvh)))
+	{
+		return false;
+	}
+
+	unsigned int blobSize = header->m_blobSize;
+	if (blobSize > bufferSize || header->m_numParts < 0 ||
+		header->m_partsOffset > blobSize || (header->m_partsOffset & 15) ||
+		unsigned(header->m_numParts) > (blobSize-header->m_partsOffset)/sizeof(btBvhMeshBlobPart) ||
+		header->m_bvhOffset > blobSize || header->m_bvhSize > blobSize-header->m_bvhOffset ||
+		header->m_bvhSize < sizeof(btQuantizedBvh) || (header->m_bvhOffset & 15) ||
+		header->m_wideNumNodes < 0 || header->m_wideOffset > blobSize || (header->m_wideOffset & 15) ||
+		unsigned(header->m_wideNumNodes) > (blobSize-header->m_wideOffset)/sizeof(btWideQuantizedBvhNode) ||
+		header->m_triangleInfoOffset > blobSize || (header->m_triangleInfoOffset & 15))
+	{
+		return false;
+	}
+
+	const btBvhMeshBlobTriangleInfoMap* blobMap = 0;
+	const btBvhMeshBlobTriangleInfo* blobInfos = 0;
+	if (header->m_triangleInfoOffset)
+	{
+		unsigned int infosOffset = header->m_triangleInfoOffset + btAlignBlobOffset(sizeof(btBvhMeshBlobTriangleInfoMap));
+		if (infosOffset > blobSize)
+			return false;
+		blobMap = (const btBvhMeshBlobTriangleInfoMap*)(blob+header->m_triangleInfoOffset);
+		blobInfos = (const btBvhMeshBlobTriangleInfo*)(blob+infosOffset);
+		if (blobMap->m_numTriangleInfos < 0 || unsigned(blobMap->m_numTriangleInfos) > (blobSize-infosOffset)/sizeof(btBvhMeshBlobTriangleInfo))
+			return false;
+	}
+
+	const btBvhMeshBlobPart* parts = (const btBvhMeshBlobPart*)(blob+header->m_partsOffset);
+	int part;
+	for (part=0;part<header->m_numParts;part++)
+	{
+		const btBvhMeshBlobPart& blobPart = parts[part];
+		int indexSize = btGetBlobIndexSize(PHY_ScalarType(blobPart.m_indexType));
+		int vertexSize = btGetBlobVertexSize(PHY_ScalarType(blobPart.m_vertexType));
+		if (!indexSize || !vertexSize ||
+			blobPart.m_triangleIndexStride != 3*indexSize || blobPart.m_vertexStride != 3*vertexSize ||
+			blobPart.m_numTriangles < 0 || blobPart.m_numVertices < 0 ||
+			//check the alignment before btHasValidBlobIndices reads the indices
+			(blobPart.m_indexOffset & 15) || (blobPart.m_vertexOffset & 15) ||
+			blobPart.m_indexOffset > blobSize || unsigned(blobPart.m_numTriangles) > (blobSize-blobPart.m_indexOffset)/blobPart.m_triangleIndexStride ||
+			blobPart.m_vertexOffset > blobSize || unsigned(blobPart.m_numVertices) > (blobSize-blobPart.m_vertexOffset)/blobPart.m_vertexStride ||
+			!btHasValidBlobIndices(blob,blobPart))
+		{
+			return false;
+		}
+	}
+
+	m_meshInterface = new btTriangleIndexVertexArray();
+	for (part=0;part<header->m_numParts;part++)
+	{
+		const btBvhMeshBlobPart& blobPart = parts[part];
+		btIndexedMesh mesh;
+		mesh.m_numTriangles = blobPart.m_numTriangles;
+		mesh.m_triangleIndexBase = blob+blobPart.m_indexOffset;
+		mesh.m_triangleIndexStride = blobPart.m_triangleIndexStride;
+		mesh.m_numVertices = blobPart.m_numVertices;
+		mesh.m_vertexBase = blob+blobPart.m_vertexOffset;
+		mesh.m_vertexStride = blobPart.m_vertexStride;
+		mesh.m_vertexType = PHY_ScalarType(blobPart.m_vertexType);
+		m_meshInterface->addIndexedMesh(mesh,PHY_ScalarType(blobPart.m_indexType));
+	}
+
+	btVector3 scaling(header->m_scaling[0],header->m_scaling[1],header->m_scaling[2]);
+	//the scaling and premade aabb avoid a pass over all triangles when the shape is created
+	m_meshInterface->setScaling(scaling);
+	m_meshInterface->setPremadeAabb(btVector3(header->m_localAabbMin[0],header->m_localAabbMin[1],header->m_localAabbMin[2]),
+		btVector3(header->m_localAabbMax[0],header->m_localAabbMax[1],header->m_localAabbMax[2]));
+
+	m_bvh = btOptimizedBvh::deSerializeInPlace(blob+header->m_bvhOffset,header->m_bvhSize,false);
+	if (!m_bvh || !m_bvh->hasValidNodes(m_meshInterface))
+	{
+		unload();
+		return false;
+	}
+
+	m_shape = new btBvhTriangleMeshShape(m_meshInterface,header->m_useQuantizedAabbCompression!=0,false);
+	m_shape->setMargin(header->m_collisionMargin);
+	//attach the stored wide tree instead of collapsing it again
+	m_shape->setUseWideBvh(header->m_useWideBvh && !header->m_wideNumNodes);
+	m_shape->setOptimizedBvh(m_bvh,scaling);
+	if (header->m_wideNumNodes)
+	{
+		btAlignedObjectArray<int> numTrianglesPerPart;
+		numTrianglesPerPart.resize(header->m_numParts);
+		for (part=0;part<header->m_numParts;part++)
+		{
+			numTrianglesPerPart[part] = parts[part].m_numTriangles;
+		}
+		void* mem = btAlignedAlloc(sizeof(btWideQuantizedBvh),16);
+		btWideQuantizedBvh* wideBvh = new(mem) btWideQuantizedBvh();
+		if (wideBvh->deSerializeInPlace(m_bvh,blob+header->m_wideOffset,header->m_wideNumNodes,header->m_wideMaxDepth,
+			numTrianglesPerPart.size() ? &numTrianglesPerPart[0] : 0,numTrianglesPerPart.size()))
+		{
+			m_shape->setWideBvh(wideBvh);
+		} else
+		{
+			wideBvh->~btWideQuantizedBvh();
+			btAlignedFree(wideBvh);
+			m_shape->setUseWideBvh(header->m_useWideBvh!=0);
+		}
+	}
+
+	if (blobMap)
+	{
+		//the map is rebuilt in the stored order, this is a single pass without any connectivity queries
+		m_triangleInfoMap = new btTriangleInfoMap();
+		m_triangleInfoMap->m_convexEpsilon = blobMap->m_convexEpsilon;
+		m_triangleInfoMap->m_planarEpsilon = blobMap->m_planarEpsilon;
+		m_triangleInfoMap->m_equalVertexThreshold = blobMap->m_equalVertexThreshold;
+		m_triangleInfoMap->m_edgeDistanceThreshold = blobMap->m_edgeDistanceThreshold;
+		m_triangleInfoMap->m_zeroAreaThreshold = blobMap->m_zeroAreaThreshold;
+		for (int i=0;i<blobMap->m_numTriangleInfos;i++)
+		{
+			btTriangleInfo info;
+			info.m_flags = blobInfos[i].m_flags;
+			info.m_edgeV0V1Angle = blobInfos[i].m_edgeV0V1Angle;
+			info.m_edgeV1V2Angle = blobInfos[i].m_edgeV1V2Angle;
+			info.m_edgeV2V0Angle = blobInfos[i].m_edgeV2V0Angle;
+			m_triangleInfoMap->insert(btHashInt(blobInfos[i].m_key),info);
+		}
+		m_shape->setTriangleInfoMap(m_triangleInfoMap);
+	}
+
+	m_buffer = alignedBuffer;
+	m_bufferSize = bufferSize;
+	m_bufferOwnership = BUFFER_EXTERNAL;
+	return true;
+}
+
+bool	btBvhTriangleMeshBlob::loadBlobFromFile(const char* fileName)
+{
+	unload();
+
+	void* buffer = 0;
+	unsigned int bufferSize = 0;
+	int ownership = BUFFER_ALLOCATED;
+
+#ifdef BT_BVH_BLOB_USE_MMAP
+	int fd = open(fileName,O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat fileStat;
+	if (fstat(fd,&fileStat)==0 && fileStat.st_size > 0)
+	{
+		//a private mapping is copy on write, deSerializeInPlace only touches the page with the bvh header
+		void* mapped = mmap(0,size_t(fileStat.st_size),PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+		if (mapped != MAP_FAILED)
+		{
+			buffer = mapped;
+			bufferSize = (unsigned int)fileStat.st_size;
+			ownership = BUFFER_MAPPED;
+		}
+	}
+	close(fd);
+#else
+	FILE* file = fopen(fileName,"rb");
+	if (!file)
+		return false;
+	fseek(file,0,SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file,0,SEEK_SET);
+	if (fileSize > 0)
+	{
+		buffer = btAlignedAlloc(size_t(fileSize),16);
+		bufferSize = (unsigned int)fileSize;
+		if (fread(buffer,1,bufferSize,file) != bufferSize)
+		{
+			btAlignedFree(buffer);
+			buffer = 0;
+		}
+	}
+	fclose(file);
+#endif //BT_BVH_BLOB_USE_MMAP
+
+	if (!buffer)
+		return false;
+
+	if (!loadBlob(buffer,bufferSize))
+	{
+		m_buffer = buffer;
+		m_bufferSize = bufferSize;
+		m_bufferOwnership = ownership;
+		releaseBuffer();
+		return false;
+	}
+
+	m_bufferOwnership = ownership;
+	return true;
+}
+
+void	btBvhTriangleMeshBlob::unload()
+{
+	if (m_shape)
+	{
+		delete m_shape;
+		m_shape = 0;
+	}
+	if (m_triangleInfoMap)
+	{
+		delete m_triangleInfoMap;
+		m_triangleInfoMap = 0;
+	}
+	if (m_bvh)
+	{
+		//the bvh lives in the buffer, its arrays don't own their memory
+		m_bvh->~btOptimizedBvh();
+		m_bvh = 0;
+	}
+	if (m_meshInterface)
+	{
+		delete m_meshInterface;
+		m_meshInterface = 0;
+	}
+	releaseBuffer();
+}
+
+void	btBvhTriangleMeshBlob::releaseBuffer()
+{
+	if (m_buffer)
+	{
+		switch (m_bufferOwnership)
+		{
+		case BUFFER_ALLOCATED:
+			btAlignedFree(m_buffer);
+			break;
+#ifdef BT_BVH_BLOB_USE_MMAP
+		case BUFFER_MAPPED:
+			munmap(m_buffer,m_bufferSize);
+			break;
+#endif //BT_BVH_BLOB_USE_MMAP
+		default:
+			break;
+		}
+	}
+	m_buffer = 0;
+	m_bufferSize = 0;
+	m_bufferOwnership = BUFFER_EXTERNAL;
+}
@@ -0,0 +1,153 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BVH_TRIANGLE_MESH_BLOB_H
+#define BVH_TRIANGLE_MESH_BLOB_H
+
+#include "btBvhTriangleMeshShape.h"
+#include "btTriangleIndexVertexArray.h"
+
+///increase this when the layout of the blob changes
+#define BT_BVH_MESH_BLOB_VERSION 2
+
+///btBvhMeshBlobHeader is at the start of every blob. All offsets are relative to the start of the blob and 16 byte aligned.
+///The in-place btQuantizedBvh depends on the platform, so the blob stores the sizes it was written with, and a blob from another platform is rejected.
+struct	btBvhMeshBlobHeader
+{
+	char	m_magic[8];
+	int		m_blobVersion;
+	int		m_bulletVersion;
+	int		m_endianMarker;
+	int		m_sizeofPointer;
+	int		m_sizeofScalar;
+	int		m_sizeofBvh;
+
+	unsigned int	m_blobSize;
+	int		m_numParts;
+	unsigned int	m_partsOffset;
+	unsigned int	m_bvhOffset;
+	unsigned int	m_bvhSize;
+	int		m_useQuantizedAabbCompression;
+	int		m_useWideBvh;
+	//the wide tree is optional, m_wideNumNodes is 0 for small meshes
+	unsigned int	m_wideOffset;
+	int		m_wideNumNodes;
+	int		m_wideMaxDepth;
+	//the triangle info map is optional, m_triangleInfoOffset is 0 if the shape has no btTriangleInfoMap
+	unsigned int	m_triangleInfoOffset;
+
+	btScalar	m_scaling[4];
+	btScalar	m_localAabbMin[4];
+	btScalar	m_localAabbMax[4];
+	btScalar	m_collisionMargin;
+};
+
+///btBvhMeshBlobPart describes the vertex and index arrays of one subpart, the arrays are stored tightly packed.
+struct	btBvhMeshBlobPart
+{
+	int		m_numTriangles;
+	int		m_triangleIndexStride;
+	int		m_indexType;
+	int		m_numVertices;
+	int		m_vertexStride;
+	int		m_vertexType;
+	unsigned int	m_indexOffset;
+	unsigned int	m_vertexOffset;
+};
+
+///btBvhMeshBlobTriangleInfoMap stores the thresholds of a btTriangleInfoMap, it is followed by m_numTriangleInfos entries in insertion order
+struct	btBvhMeshBlobTriangleInfoMap
+{
+	btScalar	m_convexEpsilon;
+	btScalar	m_planarEpsilon;
+	btScalar	m_equalVertexThreshold;
+	btScalar	m_edgeDistanceThreshold;
+	btScalar	m_zeroAreaThreshold;
+	int			m_numTriangleInfos;
+};
+
+struct	btBvhMeshBlobTriangleInfo
+{
+	int			m_key;
+	int			m_flags;
+	btScalar	m_edgeV0V1Angle;
+	btScalar	m_edgeV1V2Angle;
+	btScalar	m_edgeV2V0Angle;
+};
+
+///The btBvhTriangleMeshBlob stores a btBvhTriangleMeshShape in a single buffer: the triangle index and vertex arrays, the serialized btOptimizedBvh, the btWideQuantizedBvh nodes and the btTriangleInfoMap, so btGenerateInternalEdgeInfo doesn't need to run at load time.
+///A blob is loaded in place without copying or building anything, so static level geometry can be written once by the asset pipeline and memory mapped at startup.
+///The buffer must stay alive and writable while the shape is used, the bvh header is fixed up in place. A private (copy on write) file mapping is fine.
+class btBvhTriangleMeshBlob
+{
+	void*						m_buffer;
+	unsigned int				m_bufferSize;
+	int							m_bufferOwnership;
+
+	btTriangleIndexVertexArray*	m_meshInterface;
+	btOptimizedBvh*				m_bvh;
+	btBvhTriangleMeshShape*		m_shape;
+	btTriangleInfoMap*			m_triangleInfoMap;
+
+	enum
+	{
+		BUFFER_EXTERNAL = 0,
+		BUFFER_ALLOCATED,
+		BUFFER_MAPPED
+	};
+
+	void	releaseBuffer();
+
+public:
+
+	btBvhTriangleMeshBlob();
+
+	virtual ~btBvhTriangleMeshBlob();
+
+	///calculateBlobSize returns the number of bytes writeBlob needs for the shape, or 0 if the shape has no bvh
+	static unsigned int	calculateBlobSize(const btBvhTriangleMeshShape* shape);
+
+	///writeBlob writes the shape into a 16 byte aligned buffer, and returns the number of bytes written (0 on failure)
+	static unsigned int	writeBlob(const btBvhTriangleMeshShape* shape,void* alignedBuffer,unsigned int bufferSize);
+
+	static bool	writeBlobToFile(const btBvhTriangleMeshShape* shape,const char* fileName);
+
+	///loadBlob uses the 16 byte aligned buffer in place, the caller keeps ownership of the buffer. Returns false if the blob is invalid or was written on a different platform.
+	bool	loadBlob(void* alignedBuffer,unsigned int bufferSize);
+
+	///loadBlobFromFile maps the file into memory when the platform supports it, otherwise it reads the file into an aligned buffer
+	bool	loadBlobFromFile(const char* fileName);
+
+	///unload deletes the shape and releases the buffer
+	void	unload();
+
+	btBvhTriangleMeshShape*	getShape()
+	{
+		return m_shape;
+	}
+
+	btTriangleIndexVertexArray*	getMeshInterface()
+	{
+		return m_meshInterface;
+	}
+
+	///getTriangleInfoMap returns the map restored from the blob and set on the shape, or 0 if the blob has none
+	btTriangleInfoMap*	getTriangleInfoMap()
+	{
+		return m_triangleInfoMap;
+	}
+};
+
+#endif //BVH_TRIANGLE_MESH_BLOB_H
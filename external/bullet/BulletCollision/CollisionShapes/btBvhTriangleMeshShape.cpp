@@ -17,6 +17,7 @@ subject to the following restrictions:
 
 #include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
 #include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "BulletCollision/NarrowPhaseCollision/btRaycastCallback.h"
 #include "LinearMath/btSerializer.h"
 
 ///Bvh Concave triangle mesh is a static-triangle mesh shape with Bounding Volume Hierarchy optimization.
@@ -25,8 +26,11 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 :btTriangleMeshShape(meshInterface),
 m_bvh(0),
 m_triangleInfoMap(0),
+m_wideBvh(0),
+m_bvhBuildMode(btQuantizedBvh::BUILD_MEAN_SPLIT),
 m_useQuantizedAabbCompression(useQuantizedAabbCompression),
-m_ownsBvh(false)
+m_ownsBvh(false),
+m_useWideBvh(true)
 {
 	m_shapeType = TRIANGLE_MESH_SHAPE_PROXYTYPE;
 	//construct bvh from meshInterface
@@ -45,8 +49,11 @@ btBvhTriangleMeshShape::btBvhTriangleMeshShape(btStridingMeshInterface* meshInte
 :btTriangleMeshShape(meshInterface),
 m_bvh(0),
 m_triangleInfoMap(0),
+m_wideBvh(0),
+m_bvhBuildMode(btQuantizedBvh::BUILD_MEAN_SPLIT),
 m_useQuantizedAabbCompression(useQuantizedAabbCompression),
-m_ownsBvh(false)
+m_ownsBvh(false),
+m_useWideBvh(true)
 {
 	m_shapeType = TRIANGLE_MESH_SHAPE_PROXYTYPE;
 	//construct bvh from meshInterface
@@ -54,11 +61,13 @@ m_ownsBvh(false)
 
 	if (buildBvh)
 	{
+		BT_ALLOC_TAG(BT_ALLOC_TAG_SHAPES);
 		void* mem = btAlignedAlloc(sizeof(btOptimizedBvh),16);
 		m_bvh = new (mem) btOptimizedBvh();
 		
-		m_bvh->build(meshInterface,m_useQuantizedAabbCompression,bvhAabbMin,bvhAabbMax);
+		m_bvh->build(meshInterface,m_useQuantizedAabbCompression,bvhAabbMin,bvhAabbMax,m_bvhBuildMode);
 		m_ownsBvh = true;
+		updateWideBvh();
 	}
 
 #endif //DISABLE_BVH
@@ -68,6 +77,7 @@ m_ownsBvh(false)
 void	btBvhTriangleMeshShape::partialRefitTree(const btVector3& aabbMin,const btVector3& aabbMax)
 {
 	m_bvh->refitPartial( m_meshInterface,aabbMin,aabbMax );
+	refitWideBvh();
 	
 	m_localAabbMin.setMin(aabbMin);
 	m_localAabbMax.setMax(aabbMax);
@@ -77,12 +87,18 @@ void	btBvhTriangleMeshShape::partialRefitTree(const btVector3& aabbMin,const btV
 void	btBvhTriangleMeshShape::refitTree(const btVector3& aabbMin,const btVector3& aabbMax)
 {
 	m_bvh->refit( m_meshInterface, aabbMin,aabbMax );
+	refitWideBvh();
 	
 	recalcLocalAabb();
 }
 
 btBvhTriangleMeshShape::~btBvhTriangleMeshShape()
 {
+	if (m_wideBvh)
+	{
+		m_wideBvh->~btWideQuantizedBvh();
+		btAlignedFree(m_wideBvh);
+	}
 	if (m_ownsBvh)
 	{
 		m_bvh->~btOptimizedBvh();
@@ -90,7 +106,56 @@ btBvhTriangleMeshShape::~btBvhTriangleMeshShape()
 	}
 }
 
-void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget)
+void	btBvhTriangleMeshShape::updateWideBvh()
+{
+	BT_ALLOC_TAG(BT_ALLOC_TAG_SHAPES);
+	bool useWideBvh = m_useWideBvh && m_bvh && m_bvh->isQuantized()
+		&& (m_bvh->getQuantizedNodeArray().size()/2 >= BT_WIDE_BVH_MIN_TRIANGLES);
+
+	if (useWideBvh)
+	{
+		if (!m_wideBvh)
+		{
+			void* mem = btAlignedAlloc(sizeof(btWideQuantizedBvh),16);
+			m_wideBvh = new(mem) btWideQuantizedBvh();
+		}
+		if (m_wideBvh->build(m_bvh))
+			return;
+	}
+
+	if (m_wideBvh)
+	{
+		m_wideBvh->~btWideQuantizedBvh();
+		btAlignedFree(m_wideBvh);
+		m_wideBvh = 0;
+	}
+}
+
+void	btBvhTriangleMeshShape::refitWideBvh()
+{
+	if (m_wideBvh && m_wideBvh->refit())
+		return;
+	updateWideBvh();
+}
+
+void	btBvhTriangleMeshShape::setUseWideBvh(bool useWideBvh)
+{
+	m_useWideBvh = useWideBvh;
+	updateWideBvh();
+}
+
+void	btBvhTriangleMeshShape::setWideBvh(btWideQuantizedBvh* wideBvh)
+{
+	if (m_wideBvh && m_wideBvh != wideBvh)
+	{
+		m_wideBvh->~btWideQuantizedBvh();
+		btAlignedFree(m_wideBvh);
+	}
+	m_wideBvh = wideBvh;
+	m_useWideBvh = (wideBvh != 0);
+}
+
+void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btScalar* closestHitFraction)
 {
 	struct	MyNodeOverlapCallback : public btNodeOverlapCallback
 	{
@@ -156,10 +221,99 @@ void	btBvhTriangleMeshShape::performRaycast (btTriangleCallback* callback, const
 
 	MyNodeOverlapCallback	myNodeCallback(callback,m_meshInterface);
 
+	if (m_wideBvh)
+	{
+		m_wideBvh->reportRayOverlappingNodex(&myNodeCallback,raySource,rayTarget,closestHitFraction);
+		return;
+	}
 	m_bvh->reportRayOverlappingNodex(&myNodeCallback,raySource,rayTarget);
 }
 
-void	btBvhTriangleMeshShape::performConvexcast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax)
+bool	btBvhTriangleMeshShape::performRaycastPacket (btTriangleRaycastCallback** callbacks, btRayPacket& packet)
+{
+	struct	MyNodeRayPacketCallback : public btNodeRayPacketOverlapCallback
+	{
+		btStridingMeshInterface*	m_meshInterface;
+		btTriangleRaycastCallback** m_callbacks;
+		btRayPacket&	m_packet;
+
+		MyNodeRayPacketCallback(btTriangleRaycastCallback** callbacks,btStridingMeshInterface* meshInterface,btRayPacket& packet)
+			:m_meshInterface(meshInterface),
+			m_callbacks(callbacks),
+			m_packet(packet)
+		{
+		}
+
+		virtual void processNode(int nodeSubPart, int nodeTriangleIndex, unsigned int rayMask)
+		{
+			btVector3 m_triangle[3];
+			const unsigned char *vertexbase;
+			int numverts;
+			PHY_ScalarType type;
+			int stride;
+			const unsigned char *indexbase;
+			int indexstride;
+			int numfaces;
+			PHY_ScalarType indicestype;
+
+			m_meshInterface->getLockedReadOnlyVertexIndexBase(
+				&vertexbase,
+				numverts,
+				type,
+				stride,
+				&indexbase,
+				indexstride,
+				numfaces,
+				indicestype,
+				nodeSubPart);
+
+			unsigned int* gfxbase = (unsigned int*)(indexbase+nodeTriangleIndex*indexstride);
+			btAssert(indicestype==PHY_INTEGER||indicestype==PHY_SHORT);
+
+			const btVector3& meshScaling = m_meshInterface->getScaling();
+			for (int j=2;j>=0;j--)
+			{
+				int graphicsindex = indicestype==PHY_SHORT?((unsigned short*)gfxbase)[j]:gfxbase[j];
+
+				if (type == PHY_FLOAT)
+				{
+					float* graphicsbase = (float*)(vertexbase+graphicsindex*stride);
+
+					m_triangle[j] = btVector3(graphicsbase[0]*meshScaling.getX(),graphicsbase[1]*meshScaling.getY(),graphicsbase[2]*meshScaling.getZ());
+				}
+				else
+				{
+					double* graphicsbase = (double*)(vertexbase+graphicsindex*stride);
+
+					m_triangle[j] = btVector3(btScalar(graphicsbase[0])*meshScaling.getX(),btScalar(graphicsbase[1])*meshScaling.getY(),btScalar(graphicsbase[2])*meshScaling.getZ());
+				}
+			}
+
+			/* Perform ray vs. triangle collision for each ray that reached the triangle */
+			for (int i=0;i<m_packet.m_numRays;i++)
+			{
+				if (!(rayMask & (1u<<i)))
+					continue;
+				m_callbacks[i]->processTriangle(m_triangle,nodeSubPart,nodeTriangleIndex);
+				m_packet.m_maxFraction[i] = m_callbacks[i]->m_hitFraction;
+				if (m_callbacks[i]->m_hitFraction <= btScalar(0.))
+				{
+					m_packet.m_activeMask &= ~(1u<<i);
+				}
+			}
+			m_meshInterface->unLockReadOnlyVertexBase(nodeSubPart);
+		}
+	};
+
+	if (!m_wideBvh)
+		return false;
+
+	MyNodeRayPacketCallback	myNodeCallback(callbacks,m_meshInterface,packet);
+	m_wideBvh->reportRayPacketOverlappingNodex(&myNodeCallback,packet);
+	return true;
+}
+
+void	btBvhTriangleMeshShape::performConvexcast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btVector3& aabbMin, const btVector3& aabbMax, const btScalar* closestHitFraction)
 {
 	struct	MyNodeOverlapCallback : public btNodeOverlapCallback
 	{
@@ -225,6 +379,11 @@ void	btBvhTriangleMeshShape::performConvexcast (btTriangleCallback* callback, co
 
 	MyNodeOverlapCallback	myNodeCallback(callback,m_meshInterface);
 
+	if (m_wideBvh)
+	{
+		m_wideBvh->reportBoxCastOverlappingNodex(&myNodeCallback, raySource, rayTarget, aabbMin, aabbMax, closestHitFraction);
+		return;
+	}
 	m_bvh->reportBoxCastOverlappingNodex (&myNodeCallback, raySource, rayTarget, aabbMin, aabbMax);
 }
 
@@ -320,7 +479,13 @@ void	btBvhTriangleMeshShape::processAllTriangles(btTriangleCallback* callback,co
 
 	MyNodeOverlapCallback	myNodeCallback(callback,m_meshInterface);
 
-	m_bvh->reportAabbOverlappingNodex(&myNodeCallback,aabbMin,aabbMax);
+	if (m_wideBvh)
+	{
+		m_wideBvh->reportAabbOverlappingNodex(&myNodeCallback,aabbMin,aabbMax);
+	} else
+	{
+		m_bvh->reportAabbOverlappingNodex(&myNodeCallback,aabbMin,aabbMax);
+	}
 
 
 #endif//DISABLE_BVH
@@ -339,6 +504,7 @@ void   btBvhTriangleMeshShape::setLocalScaling(const btVector3& scaling)
 
 void   btBvhTriangleMeshShape::buildOptimizedBvh()
 {
+	BT_ALLOC_TAG(BT_ALLOC_TAG_SHAPES);
 	if (m_ownsBvh)
 	{
 		m_bvh->~btOptimizedBvh();
@@ -348,8 +514,9 @@ void   btBvhTriangleMeshShape::buildOptimizedBvh()
 	void* mem = btAlignedAlloc(sizeof(btOptimizedBvh),16);
 	m_bvh = new(mem) btOptimizedBvh();
 	//rebuild the bvh...
-	m_bvh->build(m_meshInterface,m_useQuantizedAabbCompression,m_localAabbMin,m_localAabbMax);
+	m_bvh->build(m_meshInterface,m_useQuantizedAabbCompression,m_localAabbMin,m_localAabbMax,m_bvhBuildMode);
 	m_ownsBvh = true;
+	updateWideBvh();
 }
 
 void   btBvhTriangleMeshShape::setOptimizedBvh(btOptimizedBvh* bvh, const btVector3& scaling)
@@ -359,6 +526,7 @@ void   btBvhTriangleMeshShape::setOptimizedBvh(btOptimizedBvh* bvh, const btVect
 
    m_bvh = bvh;
    m_ownsBvh = false;
+   updateWideBvh();
    // update the scaling without rebuilding the bvh
    if ((getLocalScaling() -scaling).length2() > SIMD_EPSILON)
    {
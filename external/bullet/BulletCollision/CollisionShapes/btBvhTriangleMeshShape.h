@@ -20,6 +20,12 @@ subject to the following restrictions:
 #include "btOptimizedBvh.h"
 #include "LinearMath/btAlignedAllocator.h"
 #include "btTriangleInfoMap.h"
+#include "BulletCollision/BroadphaseCollision/btWideQuantizedBvh.h"
+
+class btTriangleRaycastCallback;
+
+///meshes with fewer triangles keep using the binary tree, the wide tree only pays off when the tree no longer fits in cache
+#define BT_WIDE_BVH_MIN_TRIANGLES 4096
 
 ///The btBvhTriangleMeshShape is a static-triangle mesh shape with several optimizations, such as bounding volume hierarchy and cache friendly traversal for PlayStation 3 Cell SPU. It is recommended to enable useQuantizedAabbCompression for better memory usage.
 ///It takes a triangle mesh as input, for example a btTriangleMesh or btTriangleIndexVertexArray. The btBvhTriangleMeshShape class allows for triangle mesh deformations by a refit or partialRefit method.
@@ -30,16 +36,26 @@ ATTRIBUTE_ALIGNED16(class) btBvhTriangleMeshShape : public btTriangleMeshShape
 
 	btOptimizedBvh*	m_bvh;
 	btTriangleInfoMap*	m_triangleInfoMap;
+	btWideQuantizedBvh*	m_wideBvh;
+	btQuantizedBvh::btBuildMode	m_bvhBuildMode;
 
 	bool m_useQuantizedAabbCompression;
 	bool m_ownsBvh;
-	bool m_pad[11];////need padding due to alignment
+	bool m_useWideBvh;
+	bool m_pad[9];////pads the members to a multiple of 16 bytes on 32 and 64 bit targets
+
+	void	updateWideBvh();
+
+protected:
+
+	///refitWideBvh updates the wide tree after a refit of the optimized bvh, it is only collapsed again if it was deserialized
+	void	refitWideBvh();
 
 public:
 
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
-	btBvhTriangleMeshShape() : btTriangleMeshShape(0),m_bvh(0),m_triangleInfoMap(0),m_ownsBvh(false) {m_shapeType = TRIANGLE_MESH_SHAPE_PROXYTYPE;};
+	btBvhTriangleMeshShape() : btTriangleMeshShape(0),m_bvh(0),m_triangleInfoMap(0),m_wideBvh(0),m_bvhBuildMode(btQuantizedBvh::BUILD_MEAN_SPLIT),m_ownsBvh(false),m_useWideBvh(true) {m_shapeType = TRIANGLE_MESH_SHAPE_PROXYTYPE;};
 	btBvhTriangleMeshShape(btStridingMeshInterface* meshInterface, bool useQuantizedAabbCompression, bool buildBvh = true);
 
 	///optionally pass in a larger bvh aabb, used for quantization. This allows for deformations within this aabb
@@ -54,8 +70,14 @@ public:
 
 
 	
-	void performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget);
-	void performConvexcast (btTriangleCallback* callback, const btVector3& boxSource, const btVector3& boxTarget, const btVector3& boxMin, const btVector3& boxMax);
+	///if closestHitFraction is not null, the wide tree skips nodes beyond the closest hit found so far by the callback
+	void performRaycast (btTriangleCallback* callback, const btVector3& raySource, const btVector3& rayTarget, const btScalar* closestHitFraction=0);
+	void performConvexcast (btTriangleCallback* callback, const btVector3& boxSource, const btVector3& boxTarget, const btVector3& boxMin, const btVector3& boxMax, const btScalar* closestHitFraction=0);
+
+	///performRaycastPacket traces the active rays of the local space packet through the wide tree, callbacks[i] receives the triangles of ray i.
+	///The packet follows the m_hitFraction of the callbacks, a ray is finished when its hit fraction drops to zero.
+	///It returns false without tracing when the shape has no wide tree, then use performRaycast for each ray.
+	bool performRaycastPacket (btTriangleRaycastCallback** callbacks, btRayPacket& packet);
 
 	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
@@ -75,10 +97,43 @@ public:
 		return m_bvh;
 	}
 
+	const btOptimizedBvh*	getOptimizedBvh() const
+	{
+		return m_bvh;
+	}
+
 	void	setOptimizedBvh(btOptimizedBvh* bvh, const btVector3& localScaling=btVector3(1,1,1));
 
 	void    buildOptimizedBvh();
 
+	///setBvhBuildMode chooses between build speed and tree quality for the next buildOptimizedBvh, pass buildBvh=false to the constructor to build with a different mode
+	void	setBvhBuildMode(btQuantizedBvh::btBuildMode buildMode)
+	{
+		m_bvhBuildMode = buildMode;
+	}
+
+	btQuantizedBvh::btBuildMode	getBvhBuildMode() const
+	{
+		return m_bvhBuildMode;
+	}
+
+	///large quantized meshes are traversed using a 4-ary btWideQuantizedBvh by default, it is collapsed from the btOptimizedBvh
+	void	setUseWideBvh(bool useWideBvh);
+
+	bool	getUseWideBvh() const
+	{
+		return m_useWideBvh;
+	}
+
+	const btWideQuantizedBvh*	getWideBvh() const
+	{
+		return m_wideBvh;
+	}
+
+	///setWideBvh attaches a wide tree that was collapsed from the current optimized bvh, for example one loaded by btBvhTriangleMeshBlob.
+	///The shape takes ownership, the wide tree needs to be allocated using btAlignedAlloc.
+	void	setWideBvh(btWideQuantizedBvh* wideBvh);
+
 	bool	usesQuantizedAabbCompression() const
 	{
 		return	m_useQuantizedAabbCompression;
@@ -19,6 +19,7 @@ subject to the following restrictions:
 #include "LinearMath/btTransform.h"
 #include "LinearMath/btVector3.h"
 #include "LinearMath/btMatrix3x3.h"
+#include "LinearMath/btAlignedAllocator.h"
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h" //for the shape types
 class btSerializer;
 
@@ -32,6 +33,8 @@ protected:
 
 public:
 
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
+
 	btCollisionShape() : m_shapeType (INVALID_SHAPE_PROXYTYPE), m_userPointer(0)
 	{
 	}
@@ -23,6 +23,7 @@ btCompoundShape::btCompoundShape(bool enableDynamicAabbTree)
 m_localAabbMax(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT)),
 m_dynamicAabbTree(0),
 m_updateRevision(1),
+m_nextChildUniqueId(0),
 m_collisionMargin(btScalar(0.)),
 m_localScaling(btScalar(1.),btScalar(1.),btScalar(1.))
 {
@@ -48,6 +49,7 @@ btCompoundShape::~btCompoundShape()
 
 void	btCompoundShape::addChildShape(const btTransform& localTransform,btCollisionShape* shape)
 {
+	BT_ALLOC_TAG(BT_ALLOC_TAG_SHAPES);
 	m_updateRevision++;
 	//m_childTransforms.push_back(localTransform);
 	//m_childShapes.push_back(shape);
@@ -57,6 +59,7 @@ void	btCompoundShape::addChildShape(const btTransform& localTransform,btCollisio
 	child.m_childShape = shape;
 	child.m_childShapeType = shape->getShapeType();
 	child.m_childMargin = shape->getMargin();
+	child.m_childUniqueId = m_nextChildUniqueId++;
 
 	
 	//extend the local aabbMin/aabbMax
@@ -85,7 +88,7 @@ void	btCompoundShape::addChildShape(const btTransform& localTransform,btCollisio
 
 }
 
-void	btCompoundShape::updateChildTransform(int childIndex, const btTransform& newChildTransform)
+void	btCompoundShape::updateChildTransform(int childIndex, const btTransform& newChildTransform, bool shouldRecalculateLocalAabb)
 {
 	m_children[childIndex].m_transform = newChildTransform;
 
@@ -99,7 +102,73 @@ void	btCompoundShape::updateChildTransform(int childIndex, const btTransform& ne
 		m_dynamicAabbTree->update(m_children[childIndex].m_node,bounds);
 	}
 
-	recalculateLocalAabb();
+	if (shouldRecalculateLocalAabb)
+	{
+		recalculateLocalAabb();
+	}
+}
+
+static void	btRefitDbvtNode(btDbvtNode* node)
+{
+	if (node->isinternal())
+	{
+		btRefitDbvtNode(node->childs[0]);
+		btRefitDbvtNode(node->childs[1]);
+		Merge(node->childs[0]->volume,node->childs[1]->volume,node->volume);
+	}
+}
+
+void	btCompoundShape::updateChildTransforms(const int* childIndices, const btTransform* newChildTransforms, int numChildren)
+{
+	int i;
+	for (i=0;i<numChildren;i++)
+	{
+		btCompoundShapeChild& child = m_children[childIndices[i]];
+		child.m_transform = newChildTransforms[i];
+		if (m_dynamicAabbTree)
+		{
+			btVector3 localAabbMin,localAabbMax;
+			child.m_childShape->getAabb(child.m_transform,localAabbMin,localAabbMax);
+			child.m_node->volume = btDbvtVolume::FromMM(localAabbMin,localAabbMax);
+		}
+	}
+
+	if (!m_dynamicAabbTree)
+	{
+		recalculateLocalAabb();
+		return;
+	}
+
+	if (numChildren*4 >= m_children.size())
+	{
+		if (m_dynamicAabbTree->m_root)
+			btRefitDbvtNode(m_dynamicAabbTree->m_root);
+	} else
+	{
+		//refit the ancestors of each moved leaf, a path stops at the first node that doesn't change
+		for (i=0;i<numChildren;i++)
+		{
+			btDbvtNode* node = m_children[childIndices[i]].m_node->parent;
+			while (node)
+			{
+				btDbvtVolume volume;
+				Merge(node->childs[0]->volume,node->childs[1]->volume,volume);
+				if (!NotEqual(volume,node->volume))
+					break;
+				node->volume = volume;
+				node = node->parent;
+			}
+		}
+	}
+
+	//the leaves store the child aabbs, so the local aabb doesn't need to query the child shapes again
+	m_localAabbMin = btVector3(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	m_localAabbMax = btVector3(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+	for (i=0;i<m_children.size();i++)
+	{
+		m_localAabbMin.setMin(m_children[i].m_node->volume.Mins());
+		m_localAabbMax.setMax(m_children[i].m_node->volume.Maxs());
+	}
 }
 
 void btCompoundShape::removeChildShapeByIndex(int childShapeIndex)
@@ -274,6 +343,10 @@ void btCompoundShape::calculatePrincipalAxisTransform(btScalar* masses, btTransf
 
 void btCompoundShape::setLocalScaling(const btVector3& scaling)
 {
+	btAlignedObjectArray<int> childIndices;
+	btAlignedObjectArray<btTransform> childTransforms;
+	childIndices.resize(m_children.size());
+	childTransforms.resizeNoInitialize(m_children.size());
 
 	for(int i = 0; i < m_children.size(); i++)
 	{
@@ -283,8 +356,12 @@ void btCompoundShape::setLocalScaling(const btVector3& scaling)
 		childScale = childScale * scaling / m_localScaling;
 		m_children[i].m_childShape->setLocalScaling(childScale);
 		childTrans.setOrigin((childTrans.getOrigin())*scaling);
-		updateChildTransform(i, childTrans);
-		recalculateLocalAabb();
+		childIndices[i] = i;
+		childTransforms[i] = childTrans;
+	}
+	if (m_children.size())
+	{
+		updateChildTransforms(&childIndices[0],&childTransforms[0],m_children.size());
 	}
 	m_localScaling = scaling;
 }
@@ -29,13 +29,15 @@ struct btDbvt;
 
 ATTRIBUTE_ALIGNED16(struct) btCompoundShapeChild
 {
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
 	btTransform			m_transform;
 	btCollisionShape*	m_childShape;
 	int					m_childShapeType;
 	btScalar			m_childMargin;
 	struct btDbvtNode*	m_node;
+	///unique within the compound shape, it stays the same when other children are added or removed
+	int					m_childUniqueId;
 };
 
 SIMD_FORCE_INLINE bool operator==(const btCompoundShapeChild& c1, const btCompoundShapeChild& c2)
@@ -62,13 +64,15 @@ ATTRIBUTE_ALIGNED16(class) btCompoundShape	: public btCollisionShape
 	///increment m_updateRevision when adding/removing/replacing child shapes, so that some caches can be updated
 	int								m_updateRevision;
 
+	int								m_nextChildUniqueId;
+
 	btScalar	m_collisionMargin;
 
 protected:
 	btVector3	m_localScaling;
 
 public:
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
 	btCompoundShape(bool enableDynamicAabbTree = true);
 
@@ -106,7 +110,18 @@ public:
 	}
 
 	///set a new transform for a child, and update internal data structures (local aabb and dynamic tree)
-	void	updateChildTransform(int childIndex, const btTransform& newChildTransform);
+	///when updating many children, pass shouldRecalculateLocalAabb=false and call recalculateLocalAabb once, or use updateChildTransforms
+	void	updateChildTransform(int childIndex, const btTransform& newChildTransform, bool shouldRecalculateLocalAabb = true);
+
+	///updateChildTransforms sets new transforms for several children, then refits the dynamic aabb tree and the local aabb once.
+	///The tree keeps its topology, so call getDynamicAabbTree()->optimizeIncremental after children moved far apart.
+	void	updateChildTransforms(const int* childIndices, const btTransform* newChildTransforms, int numChildren);
+
+	///the unique id of a child is kept when other children are added or removed, while its index may change
+	int		getChildUniqueId(int index) const
+	{
+		return m_children[index].m_childUniqueId;
+	}
 
 
 	btCompoundShapeChild* getChildList()
@@ -149,6 +164,11 @@ public:
 		return m_dynamicAabbTree;
 	}
 
+	const btDbvt*					getDynamicAabbTree() const
+	{
+		return m_dynamicAabbTree;
+	}
+
 	void createAabbTreeFromChildren();
 
 	///computes the exact moment of inertia and the transform from the coordinate system defined by the principal axes of the moment of inertia
@@ -21,6 +21,7 @@ subject to the following restrictions:
 
 btConvexHullShape ::btConvexHullShape (const btScalar* points,int numPoints,int stride) : btPolyhedralConvexAabbCachingShape ()
 {
+	BT_ALLOC_TAG(BT_ALLOC_TAG_SHAPES);
 	m_shapeType = CONVEX_HULL_SHAPE_PROXYTYPE;
 	m_unscaledPoints.resize(numPoints);
 
@@ -47,6 +48,7 @@ void btConvexHullShape::setLocalScaling(const btVector3& scaling)
 
 void btConvexHullShape::addPoint(const btVector3& point)
 {
+	BT_ALLOC_TAG(BT_ALLOC_TAG_SHAPES);
 	m_unscaledPoints.push_back(point);
 	recalcLocalAabb();
 
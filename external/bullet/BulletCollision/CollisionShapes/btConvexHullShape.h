@@ -28,7 +28,7 @@ ATTRIBUTE_ALIGNED16(class) btConvexHullShape : public btPolyhedralConvexAabbCach
 	btAlignedObjectArray<btVector3>	m_unscaledPoints;
 
 public:
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
 	
 	///this constructor optionally takes in a pointer to points. Each point is assumed to be 3 consecutive btScalar (x,y,z), the striding defines the number of bytes between each point, in memory.
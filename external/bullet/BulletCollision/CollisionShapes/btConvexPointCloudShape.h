@@ -27,7 +27,7 @@ ATTRIBUTE_ALIGNED16(class) btConvexPointCloudShape : public btPolyhedralConvexAa
 	int m_numPoints;
 
 public:
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
 	btConvexPointCloudShape()
 	{
@@ -34,7 +34,7 @@ ATTRIBUTE_ALIGNED16(class) btConvexShape : public btCollisionShape
 
 public:
 
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
 	btConvexShape ();
 
@@ -0,0 +1,134 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btDeformableBvhTriangleMeshShape.h"
+
+btDeformableBvhTriangleMeshShape::btDeformableBvhTriangleMeshShape(btTriangleIndexVertexArray* meshInterface)
+:btBvhTriangleMeshShape(meshInterface,true,false),
+m_indexVertexArray(meshInterface),
+m_rebuildThreshold(BT_DEFORMABLE_BVH_REBUILD_THRESHOLD),
+m_builtSahCost(btScalar(0.)),
+m_sahCost(btScalar(0.)),
+m_needsRebuild(false),
+m_autoRebuild(true)
+{
+	//the wide tree is off by default to keep the refit lean, refitDeformedMesh refits it as well when setUseWideBvh enables it
+	setUseWideBvh(false);
+	rebuildTree();
+}
+
+btDeformableBvhTriangleMeshShape::~btDeformableBvhTriangleMeshShape()
+{
+}
+
+void	btDeformableBvhTriangleMeshShape::setVertexBuffer(int subPart,const unsigned char* vertexBase,int vertexStride)
+{
+	btAssert(subPart >= 0 && subPart < m_indexVertexArray->getNumSubParts());
+	btIndexedMesh& mesh = m_indexVertexArray->getIndexedMeshArray()[subPart];
+	mesh.m_vertexBase = vertexBase;
+	mesh.m_vertexStride = vertexStride;
+}
+
+///calculateVertexAabb scans the vertices directly, recalcLocalAabb would walk all triangles 6 times
+void	btDeformableBvhTriangleMeshShape::calculateVertexAabb(btVector3& aabbMin,btVector3& aabbMax) const
+{
+	aabbMin.setValue(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	aabbMax.setValue(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+
+	for (int part=0;part<m_indexVertexArray->getNumSubParts();part++)
+	{
+		const unsigned char *vertexbase;
+		int numverts;
+		PHY_ScalarType type;
+		int stride;
+		const unsigned char *indexbase;
+		int indexstride;
+		int numfaces;
+		PHY_ScalarType indicestype;
+
+		m_indexVertexArray->getLockedReadOnlyVertexIndexBase(&vertexbase,numverts,type,stride,&indexbase,indexstride,numfaces,indicestype,part);
+
+		int i;
+		if (type == PHY_FLOAT)
+		{
+			for (i=0;i<numverts;i++)
+			{
+				const float* graphicsbase = (const float*)(vertexbase+i*stride);
+				btVector3 vertex(graphicsbase[0],graphicsbase[1],graphicsbase[2]);
+				aabbMin.setMin(vertex);
+				aabbMax.setMax(vertex);
+			}
+		} else
+		{
+			for (i=0;i<numverts;i++)
+			{
+				const double* graphicsbase = (const double*)(vertexbase+i*stride);
+				btVector3 vertex = btVector3(btScalar(graphicsbase[0]),btScalar(graphicsbase[1]),btScalar(graphicsbase[2]));
+				aabbMin.setMin(vertex);
+				aabbMax.setMax(vertex);
+			}
+		}
+
+		m_indexVertexArray->unLockReadOnlyVertexBase(part);
+	}
+
+	//negative scaling flips the bounds
+	btVector3 scaledMin = aabbMin*m_indexVertexArray->getScaling();
+	btVector3 scaledMax = aabbMax*m_indexVertexArray->getScaling();
+	aabbMin = scaledMin;
+	aabbMin.setMin(scaledMax);
+	aabbMax = scaledMax;
+	aabbMax.setMax(scaledMin);
+}
+
+void	btDeformableBvhTriangleMeshShape::refitDeformedMesh()
+{
+	btOptimizedBvh* bvh = getOptimizedBvh();
+	btAssert(bvh);
+	if (!bvh)
+		return;
+
+	calculateVertexAabb(m_localAabbMin,m_localAabbMax);
+	bvh->refitParallel(m_meshInterface,m_localAabbMin,m_localAabbMax);
+	refitWideBvh();
+
+	m_sahCost = bvh->calculateSahCost();
+	//a tree without internal nodes, like a single triangle, has no cost to compare against
+	m_needsRebuild = (m_builtSahCost > btScalar(0.)) && (m_sahCost > m_builtSahCost*m_rebuildThreshold);
+	if (m_needsRebuild && m_autoRebuild)
+	{
+		rebuildTree();
+	}
+}
+
+void	btDeformableBvhTriangleMeshShape::rebuildTree()
+{
+	calculateVertexAabb(m_localAabbMin,m_localAabbMax);
+	buildOptimizedBvh();
+
+	m_builtSahCost = getOptimizedBvh()->calculateSahCost();
+	m_sahCost = m_builtSahCost;
+	m_needsRebuild = false;
+}
+
+void	btDeformableBvhTriangleMeshShape::setLocalScaling(const btVector3& scaling)
+{
+	if ((getLocalScaling() -scaling).length2() > SIMD_EPSILON)
+	{
+		//skip the triangle walk of btTriangleMeshShape::setLocalScaling, rebuildTree calculates the aabb
+		m_meshInterface->setScaling(scaling);
+		rebuildTree();
+	}
+}
@@ -0,0 +1,100 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef DEFORMABLE_BVH_TRIANGLE_MESH_SHAPE_H
+#define DEFORMABLE_BVH_TRIANGLE_MESH_SHAPE_H
+
+#include "btBvhTriangleMeshShape.h"
+#include "btTriangleIndexVertexArray.h"
+
+///the default rebuild threshold, the tree is rebuilt once its SAH cost is 50% higher than right after the last build
+#define BT_DEFORMABLE_BVH_REBUILD_THRESHOLD btScalar(1.5)
+
+///The btDeformableBvhTriangleMeshShape is a btBvhTriangleMeshShape for animated meshes, for example skinned or keyframe interpolated vertices.
+///After the vertices changed, refitDeformedMesh refits the quantized bvh bottom-up on multiple threads instead of building a new one.
+///A refit keeps the tree topology, so the tree gets worse when triangles move far from their neighbours. The SAH cost of the tree is measured after every refit,
+///and the tree is rebuilt (or flagged for a rebuild) once the cost grew past the rebuild threshold.
+///Like other triangle meshes it should be used for static or kinematic objects, and the collision object aabb is updated as usual.
+ATTRIBUTE_ALIGNED16(class) btDeformableBvhTriangleMeshShape : public btBvhTriangleMeshShape
+{
+	btTriangleIndexVertexArray*	m_indexVertexArray;
+
+	btScalar	m_rebuildThreshold;
+	btScalar	m_builtSahCost;
+	btScalar	m_sahCost;
+
+	bool	m_needsRebuild;
+	bool	m_autoRebuild;
+
+	void	calculateVertexAabb(btVector3& aabbMin,btVector3& aabbMax) const;
+
+public:
+
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
+
+	///the shape always uses quantized aabb compression, the bvh is built in the constructor
+	btDeformableBvhTriangleMeshShape(btTriangleIndexVertexArray* meshInterface);
+
+	virtual ~btDeformableBvhTriangleMeshShape();
+
+	///setVertexBuffer points a subpart at new vertex data, for example the next buffer of a double buffered animation. The number of vertices and the vertex type stay the same.
+	///The data is not copied. Vertex data that is updated in place doesn't need this, just call refitDeformedMesh.
+	void	setVertexBuffer(int subPart,const unsigned char* vertexBase,int vertexStride);
+
+	///refitDeformedMesh updates the local aabb and the bvh after the vertices changed
+	void	refitDeformedMesh();
+
+	///rebuildTree builds a new bvh for the current vertices, and resets the quality measurement
+	void	rebuildTree();
+
+	virtual void	setLocalScaling(const btVector3& scaling);
+
+	///setRebuildThreshold sets the allowed SAH cost growth, relative to the cost right after the last build
+	void	setRebuildThreshold(btScalar rebuildThreshold)
+	{
+		m_rebuildThreshold = rebuildThreshold;
+	}
+
+	btScalar	getRebuildThreshold() const
+	{
+		return m_rebuildThreshold;
+	}
+
+	///when auto rebuild is disabled, refitDeformedMesh only sets getNeedsRebuild, so the rebuild can be scheduled by the caller
+	void	setAutoRebuild(bool autoRebuild)
+	{
+		m_autoRebuild = autoRebuild;
+	}
+
+	bool	getAutoRebuild() const
+	{
+		return m_autoRebuild;
+	}
+
+	bool	getNeedsRebuild() const
+	{
+		return m_needsRebuild;
+	}
+
+	///getTreeQuality returns the SAH cost after the last build divided by the current SAH cost, 1 right after a build and smaller after refits that made the tree worse
+	btScalar	getTreeQuality() const
+	{
+		return m_sahCost > SIMD_EPSILON ? m_builtSahCost/m_sahCost : btScalar(1.);
+	}
+
+	virtual const char*	getName()const {return "DEFORMABLEBVHTRIANGLEMESH";}
+};
+
+#endif //DEFORMABLE_BVH_TRIANGLE_MESH_SHAPE_H
@@ -274,6 +274,123 @@ void btHeightfieldTerrainShape::quantizeWithClamp(int* out, const btVector3& poi
 
 
 
+void	btHeightfieldTerrainShape::buildMinMaxPyramid()
+{
+	int numCellsX = m_heightStickWidth-1;
+	int numCellsY = m_heightStickLength-1;
+
+	m_pyramidLevelOffset.resize(0);
+	m_pyramidLevelWidth.resize(0);
+	m_pyramidLevelLength.resize(0);
+
+	int blockSize = 1<<BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int width = (numCellsX+blockSize-1)>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int length = (numCellsY+blockSize-1)>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int numNodes = 0;
+	for (;;)
+	{
+		m_pyramidLevelOffset.push_back(numNodes);
+		m_pyramidLevelWidth.push_back(width);
+		m_pyramidLevelLength.push_back(length);
+		numNodes += width*length;
+		if (width == 1 && length == 1)
+			break;
+		width = (width+1)/2;
+		length = (length+1)/2;
+	}
+	m_pyramidMinMax.resize(numNodes*2);
+
+	updateMinMaxPyramid(0,0,m_heightStickWidth-1,m_heightStickLength-1);
+}
+
+void	btHeightfieldTerrainShape::clearMinMaxPyramid()
+{
+	m_pyramidMinMax.clear();
+	m_pyramidLevelOffset.clear();
+	m_pyramidLevelWidth.clear();
+	m_pyramidLevelLength.clear();
+}
+
+void	btHeightfieldTerrainShape::updateMinMaxPyramid(int startX,int startY,int endX,int endY)
+{
+	if (!m_pyramidMinMax.size())
+		return;
+
+	//cells that use the changed grid points
+	int numCellsX = m_heightStickWidth-1;
+	int numCellsY = m_heightStickLength-1;
+	int cellStartX = btMax(startX-1,0);
+	int cellStartY = btMax(startY-1,0);
+	int cellEndX = btMin(endX,numCellsX-1);
+	int cellEndY = btMin(endY,numCellsY-1);
+	if (cellStartX > cellEndX || cellStartY > cellEndY)
+		return;
+
+	//leaf blocks
+	int blockSize = 1<<BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int blockStartX = cellStartX>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int blockStartY = cellStartY>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int blockEndX = cellEndX>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int blockEndY = cellEndY>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+	int bx,by;
+	for (by=blockStartY;by<=blockEndY;by++)
+	{
+		for (bx=blockStartX;bx<=blockEndX;bx++)
+		{
+			btScalar minHeight = btScalar(BT_LARGE_FLOAT);
+			btScalar maxHeight = btScalar(-BT_LARGE_FLOAT);
+			//a block covers the grid points of its cells, including the last row and column
+			int pointEndX = btMin((bx+1)*blockSize,numCellsX);
+			int pointEndY = btMin((by+1)*blockSize,numCellsY);
+			for (int y=by*blockSize;y<=pointEndY;y++)
+			{
+				for (int x=bx*blockSize;x<=pointEndX;x++)
+				{
+					btScalar height = getRawHeightFieldValue(x,y);
+					minHeight = btMin(minHeight,height);
+					maxHeight = btMax(maxHeight,height);
+				}
+			}
+			btScalar* minMax = &m_pyramidMinMax[2*(by*m_pyramidLevelWidth[0]+bx)];
+			minMax[0] = minHeight;
+			minMax[1] = maxHeight;
+		}
+	}
+
+	//parents
+	for (int level=1;level<m_pyramidLevelOffset.size();level++)
+	{
+		blockStartX >>= 1;
+		blockStartY >>= 1;
+		blockEndX >>= 1;
+		blockEndY >>= 1;
+		int childWidth = m_pyramidLevelWidth[level-1];
+		int childLength = m_pyramidLevelLength[level-1];
+		const btScalar* children = &m_pyramidMinMax[2*m_pyramidLevelOffset[level-1]];
+		for (by=blockStartY;by<=blockEndY;by++)
+		{
+			for (bx=blockStartX;bx<=blockEndX;bx++)
+			{
+				btScalar minHeight = btScalar(BT_LARGE_FLOAT);
+				btScalar maxHeight = btScalar(-BT_LARGE_FLOAT);
+				for (int y=by*2;y<btMin(by*2+2,childLength);y++)
+				{
+					for (int x=bx*2;x<btMin(bx*2+2,childWidth);x++)
+					{
+						minHeight = btMin(minHeight,children[2*(y*childWidth+x)]);
+						maxHeight = btMax(maxHeight,children[2*(y*childWidth+x)+1]);
+					}
+				}
+				btScalar* minMax = &m_pyramidMinMax[2*(m_pyramidLevelOffset[level]+by*m_pyramidLevelWidth[level]+bx)];
+				minMax[0] = minHeight;
+				minMax[1] = maxHeight;
+			}
+		}
+	}
+}
+
+
+
 /// process all triangles within the provided axis-aligned bounding box
 /**
   basic algorithm:
@@ -284,8 +401,13 @@ void btHeightfieldTerrainShape::quantizeWithClamp(int* out, const btVector3& poi
 void	btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const
 {
 	// scale down the input aabb's so they are in local (non-scaled) coordinates
-	btVector3	localAabbMin = aabbMin*btVector3(1.f/m_localScaling[0],1.f/m_localScaling[1],1.f/m_localScaling[2]);
-	btVector3	localAabbMax = aabbMax*btVector3(1.f/m_localScaling[0],1.f/m_localScaling[1],1.f/m_localScaling[2]);
+	btVector3	scaledAabbMin = aabbMin*btVector3(1.f/m_localScaling[0],1.f/m_localScaling[1],1.f/m_localScaling[2]);
+	btVector3	scaledAabbMax = aabbMax*btVector3(1.f/m_localScaling[0],1.f/m_localScaling[1],1.f/m_localScaling[2]);
+	//negative scaling swaps min and max
+	btVector3	localAabbMin = scaledAabbMin;
+	localAabbMin.setMin(scaledAabbMax);
+	btVector3	localAabbMax = scaledAabbMax;
+	localAabbMax.setMax(scaledAabbMin);
 
 	// account for local origin
 	localAabbMin += m_localOrigin;
@@ -357,41 +479,247 @@ void	btHeightfieldTerrainShape::processAllTriangles(btTriangleCallback* callback
 	
   
 
-	for(int j=startJ; j<endJ; j++)
+	//triangles entirely above or below the query aabb are skipped
+	if (m_pyramidMinMax.size())
+	{
+		int topLevel = m_pyramidLevelOffset.size()-1;
+		processPyramidNode(callback,topLevel,0,0,startX,endX,startJ,endJ,localAabbMin[m_upAxis],localAabbMax[m_upAxis],aabbMin[m_upAxis],aabbMax[m_upAxis]);
+	} else
+	{
+		processCells(callback,startX,endX,startJ,endJ,aabbMin[m_upAxis],aabbMax[m_upAxis]);
+	}
+}
+
+///processPyramidNode skips pyramid nodes whose raw height range doesn't overlap the query, and processes the cells of the remaining leaf blocks
+void	btHeightfieldTerrainShape::processPyramidNode(btTriangleCallback* callback,int level,int nodeX,int nodeY,int startX,int endX,int startJ,int endJ,btScalar queryMinRawHeight,btScalar queryMaxRawHeight,btScalar queryMinHeight,btScalar queryMaxHeight) const
+{
+	int shift = BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT+level;
+	int nodeStartX = btMax(startX,nodeX<<shift);
+	int nodeEndX = btMin(endX,(nodeX+1)<<shift);
+	int nodeStartJ = btMax(startJ,nodeY<<shift);
+	int nodeEndJ = btMin(endJ,(nodeY+1)<<shift);
+	if (nodeStartX >= nodeEndX || nodeStartJ >= nodeEndJ)
+		return;
+
+	const btScalar* minMax = &m_pyramidMinMax[2*(m_pyramidLevelOffset[level]+nodeY*m_pyramidLevelWidth[level]+nodeX)];
+	if (minMax[0] > queryMaxRawHeight || minMax[1] < queryMinRawHeight)
+		return;
+
+	if (level == 0)
+	{
+		processCells(callback,nodeStartX,nodeEndX,nodeStartJ,nodeEndJ,queryMinHeight,queryMaxHeight);
+		return;
+	}
+
+	int childWidth = m_pyramidLevelWidth[level-1];
+	int childLength = m_pyramidLevelLength[level-1];
+	for (int y=nodeY*2;y<btMin(nodeY*2+2,childLength);y++)
+	{
+		for (int x=nodeX*2;x<btMin(nodeX*2+2,childWidth);x++)
+		{
+			processPyramidNode(callback,level-1,x,y,startX,endX,startJ,endJ,queryMinRawHeight,queryMaxRawHeight,queryMinHeight,queryMaxHeight);
+		}
+	}
+}
+
+///processCells reports the triangles of the cells [startX,endX)x[startJ,endJ) that overlap the height range, queryMinHeight/queryMaxHeight are scaled local coordinates
+void	btHeightfieldTerrainShape::processCells(btTriangleCallback* callback,int startX,int endX,int startJ,int endJ,btScalar queryMinHeight,btScalar queryMaxHeight) const
+{
+	//the vertices of two grid rows are fetched once per column chunk and shared by the cells, instead of fetching 6 vertices per cell
+	const int chunkSize = 64;
+	btVector3 rowVertices[2][chunkSize+1];
+
+	for (int chunkStartX=startX; chunkStartX<endX; chunkStartX+=chunkSize)
 	{
-		for(int x=startX; x<endX; x++)
+		int chunkEndX = btMin(chunkStartX+chunkSize,endX);
+		btVector3* row0 = rowVertices[0];
+		btVector3* row1 = rowVertices[1];
+		int x;
+		for (x=chunkStartX; x<=chunkEndX; x++)
+		{
+			getVertex(x,startJ,row0[x-chunkStartX]);
+		}
+
+		for(int j=startJ; j<endJ; j++)
 		{
-			btVector3 vertices[3];
-			if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1)))
+			for (x=chunkStartX; x<=chunkEndX; x++)
 			{
-        //first triangle
-        getVertex(x,j,vertices[0]);
-        getVertex(x+1,j,vertices[1]);
-        getVertex(x+1,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);
-        //second triangle
-        getVertex(x,j,vertices[0]);
-        getVertex(x+1,j+1,vertices[1]);
-        getVertex(x,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);				
-			} else
+				getVertex(x,j+1,row1[x-chunkStartX]);
+			}
+
+			for(x=chunkStartX; x<chunkEndX; x++)
 			{
-        //first triangle
-        getVertex(x,j,vertices[0]);
-        getVertex(x,j+1,vertices[1]);
-        getVertex(x+1,j,vertices[2]);
-        callback->processTriangle(vertices,x,j);
-        //second triangle
-        getVertex(x+1,j,vertices[0]);
-        getVertex(x,j+1,vertices[1]);
-        getVertex(x+1,j+1,vertices[2]);
-        callback->processTriangle(vertices,x,j);
+				const btVector3* v0 = &row0[x-chunkStartX];
+				const btVector3* v1 = &row1[x-chunkStartX];
+				btScalar minHeight = btMin(btMin(v0[0][m_upAxis],v0[1][m_upAxis]),btMin(v1[0][m_upAxis],v1[1][m_upAxis]));
+				btScalar maxHeight = btMax(btMax(v0[0][m_upAxis],v0[1][m_upAxis]),btMax(v1[0][m_upAxis],v1[1][m_upAxis]));
+				if (minHeight > queryMaxHeight || maxHeight < queryMinHeight)
+					continue;
+
+				btVector3 corners[4] = {v0[0],v0[1],v1[0],v1[1]};
+				processCell(callback,x,j,corners);
 			}
+
+			btSwap(row0,row1);
 		}
 	}
+}
 
-	
+void	btHeightfieldTerrainShape::processCell(btTriangleCallback* callback,int x,int j,const btVector3* corners) const
+{
+	btVector3 vertices[3];
+	if (m_flipQuadEdges || (m_useDiamondSubdivision && !((j+x) & 1)))
+	{
+		//first triangle
+		vertices[0] = corners[0];
+		vertices[1] = corners[1];
+		vertices[2] = corners[3];
+		callback->processTriangle(vertices,x,j);
+		//second triangle
+		vertices[0] = corners[0];
+		vertices[1] = corners[3];
+		vertices[2] = corners[2];
+		callback->processTriangle(vertices,x,j);
+	} else
+	{
+		//first triangle
+		vertices[0] = corners[0];
+		vertices[1] = corners[2];
+		vertices[2] = corners[1];
+		callback->processTriangle(vertices,x,j);
+		//second triangle
+		vertices[0] = corners[1];
+		vertices[1] = corners[2];
+		vertices[2] = corners[3];
+		callback->processTriangle(vertices,x,j);
+	}
+}
+
+void	btHeightfieldTerrainShape::performRaycast(btTriangleCallback* callback,const btVector3& raySource,const btVector3& rayTarget,const btScalar* closestHitFraction) const
+{
+	//grid axes, the heightfield x index runs along axis0 and y along axis1
+	int axis0 = (m_upAxis == 0) ? 1 : 0;
+	int axis1 = (m_upAxis == 2) ? 1 : 2;
+
+	//ray in grid coordinates: cell (x,y) spans [x,x+1]x[y,y+1], and the height coordinate is the raw height
+	btVector3 invScaling(btScalar(1.)/m_localScaling[0],btScalar(1.)/m_localScaling[1],btScalar(1.)/m_localScaling[2]);
+	btVector3 from = raySource*invScaling + m_localOrigin;
+	btVector3 to = rayTarget*invScaling + m_localOrigin;
+	btVector3 dir = to-from;
+
+	//clip the ray against the grid bounds
+	btScalar tEnter = btScalar(0.);
+	btScalar tExit = btScalar(1.);
+	for (int i=0;i<3;i++)
+	{
+		btScalar boundsMin = m_localAabbMin[i];
+		btScalar boundsMax = m_localAabbMax[i];
+		if (btFabs(dir[i]) < SIMD_EPSILON)
+		{
+			if (from[i] < boundsMin || from[i] > boundsMax)
+				return;
+		} else
+		{
+			btScalar t0 = (boundsMin-from[i])/dir[i];
+			btScalar t1 = (boundsMax-from[i])/dir[i];
+			if (t0 > t1)
+				btSwap(t0,t1);
+			tEnter = btMax(tEnter,t0);
+			tExit = btMin(tExit,t1);
+		}
+	}
+	if (tEnter > tExit)
+		return;
+
+	int numCellsX = m_heightStickWidth-1;
+	int numCellsY = m_heightStickLength-1;
+	btVector3 entry = from + dir*tEnter;
+	int cellX = btMax(0,btMin(numCellsX-1,int(entry[axis0])));
+	int cellY = btMax(0,btMin(numCellsY-1,int(entry[axis1])));
+
+	int stepX = (dir[axis0] > btScalar(0.)) ? 1 : -1;
+	int stepY = (dir[axis1] > btScalar(0.)) ? 1 : -1;
+	btScalar deltaX = (btFabs(dir[axis0]) > SIMD_EPSILON) ? btScalar(1.)/btFabs(dir[axis0]) : btScalar(BT_LARGE_FLOAT);
+	btScalar deltaY = (btFabs(dir[axis1]) > SIMD_EPSILON) ? btScalar(1.)/btFabs(dir[axis1]) : btScalar(BT_LARGE_FLOAT);
+	//ray fraction where the ray leaves the current cell along each axis
+	btScalar nextX = (btFabs(dir[axis0]) > SIMD_EPSILON) ? (btScalar(stepX > 0 ? cellX+1 : cellX)-from[axis0])/dir[axis0] : btScalar(BT_LARGE_FLOAT);
+	btScalar nextY = (btFabs(dir[axis1]) > SIMD_EPSILON) ? (btScalar(stepY > 0 ? cellY+1 : cellY)-from[axis1])/dir[axis1] : btScalar(BT_LARGE_FLOAT);
+
+	//tolerance for hits on the border of a cell
+	const btScalar heightTolerance = btScalar(1e-3);
+
+	btScalar tCell = tEnter;
+	for (;;)
+	{
+		if (closestHitFraction && tCell > *closestHitFraction)
+			break;
+
+		btScalar tCellExit = btMin(btMin(nextX,nextY),tExit);
 
+		//with a pyramid, leaf blocks the ray passes above or below are skipped without reading their heights
+		bool skipBlock = false;
+		int blockX = cellX>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+		int blockY = cellY>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT;
+		if (m_pyramidMinMax.size())
+		{
+			btScalar tBlockExit = tExit;
+			if (btFabs(dir[axis0]) > SIMD_EPSILON)
+				tBlockExit = btMin(tBlockExit,(btScalar((stepX > 0 ? blockX+1 : blockX)<<BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT)-from[axis0])/dir[axis0]);
+			if (btFabs(dir[axis1]) > SIMD_EPSILON)
+				tBlockExit = btMin(tBlockExit,(btScalar((stepY > 0 ? blockY+1 : blockY)<<BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT)-from[axis1])/dir[axis1]);
+			btScalar h0 = from[m_upAxis] + dir[m_upAxis]*tCell;
+			btScalar h1 = from[m_upAxis] + dir[m_upAxis]*tBlockExit;
+			const btScalar* minMax = &m_pyramidMinMax[2*(blockY*m_pyramidLevelWidth[0]+blockX)];
+			skipBlock = (btMin(h0,h1)-heightTolerance > minMax[1]) || (btMax(h0,h1)+heightTolerance < minMax[0]);
+		}
+
+		if (!skipBlock)
+		{
+			btScalar h0 = from[m_upAxis] + dir[m_upAxis]*tCell;
+			btScalar h1 = from[m_upAxis] + dir[m_upAxis]*tCellExit;
+			btScalar rayMinHeight = btMin(h0,h1)-heightTolerance;
+			btScalar rayMaxHeight = btMax(h0,h1)+heightTolerance;
+
+			btScalar c0 = getRawHeightFieldValue(cellX,cellY);
+			btScalar c1 = getRawHeightFieldValue(cellX+1,cellY);
+			btScalar c2 = getRawHeightFieldValue(cellX,cellY+1);
+			btScalar c3 = getRawHeightFieldValue(cellX+1,cellY+1);
+			btScalar cellMinHeight = btMin(btMin(c0,c1),btMin(c2,c3));
+			btScalar cellMaxHeight = btMax(btMax(c0,c1),btMax(c2,c3));
+
+			if (rayMinHeight <= cellMaxHeight && rayMaxHeight >= cellMinHeight)
+			{
+				btVector3 corners[4];
+				getVertex(cellX,cellY,corners[0]);
+				getVertex(cellX+1,cellY,corners[1]);
+				getVertex(cellX,cellY+1,corners[2]);
+				getVertex(cellX+1,cellY+1,corners[3]);
+				processCell(callback,cellX,cellY,corners);
+			}
+		}
+
+		//step to the next cell, or to the first cell outside a skipped block
+		do
+		{
+			if (tCellExit >= tExit)
+				return;
+
+			if (nextX < nextY)
+			{
+				cellX += stepX;
+				tCell = nextX;
+				nextX += deltaX;
+			} else
+			{
+				cellY += stepY;
+				tCell = nextY;
+				nextY += deltaY;
+			}
+			if (cellX < 0 || cellX >= numCellsX || cellY < 0 || cellY >= numCellsY)
+				return;
+			tCellExit = btMin(btMin(nextX,nextY),tExit);
+		} while (skipBlock && (cellX>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT) == blockX && (cellY>>BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT) == blockY);
+	}
 }
 
 void	btHeightfieldTerrainShape::calculateLocalInertia(btScalar ,btVector3& inertia) const
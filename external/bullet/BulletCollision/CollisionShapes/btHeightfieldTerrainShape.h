@@ -17,6 +17,10 @@ subject to the following restrictions:
 #define HEIGHTFIELD_TERRAIN_SHAPE_H
 
 #include "btConcaveShape.h"
+#include "LinearMath/btAlignedObjectArray.h"
+
+///the leaf nodes of the min/max pyramid cover blocks of 8x8 cells, a 4096x4096 terrain needs about 2.8MB
+#define BT_HEIGHTFIELD_PYRAMID_BLOCK_SHIFT 3
 
 ///btHeightfieldTerrainShape simulates a 2D heightfield terrain
 /**
@@ -99,10 +103,21 @@ protected:
 	
 	btVector3	m_localScaling;
 
+	///optional min/max raw height pyramid, interleaved min and max per node, the leaf level first
+	btAlignedObjectArray<btScalar>	m_pyramidMinMax;
+	btAlignedObjectArray<int>	m_pyramidLevelOffset;
+	btAlignedObjectArray<int>	m_pyramidLevelWidth;
+	btAlignedObjectArray<int>	m_pyramidLevelLength;
+
 	virtual btScalar	getRawHeightFieldValue(int x,int y) const;
 	void		quantizeWithClamp(int* out, const btVector3& point,int isMax) const;
 	void		getVertex(int x,int y,btVector3& vertex) const;
 
+	///processCell reports the two triangles of the grid cell at (x,y), using the 4 corner vertices in the order (x,y),(x+1,y),(x,y+1),(x+1,y+1)
+	void		processCell(btTriangleCallback* callback,int x,int y,const btVector3* corners) const;
+	void		processCells(btTriangleCallback* callback,int startX,int endX,int startJ,int endJ,btScalar queryMinHeight,btScalar queryMaxHeight) const;
+	void		processPyramidNode(btTriangleCallback* callback,int level,int nodeX,int nodeY,int startX,int endX,int startJ,int endJ,btScalar queryMinRawHeight,btScalar queryMaxRawHeight,btScalar queryMinHeight,btScalar queryMaxHeight) const;
+
 
 
 	/// protected initialization
@@ -142,11 +157,29 @@ public:
 
 	void setUseDiamondSubdivision(bool useDiamondSubdivision=true) { m_useDiamondSubdivision = useDiamondSubdivision;}
 
+	///buildMinMaxPyramid builds a quadtree of min/max heights over blocks of cells. Queries then skip whole regions that are entirely above or below the query volume.
+	///It is worth it for large terrains with tall queries. The pyramid caches the heights, call updateMinMaxPyramid after the heightfield data changed.
+	void	buildMinMaxPyramid();
+
+	///updateMinMaxPyramid updates the pyramid after the heights of the grid points [startX,endX]x[startY,endY] changed
+	void	updateMinMaxPyramid(int startX,int startY,int endX,int endY);
+
+	void	clearMinMaxPyramid();
+
+	bool	hasMinMaxPyramid() const
+	{
+		return m_pyramidMinMax.size() != 0;
+	}
+
 
 	virtual void getAabb(const btTransform& t,btVector3& aabbMin,btVector3& aabbMax) const;
 
 	virtual void	processAllTriangles(btTriangleCallback* callback,const btVector3& aabbMin,const btVector3& aabbMax) const;
 
+	///performRaycast walks the grid cells along the ray (2D DDA), and only reports the triangles of cells where the ray passes within the height range of the cell.
+	///Cells are visited front to back, if closestHitFraction is not null the walk stops at the first cell beyond *closestHitFraction. The callback may lower it while the grid is walked.
+	void	performRaycast(btTriangleCallback* callback,const btVector3& raySource,const btVector3& rayTarget,const btScalar* closestHitFraction=0) const;
+
 	virtual void	calculateLocalInertia(btScalar mass,btVector3& inertia) const;
 
 	virtual void	setLocalScaling(const btVector3& scaling);
@@ -18,6 +18,31 @@ subject to the following restrictions:
 #include "btStridingMeshInterface.h"
 #include "LinearMath/btAabbUtil2.h"
 #include "LinearMath/btIDebugDraw.h"
+#include "LinearMath/btTaskPool.h"
+
+///trees with fewer nodes are refit on the calling thread only
+#define BT_BVH_MIN_THREADED_REFIT_NODES 8192
+
+///btBvhRefitTask is a subtree that doesn't share any nodes with other tasks
+struct btBvhRefitTask
+{
+	int	m_firstNode;
+	int	m_endNode;
+};
+
+struct btBvhRefitContext
+{
+	btOptimizedBvh*				m_bvh;
+	btStridingMeshInterface*	m_meshInterface;
+	const btBvhRefitTask*		m_tasks;
+};
+
+static void	btRefitBvhTask(void* userPtr, int taskIndex)
+{
+	btBvhRefitContext& context = *(btBvhRefitContext*)userPtr;
+	const btBvhRefitTask& task = context.m_tasks[taskIndex];
+	context.m_bvh->updateBvhNodes(context.m_meshInterface,task.m_firstNode,task.m_endNode,0);
+}
 
 
 btOptimizedBvh::btOptimizedBvh()
@@ -29,8 +54,9 @@ btOptimizedBvh::~btOptimizedBvh()
 }
 
 
-void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax)
+void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax, btBuildMode buildMode)
 {
+	BT_ALLOC_TAG(BT_ALLOC_TAG_SHAPES);
 	m_useQuantization = useQuantizedAabbCompression;
 
 
@@ -179,9 +205,7 @@ void btOptimizedBvh::build(btStridingMeshInterface* triangles, bool useQuantized
 		m_contiguousNodes.resize(2*numLeafNodes);
 	}
 
-	m_curNodeIndex = 0;
-
-	buildTree(0,numLeafNodes);
+	buildTreeNodes(numLeafNodes,buildMode);
 
 	///if the entire tree is small then subtree size, we need to create a header info for the tree
 	if(m_useQuantization && !m_SubtreeHeaders.size())
@@ -269,6 +293,76 @@ void	btOptimizedBvh::refitPartial(btStridingMeshInterface* meshInterface,const b
 	
 }
 
+void	btOptimizedBvh::refitParallel(btStridingMeshInterface* meshInterface,const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	btAssert(m_useQuantization);
+	if (!m_useQuantization)
+		return;
+
+	setQuantizationValues(aabbMin,aabbMax);
+
+	int numThreads = (m_curNodeIndex >= BT_BVH_MIN_THREADED_REFIT_NODES) ? btGetTaskThreadCount() : 1;
+
+	if (numThreads <= 1)
+	{
+		updateBvhNodes(meshInterface,0,m_curNodeIndex,0);
+	} else
+	{
+		//split the tree into subtrees of at most maxTaskNodes nodes, the nodes above them are merged afterwards
+		int maxTaskNodes = btMax(m_curNodeIndex/(numThreads*8),BT_BVH_MIN_THREADED_REFIT_NODES/16);
+		btAlignedObjectArray<btBvhRefitTask> tasks;
+		btAlignedObjectArray<int> topNodes;
+		btAlignedObjectArray<int> stack;
+		stack.push_back(0);
+		while (stack.size())
+		{
+			int nodeIndex = stack[stack.size()-1];
+			stack.pop_back();
+			const btQuantizedBvhNode& node = m_quantizedContiguousNodes[nodeIndex];
+			int subtreeSize = node.isLeafNode() ? 1 : node.getEscapeIndex();
+			if (subtreeSize <= maxTaskNodes)
+			{
+				btBvhRefitTask task;
+				task.m_firstNode = nodeIndex;
+				task.m_endNode = nodeIndex+subtreeSize;
+				tasks.push_back(task);
+			} else
+			{
+				topNodes.push_back(nodeIndex);
+				int leftChildIndex = nodeIndex+1;
+				const btQuantizedBvhNode& leftChild = m_quantizedContiguousNodes[leftChildIndex];
+				stack.push_back(leftChildIndex + (leftChild.isLeafNode() ? 1 : leftChild.getEscapeIndex()));
+				stack.push_back(leftChildIndex);
+			}
+		}
+
+		btBvhRefitContext context;
+		context.m_bvh = this;
+		context.m_meshInterface = meshInterface;
+		context.m_tasks = &tasks[0];
+		btParallelFor(tasks.size(),btRefitBvhTask,&context,numThreads);
+
+		//topNodes are in depth first order, so children are merged before their parents
+		for (int i=topNodes.size()-1;i>=0;i--)
+		{
+			btQuantizedBvhNode& curNode = m_quantizedContiguousNodes[topNodes[i]];
+			const btQuantizedBvhNode* leftChildNode = &m_quantizedContiguousNodes[topNodes[i]+1];
+			const btQuantizedBvhNode* rightChildNode = leftChildNode->isLeafNode() ? leftChildNode+1 : leftChildNode+leftChildNode->getEscapeIndex();
+			for (int j=0;j<3;j++)
+			{
+				curNode.m_quantizedAabbMin[j] = btMin(leftChildNode->m_quantizedAabbMin[j],rightChildNode->m_quantizedAabbMin[j]);
+				curNode.m_quantizedAabbMax[j] = btMax(leftChildNode->m_quantizedAabbMax[j],rightChildNode->m_quantizedAabbMax[j]);
+			}
+		}
+	}
+
+	for (int i=0;i<m_SubtreeHeaders.size();i++)
+	{
+		btBvhSubtreeInfo& subtree = m_SubtreeHeaders[i];
+		subtree.setAabbFromQuantizeNode(m_quantizedContiguousNodes[subtree.m_rootNodeIndex]);
+	}
+}
+
 void	btOptimizedBvh::updateBvhNodes(btStridingMeshInterface* meshInterface,int firstNode,int endNode,int index)
 {
 	(void)index;
@@ -389,3 +483,77 @@ btOptimizedBvh* btOptimizedBvh::deSerializeInPlace(void *i_alignedDataBuffer, un
 	//we don't add additional data so just do a static upcast
 	return static_cast<btOptimizedBvh*>(bvh);
 }
+
+bool	btOptimizedBvh::hasValidNodes(const btStridingMeshInterface* meshInterface) const
+{
+	int numParts = meshInterface->getNumSubParts();
+	btAlignedObjectArray<int> numTriangles;
+	numTriangles.resize(numParts);
+	int part;
+	for (part=0;part<numParts;part++)
+	{
+		const unsigned char *vertexbase;
+		int numverts;
+		PHY_ScalarType type;
+		int stride;
+		const unsigned char *indexbase;
+		int indexstride;
+		int numfaces;
+		PHY_ScalarType indicestype;
+
+		meshInterface->getLockedReadOnlyVertexIndexBase(&vertexbase,numverts,type,stride,&indexbase,indexstride,numfaces,indicestype,part);
+		meshInterface->unLockReadOnlyVertexBase(part);
+		numTriangles[part] = numfaces;
+	}
+
+	int numNodes = m_curNodeIndex;
+	if (numNodes < 0)
+		return false;
+
+	//an internal node skips its subtree, which has to end inside the node array
+	int i;
+	if (m_useQuantization)
+	{
+		if (numNodes > m_quantizedContiguousNodes.size())
+			return false;
+		for (i=0;i<numNodes;i++)
+		{
+			const btQuantizedBvhNode& node = m_quantizedContiguousNodes[i];
+			if (node.isLeafNode())
+			{
+				part = node.getPartId();
+				if ((part >= numParts) || (node.getTriangleIndex() >= numTriangles[part]))
+					return false;
+			} else if (node.m_escapeIndexOrTriangleIndex < i-numNodes)
+			{
+				return false;
+			}
+		}
+	} else
+	{
+		if (numNodes > m_contiguousNodes.size())
+			return false;
+		for (i=0;i<numNodes;i++)
+		{
+			const btOptimizedBvhNode& node = m_contiguousNodes[i];
+			if (node.m_escapeIndex == -1)
+			{
+				part = node.m_subPart;
+				if ((part < 0) || (part >= numParts) || (node.m_triangleIndex < 0) || (node.m_triangleIndex >= numTriangles[part]))
+					return false;
+			} else if ((node.m_escapeIndex <= 0) || (node.m_escapeIndex > numNodes-i))
+			{
+				return false;
+			}
+		}
+	}
+
+	for (i=0;i<m_SubtreeHeaders.size();i++)
+	{
+		const btBvhSubtreeInfo& subtree = m_SubtreeHeaders[i];
+		if ((subtree.m_rootNodeIndex < 0) || (subtree.m_rootNodeIndex >= numNodes) ||
+			(subtree.m_subtreeSize < 0) || (subtree.m_subtreeSize > numNodes-subtree.m_rootNodeIndex))
+			return false;
+	}
+	return true;
+}
@@ -28,7 +28,7 @@ ATTRIBUTE_ALIGNED16(class) btOptimizedBvh : public btQuantizedBvh
 {
 	
 public:
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
 protected:
 
@@ -38,12 +38,16 @@ public:
 
 	virtual ~btOptimizedBvh();
 
-	void	build(btStridingMeshInterface* triangles,bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax);
+	void	build(btStridingMeshInterface* triangles,bool useQuantizedAabbCompression, const btVector3& bvhAabbMin, const btVector3& bvhAabbMax, btBuildMode buildMode=BUILD_MEAN_SPLIT);
 
 	void	refit(btStridingMeshInterface* triangles,const btVector3& aabbMin,const btVector3& aabbMax);
 
 	void	refitPartial(btStridingMeshInterface* triangles,const btVector3& aabbMin, const btVector3& aabbMax);
 
+	///refitParallel is a full refit that splits the tree into independent subtrees and refits them on multiple threads, the top of the tree is merged afterwards.
+	///The mesh interface needs to allow concurrent getLockedReadOnlyVertexIndexBase calls, which is the case for btTriangleIndexVertexArray and btTriangleMesh.
+	void	refitParallel(btStridingMeshInterface* triangles,const btVector3& aabbMin,const btVector3& aabbMax);
+
 	void	updateBvhNodes(btStridingMeshInterface* meshInterface,int firstNode,int endNode,int index);
 
 	/// Data buffer MUST be 16 byte aligned
@@ -56,6 +60,10 @@ public:
 	///deSerializeInPlace loads and initializes a BVH from a buffer in memory 'in place'
 	static btOptimizedBvh *deSerializeInPlace(void *i_alignedDataBuffer, unsigned int i_dataBufferSize, bool i_swapEndian);
 
+	///hasValidNodes returns true if the subtrees of all nodes end inside the tree and every leaf refers to an existing triangle of meshInterface.
+	///deSerializeInPlace only checks the buffer size, use hasValidNodes before querying a tree that was loaded from untrusted data.
+	bool	hasValidNodes(const btStridingMeshInterface* meshInterface) const;
+
 
 };
 
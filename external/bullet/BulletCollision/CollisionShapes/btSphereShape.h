@@ -24,7 +24,7 @@ ATTRIBUTE_ALIGNED16(class) btSphereShape : public btConvexInternalShape
 {
 	
 public:
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
 	btSphereShape (btScalar radius) : btConvexInternalShape ()
 	{
@@ -0,0 +1,432 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btTiledHeightfieldTerrainShape.h"
+
+#include <string.h>
+#include <limits.h>
+#ifndef _WIN32
+#include <sys/types.h>
+#endif
+
+///tile files can be larger than 2GB, so seeks use 64 bit offsets: off_t is 64 bit on iOS and Mac OS X, and on Linux with _FILE_OFFSET_BITS=64
+#ifdef _WIN32
+typedef __int64 btFileOffset;
+#else
+typedef off_t btFileOffset;
+#endif
+
+static SIMD_FORCE_INLINE int btSeekFile(FILE* file,btFileOffset offset,int origin)
+{
+#ifdef _WIN32
+	return _fseeki64(file,offset,origin);
+#else
+	return fseeko(file,offset,origin);
+#endif
+}
+
+static SIMD_FORCE_INLINE btFileOffset btTellFile(FILE* file)
+{
+#ifdef _WIN32
+	return _ftelli64(file);
+#else
+	return ftello(file);
+#endif
+}
+
+btTiledHeightfieldTerrainShape::btTiledHeightfieldTerrainShape(int heightStickWidth,int heightStickLength,int tileSize,
+                                                               btScalar minHeight,btScalar maxHeight,int upAxis,bool flipQuadEdges)
+//the heights come from the tiles, the data pointer of the base class is never used
+:btHeightfieldTerrainShape(heightStickWidth,heightStickLength,this,btScalar(1.),minHeight,maxHeight,upAxis,PHY_FLOAT,flipQuadEdges),
+m_tileSource(0),
+m_maxResidentTiles(0),
+m_numResidentTiles(0),
+m_pageCounter(0)
+{
+	btAssert(tileSize > 0 && !(tileSize & (tileSize-1)));
+	m_tileShift = 0;
+	while ((1<<m_tileShift) < tileSize)
+		m_tileShift++;
+
+	m_numTilesX = (heightStickWidth+tileSize-1)>>m_tileShift;
+	m_numTilesY = (heightStickLength+tileSize-1)>>m_tileShift;
+
+	btHeightfieldTile emptyTile;
+	emptyTile.m_samples = 0;
+	emptyTile.m_offset = minHeight;
+	emptyTile.m_scale = btScalar(0.);
+	emptyTile.m_lastUsed = 0;
+	emptyTile.m_ownsSamples = false;
+	m_tiles.resize(m_numTilesX*m_numTilesY,emptyTile);
+}
+
+btTiledHeightfieldTerrainShape::~btTiledHeightfieldTerrainShape()
+{
+	for (int i=0;i<m_tiles.size();i++)
+	{
+		releaseSamples(m_tiles[i]);
+	}
+}
+
+btScalar	btTiledHeightfieldTerrainShape::getRawHeightFieldValue(int x,int y) const
+{
+	int tileSize = 1<<m_tileShift;
+	const btHeightfieldTile& tile = m_tiles[(y>>m_tileShift)*m_numTilesX+(x>>m_tileShift)];
+	if (!tile.m_samples)
+		return m_minHeight;
+	return tile.m_offset + btScalar(tile.m_samples[(y&(tileSize-1))*tileSize+(x&(tileSize-1))])*tile.m_scale;
+}
+
+void	btTiledHeightfieldTerrainShape::releaseSamples(btHeightfieldTile& tile)
+{
+	if (tile.m_samples)
+	{
+		if (tile.m_ownsSamples)
+			btAlignedFree(tile.m_samples);
+		tile.m_samples = 0;
+		tile.m_ownsSamples = false;
+		m_numResidentTiles--;
+	}
+}
+
+///tileChanged keeps the min/max pyramid up to date, it also covers the cells that share grid points with the tile
+void	btTiledHeightfieldTerrainShape::tileChanged(int tileX,int tileY)
+{
+	if (hasMinMaxPyramid())
+	{
+		int tileSize = 1<<m_tileShift;
+		updateMinMaxPyramid(tileX*tileSize,tileY*tileSize,btMin((tileX+1)*tileSize,m_heightStickWidth)-1,btMin((tileY+1)*tileSize,m_heightStickLength)-1);
+	}
+}
+
+void	btTiledHeightfieldTerrainShape::encodeTile(int tileX,int tileY,const float* heights,int rowStride)
+{
+	int tileSize = 1<<m_tileShift;
+	int numX = btMin(tileSize,m_heightStickWidth-tileX*tileSize);
+	int numY = btMin(tileSize,m_heightStickLength-tileY*tileSize);
+
+	btScalar minHeight = btScalar(BT_LARGE_FLOAT);
+	btScalar maxHeight = btScalar(-BT_LARGE_FLOAT);
+	int x,y;
+	for (y=0;y<numY;y++)
+	{
+		for (x=0;x<numX;x++)
+		{
+			minHeight = btMin(minHeight,btScalar(heights[y*rowStride+x]));
+			maxHeight = btMax(maxHeight,btScalar(heights[y*rowStride+x]));
+		}
+	}
+	btAssert(minHeight >= m_minHeight && maxHeight <= m_maxHeight);
+	//heights outside the range of the shape are clamped to it, the samples below are clamped as well
+	btClamp(minHeight,m_minHeight,m_maxHeight);
+	btClamp(maxHeight,m_minHeight,m_maxHeight);
+
+	btScalar scale = (maxHeight-minHeight)/btScalar(65535.);
+	btScalar invScale = (scale > btScalar(0.)) ? btScalar(1.)/scale : btScalar(0.);
+
+	btAlignedObjectArray<unsigned short> samples;
+	samples.resize(tileSize*tileSize,0);
+	for (y=0;y<tileSize;y++)
+	{
+		for (x=0;x<tileSize;x++)
+		{
+			//edge tiles repeat the last grid point, the padding is never read
+			btScalar height = heights[btMin(y,numY-1)*rowStride+btMin(x,numX-1)];
+			int sample = int((height-minHeight)*invScale+btScalar(0.5));
+			samples[y*tileSize+x] = (unsigned short)btMax(0,btMin(sample,65535));
+		}
+	}
+	setTile(tileX,tileY,&samples[0],minHeight,scale,true);
+}
+
+void	btTiledHeightfieldTerrainShape::setTile(int tileX,int tileY,const unsigned short* samples,btScalar offset,btScalar scale,bool copySamples)
+{
+	btAssert(tileX >= 0 && tileX < m_numTilesX && tileY >= 0 && tileY < m_numTilesY);
+	btHeightfieldTile& tile = m_tiles[tileY*m_numTilesX+tileX];
+	releaseSamples(tile);
+
+	int tileSize = 1<<m_tileShift;
+	if (copySamples)
+	{
+		tile.m_samples = (unsigned short*)btAlignedAlloc(sizeof(unsigned short)*tileSize*tileSize,16);
+		memcpy(tile.m_samples,samples,sizeof(unsigned short)*tileSize*tileSize);
+	} else
+	{
+		tile.m_samples = (unsigned short*)samples;
+	}
+	tile.m_ownsSamples = copySamples;
+	tile.m_offset = offset;
+	tile.m_scale = scale;
+	tile.m_lastUsed = m_pageCounter;
+	m_numResidentTiles++;
+
+	tileChanged(tileX,tileY);
+}
+
+void	btTiledHeightfieldTerrainShape::releaseTile(int tileX,int tileY)
+{
+	btHeightfieldTile& tile = m_tiles[tileY*m_numTilesX+tileX];
+	if (tile.m_samples)
+	{
+		releaseSamples(tile);
+		tileChanged(tileX,tileY);
+	}
+}
+
+void	btTiledHeightfieldTerrainShape::pageTiles(const btVector3& aabbMin,const btVector3& aabbMax)
+{
+	//same conversion to grid coordinates as processAllTriangles
+	btVector3 invScaling(btScalar(1.)/m_localScaling[0],btScalar(1.)/m_localScaling[1],btScalar(1.)/m_localScaling[2]);
+	btVector3 scaledAabbMin = aabbMin*invScaling;
+	btVector3 scaledAabbMax = aabbMax*invScaling;
+	btVector3 localAabbMin = scaledAabbMin;
+	localAabbMin.setMin(scaledAabbMax);
+	btVector3 localAabbMax = scaledAabbMax;
+	localAabbMax.setMax(scaledAabbMin);
+	localAabbMin += m_localOrigin;
+	localAabbMax += m_localOrigin;
+
+	int axis0 = (m_upAxis == 0) ? 1 : 0;
+	int axis1 = (m_upAxis == 2) ? 1 : 2;
+	//one extra grid point on each side, the cells at the border use it
+	int startX = btMax(0,int(btScalar(floor(localAabbMin[axis0])))-1);
+	int endX = btMin(m_heightStickWidth-1,int(btScalar(floor(localAabbMax[axis0])))+2);
+	int startY = btMax(0,int(btScalar(floor(localAabbMin[axis1])))-1);
+	int endY = btMin(m_heightStickLength-1,int(btScalar(floor(localAabbMax[axis1])))+2);
+	if (startX > endX || startY > endY)
+		return;
+
+	int tileSize = 1<<m_tileShift;
+	btAlignedObjectArray<unsigned short> samples;
+	for (int tileY=startY>>m_tileShift;tileY<=(endY>>m_tileShift);tileY++)
+	{
+		for (int tileX=startX>>m_tileShift;tileX<=(endX>>m_tileShift);tileX++)
+		{
+			btHeightfieldTile& tile = m_tiles[tileY*m_numTilesX+tileX];
+			if (!tile.m_samples && m_tileSource)
+			{
+				samples.resize(tileSize*tileSize);
+				btScalar offset,scale;
+				if (m_tileSource->loadTile(tileX,tileY,&samples[0],offset,scale))
+				{
+					setTile(tileX,tileY,&samples[0],offset,scale,true);
+				}
+			}
+			tile.m_lastUsed = m_pageCounter+1;
+		}
+	}
+}
+
+struct btHeightfieldTileUseSortPredicate
+{
+	bool operator() ( const btHeightfieldTile* a, const btHeightfieldTile* b ) const
+	{
+		return a->m_lastUsed < b->m_lastUsed;
+	}
+};
+
+void	btTiledHeightfieldTerrainShape::releaseUnusedTiles()
+{
+	m_pageCounter++;
+	if (m_maxResidentTiles <= 0 || m_numResidentTiles <= m_maxResidentTiles)
+		return;
+
+	btAlignedObjectArray<btHeightfieldTile*> residentTiles;
+	int i;
+	for (i=0;i<m_tiles.size();i++)
+	{
+		//tiles used since the last call are kept, even above the limit
+		if (m_tiles[i].m_samples && m_tiles[i].m_lastUsed < m_pageCounter)
+			residentTiles.push_back(&m_tiles[i]);
+	}
+	residentTiles.quickSort(btHeightfieldTileUseSortPredicate());
+
+	for (i=0;i<residentTiles.size() && m_numResidentTiles > m_maxResidentTiles;i++)
+	{
+		int tileIndex = int(residentTiles[i]-&m_tiles[0]);
+		releaseTile(tileIndex%m_numTilesX,tileIndex/m_numTilesX);
+	}
+}
+
+
+static const char btHeightfieldTileFileMagic[8] = {'B','T','H','F','T','I','L','E'};
+static const int btHeightfieldTileFileVersion = 1;
+static const int btHeightfieldTileFileEndianMarker = 0x01020304;
+
+///the file starts with this header, followed by an offset and scale per tile and the samples of all tiles
+struct btHeightfieldTileFileHeader
+{
+	char	m_magic[8];
+	int		m_version;
+	int		m_endianMarker;
+	int		m_heightStickWidth;
+	int		m_heightStickLength;
+	int		m_tileSize;
+	float	m_minHeight;
+	float	m_maxHeight;
+	int		m_pad;
+};
+
+btHeightfieldTileFile::btHeightfieldTileFile()
+:m_file(0)
+{
+}
+
+btHeightfieldTileFile::~btHeightfieldTileFile()
+{
+	close();
+}
+
+bool	btHeightfieldTileFile::writeFile(const btTiledHeightfieldTerrainShape* shape,const char* fileName)
+{
+	int numTiles = shape->getNumTilesX()*shape->getNumTilesY();
+	int tileSize = shape->getTileSize();
+	int i;
+	for (i=0;i<numTiles;i++)
+	{
+		if (!shape->isTileResident(i%shape->getNumTilesX(),i/shape->getNumTilesX()))
+			return false;
+	}
+
+	FILE* file = fopen(fileName,"wb");
+	if (!file)
+		return false;
+
+	btHeightfieldTileFileHeader header;
+	memset(&header,0,sizeof(header));
+	memcpy(header.m_magic,btHeightfieldTileFileMagic,sizeof(btHeightfieldTileFileMagic));
+	header.m_version = btHeightfieldTileFileVersion;
+	header.m_endianMarker = btHeightfieldTileFileEndianMarker;
+	header.m_heightStickWidth = shape->getHeightStickWidth();
+	header.m_heightStickLength = shape->getHeightStickLength();
+	header.m_tileSize = tileSize;
+	header.m_minHeight = float(shape->getMinHeight());
+	header.m_maxHeight = float(shape->getMaxHeight());
+
+	btAlignedObjectArray<float> offsetScale;
+	offsetScale.resize(numTiles*2);
+	for (i=0;i<numTiles;i++)
+	{
+		const btHeightfieldTile& tile = shape->getTile(i%shape->getNumTilesX(),i/shape->getNumTilesX());
+		offsetScale[i*2] = float(tile.m_offset);
+		offsetScale[i*2+1] = float(tile.m_scale);
+	}
+
+	bool written = (fwrite(&header,sizeof(header),1,file) == 1);
+	written = written && (fwrite(&offsetScale[0],sizeof(float),numTiles*2,file) == size_t(numTiles*2));
+	for (i=0;i<numTiles && written;i++)
+	{
+		const btHeightfieldTile& tile = shape->getTile(i%shape->getNumTilesX(),i/shape->getNumTilesX());
+		written = (fwrite(tile.m_samples,sizeof(unsigned short),tileSize*tileSize,file) == size_t(tileSize*tileSize));
+	}
+	if (fclose(file) != 0)
+		written = false;
+	return written;
+}
+
+bool	btHeightfieldTileFile::open(const char* fileName)
+{
+	close();
+	m_file = fopen(fileName,"rb");
+	if (!m_file)
+		return false;
+
+	btHeightfieldTileFileHeader header;
+	if (fread(&header,sizeof(header),1,m_file) != 1
+		|| memcmp(header.m_magic,btHeightfieldTileFileMagic,sizeof(btHeightfieldTileFileMagic))
+		|| header.m_version != btHeightfieldTileFileVersion
+		|| header.m_endianMarker != btHeightfieldTileFileEndianMarker
+		|| header.m_heightStickWidth <= 1 || header.m_heightStickLength <= 1
+		|| header.m_tileSize <= 0 || header.m_tileSize > 32768 || (header.m_tileSize & (header.m_tileSize-1))
+		|| !(header.m_minHeight <= header.m_maxHeight))
+	{
+		close();
+		return false;
+	}
+
+	m_heightStickWidth = header.m_heightStickWidth;
+	m_heightStickLength = header.m_heightStickLength;
+	m_tileSize = header.m_tileSize;
+	m_minHeight = header.m_minHeight;
+	m_maxHeight = header.m_maxHeight;
+	m_numTilesX = (m_heightStickWidth-1)/m_tileSize+1;
+	m_numTilesY = (m_heightStickLength-1)/m_tileSize+1;
+
+	//the offset and scale of all tiles need to fit in memory, and the file needs to hold the samples of all tiles
+	if (m_numTilesX > INT_MAX/int(2*sizeof(float))/m_numTilesY)
+	{
+		close();
+		return false;
+	}
+	int numTiles = m_numTilesX*m_numTilesY;
+	btFileOffset tileBytes = btFileOffset(sizeof(unsigned short))*m_tileSize*m_tileSize;
+	btFileOffset fileSize = -1;
+	if (btSeekFile(m_file,0,SEEK_END) == 0)
+	{
+		fileSize = btTellFile(m_file);
+	}
+	if (fileSize < btFileOffset(sizeof(header)) + btFileOffset(sizeof(float))*numTiles*2 + tileBytes*numTiles
+		|| btSeekFile(m_file,btFileOffset(sizeof(header)),SEEK_SET) != 0)
+	{
+		close();
+		return false;
+	}
+
+	m_tileOffsetScale.resize(numTiles*2);
+	if (fread(&m_tileOffsetScale[0],sizeof(float),numTiles*2,m_file) != size_t(numTiles*2))
+	{
+		close();
+		return false;
+	}
+	m_dataOffset = (unsigned int)(sizeof(header)+sizeof(float)*numTiles*2);
+	return true;
+}
+
+void	btHeightfieldTileFile::close()
+{
+	if (m_file)
+	{
+		fclose(m_file);
+		m_file = 0;
+	}
+	m_tileOffsetScale.clear();
+}
+
+btTiledHeightfieldTerrainShape*	btHeightfieldTileFile::createShape(int upAxis,bool flipQuadEdges)
+{
+	if (!m_file)
+		return 0;
+	btTiledHeightfieldTerrainShape* shape = new btTiledHeightfieldTerrainShape(m_heightStickWidth,m_heightStickLength,m_tileSize,
+		m_minHeight,m_maxHeight,upAxis,flipQuadEdges);
+	shape->setTileSource(this);
+	return shape;
+}
+
+bool	btHeightfieldTileFile::loadTile(int tileX,int tileY,unsigned short* samples,btScalar& offset,btScalar& scale)
+{
+	if (!m_file || tileX < 0 || tileX >= m_numTilesX || tileY < 0 || tileY >= m_numTilesY)
+		return false;
+
+	int tileIndex = tileY*m_numTilesX+tileX;
+	btFileOffset tileBytes = btFileOffset(sizeof(unsigned short))*m_tileSize*m_tileSize;
+	if (btSeekFile(m_file,btFileOffset(m_dataOffset)+tileIndex*tileBytes,SEEK_SET) != 0)
+		return false;
+	if (fread(samples,sizeof(unsigned short),m_tileSize*m_tileSize,m_file) != size_t(m_tileSize*m_tileSize))
+		return false;
+
+	offset = m_tileOffsetScale[tileIndex*2];
+	scale = m_tileOffsetScale[tileIndex*2+1];
+	return true;
+}
@@ -0,0 +1,188 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose, 
+including commercial applications, and to alter it and redistribute it freely, 
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef TILED_HEIGHTFIELD_TERRAIN_SHAPE_H
+#define TILED_HEIGHTFIELD_TERRAIN_SHAPE_H
+
+#include "btHeightfieldTerrainShape.h"
+
+#include <stdio.h>
+
+///btHeightfieldTile stores the heights of tileSize x tileSize grid points as 16 bit values, height = m_offset + sample*m_scale
+struct	btHeightfieldTile
+{
+	unsigned short*	m_samples;
+	btScalar		m_offset;
+	btScalar		m_scale;
+	///last pageTiles call that used the tile, for least recently used eviction
+	unsigned int	m_lastUsed;
+	bool			m_ownsSamples;
+};
+
+///btHeightfieldTileSource provides tiles to btTiledHeightfieldTerrainShape::pageTiles, for example from a file or a network stream
+class	btHeightfieldTileSource
+{
+public:
+	virtual ~btHeightfieldTileSource() {}
+
+	///loadTile fills tileSize*tileSize samples, row by row, and returns false if the tile is not available
+	virtual bool	loadTile(int tileX,int tileY,unsigned short* samples,btScalar& offset,btScalar& scale)=0;
+};
+
+///The btTiledHeightfieldTerrainShape is a btHeightfieldTerrainShape that stores its heights in quantized 16 bit tiles, with an offset and scale per tile.
+///Tiles can be loaded and released at runtime, so only the terrain around the simulated objects needs to be in memory. Grid points of tiles that are not
+///resident have the minimum height of the shape, so keep the tiles around all objects that touch the terrain resident, see pageTiles.
+///The tile samples can be shared with the renderer, see getTile.
+class btTiledHeightfieldTerrainShape : public btHeightfieldTerrainShape
+{
+protected:
+	int		m_tileShift;
+	int		m_numTilesX;
+	int		m_numTilesY;
+
+	btAlignedObjectArray<btHeightfieldTile>	m_tiles;
+
+	btHeightfieldTileSource*	m_tileSource;
+	int				m_maxResidentTiles;
+	int				m_numResidentTiles;
+	unsigned int	m_pageCounter;
+
+	virtual btScalar	getRawHeightFieldValue(int x,int y) const;
+
+	void	releaseSamples(btHeightfieldTile& tile);
+	void	tileChanged(int tileX,int tileY);
+
+public:
+
+	///tileSize needs to be a power of 2, minHeight and maxHeight need to contain all heights of all tiles
+	btTiledHeightfieldTerrainShape(int heightStickWidth,int heightStickLength,int tileSize,
+	                               btScalar minHeight,btScalar maxHeight,int upAxis,bool flipQuadEdges);
+
+	virtual ~btTiledHeightfieldTerrainShape();
+
+	int		getHeightStickWidth() const
+	{
+		return m_heightStickWidth;
+	}
+
+	int		getHeightStickLength() const
+	{
+		return m_heightStickLength;
+	}
+
+	btScalar	getMinHeight() const
+	{
+		return m_minHeight;
+	}
+
+	btScalar	getMaxHeight() const
+	{
+		return m_maxHeight;
+	}
+
+	int		getTileSize() const
+	{
+		return 1<<m_tileShift;
+	}
+
+	int		getNumTilesX() const
+	{
+		return m_numTilesX;
+	}
+
+	int		getNumTilesY() const
+	{
+		return m_numTilesY;
+	}
+
+	///encodeTile quantizes the heights of a tile, heights points at the first grid point of the tile and rowStride is the number of heights per row
+	void	encodeTile(int tileX,int tileY,const float* heights,int rowStride);
+
+	///setTile uses tileSize*tileSize quantized samples. Without copySamples the caller keeps the samples alive until the tile is released, for example in a memory mapped file.
+	void	setTile(int tileX,int tileY,const unsigned short* samples,btScalar offset,btScalar scale,bool copySamples=true);
+
+	void	releaseTile(int tileX,int tileY);
+
+	bool	isTileResident(int tileX,int tileY) const
+	{
+		return m_tiles[tileY*m_numTilesX+tileX].m_samples != 0;
+	}
+
+	const btHeightfieldTile&	getTile(int tileX,int tileY) const
+	{
+		return m_tiles[tileY*m_numTilesX+tileX];
+	}
+
+	int		getNumResidentTiles() const
+	{
+		return m_numResidentTiles;
+	}
+
+	void	setTileSource(btHeightfieldTileSource* tileSource)
+	{
+		m_tileSource = tileSource;
+	}
+
+	///pageTiles releases the least recently used tiles above this limit, 0 keeps all tiles
+	void	setMaxResidentTiles(int maxResidentTiles)
+	{
+		m_maxResidentTiles = maxResidentTiles;
+	}
+
+	///pageTiles loads the tiles that overlap the aabb (in local coordinates, like processAllTriangles) from the tile source, and marks them as used.
+	///Call it for the aabbs of the objects near the terrain before stepping the simulation, then call releaseUnusedTiles once.
+	void	pageTiles(const btVector3& aabbMin,const btVector3& aabbMax);
+
+	///releaseUnusedTiles releases the least recently used tiles until at most maxResidentTiles are resident, tiles used since the last call are kept
+	void	releaseUnusedTiles();
+
+	virtual const char*	getName()const {return "TILEDHEIGHTFIELD";}
+};
+
+///btHeightfieldTileFile stores all tiles of a btTiledHeightfieldTerrainShape in a file, and loads single tiles from it on demand.
+///The file uses the native byte order, files written on a platform with a different byte order are rejected.
+class	btHeightfieldTileFile : public btHeightfieldTileSource
+{
+	FILE*	m_file;
+	int		m_heightStickWidth;
+	int		m_heightStickLength;
+	int		m_tileSize;
+	float	m_minHeight;
+	float	m_maxHeight;
+	int		m_numTilesX;
+	int		m_numTilesY;
+	unsigned int	m_dataOffset;
+	btAlignedObjectArray<float>	m_tileOffsetScale;
+
+public:
+
+	btHeightfieldTileFile();
+
+	virtual ~btHeightfieldTileFile();
+
+	///writeFile writes all tiles, they need to be resident
+	static bool	writeFile(const btTiledHeightfieldTerrainShape* shape,const char* fileName);
+
+	bool	open(const char* fileName);
+
+	void	close();
+
+	///createShape creates an empty shape with the dimensions of the file, and uses this file as its tile source. The file needs to stay open while the shape pages tiles.
+	btTiledHeightfieldTerrainShape*	createShape(int upAxis,bool flipQuadEdges);
+
+	virtual bool	loadTile(int tileX,int tileY,unsigned short* samples,btScalar& offset,btScalar& scale);
+};
+
+#endif //TILED_HEIGHTFIELD_TERRAIN_SHAPE_H
@@ -25,7 +25,7 @@ subject to the following restrictions:
 ///Instead of the number of indices, we pass the number of triangles.
 ATTRIBUTE_ALIGNED16( struct)	btIndexedMesh
 {
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
    int                     m_numTriangles;
    const unsigned char *   m_triangleIndexBase;
@@ -74,7 +74,7 @@ protected:
 
 public:
 
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
 	btTriangleIndexVertexArray() : m_hasAabb(0)
 	{
@@ -53,7 +53,7 @@ protected:
     MaterialArray       m_materials;
 		
 public:
-	BT_DECLARE_ALIGNED_ALLOCATOR();
+	BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(BT_ALLOC_TAG_SHAPES);
 
     btTriangleIndexVertexMaterialArray()
 	{
@@ -51,7 +51,7 @@ struct	btTriangleInfo
 
 };
 
-typedef btHashMap<btHashInt,btTriangleInfo> btInternalTriangleInfoMap;
+typedef btOpenHashMap<btHashInt,btTriangleInfo> btInternalTriangleInfoMap;
 
 
 ///The btTriangleInfoMap stores edge angle information for some triangles. You can compute this information yourself or using btGenerateInternalEdgeInfo.
@@ -63,6 +63,9 @@ struct	btTriangleInfoMap : public btInternalTriangleInfoMap
 	btScalar	m_edgeDistanceThreshold; ///used to determine edge contacts: if the closest distance between a contact point and an edge is smaller than this distance threshold it is considered to "hit the edge"
 	btScalar	m_zeroAreaThreshold; ///used to determine if a triangle is degenerate (length squared of cross product of 2 triangle edges < threshold)
 	
+	///the btOpenHashMap has no chains, serialize fills these with the chained btHashMap table of the keys, so the file format stays the same
+	mutable btAlignedObjectArray<int>	m_serializedHashTable;
+	mutable btAlignedObjectArray<int>	m_serializedNext;
 	
 	btTriangleInfoMap()
 	{
@@ -126,9 +129,26 @@ SIMD_FORCE_INLINE	const char*	btTriangleInfoMap::serialize(void* dataBuffer, btS
 	tmapData->m_edgeDistanceThreshold = m_edgeDistanceThreshold;
 	tmapData->m_zeroAreaThreshold = m_zeroAreaThreshold;
 	
-	tmapData->m_hashTableSize = m_hashTable.size();
+	int numKeys = m_keyArray.size();
+	int tableSize = numKeys ? 1 : 0;
+	while (tableSize < numKeys)
+	{
+		tableSize *= 2;
+	}
+	m_serializedHashTable.resize(0);
+	m_serializedHashTable.resize(tableSize,BT_HASH_NULL);
+	m_serializedNext.resize(0);
+	m_serializedNext.resize(tableSize,BT_HASH_NULL);
+	for (int i=0;i<numKeys;i++)
+	{
+		int hash = int(m_keyArray[i].getHash() & unsigned(tableSize-1));
+		m_serializedNext[i] = m_serializedHashTable[hash];
+		m_serializedHashTable[hash] = i;
+	}
+
+	tmapData->m_hashTableSize = m_serializedHashTable.size();
 
-	tmapData->m_hashTablePtr = tmapData->m_hashTableSize ? (int*)serializer->getUniquePointer((void*)&m_hashTable[0]) : 0;
+	tmapData->m_hashTablePtr = tmapData->m_hashTableSize ? (int*)serializer->getUniquePointer((void*)&m_serializedHashTable[0]) : 0;
 	if (tmapData->m_hashTablePtr)
 	{ 
 		//serialize an int buffer
@@ -138,14 +158,14 @@ SIMD_FORCE_INLINE	const char*	btTriangleInfoMap::serialize(void* dataBuffer, btS
 		int* memPtr = (int*)chunk->m_oldPtr;
 		for (int i=0;i<numElem;i++,memPtr++)
 		{
-			*memPtr = m_hashTable[i];
+			*memPtr = m_serializedHashTable[i];
 		}
-		serializer->finalizeChunk(chunk,"int",BT_ARRAY_CODE,(void*)&m_hashTable[0]);
+		serializer->finalizeChunk(chunk,"int",BT_ARRAY_CODE,(void*)&m_serializedHashTable[0]);
 
 	}
 
-	tmapData->m_nextSize = m_next.size();
-	tmapData->m_nextPtr = tmapData->m_nextSize? (int*)serializer->getUniquePointer((void*)&m_next[0]): 0;
+	tmapData->m_nextSize = m_serializedNext.size();
+	tmapData->m_nextPtr = tmapData->m_nextSize? (int*)serializer->getUniquePointer((void*)&m_serializedNext[0]): 0;
 	if (tmapData->m_nextPtr)
 	{
 		int sz = sizeof(int);
@@ -154,9 +174,9 @@ SIMD_FORCE_INLINE	const char*	btTriangleInfoMap::serialize(void* dataBuffer, btS
 		int* memPtr = (int*)chunk->m_oldPtr;
 		for (int i=0;i<numElem;i++,memPtr++)
 		{
-			*memPtr = m_next[i];
+			*memPtr = m_serializedNext[i];
 		}
-		serializer->finalizeChunk(chunk,"int",BT_ARRAY_CODE,(void*)&m_next[0]);
+		serializer->finalizeChunk(chunk,"int",BT_ARRAY_CODE,(void*)&m_serializedNext[0]);
 	}
 	
 	tmapData->m_numValues = m_valueArray.size();
@@ -207,30 +227,17 @@ SIMD_FORCE_INLINE	void	btTriangleInfoMap::deSerialize(btTriangleInfoMapData& tma
 	m_equalVertexThreshold = tmapData.m_equalVertexThreshold;
 	m_edgeDistanceThreshold = tmapData.m_edgeDistanceThreshold;
 	m_zeroAreaThreshold = tmapData.m_zeroAreaThreshold;
-	m_hashTable.resize(tmapData.m_hashTableSize);
+	//the hash table is rebuilt from the keys, the stored table was made for the capacity of the arrays when they were serialized
+	clear();
 	int i =0;
-	for (i=0;i<tmapData.m_hashTableSize;i++)
-	{
-		m_hashTable[i] = tmapData.m_hashTablePtr[i];
-	}
-	m_next.resize(tmapData.m_nextSize);
-	for (i=0;i<tmapData.m_nextSize;i++)
-	{
-		m_next[i] = tmapData.m_nextPtr[i];
-	}
-	m_valueArray.resize(tmapData.m_numValues);
-	for (i=0;i<tmapData.m_numValues;i++)
-	{
-		m_valueArray[i].m_edgeV0V1Angle = tmapData.m_valueArrayPtr[i].m_edgeV0V1Angle;
-		m_valueArray[i].m_edgeV1V2Angle = tmapData.m_valueArrayPtr[i].m_edgeV1V2Angle;
-		m_valueArray[i].m_edgeV2V0Angle = tmapData.m_valueArrayPtr[i].m_edgeV2V0Angle;
-		m_valueArray[i].m_flags = tmapData.m_valueArrayPtr[i].m_flags;
-	}
-	
-	m_keyArray.resize(tmapData.m_numKeys,btHashInt(0));
-	for (i=0;i<tmapData.m_numKeys;i++)
+	for (i=0;i<tmapData.m_numValues && i<tmapData.m_numKeys;i++)
 	{
-		m_keyArray[i].setUid1(tmapData.m_keyArrayPtr[i]);
+		btTriangleInfo info;
+		info.m_edgeV0V1Angle = tmapData.m_valueArrayPtr[i].m_edgeV0V1Angle;
+		info.m_edgeV1V2Angle = tmapData.m_valueArrayPtr[i].m_edgeV1V2Angle;
+		info.m_edgeV2V0Angle = tmapData.m_valueArrayPtr[i].m_edgeV2V0Angle;
+		info.m_flags = tmapData.m_valueArrayPtr[i].m_flags;
+		insert(btHashInt(tmapData.m_keyArrayPtr[i]),info);
 	}
 }
 
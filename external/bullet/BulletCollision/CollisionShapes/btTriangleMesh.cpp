@@ -16,11 +16,15 @@ subject to the following restrictions:
 
 #include "btTriangleMesh.h"
 
+#include <string.h>
+
 
 
 btTriangleMesh::btTriangleMesh (bool use32bitIndices,bool use4componentVertices)
 :m_use32bitIndices(use32bitIndices),
 m_use4componentVertices(use4componentVertices),
+m_weldingHashThreshold(btScalar(-1.)),
+m_weldingHashCellSize(btScalar(0.)),
 m_weldingThreshold(0.0)
 {
 	btIndexedMesh meshIndex;
@@ -76,50 +80,179 @@ void	btTriangleMesh::addIndex(int index)
 }
 
 
-int	btTriangleMesh::findOrAddVertex(const btVector3& vertex, bool removeDuplicateVertices)
+void	btTriangleMesh::preallocateVertices(int numverts)
 {
-	//return index of new/existing vertex
-	///@todo: could use acceleration structure for this
 	if (m_use4componentVertices)
 	{
-		if (removeDuplicateVertices)
-			{
-			for (int i=0;i< m_4componentVertices.size();i++)
-			{
-				if ((m_4componentVertices[i]-vertex).length2() <= m_weldingThreshold)
-				{
-					return i;
-				}
-			}
-		}
-		m_indexedMeshes[0].m_numVertices++;
-		m_4componentVertices.push_back(vertex);
-		m_indexedMeshes[0].m_vertexBase = (unsigned char*)&m_4componentVertices[0];
+		m_4componentVertices.reserve(numverts);
+		if (m_4componentVertices.size())
+			m_indexedMeshes[0].m_vertexBase = (unsigned char*)&m_4componentVertices[0];
+	} else
+	{
+		m_3componentVertices.reserve(numverts*3);
+		if (m_3componentVertices.size())
+			m_indexedMeshes[0].m_vertexBase = (unsigned char*)&m_3componentVertices[0];
+	}
+	if (m_weldingHashTable.size())
+	{
+		m_weldingHashNext.reserve(numverts);
+	}
+}
 
-		return m_4componentVertices.size()-1;
-		
+void	btTriangleMesh::preallocateIndices(int numindices)
+{
+	if (m_use32bitIndices)
+	{
+		m_32bitIndices.reserve(numindices);
+		if (m_32bitIndices.size())
+			m_indexedMeshes[0].m_triangleIndexBase = (unsigned char*) &m_32bitIndices[0];
 	} else
 	{
-		
-		if (removeDuplicateVertices)
+		m_16bitIndices.reserve(numindices);
+		if (m_16bitIndices.size())
+			m_indexedMeshes[0].m_triangleIndexBase = (unsigned char*) &m_16bitIndices[0];
+	}
+}
+
+btVector3	btTriangleMesh::getVertex(int index) const
+{
+	if (m_use4componentVertices)
+	{
+		return m_4componentVertices[index];
+	}
+	return btVector3(m_3componentVertices[index*3],m_3componentVertices[index*3+1],m_3componentVertices[index*3+2]);
+}
+
+unsigned int	btTriangleMesh::getWeldingHash(int cellX,int cellY,int cellZ) const
+{
+	//the multiplications are done unsigned, a signed overflow would be undefined
+	unsigned int hash = ((unsigned int)cellX*73856093u) ^ ((unsigned int)cellY*19349663u) ^ ((unsigned int)cellZ*83492791u);
+	//mix the high bits down, the low bits of float coordinates are often zero
+	hash ^= hash >> 16;
+	hash *= 0x85ebca6bu;
+	hash ^= hash >> 13;
+	return hash & (m_weldingHashTable.size()-1);
+}
+
+///getWeldingCell returns the cell of the vertex, and in side the direction of the nearest neighbour cell along each axis
+void	btTriangleMesh::getWeldingCell(const btVector3& vertex,int* cell,int* side) const
+{
+	for (int i=0;i<3;i++)
+	{
+		if (m_weldingHashCellSize > btScalar(0.))
+		{
+			btScalar c = vertex[i]/m_weldingHashCellSize;
+			btScalar cellFloor = btScalar(floor(c));
+			//far away vertices share the outer cells, which is still correct
+			cell[i] = int(btClamped(cellFloor,btScalar(-0x3fffffff),btScalar(0x3fffffff)));
+			side[i] = (c-cellFloor < btScalar(0.5)) ? -1 : 1;
+		} else
+		{
+			//exact welding hashes the coordinate bits, adding zero turns -0 into +0
+			float f = float(vertex[i])+0.f;
+			memcpy(&cell[i],&f,sizeof(int));
+			side[i] = 0;
+		}
+	}
+}
+
+void	btTriangleMesh::buildWeldingHash()
+{
+	int numVertices = m_indexedMeshes[0].m_numVertices;
+	int tableSize = 1024;
+	while (tableSize < numVertices*2)
+		tableSize *= 2;
+
+	m_weldingHashThreshold = m_weldingThreshold;
+	//the threshold is compared against the squared distance. With cells twice the welding distance, a vertex can only be welded to vertices in its own cell
+	//and the nearest neighbour cell along each axis, 8 cells in total. Slightly larger cells keep rounding from missing a neighbour.
+	m_weldingHashCellSize = m_weldingThreshold > btScalar(0.) ? btSqrt(m_weldingThreshold)*btScalar(2.002) : btScalar(0.);
+
+	m_weldingHashTable.resize(0);
+	m_weldingHashTable.resize(tableSize,-1);
+	m_weldingHashNext.resize(0);
+	m_weldingHashNext.reserve(tableSize/2);
+	for (int i=0;i<numVertices;i++)
+	{
+		addWeldingHashVertex(i);
+	}
+}
+
+void	btTriangleMesh::addWeldingHashVertex(int index)
+{
+	btAssert(index == m_weldingHashNext.size());
+	if (index*2 > m_weldingHashTable.size())
+	{
+		//buildWeldingHash grows the table and adds all vertices including this one
+		buildWeldingHash();
+		return;
+	}
+	int cell[3],side[3];
+	getWeldingCell(getVertex(index),cell,side);
+	unsigned int hash = getWeldingHash(cell[0],cell[1],cell[2]);
+	m_weldingHashNext.push_back(m_weldingHashTable[hash]);
+	m_weldingHashTable[hash] = index;
+}
+
+///findWeldingVertex returns the lowest vertex index within the welding distance, the same vertex a linear search would find, or -1
+int		btTriangleMesh::findWeldingVertex(const btVector3& vertex) const
+{
+	int cell[3],side[3];
+	getWeldingCell(vertex,cell,side);
+
+	//the stored 3 component vertices are floats, compare against the rounded vertex like the linear search did
+	int bestIndex = -1;
+	int numCells = (m_weldingHashCellSize > btScalar(0.)) ? 8 : 1;
+	for (int c=0;c<numCells;c++)
+	{
+		unsigned int hash = getWeldingHash(cell[0]+((c&1)?side[0]:0),cell[1]+((c&2)?side[1]:0),cell[2]+((c&4)?side[2]:0));
+		for (int i=m_weldingHashTable[hash];i>=0;i=m_weldingHashNext[i])
 		{
-			for (int i=0;i< m_3componentVertices.size();i+=3)
+			if ((bestIndex < 0 || i < bestIndex) && (getVertex(i)-vertex).length2() <= m_weldingThreshold)
 			{
-				btVector3 vtx(m_3componentVertices[i],m_3componentVertices[i+1],m_3componentVertices[i+2]);
-				if ((vtx-vertex).length2() <= m_weldingThreshold)
-				{
-					return i/3;
-				}
+				bestIndex = i;
 			}
+		}
 	}
+	return bestIndex;
+}
+
+int	btTriangleMesh::findOrAddVertex(const btVector3& vertex, bool removeDuplicateVertices)
+{
+	//return index of new/existing vertex
+	if (removeDuplicateVertices)
+	{
+		if (m_weldingHashThreshold != m_weldingThreshold)
+		{
+			buildWeldingHash();
+		}
+		int index = findWeldingVertex(vertex);
+		if (index >= 0)
+			return index;
+	}
+
+	int index;
+	if (m_use4componentVertices)
+	{
+		m_4componentVertices.push_back(vertex);
+		m_indexedMeshes[0].m_vertexBase = (unsigned char*)&m_4componentVertices[0];
+		index = m_4componentVertices.size()-1;
+	} else
+	{
 		m_3componentVertices.push_back((float)vertex.getX());
 		m_3componentVertices.push_back((float)vertex.getY());
 		m_3componentVertices.push_back((float)vertex.getZ());
-		m_indexedMeshes[0].m_numVertices++;
 		m_indexedMeshes[0].m_vertexBase = (unsigned char*)&m_3componentVertices[0];
-		return (m_3componentVertices.size()/3)-1;
+		index = (m_3componentVertices.size()/3)-1;
 	}
+	m_indexedMeshes[0].m_numVertices++;
 
+	//once welding was used, every vertex goes into the hash so later welded triangles can find it
+	if (m_weldingHashTable.size())
+	{
+		addWeldingHashVertex(index);
+	}
+	return index;
 }
 		
 void	btTriangleMesh::addTriangle(const btVector3& vertex0,const btVector3& vertex1,const btVector3& vertex2,bool removeDuplicateVertices)
@@ -130,6 +263,22 @@ void	btTriangleMesh::addTriangle(const btVector3& vertex0,const btVector3& verte
 	addIndex(findOrAddVertex(vertex2,removeDuplicateVertices));
 }
 
+void	btTriangleMesh::addTriangles(const btVector3* vertices,int numTriangles,bool removeDuplicateVertices)
+{
+	int numIndices = getNumTriangles()*3 + numTriangles*3;
+	preallocateIndices(numIndices);
+	//without welding every triangle adds 3 vertices
+	if (!removeDuplicateVertices)
+	{
+		preallocateVertices(m_indexedMeshes[0].m_numVertices + numTriangles*3);
+	}
+
+	for (int i=0;i<numTriangles;i++)
+	{
+		addTriangle(vertices[i*3],vertices[i*3+1],vertices[i*3+2],removeDuplicateVertices);
+	}
+}
+
 int btTriangleMesh::getNumTriangles() const
 {
 	if (m_use32bitIndices)
@@ -33,9 +33,23 @@ class btTriangleMesh : public btTriangleIndexVertexArray
 	btAlignedObjectArray<unsigned short int>		m_16bitIndices;
 	bool	m_use32bitIndices;
 	bool	m_use4componentVertices;
+
+	///spatial hash for vertex welding, it is built on the first welded vertex and then contains all vertices
+	btAlignedObjectArray<int>	m_weldingHashTable;
+	btAlignedObjectArray<int>	m_weldingHashNext;
+	btScalar	m_weldingHashThreshold;
+	btScalar	m_weldingHashCellSize;
+
+	btVector3	getVertex(int index) const;
+	unsigned int	getWeldingHash(int cellX,int cellY,int cellZ) const;
+	void	getWeldingCell(const btVector3& vertex,int* cell,int* side) const;
+	void	buildWeldingHash();
+	void	addWeldingHashVertex(int index);
+	int		findWeldingVertex(const btVector3& vertex) const;
 	
 
 	public:
+		///vertices closer than the square root of m_weldingThreshold are welded, 0 only welds identical vertices
 		btScalar	m_weldingThreshold;
 
 		btTriangleMesh (bool use32bitIndices=true,bool use4componentVertices=true);
@@ -51,12 +65,16 @@ class btTriangleMesh : public btTriangleIndexVertexArray
 		}
 		///By default addTriangle won't search for duplicate vertices, because the search is very slow for large triangle meshes.
 		///In general it is better to directly use btTriangleIndexVertexArray instead.
+		///Duplicate vertices are found using a spatial hash with cells the size of the welding distance, so welding takes linear time.
 		void	addTriangle(const btVector3& vertex0,const btVector3& vertex1,const btVector3& vertex2, bool removeDuplicateVertices=false);
+
+		///addTriangles adds numTriangles triangles from an array of 3*numTriangles vertices, the storage is allocated once up front
+		void	addTriangles(const btVector3* vertices,int numTriangles,bool removeDuplicateVertices=false);
 		
 		int getNumTriangles() const;
 
-		virtual void	preallocateVertices(int numverts){(void) numverts;}
-		virtual void	preallocateIndices(int numindices){(void) numindices;}
+		virtual void	preallocateVertices(int numverts);
+		virtual void	preallocateIndices(int numindices);
 
 		///findOrAddVertex is an internal method, use addTriangle instead
 		int		findOrAddVertex(const btVector3& vertex, bool removeDuplicateVertices);
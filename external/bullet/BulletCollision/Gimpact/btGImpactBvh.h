@@ -26,6 +26,7 @@ subject to the following restrictions:
 
 
 #include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btFrameArena.h"
 
 #include "btBoxCollision.h"
 #include "btTriangleShapeEx.h"
@@ -58,18 +59,51 @@ struct GIM_PAIR
 //! A pairset array
 class btPairSet: public btAlignedObjectArray<GIM_PAIR>
 {
+	btFrameArena* m_arena;
+
+	void growInArena()
+	{
+		int newCapacity = capacity() ? capacity()*2 : 64;
+		GIM_PAIR* pairs = m_arena->allocateArray<GIM_PAIR>(newCapacity);
+		int count = size();
+		for (int i=0;i<count;i++)
+		{
+			new (&pairs[i]) GIM_PAIR((*this)[i]);
+		}
+		initializeFromBuffer(pairs,count,newCapacity);
+	}
+
 public:
-	btPairSet()
+	btPairSet():m_arena(0)
 	{
 		reserve(32);
 	}
+
+	//! The pairs are stored in the arena, the pair set needs to go out of scope before the arena is rewound
+	btPairSet(btFrameArena* arena):m_arena(arena)
+	{
+	}
+
+	btFrameArena* getArena() const
+	{
+		return m_arena;
+	}
+
 	inline void push_pair(int index1,int index2)
 	{
+		if (m_arena && size()==capacity())
+		{
+			growInArena();
+		}
 		push_back(GIM_PAIR(index1,index2));
 	}
 
 	inline void push_pair_inv(int index1,int index2)
 	{
+		if (m_arena && size()==capacity())
+		{
+			growInArena();
+		}
 		push_back(GIM_PAIR(index2,index1));
 	}
 };
@@ -30,6 +30,14 @@ Concave-Concave Collision
 #include "btGImpactCollisionAlgorithm.h"
 #include "btContactProcessing.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btTaskPool.h"
+
+///triangle pairs are tested in batches of 4, stored as structure of arrays so the plane tests compile to SIMD code
+#define BT_GIMPACT_TRIANGLE_BATCH 4
+///fewer triangle pairs are tested on the calling thread only
+#define BT_GIMPACT_MIN_THREADED_TRIANGLE_PAIRS 1024
+#define BT_GIMPACT_TRIANGLE_PAIRS_PER_TASK 256
+#define BT_GIMPACT_TRIANGLE_TASKS_PER_THREAD 4
 
 
 //! Class for accessing the plane equation
@@ -398,76 +406,216 @@ void btGImpactCollisionAlgorithm::collide_gjk_triangles(btCollisionObject * body
 	shape1->unlockChildShapes();
 }
 
-void btGImpactCollisionAlgorithm::collide_sat_triangles(btCollisionObject * body0,
-					  btCollisionObject * body1,
-					  btGImpactMeshShapePart * shape0,
-					  btGImpactMeshShapePart * shape1,
-					  const int * pairs, int pair_count)
+///btOverlapTestConservativeBatch runs btPrimitiveTriangle::overlap_test_conservative on up to 4 triangle pairs at once, and returns a bit per overlapping pair
+static int	btOverlapTestConservativeBatch(const btPrimitiveTriangle* tri0,const btPrimitiveTriangle* tri1,int count)
 {
-	btTransform orgtrans0 = body0->getWorldTransform();
-	btTransform orgtrans1 = body1->getWorldTransform();
+	btScalar plane[2][4][BT_GIMPACT_TRIANGLE_BATCH];
+	btScalar vertex[2][3][3][BT_GIMPACT_TRIANGLE_BATCH];
+	btScalar totalMargin[BT_GIMPACT_TRIANGLE_BATCH];
+	int lane,i,j;
+	for (lane=0;lane<BT_GIMPACT_TRIANGLE_BATCH;lane++)
+	{
+		//unused lanes repeat the first pair
+		const btPrimitiveTriangle& t0 = tri0[lane<count ? lane : 0];
+		const btPrimitiveTriangle& t1 = tri1[lane<count ? lane : 0];
+		for (j=0;j<4;j++)
+		{
+			plane[0][j][lane] = t0.m_plane[j];
+			plane[1][j][lane] = t1.m_plane[j];
+		}
+		for (i=0;i<3;i++)
+		{
+			for (j=0;j<3;j++)
+			{
+				vertex[0][i][j][lane] = t0.m_vertices[i][j];
+				vertex[1][i][j][lane] = t1.m_vertices[i][j];
+			}
+		}
+		totalMargin[lane] = t0.m_margin + t1.m_margin;
+	}
 
-	btPrimitiveTriangle ptri0;
-	btPrimitiveTriangle ptri1;
-	GIM_TRIANGLE_CONTACT contact_data;
+	int separated[BT_GIMPACT_TRIANGLE_BATCH];
+	for (lane=0;lane<BT_GIMPACT_TRIANGLE_BATCH;lane++)
+	{
+		separated[lane] = 0;
+	}
+	//the vertices of each triangle against the plane of the other one
+	for (int side=0;side<2;side++)
+	{
+		const btScalar (*p)[BT_GIMPACT_TRIANGLE_BATCH] = plane[side];
+		int allAbove[BT_GIMPACT_TRIANGLE_BATCH];
+		for (lane=0;lane<BT_GIMPACT_TRIANGLE_BATCH;lane++)
+		{
+			allAbove[lane] = 1;
+		}
+		for (i=0;i<3;i++)
+		{
+			const btScalar (*v)[BT_GIMPACT_TRIANGLE_BATCH] = vertex[1-side][i];
+			for (lane=0;lane<BT_GIMPACT_TRIANGLE_BATCH;lane++)
+			{
+				btScalar dis = (v[0][lane]*p[0][lane] + v[1][lane]*p[1][lane] + v[2][lane]*p[2][lane]) - p[3][lane] - totalMargin[lane];
+				allAbove[lane] &= (dis > btScalar(0.)) ? 1 : 0;
+			}
+		}
+		for (lane=0;lane<BT_GIMPACT_TRIANGLE_BATCH;lane++)
+		{
+			separated[lane] |= allAbove[lane];
+		}
+	}
 
-	shape0->lockChildShapes();
-	shape1->lockChildShapes();
+	int mask = 0;
+	for (lane=0;lane<count;lane++)
+	{
+		if (!separated[lane])
+			mask |= 1<<lane;
+	}
+	return mask;
+}
 
-	const int * pair_pointer = pairs;
+struct btGImpactTriangleContact
+{
+	int	m_pairIndex;
+	GIM_TRIANGLE_CONTACT	m_contact;
+};
 
-	while(pair_count--)
+///btCollideSatTriangleRange finds the contacts of the triangle pairs [firstPair,endPair) and returns the number of contacts, the shapes need to be locked.
+///A pair has at most one contact, so contacts needs room for endPair-firstPair entries.
+static int	btCollideSatTriangleRange(btGImpactMeshShapePart * shape0,btGImpactMeshShapePart * shape1,
+										const btTransform& trans0,const btTransform& trans1,
+										const int * pairs,int firstPair,int endPair,
+										btGImpactTriangleContact* contacts)
+{
+	btPrimitiveTriangle ptri0[BT_GIMPACT_TRIANGLE_BATCH];
+	btPrimitiveTriangle ptri1[BT_GIMPACT_TRIANGLE_BATCH];
+	int numContacts = 0;
+
+	for (int batchStart=firstPair;batchStart<endPair;batchStart+=BT_GIMPACT_TRIANGLE_BATCH)
 	{
+		int count = btMin(BT_GIMPACT_TRIANGLE_BATCH,endPair-batchStart);
+		int k;
+		for (k=0;k<count;k++)
+		{
+			shape0->getPrimitiveTriangle(pairs[(batchStart+k)*2],ptri0[k]);
+			shape1->getPrimitiveTriangle(pairs[(batchStart+k)*2+1],ptri1[k]);
 
-		m_triface0 = *(pair_pointer);
-		m_triface1 = *(pair_pointer+1);
-		pair_pointer+=2;
+			ptri0[k].applyTransform(trans0);
+			ptri1[k].applyTransform(trans1);
 
+			//build planes
+			ptri0[k].buildTriPlane();
+			ptri1[k].buildTriPlane();
+		}
 
-		shape0->getPrimitiveTriangle(m_triface0,ptri0);
-		shape1->getPrimitiveTriangle(m_triface1,ptri1);
+		// test conservative
+		int overlapMask = btOverlapTestConservativeBatch(ptri0,ptri1,count);
 
-		#ifdef TRI_COLLISION_PROFILING
-		bt_begin_gim02_tri_time();
-		#endif
+		for (k=0;k<count;k++)
+		{
+			if ((overlapMask & (1<<k)) && ptri0[k].find_triangle_collision_clip_method(ptri1[k],contacts[numContacts].m_contact))
+			{
+				contacts[numContacts].m_pairIndex = batchStart+k;
+				numContacts++;
+			}
+		}
+	}
+	return numContacts;
+}
 
-		ptri0.applyTransform(orgtrans0);
-		ptri1.applyTransform(orgtrans1);
+struct btGImpactTriangleContext
+{
+	btGImpactMeshShapePart*	m_shape0;
+	btGImpactMeshShapePart*	m_shape1;
+	const btTransform*	m_trans0;
+	const btTransform*	m_trans1;
+	const int*	m_pairs;
+	int			m_pairCount;
+	///the tasks of one round start at m_firstTask, task t of the round writes BT_GIMPACT_TRIANGLE_PAIRS_PER_TASK contacts at m_taskContacts[t*BT_GIMPACT_TRIANGLE_PAIRS_PER_TASK]
+	int			m_firstTask;
+	btGImpactTriangleContact*	m_taskContacts;
+	int*		m_taskContactCounts;
+};
 
+static void	btGImpactTriangleTask(void* userPtr, int taskIndex)
+{
+	BT_PROFILE("gimpactTriangleTask");
+	BT_ALLOC_TAG(BT_ALLOC_TAG_MANIFOLDS);
+	const btGImpactTriangleContext& context = *(const btGImpactTriangleContext*)userPtr;
+	int firstPair = (context.m_firstTask+taskIndex)*BT_GIMPACT_TRIANGLE_PAIRS_PER_TASK;
+	int endPair = btMin(firstPair+BT_GIMPACT_TRIANGLE_PAIRS_PER_TASK,context.m_pairCount);
+	context.m_taskContactCounts[taskIndex] = btCollideSatTriangleRange(context.m_shape0,context.m_shape1,*context.m_trans0,*context.m_trans1,
+		context.m_pairs,firstPair,endPair,&context.m_taskContacts[taskIndex*BT_GIMPACT_TRIANGLE_PAIRS_PER_TASK]);
+}
 
-		//build planes
-		ptri0.buildTriPlane();
-		ptri1.buildTriPlane();
-		// test conservative
+void btGImpactCollisionAlgorithm::collide_sat_triangles(btCollisionObject * body0,
+					  btCollisionObject * body1,
+					  btGImpactMeshShapePart * shape0,
+					  btGImpactMeshShapePart * shape1,
+					  const int * pairs, int pair_count)
+{
+	btTransform orgtrans0 = body0->getWorldTransform();
+	btTransform orgtrans1 = body1->getWorldTransform();
 
+	shape0->lockChildShapes();
+	shape1->lockChildShapes();
 
+	#ifdef TRI_COLLISION_PROFILING
+	bt_begin_gim02_tri_time();
+	#endif
+
+	int numThreads = (pair_count >= BT_GIMPACT_MIN_THREADED_TRIANGLE_PAIRS) ? btGetTaskThreadCount() : 1;
+
+	//the contacts are found first, possibly on several threads, then added to the manifold in pair order
+	int numTasks = (pair_count+BT_GIMPACT_TRIANGLE_PAIRS_PER_TASK-1)/BT_GIMPACT_TRIANGLE_PAIRS_PER_TASK;
+	//the contact buffers are taken from the frame arena of this thread, rounds are limited to bound their size
+	int tasksPerRound = (numThreads > 1) ? btMin(numTasks,numThreads*BT_GIMPACT_TRIANGLE_TASKS_PER_THREAD) : 1;
+	btFrameArenaScope arenaScope(btFrameArena::getThreadArena());
+	btGImpactTriangleContact* taskContacts = arenaScope.getArena()->allocateArray<btGImpactTriangleContact>(tasksPerRound*BT_GIMPACT_TRIANGLE_PAIRS_PER_TASK);
+	int* taskContactCounts = arenaScope.getArena()->allocateArray<int>(tasksPerRound);
+
+	btGImpactTriangleContext context;
+	context.m_shape0 = shape0;
+	context.m_shape1 = shape1;
+	context.m_trans0 = &orgtrans0;
+	context.m_trans1 = &orgtrans1;
+	context.m_pairs = pairs;
+	context.m_pairCount = pair_count;
+	context.m_taskContacts = taskContacts;
+	context.m_taskContactCounts = taskContactCounts;
+
+	for (int firstTask=0;firstTask<numTasks;firstTask+=tasksPerRound)
+	{
+		int i,t;
+		context.m_firstTask = firstTask;
+		int numRoundTasks = btMin(tasksPerRound,numTasks-firstTask);
+		btParallelFor(numRoundTasks,btGImpactTriangleTask,&context,numThreads);
 
-		if(ptri0.overlap_test_conservative(ptri1))
+		for (t=0;t<numRoundTasks;t++)
 		{
-			if(ptri0.find_triangle_collision_clip_method(ptri1,contact_data))
+			for (i=0;i<taskContactCounts[t];i++)
 			{
+				const btGImpactTriangleContact& triangleContact = taskContacts[t*BT_GIMPACT_TRIANGLE_PAIRS_PER_TASK+i];
+				m_triface0 = pairs[triangleContact.m_pairIndex*2];
+				m_triface1 = pairs[triangleContact.m_pairIndex*2+1];
 
-				int j = contact_data.m_point_count;
+				int j = triangleContact.m_contact.m_point_count;
 				while(j--)
 				{
 
 					addContactPoint(body0, body1,
-								contact_data.m_points[j],
-								contact_data.m_separating_normal,
-								-contact_data.m_penetration_depth);
+								triangleContact.m_contact.m_points[j],
+								triangleContact.m_contact.m_separating_normal,
+								-triangleContact.m_contact.m_penetration_depth);
 				}
 			}
 		}
-
-		#ifdef TRI_COLLISION_PROFILING
-		bt_end_gim02_tri_time();
-		#endif
-
 	}
 
+	#ifdef TRI_COLLISION_PROFILING
+	bt_end_gim02_tri_time();
+	#endif
+
 	shape0->unlockChildShapes();
 	shape1->unlockChildShapes();
-
 }
 
 
@@ -510,7 +658,9 @@ void btGImpactCollisionAlgorithm::gimpact_vs_gimpact(
 	btTransform orgtrans0 = body0->getWorldTransform();
 	btTransform orgtrans1 = body1->getWorldTransform();
 
-	btPairSet pairset;
+	//the pairs live in the frame arena of this thread until the function returns
+	btFrameArenaScope arenaScope(btFrameArena::getThreadArena());
+	btPairSet pairset(arenaScope.getArena());
 
 	gimpact_vs_gimpact_find_pairs(orgtrans0,orgtrans1,shape0,shape1,pairset);
 
@@ -637,7 +787,11 @@ void btGImpactCollisionAlgorithm::gimpact_vs_shape(btCollisionObject * body0,
 
 	btTransform orgtrans1 = body1->getWorldTransform();
 
+	//a primitive is found at most once, so the arena buffer never needs to grow
+	btFrameArenaScope arenaScope(btFrameArena::getThreadArena());
 	btAlignedObjectArray<int> collided_results;
+	int maxResults = shape0->getNumChildShapes();
+	collided_results.initializeFromBuffer(arenaScope.getArena()->allocateArray<int>(maxResults),0,maxResults);
 
 	gimpact_vs_shape_find_pairs(orgtrans0,orgtrans1,shape0,shape1,collided_results);
 
@@ -23,6 +23,10 @@ subject to the following restrictions:
 
 #include "btGImpactQuantizedBvh.h"
 #include "LinearMath/btQuickprof.h"
+#include "LinearMath/btTaskPool.h"
+
+///tree pairs with fewer nodes are traversed on the calling thread only
+#define BT_GIMPACT_MIN_THREADED_NODES 4096
 
 #ifdef TRI_COLLISION_PROFILING
 btClock g_q_tree_clock;
@@ -501,6 +505,127 @@ static void _find_quantized_collision_pairs_recursive(
 }
 
 
+///btGImpactNodePairTask is a pair of subtrees, the tasks of a traversal are kept in the order of the recursive traversal
+struct btGImpactNodePairTask
+{
+	int		m_node0;
+	int		m_node1;
+	///the pair already passed the overlap test and both nodes are leaves
+	bool	m_isLeafPair;
+	bool	m_completePrimitiveTests;
+};
+
+///the pairs of a task are stored in the frame arena of the thread that runs it, from m_marker on
+struct btGImpactFindTaskPairs
+{
+	btFrameArenaMarker	m_marker;
+	btPairSet	m_pairs;
+
+	btGImpactFindTaskPairs(btFrameArena* arena)
+		:m_marker(arena->getMarker()),
+		m_pairs(arena)
+	{
+	}
+};
+
+struct btGImpactFindContext
+{
+	btGImpactQuantizedBvh*	m_boxset0;
+	btGImpactQuantizedBvh*	m_boxset1;
+	const BT_BOX_BOX_TRANSFORM_CACHE*	m_transCache1to0;
+	const btGImpactNodePairTask*	m_tasks;
+	btGImpactFindTaskPairs*	m_taskPairs;
+};
+
+static void	btGImpactFindTask(void* userPtr, int taskIndex)
+{
+	const btGImpactFindContext& context = *(const btGImpactFindContext*)userPtr;
+	const btGImpactNodePairTask& task = context.m_tasks[taskIndex];
+	if (task.m_isLeafPair)
+		return;
+	BT_PROFILE("gimpactFindTask");
+	BT_ALLOC_TAG(BT_ALLOC_TAG_MANIFOLDS);
+	btGImpactFindTaskPairs* taskPairs = new (&context.m_taskPairs[taskIndex]) btGImpactFindTaskPairs(btFrameArena::getThreadArena());
+	_find_quantized_collision_pairs_recursive(
+		context.m_boxset0,context.m_boxset1,
+		&taskPairs->m_pairs,*context.m_transCache1to0,
+		task.m_node0,task.m_node1,task.m_completePrimitiveTests);
+}
+
+///expand the top of the traversal into subtree pairs, replacing each pair by its children keeps the order of the recursive traversal.
+///A pair is replaced by at most 4 children and the expansion stops at minTasks, so tasks and expanded need room for 4*minTasks pairs.
+static void	_split_quantized_collision_pairs(
+	btGImpactQuantizedBvh * boxset0, btGImpactQuantizedBvh * boxset1,
+	const BT_BOX_BOX_TRANSFORM_CACHE & trans_cache_1to0,
+	int minTasks, btAlignedObjectArray<btGImpactNodePairTask> & tasks,
+	btAlignedObjectArray<btGImpactNodePairTask> & expanded)
+{
+	btGImpactNodePairTask root;
+	root.m_node0 = 0;
+	root.m_node1 = 0;
+	root.m_isLeafPair = false;
+	root.m_completePrimitiveTests = true;
+	tasks.push_back(root);
+
+	bool split = true;
+	while (split && tasks.size() < minTasks)
+	{
+		split = false;
+		expanded.resize(0);
+		for (int i=0;i<tasks.size();i++)
+		{
+			btGImpactNodePairTask task = tasks[i];
+			if (task.m_isLeafPair)
+			{
+				expanded.push_back(task);
+				continue;
+			}
+			if (!_quantized_node_collision(boxset0,boxset1,trans_cache_1to0,task.m_node0,task.m_node1,task.m_completePrimitiveTests))
+				continue;
+
+			bool leaf0 = boxset0->isLeafNode(task.m_node0);
+			bool leaf1 = boxset1->isLeafNode(task.m_node1);
+			btGImpactNodePairTask child;
+			child.m_isLeafPair = false;
+			child.m_completePrimitiveTests = false;
+			if (leaf0 && leaf1)
+			{
+				task.m_isLeafPair = true;
+				expanded.push_back(task);
+			} else if (leaf0)
+			{
+				child.m_node0 = task.m_node0;
+				child.m_node1 = boxset1->getLeftNode(task.m_node1);
+				expanded.push_back(child);
+				child.m_node1 = boxset1->getRightNode(task.m_node1);
+				expanded.push_back(child);
+			} else if (leaf1)
+			{
+				child.m_node1 = task.m_node1;
+				child.m_node0 = boxset0->getLeftNode(task.m_node0);
+				expanded.push_back(child);
+				child.m_node0 = boxset0->getRightNode(task.m_node0);
+				expanded.push_back(child);
+			} else
+			{
+				child.m_node0 = boxset0->getLeftNode(task.m_node0);
+				child.m_node1 = boxset1->getLeftNode(task.m_node1);
+				expanded.push_back(child);
+				child.m_node1 = boxset1->getRightNode(task.m_node1);
+				expanded.push_back(child);
+				child.m_node0 = boxset0->getRightNode(task.m_node0);
+				child.m_node1 = boxset1->getLeftNode(task.m_node1);
+				expanded.push_back(child);
+				child.m_node1 = boxset1->getRightNode(task.m_node1);
+				expanded.push_back(child);
+			}
+			if (!leaf0 || !leaf1)
+				split = true;
+		}
+		tasks.copyFromArray(expanded);
+	}
+}
+
 void btGImpactQuantizedBvh::find_collision(btGImpactQuantizedBvh * boxset0, const btTransform & trans0,
 		btGImpactQuantizedBvh * boxset1, const btTransform & trans1,
 		btPairSet & collision_pairs)
@@ -516,9 +641,79 @@ void btGImpactQuantizedBvh::find_collision(btGImpactQuantizedBvh * boxset0, cons
 	bt_begin_gim02_q_tree_time();
 #endif //TRI_COLLISION_PROFILING
 
-	_find_quantized_collision_pairs_recursive(
-		boxset0,boxset1,
-		&collision_pairs,trans_cache_1to0,0,0,true);
+	int numThreads = 1;
+	if (boxset0->getNodeCount()+boxset1->getNodeCount() >= BT_GIMPACT_MIN_THREADED_NODES)
+	{
+		numThreads = btGetTaskThreadCount();
+	}
+
+	if (numThreads <= 1)
+	{
+		_find_quantized_collision_pairs_recursive(
+			boxset0,boxset1,
+			&collision_pairs,trans_cache_1to0,0,0,true);
+	} else
+	{
+		//each task collects its pairs separately, they are appended in task order so the result matches the single threaded traversal.
+		//The tasks and their pairs are kept in the frame arenas, so the traversal does not allocate on the heap.
+		btFrameArena* arena = btFrameArena::getThreadArena();
+		btFrameArenaMarker marker = arena->getMarker();
+
+		int minTasks = numThreads*16;
+		btAlignedObjectArray<btGImpactNodePairTask> tasks;
+		btAlignedObjectArray<btGImpactNodePairTask> expanded;
+		tasks.initializeFromBuffer(arena->allocateArray<btGImpactNodePairTask>(minTasks*4),0,minTasks*4);
+		expanded.initializeFromBuffer(arena->allocateArray<btGImpactNodePairTask>(minTasks*4),0,minTasks*4);
+		_split_quantized_collision_pairs(boxset0,boxset1,trans_cache_1to0,minTasks,tasks,expanded);
+
+		//constructed by the tasks, in the arena of the thread that runs them
+		btGImpactFindTaskPairs* taskPairs = arena->allocateArray<btGImpactFindTaskPairs>(tasks.size());
+
+		btGImpactFindContext context;
+		context.m_boxset0 = boxset0;
+		context.m_boxset1 = boxset1;
+		context.m_transCache1to0 = &trans_cache_1to0;
+		context.m_tasks = tasks.size() ? &tasks[0] : 0;
+		context.m_taskPairs = taskPairs;
+		btParallelFor(tasks.size(),btGImpactFindTask,&context,numThreads);
+
+		int i;
+		for (i=0;i<tasks.size();i++)
+		{
+			if (tasks[i].m_isLeafPair)
+			{
+				collision_pairs.push_pair(
+					boxset0->getNodeData(tasks[i].m_node0),boxset1->getNodeData(tasks[i].m_node1));
+			} else
+			{
+				const btPairSet& pairs = taskPairs[i].m_pairs;
+				for (int j=0;j<pairs.size();j++)
+				{
+					collision_pairs.push_pair(pairs[j].m_index1,pairs[j].m_index2);
+				}
+			}
+		}
+
+		//a thread takes its tasks in increasing order, so rewinding newest first leaves every pool arena where it was before the traversal
+		for (i=tasks.size()-1;i>=0;i--)
+		{
+			if (!tasks[i].m_isLeafPair)
+			{
+				btFrameArena* taskArena = taskPairs[i].m_pairs.getArena();
+				if (taskArena != arena)
+				{
+					taskArena->rewind(taskPairs[i].m_marker);
+				}
+				taskPairs[i].~btGImpactFindTaskPairs();
+			}
+		}
+		//when collision_pairs grew in this arena after the tasks, the scope of the caller releases them together
+		if (collision_pairs.getArena() != arena)
+		{
+			arena->rewind(marker);
+		}
+	}
+
 #ifdef TRI_COLLISION_PROFILING
 	bt_end_gim02_q_tree_time();
 #endif //TRI_COLLISION_PROFILING
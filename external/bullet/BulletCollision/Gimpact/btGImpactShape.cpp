@@ -152,7 +152,10 @@ void btGImpactMeshShapePart::processAllTriangles(btTriangleCallback* callback,co
 	box.m_min = aabbMin;
 	box.m_max = aabbMax;
 
+	btFrameArenaScope arenaScope(btFrameArena::getThreadArena());
 	btAlignedObjectArray<int> collided;
+	int maxCollided = getNumChildShapes();
+	collided.initializeFromBuffer(arenaScope.getArena()->allocateArray<int>(maxCollided),0,maxCollided);
 	m_box_set.boxQuery(box,collided);
 
 	if(collided.size()==0)
@@ -29,7 +29,10 @@ btPersistentManifold::btPersistentManifold()
 m_body0(0),
 m_body1(0),
 m_cachedPoints (0),
-m_index1a(0)
+m_speculativeDistance(btScalar(0.)),
+m_index1a(0),
+m_childIndex0(BT_MANIFOLD_UNBOUND_CHILD),
+m_childIndex1(BT_MANIFOLD_UNBOUND_CHILD)
 {
 }
 
@@ -145,7 +148,7 @@ int btPersistentManifold::sortCachedPoints(const btManifoldPoint& pt)
 
 int btPersistentManifold::getCacheEntry(const btManifoldPoint& newPoint) const
 {
-	btScalar shortestDist =  getContactBreakingThreshold() * getContactBreakingThreshold();
+	btScalar shortestDist =  m_contactBreakingThreshold * m_contactBreakingThreshold;
 	int size = getNumContacts();
 	int nearestPoint = -1;
 	for( int i = 0; i < size; i++ )
@@ -194,7 +197,7 @@ int btPersistentManifold::addManifoldPoint(const btManifoldPoint& newPoint)
 
 btScalar	btPersistentManifold::getContactBreakingThreshold() const
 {
-	return m_contactBreakingThreshold;
+	return m_contactBreakingThreshold + m_speculativeDistance;
 }
 
 
@@ -238,7 +241,7 @@ void btPersistentManifold::refreshContactPoints(const btTransform& trA,const btT
 			projectedPoint = manifoldPoint.m_positionWorldOnA - manifoldPoint.m_normalWorldOnB * manifoldPoint.m_distance1;
 			projectedDifference = manifoldPoint.m_positionWorldOnB - projectedPoint;
 			distance2d = projectedDifference.dot(projectedDifference);
-			if (distance2d  > getContactBreakingThreshold()*getContactBreakingThreshold() )
+			if (distance2d  > m_contactBreakingThreshold*m_contactBreakingThreshold )
 			{
 				removeContactPoint(i);
 			} else
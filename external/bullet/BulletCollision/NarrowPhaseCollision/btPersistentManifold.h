@@ -41,6 +41,9 @@ enum btContactManifoldTypes
 
 #define MANIFOLD_CACHE_SIZE 4
 
+///child keys of a manifold that has not been passed to a btManifoldResult yet
+#define BT_MANIFOLD_UNBOUND_CHILD -2
+
 ///btPersistentManifold is a contact point cache, it stays persistent as long as objects are overlapping in the broadphase.
 ///Those contact points are created by the collision narrow phase.
 ///The cache can be empty, or hold 1,2,3 or 4 points. Some collision algorithms (GJK) might only add one point at a time.
@@ -65,6 +68,7 @@ ATTRIBUTE_ALIGNED128( class) btPersistentManifold : public btTypedObject
 
 	btScalar	m_contactBreakingThreshold;
 	btScalar	m_contactProcessingThreshold;
+	btScalar	m_speculativeDistance;
 
 	
 	/// sort cached points so most isolated points come first
@@ -81,13 +85,21 @@ public:
 
 	int m_index1a;
 
+	///m_childIndex0/1 identify the compound child of body0/1 the manifold belongs to (-1 for the whole shape).
+	///They are stamped by btManifoldResult::setPersistentManifold and give manifolds an order that does not depend on their creation order.
+	int	m_childIndex0;
+	int	m_childIndex1;
+
 	btPersistentManifold();
 
 	btPersistentManifold(void* body0,void* body1,int , btScalar contactBreakingThreshold,btScalar contactProcessingThreshold)
 		: btTypedObject(BT_PERSISTENT_MANIFOLD_TYPE),
 	m_body0(body0),m_body1(body1),m_cachedPoints(0),
 		m_contactBreakingThreshold(contactBreakingThreshold),
-		m_contactProcessingThreshold(contactProcessingThreshold)
+		m_contactProcessingThreshold(contactProcessingThreshold),
+		m_speculativeDistance(btScalar(0.)),
+		m_childIndex0(BT_MANIFOLD_UNBOUND_CHILD),
+		m_childIndex1(BT_MANIFOLD_UNBOUND_CHILD)
 	{
 	}
 
@@ -130,6 +142,17 @@ public:
 	{
 		return m_contactProcessingThreshold;
 	}
+
+	///the speculative distance is added to the contact breaking threshold, so points with a positive distance the bodies can close this step are kept
+	void	setSpeculativeDistance(btScalar speculativeDistance)
+	{
+		m_speculativeDistance = speculativeDistance;
+	}
+
+	btScalar	getSpeculativeDistance() const
+	{
+		return m_speculativeDistance;
+	}
 	
 	int getCacheEntry(const btManifoldPoint& newPoint) const;
 
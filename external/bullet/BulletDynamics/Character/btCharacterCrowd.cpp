@@ -0,0 +1,694 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btCharacterCrowd.h"
+#include "LinearMath/btIDebugDraw.h"
+#include "LinearMath/btQuickprof.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+#include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "BulletCollision/CollisionShapes/btConcaveShape.h"
+#include "BulletCollision/CollisionShapes/btTriangleShape.h"
+#include "BulletCollision/CollisionShapes/btTriangleCallback.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkPairDetector.h"
+#include "BulletCollision/NarrowPhaseCollision/btGjkEpaPenetrationDepthSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h"
+#include "BulletCollision/NarrowPhaseCollision/btPointCollector.h"
+#include "LinearMath/btTaskPool.h"
+
+#define BT_CHARACTER_CROWD_CHARACTERS_PER_TASK 8
+
+
+///btCrowdConvexResultCallback ignores hits with a normal that is too steep, like the sweep callback of btKinematicCharacterController
+class btCrowdConvexResultCallback : public btCollisionWorld::ClosestConvexResultCallback
+{
+public:
+	btCrowdConvexResultCallback (const btVector3& up, btScalar minSlopeDot)
+	: btCollisionWorld::ClosestConvexResultCallback(btVector3(0.0, 0.0, 0.0), btVector3(0.0, 0.0, 0.0))
+	, m_up(up)
+	, m_minSlopeDot(minSlopeDot)
+	{
+	}
+
+	virtual btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult,bool normalInWorldSpace)
+	{
+		btVector3 hitNormalWorld;
+		if (normalInWorldSpace)
+		{
+			hitNormalWorld = convexResult.m_hitNormalLocal;
+		} else
+		{
+			///need to transform normal into worldspace
+			hitNormalWorld = convexResult.m_hitCollisionObject->getWorldTransform().getBasis()*convexResult.m_hitNormalLocal;
+		}
+
+		btScalar dotUp = m_up.dot(hitNormalWorld);
+		if (dotUp < m_minSlopeDot) {
+			return btScalar(1.0);
+		}
+
+		return ClosestConvexResultCallback::addSingleResult (convexResult, normalInWorldSpace);
+	}
+protected:
+	const btVector3 m_up;
+	btScalar m_minSlopeDot;
+};
+
+///btCrowdSweepObject sweeps compound children without replacing the shape of the collision object, unlike btCollisionWorld::objectQuerySingle, so several characters can sweep against the same object at the same time
+static void	btCrowdSweepObject(const btConvexShape* castShape,const btTransform& convexFromTrans,const btTransform& convexToTrans,
+					  btCollisionObject* collisionObject,
+					  const btCollisionShape* collisionShape,
+					  const btTransform& colObjWorldTransform,
+					  btCollisionWorld::ConvexResultCallback& resultCallback, btScalar allowedPenetration)
+{
+	if (collisionShape->isCompound())
+	{
+		const btCompoundShape* compoundShape = static_cast<const btCompoundShape*>(collisionShape);
+		for (int i=0;i<compoundShape->getNumChildShapes();i++)
+		{
+			btTransform childWorldTrans = colObjWorldTransform * compoundShape->getChildTransform(i);
+			btCrowdSweepObject(castShape,convexFromTrans,convexToTrans,collisionObject,compoundShape->getChildShape(i),childWorldTrans,resultCallback,allowedPenetration);
+		}
+		return;
+	}
+	btCollisionWorld::objectQuerySingle(castShape,convexFromTrans,convexToTrans,collisionObject,collisionShape,colObjWorldTransform,resultCallback,allowedPenetration);
+}
+
+///btCrowdPenetration accumulates the penetration recovery of a character, the same way btKinematicCharacterController::recoverFromPenetration treats its contact points
+struct btCrowdPenetration
+{
+	btVector3	m_displacement;
+	btVector3	m_touchingNormal;
+	btScalar	m_maxPenetration;
+	bool		m_penetration;
+
+	btCrowdPenetration(const btVector3& touchingNormal)
+		:m_displacement(btScalar(0.),btScalar(0.),btScalar(0.)),
+		m_touchingNormal(touchingNormal),
+		m_maxPenetration(btScalar(0.)),
+		m_penetration(false)
+	{
+	}
+
+	///normalOnB points from the object to the character
+	void	addContact(const btVector3& normalOnB,btScalar distance)
+	{
+		if (distance < btScalar(0.))
+		{
+			if (distance < m_maxPenetration)
+			{
+				m_maxPenetration = distance;
+				m_touchingNormal = -normalOnB;
+			}
+			m_displacement -= normalOnB * distance * btScalar(0.2);
+			m_penetration = true;
+		}
+	}
+};
+
+static void	btCrowdConvexContact(const btConvexShape* characterShape,const btTransform& characterTransform,
+								 const btConvexShape* convexShape,const btTransform& convexTransform,
+								 const btMatrix3x3& normalToWorld,btCrowdPenetration& penetration)
+{
+	btVoronoiSimplexSolver	simplexSolver;
+	btGjkEpaPenetrationDepthSolver	gjkEpaPenetrationSolver;
+	btGjkPairDetector	gjkPairDetector(characterShape,convexShape,&simplexSolver,&gjkEpaPenetrationSolver);
+	btGjkPairDetector::ClosestPointInput input;
+	input.m_transformA = characterTransform;
+	input.m_transformB = convexTransform;
+	//only penetrations are needed, GJK can stop as soon as the shapes are separated by more than their margins
+	btScalar margin = characterShape->getMargin()+convexShape->getMargin();
+	input.m_maximumDistanceSquared = margin*margin;
+	btPointCollector	pointCollector;
+	gjkPairDetector.getClosestPoints(input,pointCollector,0);
+	if (pointCollector.m_hasResult)
+	{
+		penetration.addContact(normalToWorld*pointCollector.m_normalOnBInWorld,pointCollector.m_distance);
+	}
+}
+
+struct btCrowdTriangleContactCallback : public btTriangleCallback
+{
+	const btConvexShape*	m_characterShape;
+	btTransform	m_characterTransform;
+	btMatrix3x3	m_normalToWorld;
+	btScalar	m_triangleMargin;
+	btCrowdPenetration&	m_penetration;
+
+	btCrowdTriangleContactCallback(const btConvexShape* characterShape,const btTransform& characterTransform,const btMatrix3x3& normalToWorld,btScalar triangleMargin,btCrowdPenetration& penetration)
+		:m_characterShape(characterShape),
+		m_characterTransform(characterTransform),
+		m_normalToWorld(normalToWorld),
+		m_triangleMargin(triangleMargin),
+		m_penetration(penetration)
+	{
+	}
+
+	virtual void processTriangle(btVector3* triangle, int partId, int triangleIndex)
+	{
+		(void)partId;
+		(void)triangleIndex;
+		btTriangleShape triangleShape(triangle[0],triangle[1],triangle[2]);
+		triangleShape.setMargin(m_triangleMargin);
+		btTransform identity;
+		identity.setIdentity();
+		btCrowdConvexContact(m_characterShape,m_characterTransform,&triangleShape,identity,m_normalToWorld,m_penetration);
+	}
+};
+
+static void	btCrowdShapeContacts(const btConvexShape* characterShape,const btTransform& characterTransform,const btVector3& aabbMin,const btVector3& aabbMax,
+								 const btCollisionShape* collisionShape,const btTransform& colObjWorldTransform,btCrowdPenetration& penetration)
+{
+	if (collisionShape->isConvex())
+	{
+		btCrowdConvexContact(characterShape,characterTransform,static_cast<const btConvexShape*>(collisionShape),colObjWorldTransform,btMatrix3x3::getIdentity(),penetration);
+	} else if (collisionShape->isCompound())
+	{
+		const btCompoundShape* compoundShape = static_cast<const btCompoundShape*>(collisionShape);
+		for (int i=0;i<compoundShape->getNumChildShapes();i++)
+		{
+			btTransform childWorldTrans = colObjWorldTransform * compoundShape->getChildTransform(i);
+			const btCollisionShape* childShape = compoundShape->getChildShape(i);
+			btVector3 childAabbMin,childAabbMax;
+			childShape->getAabb(childWorldTrans,childAabbMin,childAabbMax);
+			if (TestAabbAgainstAabb2(aabbMin,aabbMax,childAabbMin,childAabbMax))
+			{
+				btCrowdShapeContacts(characterShape,characterTransform,aabbMin,aabbMax,childShape,childWorldTrans,penetration);
+			}
+		}
+	} else if (collisionShape->isConcave())
+	{
+		//the triangles are tested in the space of the concave shape
+		const btConcaveShape* concaveShape = static_cast<const btConcaveShape*>(collisionShape);
+		btTransform characterTransformLocal = colObjWorldTransform.inverse() * characterTransform;
+		btVector3 localAabbMin,localAabbMax;
+		characterShape->getAabb(characterTransformLocal,localAabbMin,localAabbMax);
+		btCrowdTriangleContactCallback triangleCallback(characterShape,characterTransformLocal,colObjWorldTransform.getBasis(),concaveShape->getMargin(),penetration);
+		concaveShape->processAllTriangles(&triangleCallback,localAabbMin,localAabbMax);
+	}
+}
+
+struct btCrowdCacheCollector : public btBroadphaseAabbCallback
+{
+	btCrowdCharacter&	m_character;
+
+	btCrowdCacheCollector(btCrowdCharacter& character)
+		:m_character(character)
+	{
+	}
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		btCollisionObject* collisionObject = (btCollisionObject*)proxy->m_clientObject;
+		if (collisionObject == m_character.m_collisionObject)
+			return true;
+		const btBroadphaseProxy* characterProxy = m_character.m_collisionObject->getBroadphaseHandle();
+		bool collides = (proxy->m_collisionFilterGroup & characterProxy->m_collisionFilterMask) != 0;
+		collides = collides && (characterProxy->m_collisionFilterGroup & proxy->m_collisionFilterMask);
+		if (collides)
+		{
+			m_character.m_cachedObjects.push_back(collisionObject);
+		}
+		return true;
+	}
+};
+
+/*
+ * Returns the reflection direction of a ray going 'direction' hitting a surface with normal 'normal'
+ */
+static btVector3 btCrowdReflectionDirection (const btVector3& direction, const btVector3& normal)
+{
+	return direction - (btScalar(2.0) * direction.dot(normal)) * normal;
+}
+
+///see btKinematicCharacterController::updateTargetPositionBasedOnCollision
+static void btCrowdUpdateTargetPositionBasedOnCollision (btCrowdCharacter& character, const btVector3& hitNormal)
+{
+	btVector3 movementDirection = character.m_targetPosition - character.m_currentPosition;
+	btScalar movementLength = movementDirection.length();
+	if (movementLength>SIMD_EPSILON)
+	{
+		movementDirection.normalize();
+
+		btVector3 reflectDir = btCrowdReflectionDirection (movementDirection, hitNormal);
+		reflectDir.normalize();
+
+		btVector3 perpindicularDir = reflectDir - hitNormal * reflectDir.dot(hitNormal);
+
+		character.m_targetPosition = character.m_currentPosition + perpindicularDir * movementLength;
+	}
+}
+
+btCharacterCrowd::btCharacterCrowd(int upAxis)
+{
+	m_upAxis = upAxis;
+	m_addedMargin = 0.02;
+	m_gravity = 9.8 * 3 ; // 3G acceleration.
+	m_fallSpeed = 55.0; // Terminal velocity of a sky diver in m/s.
+	m_jumpSpeed = 10.0;
+	setMaxSlope(btRadians(45.0));
+	m_cacheMargin = btScalar(1.0);
+	m_cacheRefreshInterval = 10;
+	m_maxThreads = 1;
+}
+
+btCharacterCrowd::~btCharacterCrowd()
+{
+}
+
+int	btCharacterCrowd::addCharacter(btCollisionObject* collisionObject, btConvexShape* convexShape, btScalar stepHeight)
+{
+	btAssert(collisionObject->getBroadphaseHandle());
+	btCrowdCharacter character;
+	character.m_collisionObject = collisionObject;
+	character.m_convexShape = convexShape;
+	character.m_stepHeight = stepHeight;
+	character.m_walkDirection.setValue(0,0,0);
+	character.m_normalizedDirection.setValue(0,0,0);
+	character.m_useWalkDirection = true;	// use walk direction by default, legacy behavior
+	character.m_velocityTimeInterval = 0.0;
+	character.m_verticalVelocity = 0.0;
+	character.m_verticalOffset = 0.0;
+	character.m_currentStepOffset = 0.0;
+	character.m_currentPosition = collisionObject->getWorldTransform().getOrigin();
+	character.m_targetPosition = character.m_currentPosition;
+	character.m_touchingNormal.setValue(0,0,0);
+	character.m_touchingContact = false;
+	character.m_wasOnGround = false;
+	character.m_wasJumping = false;
+	character.m_cachedObjects.resize(0);
+	character.m_cacheAabbMin = character.m_currentPosition;
+	character.m_cacheAabbMax = character.m_currentPosition;
+	character.m_cacheAge = 0;
+	character.m_cacheValid = false;
+	m_characters.push_back(character);
+	return m_characters.size()-1;
+}
+
+void	btCharacterCrowd::removeCharacter(int characterIndex)
+{
+	int lastIndex = m_characters.size()-1;
+	if (characterIndex != lastIndex)
+	{
+		m_characters.swap(characterIndex,lastIndex);
+	}
+	m_characters.pop_back();
+}
+
+void	btCharacterCrowd::invalidateCaches()
+{
+	for (int i=0;i<m_characters.size();i++)
+	{
+		m_characters[i].m_cachedObjects.resize(0);
+		m_characters[i].m_cacheValid = false;
+	}
+}
+
+void	btCharacterCrowd::setWalkDirection(int characterIndex, const btVector3& walkDirection)
+{
+	btCrowdCharacter& character = m_characters[characterIndex];
+	character.m_useWalkDirection = true;
+	character.m_walkDirection = walkDirection;
+	character.m_normalizedDirection = walkDirection.fuzzyZero() ? btVector3(0,0,0) : walkDirection.normalized();
+}
+
+void	btCharacterCrowd::setVelocityForTimeInterval(int characterIndex, const btVector3& velocity, btScalar timeInterval)
+{
+	btCrowdCharacter& character = m_characters[characterIndex];
+	character.m_useWalkDirection = false;
+	character.m_walkDirection = velocity;
+	character.m_normalizedDirection = velocity.fuzzyZero() ? btVector3(0,0,0) : velocity.normalized();
+	character.m_velocityTimeInterval = timeInterval;
+}
+
+void	btCharacterCrowd::warp(int characterIndex, const btVector3& origin)
+{
+	btCrowdCharacter& character = m_characters[characterIndex];
+	character.m_currentPosition = origin;
+	character.m_targetPosition = origin;
+	btTransform xform = character.m_collisionObject->getWorldTransform();
+	xform.setOrigin(origin);
+	character.m_collisionObject->setWorldTransform(xform);
+}
+
+bool	btCharacterCrowd::onGround(int characterIndex) const
+{
+	const btCrowdCharacter& character = m_characters[characterIndex];
+	return character.m_verticalVelocity == 0.0 && character.m_verticalOffset == 0.0;
+}
+
+void	btCharacterCrowd::jump(int characterIndex)
+{
+	if (!canJump(characterIndex))
+		return;
+
+	btCrowdCharacter& character = m_characters[characterIndex];
+	character.m_verticalVelocity = m_jumpSpeed;
+	character.m_wasJumping = true;
+}
+
+void	btCharacterCrowd::setMaxSlope(btScalar slopeRadians)
+{
+	m_maxSlopeRadians = slopeRadians;
+	m_maxSlopeCosine = btCos(slopeRadians);
+}
+
+const btVector3&	btCharacterCrowd::getUpAxisDirection(int upAxis)
+{
+	static btVector3 sUpAxisDirection[3] = { btVector3(1.0f, 0.0f, 0.0f), btVector3(0.0f, 1.0f, 0.0f), btVector3(0.0f, 0.0f, 1.0f) };
+
+	return sUpAxisDirection[upAxis];
+}
+
+void	btCharacterCrowd::updateCache(btCollisionWorld* collisionWorld, btCrowdCharacter& character, btScalar dt)
+{
+	//everything the update can touch: penetration recovery, step up, walk, and step down or fall
+	btVector3 center;
+	btScalar radius;
+	character.m_convexShape->getBoundingSphere(center,radius);
+	btScalar walkLength = character.m_walkDirection.length();
+	if (!character.m_useWalkDirection)
+	{
+		walkLength *= btMax(btMin(dt,character.m_velocityTimeInterval),btScalar(0.));
+	}
+	btScalar reach = center.length() + radius + m_addedMargin + walkLength + btScalar(2.)*character.m_stepHeight +
+		btMax(btFabs(m_fallSpeed),btFabs(m_jumpSpeed))*dt;
+	btVector3 reach3d(reach,reach,reach);
+	btVector3 reachMin = character.m_currentPosition - reach3d;
+	btVector3 reachMax = character.m_currentPosition + reach3d;
+
+	character.m_cacheAge++;
+	if (character.m_cacheValid && character.m_cacheAge < m_cacheRefreshInterval &&
+		reachMin.getX() >= character.m_cacheAabbMin.getX() && reachMin.getY() >= character.m_cacheAabbMin.getY() && reachMin.getZ() >= character.m_cacheAabbMin.getZ() &&
+		reachMax.getX() <= character.m_cacheAabbMax.getX() && reachMax.getY() <= character.m_cacheAabbMax.getY() && reachMax.getZ() <= character.m_cacheAabbMax.getZ())
+	{
+		return;
+	}
+
+	btVector3 margin(m_cacheMargin,m_cacheMargin,m_cacheMargin);
+	character.m_cacheAabbMin = reachMin - margin;
+	character.m_cacheAabbMax = reachMax + margin;
+	character.m_cacheAge = 0;
+	character.m_cacheValid = true;
+	character.m_cachedObjects.resize(0);
+	btCrowdCacheCollector collector(character);
+	collisionWorld->getBroadphase()->aabbTest(character.m_cacheAabbMin,character.m_cacheAabbMax,collector);
+}
+
+bool	btCharacterCrowd::recoverFromPenetration(btCrowdCharacter& character)
+{
+	btTransform characterTransform = character.m_collisionObject->getWorldTransform();
+	characterTransform.setOrigin(character.m_currentPosition);
+	btVector3 aabbMin,aabbMax;
+	character.m_convexShape->getAabb(characterTransform,aabbMin,aabbMax);
+
+	btCrowdPenetration penetration(character.m_touchingNormal);
+	for (int i=0;i<character.m_cachedObjects.size();i++)
+	{
+		btCollisionObject* collisionObject = character.m_cachedObjects[i];
+		const btBroadphaseProxy* proxy = collisionObject->getBroadphaseHandle();
+		if (!TestAabbAgainstAabb2(aabbMin,aabbMax,proxy->m_aabbMin,proxy->m_aabbMax))
+			continue;
+		btCrowdShapeContacts(character.m_convexShape,characterTransform,aabbMin,aabbMax,collisionObject->getCollisionShape(),collisionObject->getWorldTransform(),penetration);
+	}
+	character.m_currentPosition += penetration.m_displacement;
+	character.m_touchingNormal = penetration.m_touchingNormal;
+	return penetration.m_penetration;
+}
+
+bool	btCharacterCrowd::sweepCharacter(const btCrowdCharacter& character, const btVector3& from, const btVector3& to, const btVector3& up, btScalar minSlopeDot,
+										  btScalar& hitFraction, btVector3& hitNormal, btScalar allowedPenetration) const
+{
+	btTransform start, end;
+	start.setIdentity ();
+	end.setIdentity ();
+	start.setOrigin (from);
+	end.setOrigin (to);
+
+	btCrowdConvexResultCallback callback (up, minSlopeDot);
+	callback.m_collisionFilterGroup = character.m_collisionObject->getBroadphaseHandle()->m_collisionFilterGroup;
+	callback.m_collisionFilterMask = character.m_collisionObject->getBroadphaseHandle()->m_collisionFilterMask;
+
+	btVector3 sweptAabbMin,sweptAabbMax,endAabbMin,endAabbMax;
+	character.m_convexShape->getAabb(start,sweptAabbMin,sweptAabbMax);
+	character.m_convexShape->getAabb(end,endAabbMin,endAabbMax);
+	sweptAabbMin.setMin(endAabbMin);
+	sweptAabbMax.setMax(endAabbMax);
+
+	for (int i=0;i<character.m_cachedObjects.size();i++)
+	{
+		btCollisionObject* collisionObject = character.m_cachedObjects[i];
+		btBroadphaseProxy* proxy = collisionObject->getBroadphaseHandle();
+		if (!TestAabbAgainstAabb2(sweptAabbMin,sweptAabbMax,proxy->m_aabbMin,proxy->m_aabbMax))
+			continue;
+		btCrowdSweepObject(character.m_convexShape,start,end,collisionObject,collisionObject->getCollisionShape(),collisionObject->getWorldTransform(),callback,allowedPenetration);
+	}
+
+	hitFraction = callback.m_closestHitFraction;
+	hitNormal = callback.m_hitNormalWorld;
+	return callback.hasHit();
+}
+
+void	btCharacterCrowd::stepUp(btCrowdCharacter& character, btScalar allowedPenetration)
+{
+	// phase 1: up
+	const btVector3& up = getUpAxisDirection(m_upAxis);
+	character.m_targetPosition = character.m_currentPosition + up * (character.m_stepHeight + (character.m_verticalOffset > 0.f?character.m_verticalOffset:0.f));
+
+	/* FIXME: Handle penetration properly */
+	btVector3 from = character.m_currentPosition + up * (character.m_convexShape->getMargin() + m_addedMargin);
+
+	btScalar hitFraction;
+	btVector3 hitNormal;
+	if (sweepCharacter(character, from, character.m_targetPosition, -up, btScalar(0.7071), hitFraction, hitNormal, allowedPenetration))
+	{
+		// Only modify the position if the hit was a slope and not a wall or ceiling.
+		if(hitNormal.dot(up) > 0.0)
+		{
+			// we moved up only a fraction of the step height
+			character.m_currentStepOffset = character.m_stepHeight * hitFraction;
+			character.m_currentPosition.setInterpolate3 (character.m_currentPosition, character.m_targetPosition, hitFraction);
+		}
+		character.m_verticalVelocity = 0.0;
+		character.m_verticalOffset = 0.0;
+	} else {
+		character.m_currentStepOffset = character.m_stepHeight;
+		character.m_currentPosition = character.m_targetPosition;
+	}
+}
+
+void	btCharacterCrowd::stepForwardAndStrafe(btCrowdCharacter& character, const btVector3& walkMove, btScalar allowedPenetration)
+{
+	// phase 2: forward and strafe
+	character.m_targetPosition = character.m_currentPosition + walkMove;
+
+	btScalar fraction = 1.0;
+
+	if (character.m_touchingContact)
+	{
+		if (character.m_normalizedDirection.dot(character.m_touchingNormal) > btScalar(0.0))
+		{
+			btCrowdUpdateTargetPositionBasedOnCollision (character, character.m_touchingNormal);
+		}
+	}
+
+	int maxIter = 10;
+
+	while (fraction > btScalar(0.01) && maxIter-- > 0)
+	{
+		btVector3 sweepDirNegative(character.m_currentPosition - character.m_targetPosition);
+
+		//btKinematicCharacterController adds m_addedMargin to the margin of the shape here. That does not change the swept volume of the
+		//implicit shapes (sphere, capsule, box, cylinder), and changing a shape that characters share is not thread safe, so the crowd doesn't
+		btScalar hitFraction;
+		btVector3 hitNormal;
+		bool hasHit = sweepCharacter(character, character.m_currentPosition, character.m_targetPosition, sweepDirNegative, btScalar(0.0), hitFraction, hitNormal, allowedPenetration);
+
+		fraction -= hitFraction;
+
+		if (hasHit)
+		{
+			btCrowdUpdateTargetPositionBasedOnCollision (character, hitNormal);
+			btVector3 currentDir = character.m_targetPosition - character.m_currentPosition;
+			btScalar distance2 = currentDir.length2();
+			if (distance2 > SIMD_EPSILON)
+			{
+				currentDir.normalize();
+				/* See Quake2: "If velocity is against original velocity, stop ead to avoid tiny oscilations in sloping corners." */
+				if (currentDir.dot(character.m_normalizedDirection) <= btScalar(0.0))
+				{
+					break;
+				}
+			} else
+			{
+				break;
+			}
+
+		} else {
+			// we moved whole way
+			character.m_currentPosition = character.m_targetPosition;
+		}
+	}
+}
+
+void	btCharacterCrowd::stepDown(btCrowdCharacter& character, btScalar dt, btScalar allowedPenetration)
+{
+	// phase 3: down
+	const btVector3& up = getUpAxisDirection(m_upAxis);
+	btScalar downVelocity = (character.m_verticalVelocity<0.f?-character.m_verticalVelocity:0.f) * dt;
+	if(downVelocity > 0.0 && downVelocity < character.m_stepHeight
+		&& (character.m_wasOnGround || !character.m_wasJumping))
+	{
+		downVelocity = character.m_stepHeight;
+	}
+
+	btVector3 step_drop = up * (character.m_currentStepOffset + downVelocity);
+	character.m_targetPosition -= step_drop;
+
+	btScalar hitFraction;
+	btVector3 hitNormal;
+	if (sweepCharacter(character, character.m_currentPosition, character.m_targetPosition, up, m_maxSlopeCosine, hitFraction, hitNormal, allowedPenetration))
+	{
+		// we dropped a fraction of the height -> hit floor
+		character.m_currentPosition.setInterpolate3 (character.m_currentPosition, character.m_targetPosition, hitFraction);
+		character.m_verticalVelocity = 0.0;
+		character.m_verticalOffset = 0.0;
+		character.m_wasJumping = false;
+	} else {
+		// we dropped the full height
+		character.m_currentPosition = character.m_targetPosition;
+	}
+}
+
+void	btCharacterCrowd::updateCharacter(btCollisionWorld* collisionWorld, int characterIndex, btScalar dt)
+{
+	btCrowdCharacter& character = m_characters[characterIndex];
+	btScalar allowedPenetration = collisionWorld->getDispatchInfo().m_allowedCcdPenetration;
+
+	updateCache(collisionWorld,character,dt);
+
+	// pre step
+	int numPenetrationLoops = 0;
+	character.m_touchingContact = false;
+	while (recoverFromPenetration (character))
+	{
+		numPenetrationLoops++;
+		character.m_touchingContact = true;
+		if (numPenetrationLoops > 4)
+		{
+			break;
+		}
+	}
+	character.m_targetPosition = character.m_currentPosition;
+
+	// player step
+	if (!character.m_useWalkDirection && character.m_velocityTimeInterval <= 0.0) {
+		return;		// no motion
+	}
+
+	character.m_wasOnGround = onGround(characterIndex);
+
+	// Update fall velocity.
+	character.m_verticalVelocity -= m_gravity * dt;
+	if(character.m_verticalVelocity > 0.0 && character.m_verticalVelocity > m_jumpSpeed)
+	{
+		character.m_verticalVelocity = m_jumpSpeed;
+	}
+	if(character.m_verticalVelocity < 0.0 && btFabs(character.m_verticalVelocity) > btFabs(m_fallSpeed))
+	{
+		character.m_verticalVelocity = -btFabs(m_fallSpeed);
+	}
+	character.m_verticalOffset = character.m_verticalVelocity * dt;
+
+	stepUp (character, allowedPenetration);
+	if (character.m_useWalkDirection) {
+		stepForwardAndStrafe (character, character.m_walkDirection, allowedPenetration);
+	} else {
+		// still have some time left for moving!
+		btScalar dtMoving =
+			(dt < character.m_velocityTimeInterval) ? dt : character.m_velocityTimeInterval;
+		character.m_velocityTimeInterval -= dt;
+
+		// how far will we move while we are moving?
+		btVector3 move = character.m_walkDirection * dtMoving;
+
+		// okay, step
+		stepForwardAndStrafe(character, move, allowedPenetration);
+	}
+	stepDown (character, dt, allowedPenetration);
+}
+
+struct btCharacterCrowdContext
+{
+	btCharacterCrowd*	m_crowd;
+	btCollisionWorld*	m_collisionWorld;
+	btScalar	m_deltaTime;
+	int		m_numCharacters;
+};
+
+static void	btCharacterCrowdTask(void* userPtr, int taskIndex)
+{
+	BT_PROFILE("characterCrowdTask");
+	const btCharacterCrowdContext& context = *(const btCharacterCrowdContext*)userPtr;
+	int firstCharacter = taskIndex*BT_CHARACTER_CROWD_CHARACTERS_PER_TASK;
+	int endCharacter = btMin(firstCharacter+BT_CHARACTER_CROWD_CHARACTERS_PER_TASK,context.m_numCharacters);
+	for (int i=firstCharacter;i<endCharacter;i++)
+	{
+		context.m_crowd->updateCharacter(context.m_collisionWorld,i,context.m_deltaTime);
+	}
+}
+
+void	btCharacterCrowd::updateAction(btCollisionWorld* collisionWorld, btScalar deltaTime)
+{
+	BT_PROFILE("btCharacterCrowd::updateAction");
+	if (!m_characters.size())
+		return;
+
+	//the characters only read the world during the update, their collision objects are moved afterwards
+	btCharacterCrowdContext context;
+	context.m_crowd = this;
+	context.m_collisionWorld = collisionWorld;
+	context.m_deltaTime = deltaTime;
+	context.m_numCharacters = m_characters.size();
+
+	int numTasks = (m_characters.size()+BT_CHARACTER_CROWD_CHARACTERS_PER_TASK-1)/BT_CHARACTER_CROWD_CHARACTERS_PER_TASK;
+	int numThreads = 1;
+	if (m_maxThreads > 1 && m_characters.size() >= BT_CHARACTER_CROWD_MIN_THREADED_CHARACTERS && collisionWorld->supportsConcurrentQueries())
+	{
+		numThreads = m_maxThreads;
+	}
+	btParallelFor(numTasks,btCharacterCrowdTask,&context,numThreads);
+
+	for (int j=0;j<m_characters.size();j++)
+	{
+		btCrowdCharacter& character = m_characters[j];
+		btTransform xform = character.m_collisionObject->getWorldTransform();
+		xform.setOrigin(character.m_currentPosition);
+		character.m_collisionObject->setWorldTransform(xform);
+		collisionWorld->updateSingleAabb(character.m_collisionObject);
+	}
+}
+
+void	btCharacterCrowd::debugDraw(btIDebugDraw* debugDrawer)
+{
+	btVector3 color(btScalar(0.),btScalar(0.5),btScalar(1.));
+	for (int i=0;i<m_characters.size();i++)
+	{
+		if (m_characters[i].m_cacheValid)
+		{
+			debugDrawer->drawAabb(m_characters[i].m_cacheAabbMin,m_characters[i].m_cacheAabbMax,color);
+		}
+	}
+}
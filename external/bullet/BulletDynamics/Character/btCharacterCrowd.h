@@ -0,0 +1,194 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef CHARACTER_CROWD_H
+#define CHARACTER_CROWD_H
+
+#include "LinearMath/btVector3.h"
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletDynamics/Dynamics/btActionInterface.h"
+
+class btCollisionObject;
+class btCollisionWorld;
+class btConvexShape;
+
+///above this number of characters btCharacterCrowd updates the characters on several threads, see setMaxThreads
+#define BT_CHARACTER_CROWD_MIN_THREADED_CHARACTERS 32
+
+///btCrowdCharacter is the state of one character of a btCharacterCrowd, the members match the ones of btKinematicCharacterController
+struct	btCrowdCharacter
+{
+	btCollisionObject*	m_collisionObject;
+	btConvexShape*	m_convexShape;
+	btScalar	m_stepHeight;
+
+	btVector3	m_walkDirection;
+	btVector3	m_normalizedDirection;
+	bool		m_useWalkDirection;
+	btScalar	m_velocityTimeInterval;
+
+	btScalar	m_verticalVelocity;
+	btScalar	m_verticalOffset;
+	btScalar	m_currentStepOffset;
+	btVector3	m_currentPosition;
+	btVector3	m_targetPosition;
+
+	btVector3	m_touchingNormal;
+	bool		m_touchingContact;
+	bool		m_wasOnGround;
+	bool		m_wasJumping;
+
+	///the collision objects that overlap the cache aabb, all sweeps and penetration tests of the character only visit these objects
+	btAlignedObjectArray<btCollisionObject*>	m_cachedObjects;
+	btVector3	m_cacheAabbMin;
+	btVector3	m_cacheAabbMax;
+	int			m_cacheAge;
+	bool		m_cacheValid;
+};
+
+///btCharacterCrowd moves many kinematic characters, each with the stepping of btKinematicCharacterController: penetration recovery, step up, forward and strafe with sliding, and step down.
+///Instead of a btPairCachingGhostObject and full world sweeps per character, each character caches the collision objects around it with one broadphase aabb query.
+///The cache is only refreshed when the reach of the next update leaves the cached region, or after setCacheRefreshInterval updates so that new objects are found.
+///The characters are updated independently against the world as it was at the start of updateAction, so they can be updated on several threads.
+///The collision objects of the characters need to be added to the world, they are moved by the crowd. Call invalidateCaches after removing collision objects from the world.
+class btCharacterCrowd : public btActionInterface
+{
+protected:
+
+	btAlignedObjectArray<btCrowdCharacter>	m_characters;
+
+	btScalar	m_fallSpeed;
+	btScalar	m_jumpSpeed;
+	btScalar	m_maxSlopeRadians;
+	btScalar	m_maxSlopeCosine;
+	btScalar	m_gravity;
+	btScalar	m_addedMargin;
+	int			m_upAxis;
+
+	btScalar	m_cacheMargin;
+	int			m_cacheRefreshInterval;
+	int			m_maxThreads;
+
+	static const btVector3&	getUpAxisDirection(int upAxis);
+
+	void	updateCache(btCollisionWorld* collisionWorld, btCrowdCharacter& character, btScalar dt);
+	bool	recoverFromPenetration(btCrowdCharacter& character);
+	bool	sweepCharacter(const btCrowdCharacter& character, const btVector3& from, const btVector3& to, const btVector3& up, btScalar minSlopeDot,
+							btScalar& hitFraction, btVector3& hitNormal, btScalar allowedPenetration) const;
+	void	stepUp(btCrowdCharacter& character, btScalar allowedPenetration);
+	void	stepForwardAndStrafe(btCrowdCharacter& character, const btVector3& walkMove, btScalar allowedPenetration);
+	void	stepDown(btCrowdCharacter& character, btScalar dt, btScalar allowedPenetration);
+
+public:
+
+	btCharacterCrowd(int upAxis = 1);
+
+	virtual ~btCharacterCrowd();
+
+	///addCharacter returns the index of the character. The collision object needs to be in the world, and keeps its orientation.
+	int		addCharacter(btCollisionObject* collisionObject, btConvexShape* convexShape, btScalar stepHeight);
+
+	///removeCharacter moves the last character into the index of the removed one
+	void	removeCharacter(int characterIndex);
+
+	int		getNumCharacters() const
+	{
+		return m_characters.size();
+	}
+
+	const btCrowdCharacter&	getCharacter(int characterIndex) const
+	{
+		return m_characters[characterIndex];
+	}
+
+	///btActionInterface interface
+	virtual void	updateAction(btCollisionWorld* collisionWorld, btScalar deltaTime);
+
+	///btActionInterface interface
+	virtual void	debugDraw(btIDebugDraw* debugDrawer);
+
+	///updateCharacter runs the update of a single character without writing its collision object, several characters can be updated at the same time
+	void	updateCharacter(btCollisionWorld* collisionWorld, int characterIndex, btScalar dt);
+
+	///see btKinematicCharacterController::setWalkDirection
+	void	setWalkDirection(int characterIndex, const btVector3& walkDirection);
+
+	///see btKinematicCharacterController::setVelocityForTimeInterval
+	void	setVelocityForTimeInterval(int characterIndex, const btVector3& velocity, btScalar timeInterval);
+
+	void	warp(int characterIndex, const btVector3& origin);
+
+	bool	onGround(int characterIndex) const;
+
+	bool	canJump(int characterIndex) const
+	{
+		return onGround(characterIndex);
+	}
+
+	void	jump(int characterIndex);
+
+	void	setFallSpeed(btScalar fallSpeed)
+	{
+		m_fallSpeed = fallSpeed;
+	}
+
+	void	setJumpSpeed(btScalar jumpSpeed)
+	{
+		m_jumpSpeed = jumpSpeed;
+	}
+
+	void	setGravity(btScalar gravity)
+	{
+		m_gravity = gravity;
+	}
+
+	btScalar	getGravity() const
+	{
+		return m_gravity;
+	}
+
+	/// The max slope determines the maximum angle that the characters can walk up.
+	/// The slope angle is measured in radians.
+	void	setMaxSlope(btScalar slopeRadians);
+
+	btScalar	getMaxSlope() const
+	{
+		return m_maxSlopeRadians;
+	}
+
+	///the cached region of a character extends cacheMargin beyond the reach of its update, a larger margin means fewer but larger cache refreshes
+	void	setCacheMargin(btScalar cacheMargin)
+	{
+		m_cacheMargin = cacheMargin;
+	}
+
+	///the cache of a character is refreshed at least every refreshInterval updates, to pick up objects that moved into the cached region
+	void	setCacheRefreshInterval(int refreshInterval)
+	{
+		m_cacheRefreshInterval = refreshInterval;
+	}
+
+	///invalidateCaches needs to be called when collision objects are removed from the world
+	void	invalidateCaches();
+
+	///the characters are updated on at most maxThreads threads of the task pool, or on the calling thread if the world contains shapes that can't be queried concurrently, see btCollisionWorld::supportsConcurrentQueries
+	void	setMaxThreads(int maxThreads)
+	{
+		m_maxThreads = maxThreads;
+	}
+};
+
+#endif //CHARACTER_CROWD_H
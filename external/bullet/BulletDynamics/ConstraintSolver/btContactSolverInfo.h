@@ -27,7 +27,8 @@ enum	btSolverMode
 	SOLVER_DISABLE_VELOCITY_DEPENDENT_FRICTION_DIRECTION = 64,
 	SOLVER_CACHE_FRIENDLY = 128,
 	SOLVER_SIMD = 256,	//enabled for Windows, the solver innerloop is branchless SIMD, 40% faster than FPU/scalar version
-	SOLVER_CUDA = 512	//will be open sourced during Game Developers Conference 2009. Much faster.
+	SOLVER_CUDA = 512,	//will be open sourced during Game Developers Conference 2009. Much faster.
+	SOLVER_USE_SPECULATIVE_CONTACTS = 1024	//keep contacts with positive distance and only let bodies close that gap during the step, a cheaper alternative to swept ccd
 };
 
 struct btContactSolverInfoData
@@ -39,7 +39,7 @@ int		gNumSplitImpulseRecoveries = 0;
 btSequentialImpulseConstraintSolver::btSequentialImpulseConstraintSolver()
 :m_btSeed2(0)
 {
-
+	m_groupMarker = m_frameArena.getMarker();
 }
 
 btSequentialImpulseConstraintSolver::~btSequentialImpulseConstraintSolver()
@@ -514,12 +514,14 @@ void btSequentialImpulseConstraintSolver::setupContactConstraint(btSolverConstra
 
 				btScalar penetration = cp.getDistance()+infoGlobal.m_linearSlop;
 
+				//a speculative contact is still separated, the bodies may not touch during this step
+				bool isSpeculative = (infoGlobal.m_solverMode & SOLVER_USE_SPECULATIVE_CONTACTS) && (penetration > btScalar(0.));
 
 				solverConstraint.m_friction = cp.m_combinedFriction;
 
 				btScalar restitution = 0.f;
 				
-				if (cp.m_lifeTime>infoGlobal.m_restingContactRestitutionThreshold)
+				if (isSpeculative || (cp.m_lifeTime>infoGlobal.m_restingContactRestitutionThreshold))
 				{
 					restitution = 0.f;
 				} else
@@ -557,8 +559,15 @@ void btSequentialImpulseConstraintSolver::setupContactConstraint(btSolverConstra
 					rel_vel = vel1Dotn+vel2Dotn;
 
 					btScalar positionalError = 0.f;
-					positionalError = -penetration * infoGlobal.m_erp/infoGlobal.m_timeStep;
 					btScalar	velocityError = restitution - rel_vel;// * damping;
+					if (isSpeculative)
+					{
+						//speculative contact: allow the bodies to close the gap during this step, but not to pass through
+						velocityError -= penetration / infoGlobal.m_timeStep;
+					} else
+					{
+						positionalError = -penetration * infoGlobal.m_erp/infoGlobal.m_timeStep;
+					}
 					btScalar  penetrationImpulse = positionalError*solverConstraint.m_jacDiagABInv;
 					btScalar velocityImpulse = velocityError *solverConstraint.m_jacDiagABInv;
 					if (!infoGlobal.m_splitImpulse || (penetration > infoGlobal.m_splitImpulsePenetrationThreshold))
@@ -738,6 +747,8 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 	(void)stackAlloc;
 	(void)debugDrawer;
 
+	//the temporary arrays of this group are allocated from the arena, solveGroupCacheFriendlyFinish rewinds it
+	m_groupMarker = m_frameArena.getMarker();
 
 	if (!(numConstraints + numManifolds))
 	{
@@ -790,7 +801,7 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 			int totalNumRows = 0;
 			int i;
 			
-			m_tmpConstraintSizesPool.resize(numConstraints);
+			m_tmpConstraintSizesPool.initializeFromBuffer(m_frameArena.allocateArray<btTypedConstraint::btConstraintInfo1>(numConstraints),numConstraints,numConstraints);
 			//calculate the total number of contraint rows
 			for (i=0;i<numConstraints;i++)
 			{
@@ -798,7 +809,7 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 				constraints[i]->getInfo1(&info1);
 				totalNumRows += info1.m_numConstraintRows;
 			}
-			m_tmpSolverNonContactConstraintPool.resize(totalNumRows);
+			m_tmpSolverNonContactConstraintPool.initializeFromBuffer(m_frameArena.allocateArray<btSolverConstraint>(totalNumRows),totalNumRows,totalNumRows);
 
 			
 			///setup the btSolverConstraints
@@ -918,6 +929,14 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 			btPersistentManifold* manifold = 0;
 //			btCollisionObject* colObj0=0,*colObj1=0;
 
+			//each contact point needs at most one contact row and two friction rows
+			int maxContacts = 0;
+			for (i=0;i<numManifolds;i++)
+			{
+				maxContacts += manifoldPtr[i]->getNumContacts();
+			}
+			m_tmpSolverContactConstraintPool.initializeFromBuffer(m_frameArena.allocateArray<btSolverConstraint>(maxContacts),0,maxContacts);
+			m_tmpSolverContactFrictionConstraintPool.initializeFromBuffer(m_frameArena.allocateArray<btSolverConstraint>(maxContacts*2),0,maxContacts*2);
 
 			for (i=0;i<numManifolds;i++)
 			{
@@ -934,9 +953,8 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlySetup(btCol
 	int numConstraintPool = m_tmpSolverContactConstraintPool.size();
 	int numFrictionPool = m_tmpSolverContactFrictionConstraintPool.size();
 
-	///@todo: use stack allocator for such temporarily memory, same for solver bodies/constraints
-	m_orderTmpConstraintPool.resize(numConstraintPool);
-	m_orderFrictionConstraintPool.resize(numFrictionPool);
+	m_orderTmpConstraintPool.initializeFromBuffer(m_frameArena.allocateArray<int>(numConstraintPool),numConstraintPool,numConstraintPool);
+	m_orderFrictionConstraintPool.initializeFromBuffer(m_frameArena.allocateArray<int>(numFrictionPool),numFrictionPool,numFrictionPool);
 	{
 		int i;
 		for (i=0;i<numConstraintPool;i++)
@@ -1170,6 +1188,11 @@ btScalar btSequentialImpulseConstraintSolver::solveGroupCacheFriendlyFinish(btCo
 	m_tmpSolverContactConstraintPool.resize(0);
 	m_tmpSolverNonContactConstraintPool.resize(0);
 	m_tmpSolverContactFrictionConstraintPool.resize(0);
+	m_orderTmpConstraintPool.resize(0);
+	m_orderFrictionConstraintPool.resize(0);
+	m_tmpConstraintSizesPool.resize(0);
+
+	m_frameArena.rewind(m_groupMarker);
 
 	return 0.f;
 }
@@ -1194,6 +1217,11 @@ btScalar btSequentialImpulseConstraintSolver::solveGroup(btCollisionObject** bod
 	return 0.f;
 }
 
+void	btSequentialImpulseConstraintSolver::prepareSolve(int /*numBodies*/, int /*numManifolds*/)
+{
+	m_frameArena.reset();
+}
+
 void	btSequentialImpulseConstraintSolver::reset()
 {
 	m_btSeed2 = 0;
@@ -23,12 +23,18 @@ class btIDebugDraw;
 #include "btSolverConstraint.h"
 #include "btTypedConstraint.h"
 #include "BulletCollision/NarrowPhaseCollision/btManifoldPoint.h"
+#include "LinearMath/btFrameArena.h"
 
 ///The btSequentialImpulseConstraintSolver is a fast SIMD implementation of the Projected Gauss Seidel (iterative LCP) method.
+///The constraint rows and order arrays of a group live in a btFrameArena that is rewound after each group and reset in prepareSolve, so solving doesn't allocate once the arena has grown to the largest group.
+///Use one solver per thread when solving islands in parallel, each solver has its own arena.
 class btSequentialImpulseConstraintSolver : public btConstraintSolver
 {
 protected:
 
+	btFrameArena				m_frameArena;
+	btFrameArenaMarker			m_groupMarker;
+
 	btConstraintArray			m_tmpSolverContactConstraintPool;
 	btConstraintArray			m_tmpSolverNonContactConstraintPool;
 	btConstraintArray			m_tmpSolverContactFrictionConstraintPool;
@@ -97,8 +103,15 @@ public:
 	btSequentialImpulseConstraintSolver();
 	virtual ~btSequentialImpulseConstraintSolver();
 
+	virtual void prepareSolve(int numBodies, int numManifolds);
+
 	virtual btScalar solveGroup(btCollisionObject** bodies,int numBodies,btPersistentManifold** manifold,int numManifolds,btTypedConstraint** constraints,int numConstraints,const btContactSolverInfo& info, btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc,btDispatcher* dispatcher);
 	
+	///getFrameArena gives access to the arena of the solver, its getHighWaterMark is the peak memory used by a group
+	const btFrameArena&	getFrameArena() const
+	{
+		return m_frameArena;
+	}
 
 	
 	///clear internal cached data and reset random seed
@@ -403,3 +403,48 @@ double plNearestPoints(float p1[3], float p2[3], float p3[3], float q1[3], float
 	return -1.0f;	
 }
 
+
+void	plProfileBegin(const char* name)
+{
+#ifndef BT_NO_PROFILE
+	CProfileManager::Start_Profile(name);
+#else
+	(void)name;
+#endif //BT_NO_PROFILE
+}
+
+void	plProfileEnd()
+{
+#ifndef BT_NO_PROFILE
+	CProfileManager::Stop_Profile();
+#endif //BT_NO_PROFILE
+}
+
+void	plProfileSetThreadName(const char* name)
+{
+#ifndef BT_NO_PROFILE
+	CProfileManager::setThreadName(name);
+#else
+	(void)name;
+#endif //BT_NO_PROFILE
+}
+
+void	plProfileSetEventRecording(int enable, int eventsPerThread)
+{
+#ifndef BT_NO_PROFILE
+	CProfileManager::setEventRecording(enable != 0, eventsPerThread);
+#else
+	(void)enable;
+	(void)eventsPerThread;
+#endif //BT_NO_PROFILE
+}
+
+int		plProfileWriteChromeTrace(const char* fileName)
+{
+#ifndef BT_NO_PROFILE
+	return CProfileManager::writeChromeTrace(fileName) ? 1 : 0;
+#else
+	(void)fileName;
+	return 0;
+#endif //BT_NO_PROFILE
+}
@@ -0,0 +1,1230 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btBulletFileLoader.h"
+#include "btDynamicsWorld.h"
+#include "btRigidBody.h"
+#include "LinearMath/btSerializer.h"
+#include "BulletCollision/CollisionShapes/btBoxShape.h"
+#include "BulletCollision/CollisionShapes/btSphereShape.h"
+#include "BulletCollision/CollisionShapes/btCapsuleShape.h"
+#include "BulletCollision/CollisionShapes/btCylinderShape.h"
+#include "BulletCollision/CollisionShapes/btMultiSphereShape.h"
+#include "BulletCollision/CollisionShapes/btConvexHullShape.h"
+#include "BulletCollision/CollisionShapes/btStaticPlaneShape.h"
+#include "BulletCollision/CollisionShapes/btCompoundShape.h"
+#include "BulletCollision/CollisionShapes/btBvhTriangleMeshShape.h"
+#include "BulletCollision/CollisionShapes/btOptimizedBvh.h"
+#include "BulletCollision/CollisionShapes/btTriangleIndexVertexArray.h"
+#include "BulletCollision/CollisionShapes/btTriangleInfoMap.h"
+#include "BulletDynamics/ConstraintSolver/btPoint2PointConstraint.h"
+#include "BulletDynamics/ConstraintSolver/btHingeConstraint.h"
+#include "BulletDynamics/ConstraintSolver/btConeTwistConstraint.h"
+#include "BulletDynamics/ConstraintSolver/btGeneric6DofConstraint.h"
+#include "BulletDynamics/ConstraintSolver/btSliderConstraint.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#if !defined (_WIN32) && !defined (__SPU__)
+#define BT_BULLET_FILE_USE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif //_WIN32
+
+//the endian character in the header is replaced once the pointers are fixed up, so a buffer is not loaded twice
+#define BT_BULLET_FILE_LOADED_MARKER 'L'
+
+btBulletFileLoader::btBulletFileLoader(btDynamicsWorld* dynamicsWorld)
+:m_dynamicsWorld(dynamicsWorld),
+m_buffer(0),
+m_bufferSize(0),
+m_bufferOwnership(BUFFER_EXTERNAL),
+m_numSkippedChunks(0)
+{
+}
+
+btBulletFileLoader::~btBulletFileLoader()
+{
+	unload();
+}
+
+static SIMD_FORCE_INLINE char*	btAlignDNA(char* dna,char* ptr)
+{
+	return dna + ((ptr-dna+3)&~3);
+}
+
+bool	btBulletFileLoader::parseDNA(char* dna,int dnaLength)
+{
+	char* end = dna+dnaLength;
+
+	/*
+		SDNA, NAME, <number of names>, <names>
+		TYPE, <number of types>, <types>
+		TLEN, <type lengths>
+		STRC, <number of structs>, <type, number of members, (type, name) for each member>
+	*/
+	if ((dnaLength < 12) || strncmp(dna,"SDNA",4) || strncmp(dna+4,"NAME",4))
+		return false;
+
+	int numNames = *(int*)(dna+8);
+	char* cp = dna+12;
+	int i;
+	for (i=0;i<numNames;i++)
+	{
+		m_dnaNames.push_back(cp);
+		while ((cp < end) && *cp)
+			cp++;
+		cp++;
+	}
+	cp = btAlignDNA(dna,cp);
+
+	if ((cp+8 > end) || strncmp(cp,"TYPE",4))
+		return false;
+	int numTypes = *(int*)(cp+4);
+	cp += 8;
+	for (i=0;i<numTypes;i++)
+	{
+		m_dnaTypes.push_back(cp);
+		while ((cp < end) && *cp)
+			cp++;
+		cp++;
+	}
+	cp = btAlignDNA(dna,cp);
+
+	if ((cp+4+numTypes*2 > end) || strncmp(cp,"TLEN",4))
+		return false;
+	short* shtPtr = (short*)(cp+4);
+	for (i=0;i<numTypes;i++)
+	{
+		m_dnaTypeLengths.push_back(shtPtr[i]);
+	}
+	cp = btAlignDNA(dna,(char*)(shtPtr+numTypes));
+
+	if ((cp+8 > end) || strncmp(cp,"STRC",4))
+		return false;
+	int numStructs = *(int*)(cp+4);
+	shtPtr = (short*)(cp+8);
+	m_dnaStructOfType.resize(numTypes,-1);
+	for (i=0;i<numStructs;i++)
+	{
+		if ((char*)(shtPtr+2) > end)
+			return false;
+		int numMembers = shtPtr[1];
+		if (((char*)(shtPtr+2+2*numMembers) > end) || (shtPtr[0] < 0) || (shtPtr[0] >= numTypes))
+			return false;
+		m_dnaStructs.push_back(shtPtr);
+		m_dnaStructOfType[shtPtr[0]] = i;
+		shtPtr += 2+2*numMembers;
+	}
+
+	//the pointer fixup walks the members, so they have to add up to the length of the struct
+	for (i=0;i<numStructs;i++)
+	{
+		const short* strc = m_dnaStructs[i];
+		int size = 0;
+		for (int m=0;m<strc[1];m++)
+		{
+			int type = strc[2+2*m];
+			int name = strc[3+2*m];
+			if ((type < 0) || (type >= numTypes) || (name < 0) || (name >= numNames))
+				return false;
+			const char* memberName = m_dnaNames[name];
+			int memberSize = ((memberName[0]=='*') || (memberName[0]=='(')) ? int(sizeof(void*)) : m_dnaTypeLengths[type];
+			size += memberSize*getArraySize(memberName);
+		}
+		if (size != m_dnaTypeLengths[strc[0]])
+			return false;
+	}
+
+	//vertex, index and bvh node arrays have no pointers, the fixup skips them instead of walking every element
+	m_dnaStructHasPointers.resize(numStructs,false);
+	bool changed = true;
+	while (changed)
+	{
+		changed = false;
+		for (i=0;i<numStructs;i++)
+		{
+			if (m_dnaStructHasPointers[i])
+				continue;
+			const short* strc = m_dnaStructs[i];
+			for (int m=0;m<strc[1];m++)
+			{
+				const char* memberName = m_dnaNames[strc[3+2*m]];
+				int subStruct = m_dnaStructOfType[strc[2+2*m]];
+				if ((memberName[0]=='*') || (memberName[0]=='(') || ((subStruct >= 0) && m_dnaStructHasPointers[subStruct]))
+				{
+					m_dnaStructHasPointers[i] = true;
+					changed = true;
+					break;
+				}
+			}
+		}
+	}
+	return true;
+}
+
+int		btBulletFileLoader::getArraySize(const char* name) const
+{
+	int size = 1;
+	for (const char* cp = name;*cp;cp++)
+	{
+		if (*cp == '[')
+		{
+			int dim = 0;
+			for (cp++;(*cp >= '0') && (*cp <= '9');cp++)
+			{
+				dim = dim*10 + (*cp-'0');
+			}
+			size *= dim;
+			if (!*cp)
+				break;
+		}
+	}
+	return size;
+}
+
+bool	btBulletFileLoader::checkStructSize(const char* typeName,int size) const
+{
+	for (int i=0;i<m_dnaStructs.size();i++)
+	{
+		int type = m_dnaStructs[i][0];
+		if (!strcmp(m_dnaTypes[type],typeName))
+			return m_dnaTypeLengths[type] == size;
+	}
+	//types that are not in the file are not used by its chunks
+	return true;
+}
+
+void	btBulletFileLoader::fixupPointers(char* data,int structIndex)
+{
+	const short* strc = m_dnaStructs[structIndex];
+	const short* member = strc+2;
+	for (int m=0;m<strc[1];m++,member+=2)
+	{
+		const char* name = m_dnaNames[member[1]];
+		int arraySize = getArraySize(name);
+		if ((name[0]=='*') || (name[0]=='('))
+		{
+			void** ptrs = (void**)data;
+			for (int a=0;a<arraySize;a++)
+			{
+				if (ptrs[a])
+				{
+					//pointers to objects that were not serialized, like the fixed body of a constraint, become 0
+					void** found = m_chunkData.find(ptrs[a]);
+					ptrs[a] = found ? *found : 0;
+				}
+			}
+			data += sizeof(void*)*arraySize;
+		} else
+		{
+			int type = member[0];
+			int length = m_dnaTypeLengths[type];
+			int subStruct = m_dnaStructOfType[type];
+			if ((subStruct >= 0) && m_dnaStructHasPointers[subStruct])
+			{
+				for (int a=0;a<arraySize;a++)
+				{
+					fixupPointers(data+a*length,subStruct);
+				}
+			}
+			data += length*arraySize;
+		}
+	}
+}
+
+bool	btBulletFileLoader::isArrayInChunk(const void* array,int count,int elementSize) const
+{
+	if (!count)
+		return true;
+	if (!array || (count < 0))
+		return false;
+	//arrays are serialized as one chunk each, so the pointer is the start of the chunk data
+	const btChunkInfo* info = m_chunkInfos.find(array);
+	return info && (count <= info->m_length/elementSize);
+}
+
+///isStructInChunk returns true if data is the start of a chunk that holds structs of type typeName.
+///The chunk length was checked against the DNA of the file and the struct sizes against this build, so the data can be cast to the struct.
+bool	btBulletFileLoader::isStructInChunk(const void* data,const char* typeName) const
+{
+	if (!data || !typeName)
+		return false;
+	const btChunkInfo* info = m_chunkInfos.find(data);
+	return info && (info->m_dnaNr >= 0) && !strcmp(m_dnaTypes[m_dnaStructs[info->m_dnaNr][0]],typeName);
+}
+
+///btGetShapeDataName returns the struct that btCollisionShape::serialize writes for the shape type, or 0 if the loader doesn't support the shape type
+static const char*	btGetShapeDataName(int shapeType)
+{
+	switch (shapeType)
+	{
+	case STATIC_PLANE_PROXYTYPE:
+		return "btStaticPlaneShapeData";
+	case BOX_SHAPE_PROXYTYPE:
+	case SPHERE_SHAPE_PROXYTYPE:
+		return "btConvexInternalShapeData";
+	case CAPSULE_SHAPE_PROXYTYPE:
+		return "btCapsuleShapeData";
+	case CYLINDER_SHAPE_PROXYTYPE:
+		return "btCylinderShapeData";
+	case MULTI_SPHERE_SHAPE_PROXYTYPE:
+		return "btMultiSphereShapeData";
+	case CONVEX_HULL_SHAPE_PROXYTYPE:
+		return "btConvexHullShapeData";
+	case COMPOUND_SHAPE_PROXYTYPE:
+		return "btCompoundShapeData";
+	case TRIANGLE_MESH_SHAPE_PROXYTYPE:
+		return "btTriangleMeshShapeData";
+	default:
+		return 0;
+	}
+}
+
+///btGetConstraintDataName returns the struct that btTypedConstraint::serialize writes for the constraint type
+static const char*	btGetConstraintDataName(int constraintType)
+{
+	switch (constraintType)
+	{
+	case POINT2POINT_CONSTRAINT_TYPE:
+		return btPoint2PointConstraintDataName;
+	case HINGE_CONSTRAINT_TYPE:
+		return btHingeConstraintDataName;
+	case CONETWIST_CONSTRAINT_TYPE:
+		return "btConeTwistConstraintData";
+	case D6_CONSTRAINT_TYPE:
+		return "btGeneric6DofConstraintData";
+	case SLIDER_CONSTRAINT_TYPE:
+		return "btSliderConstraintData";
+	default:
+		return 0;
+	}
+}
+
+bool	btBulletFileLoader::loadBuffer(void* alignedBuffer,int bufferSize)
+{
+	unload();
+
+	char* buffer = (char*)alignedBuffer;
+	if (!buffer || (bufferSize < BT_HEADER_LENGTH))
+		return false;
+
+#ifdef BT_USE_DOUBLE_PRECISION
+	if (strncmp(buffer,"BULLETd",7))
+		return false;
+#else
+	if (strncmp(buffer,"BULLETf",7))
+		return false;
+#endif //BT_USE_DOUBLE_PRECISION
+
+	int littleEndian= 1;
+	littleEndian= ((char*)&littleEndian)[0];
+	if ((buffer[7] != ((sizeof(void*)==8) ? '-' : '_')) ||
+		(buffer[8] != (littleEndian ? 'v' : 'V')) ||
+		strncmp(buffer+9,"277",3))
+	{
+		return false;
+	}
+
+	char* dna = 0;
+	int dnaLength = 0;
+	char* ptr = buffer+BT_HEADER_LENGTH;
+	char* end = buffer+bufferSize;
+	while (ptr+sizeof(btChunk) <= end)
+	{
+		btChunk* chunk = (btChunk*)ptr;
+		char* data = ptr+sizeof(btChunk);
+		if ((chunk->m_length < 0) || (chunk->m_length > end-data))
+		{
+			unload();
+			return false;
+		}
+		if (chunk->m_chunkCode == BT_DNA_CODE)
+		{
+			//finishSerialization writes the DNA last
+			dna = data;
+			dnaLength = chunk->m_length;
+			break;
+		} else
+		{
+			m_chunks.push_back(chunk);
+			m_chunkData.insert(chunk->m_oldPtr,data);
+			btChunkInfo info;
+			info.m_length = chunk->m_length;
+			info.m_dnaNr = chunk->m_dna_nr;
+			m_chunkInfos.insert(data,info);
+		}
+		ptr = data+chunk->m_length;
+	}
+
+	if (!dna || !parseDNA(dna,dnaLength))
+	{
+		unload();
+		return false;
+	}
+
+	//the objects are read straight from the buffer, so the structs of the file have to match the ones of this build
+	if (!checkStructSize("btCollisionShapeData",sizeof(btCollisionShapeData)) ||
+		!checkStructSize("btConvexInternalShapeData",sizeof(btConvexInternalShapeData)) ||
+		!checkStructSize("btStaticPlaneShapeData",sizeof(btStaticPlaneShapeData)) ||
+		!checkStructSize("btCapsuleShapeData",sizeof(btCapsuleShapeData)) ||
+		!checkStructSize("btCylinderShapeData",sizeof(btCylinderShapeData)) ||
+		!checkStructSize("btMultiSphereShapeData",sizeof(btMultiSphereShapeData)) ||
+		!checkStructSize("btPositionAndRadius",sizeof(btPositionAndRadius)) ||
+		!checkStructSize("btConvexHullShapeData",sizeof(btConvexHullShapeData)) ||
+		!checkStructSize("btCompoundShapeData",sizeof(btCompoundShapeData)) ||
+		!checkStructSize("btCompoundShapeChildData",sizeof(btCompoundShapeChildData)) ||
+		!checkStructSize("btTriangleMeshShapeData",sizeof(btTriangleMeshShapeData)) ||
+		!checkStructSize("btStridingMeshInterfaceData",sizeof(btStridingMeshInterfaceData)) ||
+		!checkStructSize("btMeshPartData",sizeof(btMeshPartData)) ||
+		!checkStructSize("btTriangleInfoMapData",sizeof(btTriangleInfoMapData)) ||
+		!checkStructSize(btQuantizedBvhDataName,sizeof(btQuantizedBvhData)) ||
+		!checkStructSize(btCollisionObjectDataName,sizeof(btCollisionObjectData)) ||
+		!checkStructSize(btRigidBodyDataName,sizeof(btRigidBodyData)) ||
+		!checkStructSize("btTypedConstraintData",sizeof(btTypedConstraintData)) ||
+		!checkStructSize(btPoint2PointConstraintDataName,sizeof(btPoint2PointConstraintData)) ||
+		!checkStructSize(btHingeConstraintDataName,sizeof(btHingeConstraintData)) ||
+		!checkStructSize("btConeTwistConstraintData",sizeof(btConeTwistConstraintData)) ||
+		!checkStructSize("btGeneric6DofConstraintData",sizeof(btGeneric6DofConstraintData)) ||
+		!checkStructSize("btSliderConstraintData",sizeof(btSliderConstraintData)))
+	{
+		unload();
+		return false;
+	}
+
+	int i;
+	for (i=0;i<m_chunks.size();i++)
+	{
+		btChunk* chunk = m_chunks[i];
+		if (chunk->m_dna_nr < 0)
+			continue;
+		if ((chunk->m_dna_nr >= m_dnaStructs.size()) ||
+			(chunk->m_number < 1) ||
+			(m_dnaTypeLengths[m_dnaStructs[chunk->m_dna_nr][0]]*chunk->m_number != chunk->m_length))
+		{
+			unload();
+			return false;
+		}
+	}
+
+	//nothing can fail from here on, the buffer is modified
+	for (i=0;i<m_chunks.size();i++)
+	{
+		btChunk* chunk = m_chunks[i];
+		if ((chunk->m_dna_nr < 0) || !m_dnaStructHasPointers[chunk->m_dna_nr])
+			continue;
+		char* data = (char*)(chunk+1);
+		int structLength = m_dnaTypeLengths[m_dnaStructs[chunk->m_dna_nr][0]];
+		for (int e=0;e<chunk->m_number;e++)
+		{
+			fixupPointers(data+e*structLength,chunk->m_dna_nr);
+		}
+	}
+	buffer[8] = BT_BULLET_FILE_LOADED_MARKER;
+
+	m_buffer = alignedBuffer;
+	m_bufferSize = bufferSize;
+	m_bufferOwnership = BUFFER_EXTERNAL;
+
+	for (i=0;i<m_chunks.size();i++)
+	{
+		if (m_chunks[i]->m_chunkCode == BT_SHAPE_CODE)
+		{
+			convertCollisionShape((btCollisionShapeData*)(m_chunks[i]+1));
+		}
+	}
+	for (i=0;i<m_chunks.size();i++)
+	{
+		if (m_chunks[i]->m_chunkCode == BT_RIGIDBODY_CODE)
+		{
+			if (isStructInChunk(m_chunks[i]+1,btRigidBodyDataName))
+				convertRigidBody(m_chunks[i]+1);
+			else
+				m_numSkippedChunks++;
+		} else if (m_chunks[i]->m_chunkCode == BT_COLLISIONOBJECT_CODE)
+		{
+			if (isStructInChunk(m_chunks[i]+1,btCollisionObjectDataName))
+				convertCollisionObject(m_chunks[i]+1);
+			else
+				m_numSkippedChunks++;
+		}
+	}
+	for (i=0;i<m_chunks.size();i++)
+	{
+		if (m_chunks[i]->m_chunkCode == BT_CONSTRAINT_CODE)
+		{
+			convertConstraint((btTypedConstraintData*)(m_chunks[i]+1));
+		}
+	}
+
+	//the chunk table is only needed while loading
+	m_chunks.clear();
+	m_chunkData.clear();
+	m_chunkInfos.clear();
+	m_shapeMap.clear();
+	m_bodyMap.clear();
+	return true;
+}
+
+btCollisionShape*	btBulletFileLoader::convertCollisionShape(btCollisionShapeData* shapeData)
+{
+	btCollisionShape** found = m_shapeMap.find(shapeData);
+	if (found)
+		return *found;
+
+	btCollisionShape* shape = 0;
+	//a compound that contains itself finds the 0 and skips the child
+	m_shapeMap.insert(shapeData,shape);
+
+	//the shape type is only read from a chunk that is large enough for it, then the chunk has to hold the struct of that type
+	const btChunkInfo* chunkInfo = m_chunkInfos.find(shapeData);
+	if (!chunkInfo || (chunkInfo->m_length < int(sizeof(btCollisionShapeData))) ||
+		!isStructInChunk(shapeData,btGetShapeDataName(shapeData->m_shapeType)))
+	{
+		m_numSkippedChunks++;
+		return 0;
+	}
+
+	switch (shapeData->m_shapeType)
+	{
+	case STATIC_PLANE_PROXYTYPE:
+		{
+			btStaticPlaneShapeData* planeData = (btStaticPlaneShapeData*)shapeData;
+			btVector3 planeNormal,localScaling;
+			planeNormal.deSerializeFloat(planeData->m_planeNormal);
+			localScaling.deSerializeFloat(planeData->m_localScaling);
+			btStaticPlaneShape* plane = new btStaticPlaneShape(planeNormal,planeData->m_planeConstant);
+			plane->setLocalScaling(localScaling);
+			shape = plane;
+			break;
+		}
+	case BOX_SHAPE_PROXYTYPE:
+	case SPHERE_SHAPE_PROXYTYPE:
+	case CAPSULE_SHAPE_PROXYTYPE:
+	case CYLINDER_SHAPE_PROXYTYPE:
+		{
+			btConvexInternalShapeData* convexData = (btConvexInternalShapeData*)shapeData;
+			btVector3 implicitShapeDimensions,localScaling;
+			implicitShapeDimensions.deSerializeFloat(convexData->m_implicitShapeDimensions);
+			localScaling.deSerializeFloat(convexData->m_localScaling);
+
+			btConvexInternalShape* convex = 0;
+			int upAxis = 1;
+			if (shapeData->m_shapeType == CAPSULE_SHAPE_PROXYTYPE)
+				upAxis = ((btCapsuleShapeData*)shapeData)->m_upAxis;
+			if (shapeData->m_shapeType == CYLINDER_SHAPE_PROXYTYPE)
+				upAxis = ((btCylinderShapeData*)shapeData)->m_upAxis;
+
+			switch (shapeData->m_shapeType)
+			{
+			case BOX_SHAPE_PROXYTYPE:
+				convex = new btBoxShape(btVector3(btScalar(1.),btScalar(1.),btScalar(1.)));
+				break;
+			case SPHERE_SHAPE_PROXYTYPE:
+				convex = new btSphereShape(implicitShapeDimensions.getX());
+				break;
+			case CAPSULE_SHAPE_PROXYTYPE:
+				if (upAxis == 0)
+					convex = new btCapsuleShapeX(btScalar(1.),btScalar(1.));
+				else if (upAxis == 2)
+					convex = new btCapsuleShapeZ(btScalar(1.),btScalar(1.));
+				else
+					convex = new btCapsuleShape(btScalar(1.),btScalar(1.));
+				break;
+			default:
+				if (upAxis == 0)
+					convex = new btCylinderShapeX(btVector3(btScalar(1.),btScalar(1.),btScalar(1.)));
+				else if (upAxis == 2)
+					convex = new btCylinderShapeZ(btVector3(btScalar(1.),btScalar(1.),btScalar(1.)));
+				else
+					convex = new btCylinderShape(btVector3(btScalar(1.),btScalar(1.),btScalar(1.)));
+			}
+
+			//the saved dimensions already include the scaling and margin, so they are set directly instead of being recalculated
+			convex->setMargin(convexData->m_collisionMargin);
+			convex->btConvexInternalShape::setLocalScaling(localScaling);
+			convex->setImplicitShapeDimensions(implicitShapeDimensions);
+			shape = convex;
+			break;
+		}
+	case MULTI_SPHERE_SHAPE_PROXYTYPE:
+		{
+			btMultiSphereShapeData* multiSphereData = (btMultiSphereShapeData*)shapeData;
+			int numSpheres = multiSphereData->m_localPositionArrayPtr ? multiSphereData->m_localPositionArraySize : 0;
+			if (!numSpheres || !isArrayInChunk(multiSphereData->m_localPositionArrayPtr,numSpheres,sizeof(btPositionAndRadius)))
+				break;
+			btAlignedObjectArray<btVector3> positions;
+			btAlignedObjectArray<btScalar> radii;
+			positions.resize(numSpheres);
+			radii.resize(numSpheres);
+			for (int i=0;i<numSpheres;i++)
+			{
+				positions[i].deSerializeFloat(multiSphereData->m_localPositionArrayPtr[i].m_pos);
+				radii[i] = multiSphereData->m_localPositionArrayPtr[i].m_radius;
+			}
+			btVector3 localScaling;
+			localScaling.deSerializeFloat(multiSphereData->m_convexInternalShapeData.m_localScaling);
+			btMultiSphereShape* multiSphere = new btMultiSphereShape(&positions[0],&radii[0],numSpheres);
+			multiSphere->setMargin(multiSphereData->m_convexInternalShapeData.m_collisionMargin);
+			multiSphere->setLocalScaling(localScaling);
+			shape = multiSphere;
+			break;
+		}
+	case CONVEX_HULL_SHAPE_PROXYTYPE:
+		{
+			btConvexHullShapeData* hullData = (btConvexHullShapeData*)shapeData;
+#ifdef BT_USE_DOUBLE_PRECISION
+			btVector3DoubleData* unscaledPoints = hullData->m_unscaledPointsDoublePtr;
+#else
+			btVector3FloatData* unscaledPoints = hullData->m_unscaledPointsFloatPtr;
+#endif //BT_USE_DOUBLE_PRECISION
+			if (!isArrayInChunk(unscaledPoints,hullData->m_numUnscaledPoints,sizeof(*unscaledPoints)))
+				break;
+			btAlignedObjectArray<btVector3> points;
+			points.resize(hullData->m_numUnscaledPoints);
+			for (int i=0;i<points.size();i++)
+			{
+#ifdef BT_USE_DOUBLE_PRECISION
+				points[i].deSerializeDouble(unscaledPoints[i]);
+#else
+				points[i].deSerializeFloat(unscaledPoints[i]);
+#endif //BT_USE_DOUBLE_PRECISION
+			}
+			btVector3 localScaling;
+			localScaling.deSerializeFloat(hullData->m_convexInternalShapeData.m_localScaling);
+			btConvexHullShape* hull = new btConvexHullShape(points.size() ? &points[0].getX() : 0,points.size(),sizeof(btVector3));
+			hull->setMargin(hullData->m_convexInternalShapeData.m_collisionMargin);
+			hull->setLocalScaling(localScaling);
+			shape = hull;
+			break;
+		}
+	case COMPOUND_SHAPE_PROXYTYPE:
+		shape = convertCompoundShape((btCompoundShapeData*)shapeData);
+		break;
+	case TRIANGLE_MESH_SHAPE_PROXYTYPE:
+		shape = convertTriangleMeshShape((btTriangleMeshShapeData*)shapeData);
+		break;
+	default:
+		break;
+	}
+
+	if (shape)
+	{
+		m_collisionShapes.push_back(shape);
+		if (shapeData->m_name)
+		{
+			m_objectNames.insert(shape,shapeData->m_name);
+		}
+	} else
+	{
+		m_numSkippedChunks++;
+	}
+	m_shapeMap.insert(shapeData,shape);
+	return shape;
+}
+
+btCollisionShape*	btBulletFileLoader::convertCompoundShape(btCompoundShapeData* compoundData)
+{
+	btCompoundShape* compound = new btCompoundShape();
+	if (!compoundData->m_numChildShapes ||
+		(isStructInChunk(compoundData->m_childShapePtr,"btCompoundShapeChildData") &&
+		isArrayInChunk(compoundData->m_childShapePtr,compoundData->m_numChildShapes,sizeof(btCompoundShapeChildData))))
+	{
+		for (int i=0;i<compoundData->m_numChildShapes;i++)
+		{
+			btCompoundShapeChildData& childData = compoundData->m_childShapePtr[i];
+			btCollisionShape* childShape = childData.m_childShape ? convertCollisionShape(childData.m_childShape) : 0;
+			if (!childShape)
+				continue;
+			btTransform childTransform;
+			childTransform.deSerializeFloat(childData.m_transform);
+			compound->addChildShape(childTransform,childShape);
+		}
+	}
+	compound->setMargin(compoundData->m_collisionMargin);
+	return compound;
+}
+
+btCollisionShape*	btBulletFileLoader::convertTriangleMeshShape(btTriangleMeshShapeData* trimeshData)
+{
+	btStridingMeshInterfaceData& meshData = trimeshData->m_meshInterface;
+	if ((meshData.m_numMeshParts < 1) || !isStructInChunk(meshData.m_meshPartsPtr,"btMeshPartData") ||
+		!isArrayInChunk(meshData.m_meshPartsPtr,meshData.m_numMeshParts,sizeof(btMeshPartData)))
+		return 0;
+
+	//the index and vertex arrays are used in place
+	btTriangleIndexVertexArray* meshInterface = new btTriangleIndexVertexArray();
+	for (int i=0;i<meshData.m_numMeshParts;i++)
+	{
+		btMeshPartData& partData = meshData.m_meshPartsPtr[i];
+		btIndexedMesh mesh;
+		mesh.m_numTriangles = partData.m_numTriangles;
+		mesh.m_numVertices = partData.m_numVertices;
+		if (partData.m_indices32)
+		{
+			mesh.m_triangleIndexBase = (const unsigned char*)partData.m_indices32;
+			mesh.m_triangleIndexStride = 3*sizeof(btIntIndexData);
+			mesh.m_indexType = PHY_INTEGER;
+		} else if (partData.m_3indices16)
+		{
+			mesh.m_triangleIndexBase = (const unsigned char*)partData.m_3indices16;
+			mesh.m_triangleIndexStride = sizeof(btShortIntIndexTripletData);
+			mesh.m_indexType = PHY_SHORT;
+		} else
+		{
+			//the padded 16 bit indices of older files can't be used in place
+			delete meshInterface;
+			return 0;
+		}
+		if (partData.m_vertices3f)
+		{
+			mesh.m_vertexBase = (const unsigned char*)partData.m_vertices3f;
+			mesh.m_vertexStride = sizeof(btVector3FloatData);
+			mesh.m_vertexType = PHY_FLOAT;
+		} else if (partData.m_vertices3d)
+		{
+			mesh.m_vertexBase = (const unsigned char*)partData.m_vertices3d;
+			mesh.m_vertexStride = sizeof(btVector3DoubleData);
+			mesh.m_vertexType = PHY_DOUBLE;
+		} else
+		{
+			delete meshInterface;
+			return 0;
+		}
+		if ((mesh.m_numTriangles < 0) ||
+			!isArrayInChunk(mesh.m_triangleIndexBase,mesh.m_numTriangles,mesh.m_triangleIndexStride) ||
+			!isArrayInChunk(mesh.m_vertexBase,mesh.m_numVertices,mesh.m_vertexStride))
+		{
+			delete meshInterface;
+			return 0;
+		}
+		meshInterface->addIndexedMesh(mesh,mesh.m_indexType);
+	}
+	btVector3 meshScaling;
+	meshScaling.deSerializeFloat(meshData.m_scaling);
+	meshInterface->setScaling(meshScaling);
+
+	//the local aabb is not serialized, a single pass over the triangles is much cheaper than recalcLocalAabb
+	btVector3 aabbMin(btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT),btScalar(BT_LARGE_FLOAT));
+	btVector3 aabbMax(btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT),btScalar(-BT_LARGE_FLOAT));
+	for (int part=0;part<meshInterface->getNumSubParts();part++)
+	{
+		const btIndexedMesh& mesh = meshInterface->getIndexedMeshArray()[part];
+		for (int t=0;t<mesh.m_numTriangles;t++)
+		{
+			const unsigned char* indexBase = mesh.m_triangleIndexBase+t*mesh.m_triangleIndexStride;
+			for (int v=0;v<3;v++)
+			{
+				int index = (mesh.m_indexType == PHY_SHORT) ? int(((const unsigned short*)indexBase)[v]) : ((const int*)indexBase)[v];
+				if ((index < 0) || (index >= mesh.m_numVertices))
+				{
+					delete meshInterface;
+					return 0;
+				}
+				btVector3 vertex;
+				if (mesh.m_vertexType == PHY_DOUBLE)
+				{
+					const double* vertexBase = (const double*)(mesh.m_vertexBase+index*mesh.m_vertexStride);
+					vertex.setValue(btScalar(vertexBase[0]),btScalar(vertexBase[1]),btScalar(vertexBase[2]));
+				} else
+				{
+					const float* vertexBase = (const float*)(mesh.m_vertexBase+index*mesh.m_vertexStride);
+					vertex.setValue(btScalar(vertexBase[0]),btScalar(vertexBase[1]),btScalar(vertexBase[2]));
+				}
+				vertex *= meshScaling;
+				aabbMin.setMin(vertex);
+				aabbMax.setMax(vertex);
+			}
+		}
+	}
+	meshInterface->setPremadeAabb(aabbMin,aabbMax);
+	m_meshInterfaces.push_back(meshInterface);
+
+#ifdef BT_USE_DOUBLE_PRECISION
+	btQuantizedBvhData* bvhData = trimeshData->m_quantizedDoubleBvh;
+#else
+	btQuantizedBvhData* bvhData = trimeshData->m_quantizedFloatBvh;
+#endif //BT_USE_DOUBLE_PRECISION
+
+	if (bvhData && (!isStructInChunk(bvhData,btQuantizedBvhDataName) ||
+		!isArrayInChunk(bvhData->m_contiguousNodesPtr,bvhData->m_numContiguousLeafNodes,sizeof(*bvhData->m_contiguousNodesPtr)) ||
+		!isArrayInChunk(bvhData->m_quantizedContiguousNodesPtr,bvhData->m_numQuantizedContiguousNodes,sizeof(btQuantizedBvhNodeData)) ||
+		!isArrayInChunk(bvhData->m_subTreeInfoPtr,bvhData->m_numSubtreeHeaders,sizeof(btBvhSubtreeInfoData))))
+	{
+		//the mesh is still usable, its bvh is built again
+		bvhData = 0;
+	}
+
+	btOptimizedBvh* bvh = 0;
+	if (bvhData)
+	{
+		bvh = new btOptimizedBvh();
+#ifdef BT_USE_DOUBLE_PRECISION
+		bvh->deSerializeDouble(*bvhData);
+#else
+		bvh->deSerializeFloat(*bvhData);
+#endif //BT_USE_DOUBLE_PRECISION
+		if (!bvh->hasValidNodes(meshInterface))
+		{
+			delete bvh;
+			bvh = 0;
+		}
+	}
+
+	btBvhTriangleMeshShape* trimesh = 0;
+	if (bvh)
+	{
+		m_bvhs.push_back(bvh);
+		trimesh = new btBvhTriangleMeshShape(meshInterface,bvh->isQuantized(),false);
+		trimesh->setOptimizedBvh(bvh,meshScaling);
+	} else
+	{
+		trimesh = new btBvhTriangleMeshShape(meshInterface,true);
+	}
+
+	btTriangleInfoMapData* infoMapData = trimeshData->m_triangleInfoMap;
+	if (infoMapData && isStructInChunk(infoMapData,"btTriangleInfoMapData") &&
+		isArrayInChunk(infoMapData->m_hashTablePtr,infoMapData->m_hashTableSize,sizeof(int)) &&
+		isArrayInChunk(infoMapData->m_nextPtr,infoMapData->m_nextSize,sizeof(int)) &&
+		isArrayInChunk(infoMapData->m_valueArrayPtr,infoMapData->m_numValues,sizeof(btTriangleInfoData)) &&
+		isArrayInChunk(infoMapData->m_keyArrayPtr,infoMapData->m_numKeys,sizeof(int)))
+	{
+		btTriangleInfoMap* triangleInfoMap = new btTriangleInfoMap();
+		triangleInfoMap->deSerialize(*infoMapData);
+		m_triangleInfoMaps.push_back(triangleInfoMap);
+		trimesh->setTriangleInfoMap(triangleInfoMap);
+	}
+	trimesh->setMargin(trimeshData->m_collisionMargin);
+	return trimesh;
+}
+
+static void	btRestoreCollisionObject(btCollisionObject* colObj,const btCollisionObjectData& colData)
+{
+	btTransform interpolationWorldTransform;
+	interpolationWorldTransform.deSerialize(colData.m_interpolationWorldTransform);
+	colObj->setInterpolationWorldTransform(interpolationWorldTransform);
+	btVector3 vec;
+	vec.deSerialize(colData.m_interpolationLinearVelocity);
+	colObj->setInterpolationLinearVelocity(vec);
+	vec.deSerialize(colData.m_interpolationAngularVelocity);
+	colObj->setInterpolationAngularVelocity(vec);
+	vec.deSerialize(colData.m_anisotropicFriction);
+	colObj->setAnisotropicFriction(vec);
+
+	colObj->setContactProcessingThreshold(colData.m_contactProcessingThreshold);
+	colObj->setFriction(colData.m_friction);
+	colObj->setRestitution(colData.m_restitution);
+	colObj->setHitFraction(colData.m_hitFraction);
+	colObj->setCcdSweptSphereRadius(colData.m_ccdSweptSphereRadius);
+	colObj->setCcdMotionThreshold(colData.m_ccdMotionThreshold);
+	colObj->setCollisionFlags(colData.m_collisionFlags);
+	colObj->setDeactivationTime(colData.m_deactivationTime);
+}
+
+btRigidBody*	btBulletFileLoader::convertRigidBody(void* rigidBodyData)
+{
+	btRigidBodyData* rbData = (btRigidBodyData*)rigidBodyData;
+	btCollisionObjectData& colData = rbData->m_collisionObjectData;
+
+	btCollisionShape* shape = colData.m_collisionShape ? convertCollisionShape((btCollisionShapeData*)colData.m_collisionShape) : 0;
+	if (!shape)
+	{
+		m_numSkippedChunks++;
+		m_bodyMap.insert(rigidBodyData,0);
+		return 0;
+	}
+
+	btScalar mass = rbData->m_inverseMass != btScalar(0.) ? btScalar(1.)/rbData->m_inverseMass : btScalar(0.);
+	btVector3 invInertia;
+	invInertia.deSerialize(rbData->m_invInertiaLocal);
+	btVector3 localInertia(
+		invInertia.getX() != btScalar(0.) ? btScalar(1.)/invInertia.getX() : btScalar(0.),
+		invInertia.getY() != btScalar(0.) ? btScalar(1.)/invInertia.getY() : btScalar(0.),
+		invInertia.getZ() != btScalar(0.) ? btScalar(1.)/invInertia.getZ() : btScalar(0.));
+
+	btRigidBody::btRigidBodyConstructionInfo rbInfo(mass,0,shape,localInertia);
+	rbInfo.m_startWorldTransform.deSerialize(colData.m_worldTransform);
+	rbInfo.m_linearDamping = rbData->m_linearDamping;
+	rbInfo.m_angularDamping = rbData->m_angularDamping;
+	rbInfo.m_friction = colData.m_friction;
+	rbInfo.m_restitution = colData.m_restitution;
+	rbInfo.m_linearSleepingThreshold = rbData->m_linearSleepingThreshold;
+	rbInfo.m_angularSleepingThreshold = rbData->m_angularSleepingThreshold;
+	rbInfo.m_additionalDamping = rbData->m_additionalDamping != 0;
+	rbInfo.m_additionalDampingFactor = rbData->m_additionalDampingFactor;
+	rbInfo.m_additionalLinearDampingThresholdSqr = rbData->m_additionalLinearDampingThresholdSqr;
+	rbInfo.m_additionalAngularDampingThresholdSqr = rbData->m_additionalAngularDampingThresholdSqr;
+	rbInfo.m_additionalAngularDampingFactor = rbData->m_additionalAngularDampingFactor;
+
+	btRigidBody* body = new btRigidBody(rbInfo);
+	btRestoreCollisionObject(body,colData);
+
+	btVector3 vec;
+	vec.deSerialize(rbData->m_linearVelocity);
+	body->setLinearVelocity(vec);
+	vec.deSerialize(rbData->m_angularVelocity);
+	body->setAngularVelocity(vec);
+	vec.deSerialize(rbData->m_linearFactor);
+	body->setLinearFactor(vec);
+	vec.deSerialize(rbData->m_angularFactor);
+	body->setAngularFactor(vec);
+
+	if (m_dynamicsWorld)
+	{
+		m_dynamicsWorld->addRigidBody(body);
+	}
+	//addRigidBody applies the world gravity and puts static bodies to sleep
+	vec.deSerialize(rbData->m_gravity_acceleration);
+	body->setGravity(vec);
+	body->forceActivationState(colData.m_activationState1);
+	body->setDeactivationTime(colData.m_deactivationTime);
+
+	m_rigidBodies.push_back(body);
+	m_bodyMap.insert(rigidBodyData,body);
+	if (colData.m_name)
+	{
+		m_objectNames.insert(body,colData.m_name);
+	}
+	return body;
+}
+
+btCollisionObject*	btBulletFileLoader::convertCollisionObject(void* collisionObjectData)
+{
+	btCollisionObjectData* colData = (btCollisionObjectData*)collisionObjectData;
+
+	btCollisionShape* shape = colData->m_collisionShape ? convertCollisionShape((btCollisionShapeData*)colData->m_collisionShape) : 0;
+	if (!shape)
+	{
+		m_numSkippedChunks++;
+		return 0;
+	}
+
+	btCollisionObject* colObj = new btCollisionObject();
+	colObj->setCollisionShape(shape);
+	btTransform worldTransform;
+	worldTransform.deSerialize(colData->m_worldTransform);
+	colObj->setWorldTransform(worldTransform);
+	btRestoreCollisionObject(colObj,*colData);
+
+	if (m_dynamicsWorld)
+	{
+		m_dynamicsWorld->addCollisionObject(colObj);
+	}
+	colObj->forceActivationState(colData->m_activationState1);
+
+	m_collisionObjects.push_back(colObj);
+	if (colData->m_name)
+	{
+		m_objectNames.insert(colObj,colData->m_name);
+	}
+	return colObj;
+}
+
+btTypedConstraint*	btBulletFileLoader::convertConstraint(btTypedConstraintData* constraintData)
+{
+	const btChunkInfo* chunkInfo = m_chunkInfos.find(constraintData);
+	if (!chunkInfo || (chunkInfo->m_length < int(sizeof(btTypedConstraintData))) ||
+		!isStructInChunk(constraintData,btGetConstraintDataName(constraintData->m_objectType)))
+	{
+		m_numSkippedChunks++;
+		return 0;
+	}
+
+	//a body that was not serialized is the fixed body of a single body constraint, a body that was skipped skips the constraint
+	btRigidBody* rbA = &btTypedConstraint::getFixedBody();
+	btRigidBody* rbB = &btTypedConstraint::getFixedBody();
+	if (constraintData->m_rbA)
+	{
+		btRigidBody** found = m_bodyMap.find(constraintData->m_rbA);
+		rbA = found ? *found : 0;
+	}
+	if (constraintData->m_rbB)
+	{
+		btRigidBody** found = m_bodyMap.find(constraintData->m_rbB);
+		rbB = found ? *found : 0;
+	}
+	if (!rbA || !rbB)
+	{
+		m_numSkippedChunks++;
+		return 0;
+	}
+
+	btTypedConstraint* constraint = 0;
+
+	switch (constraintData->m_objectType)
+	{
+	case POINT2POINT_CONSTRAINT_TYPE:
+		{
+			btPoint2PointConstraintData* p2pData = (btPoint2PointConstraintData*)constraintData;
+			btVector3 pivotInA,pivotInB;
+			pivotInA.deSerialize(p2pData->m_pivotInA);
+			pivotInB.deSerialize(p2pData->m_pivotInB);
+			constraint = new btPoint2PointConstraint(*rbA,*rbB,pivotInA,pivotInB);
+			break;
+		}
+	case HINGE_CONSTRAINT_TYPE:
+		{
+			btHingeConstraintData* hingeData = (btHingeConstraintData*)constraintData;
+			btTransform rbAFrame,rbBFrame;
+			rbAFrame.deSerialize(hingeData->m_rbAFrame);
+			rbBFrame.deSerialize(hingeData->m_rbBFrame);
+			btHingeConstraint* hinge = new btHingeConstraint(*rbA,*rbB,rbAFrame,rbBFrame,hingeData->m_useReferenceFrameA!=0);
+			hinge->setAngularOnly(hingeData->m_angularOnly!=0);
+			hinge->enableAngularMotor(hingeData->m_enableAngularMotor!=0,hingeData->m_motorTargetVelocity,hingeData->m_maxMotorImpulse);
+			hinge->setLimit(hingeData->m_lowerLimit,hingeData->m_upperLimit,hingeData->m_limitSoftness,hingeData->m_biasFactor,hingeData->m_relaxationFactor);
+			constraint = hinge;
+			break;
+		}
+	case CONETWIST_CONSTRAINT_TYPE:
+		{
+			btConeTwistConstraintData* coneData = (btConeTwistConstraintData*)constraintData;
+			btTransform rbAFrame,rbBFrame;
+			rbAFrame.deSerializeFloat(coneData->m_rbAFrame);
+			rbBFrame.deSerializeFloat(coneData->m_rbBFrame);
+			btConeTwistConstraint* coneTwist = new btConeTwistConstraint(*rbA,*rbB,rbAFrame,rbBFrame);
+			coneTwist->setLimit(coneData->m_swingSpan1,coneData->m_swingSpan2,coneData->m_twistSpan,coneData->m_limitSoftness,coneData->m_biasFactor,coneData->m_relaxationFactor);
+			coneTwist->setDamping(coneData->m_damping);
+			constraint = coneTwist;
+			break;
+		}
+	case D6_CONSTRAINT_TYPE:
+		{
+			btGeneric6DofConstraintData* dofData = (btGeneric6DofConstraintData*)constraintData;
+			btTransform rbAFrame,rbBFrame;
+			rbAFrame.deSerializeFloat(dofData->m_rbAFrame);
+			rbBFrame.deSerializeFloat(dofData->m_rbBFrame);
+			btGeneric6DofConstraint* dof = new btGeneric6DofConstraint(*rbA,*rbB,rbAFrame,rbBFrame,dofData->m_useLinearReferenceFrameA!=0);
+			btVector3 limit;
+			limit.deSerializeFloat(dofData->m_linearLowerLimit);
+			dof->setLinearLowerLimit(limit);
+			limit.deSerializeFloat(dofData->m_linearUpperLimit);
+			dof->setLinearUpperLimit(limit);
+			limit.deSerializeFloat(dofData->m_angularLowerLimit);
+			dof->setAngularLowerLimit(limit);
+			limit.deSerializeFloat(dofData->m_angularUpperLimit);
+			dof->setAngularUpperLimit(limit);
+			dof->setUseFrameOffset(dofData->m_useOffsetForConstraintFrame!=0);
+			constraint = dof;
+			break;
+		}
+	case SLIDER_CONSTRAINT_TYPE:
+		{
+			btSliderConstraintData* sliderData = (btSliderConstraintData*)constraintData;
+			btTransform rbAFrame,rbBFrame;
+			rbAFrame.deSerializeFloat(sliderData->m_rbAFrame);
+			rbBFrame.deSerializeFloat(sliderData->m_rbBFrame);
+			btSliderConstraint* slider = new btSliderConstraint(*rbA,*rbB,rbAFrame,rbBFrame,sliderData->m_useLinearReferenceFrameA!=0);
+			slider->setLowerLinLimit(sliderData->m_linearLowerLimit);
+			slider->setUpperLinLimit(sliderData->m_linearUpperLimit);
+			slider->setLowerAngLimit(sliderData->m_angularLowerLimit);
+			slider->setUpperAngLimit(sliderData->m_angularUpperLimit);
+			slider->setUseFrameOffset(sliderData->m_useOffsetForConstraintFrame!=0);
+			constraint = slider;
+			break;
+		}
+	default:
+		m_numSkippedChunks++;
+		return 0;
+	}
+
+	constraint->setUserConstraintType(constraintData->m_userConstraintType);
+	constraint->setUserConstraintId(constraintData->m_userConstraintId);
+	constraint->enableFeedback(constraintData->m_needsFeedback!=0);
+	constraint->setDbgDrawSize(constraintData->m_dbgDrawSize);
+
+	if (m_dynamicsWorld)
+	{
+		m_dynamicsWorld->addConstraint(constraint,constraintData->m_disableCollisionsBetweenLinkedBodies!=0);
+	}
+
+	m_constraints.push_back(constraint);
+	if (constraintData->m_name)
+	{
+		m_objectNames.insert(constraint,constraintData->m_name);
+	}
+	return constraint;
+}
+
+bool	btBulletFileLoader::loadFile(const char* fileName)
+{
+	unload();
+
+	void* buffer = 0;
+	int bufferSize = 0;
+	int ownership = BUFFER_ALLOCATED;
+
+#ifdef BT_BULLET_FILE_USE_MMAP
+	int fd = open(fileName,O_RDONLY);
+	if (fd < 0)
+		return false;
+	struct stat fileStat;
+	if (fstat(fd,&fileStat)==0 && fileStat.st_size > 0)
+	{
+		//a private mapping is copy on write, only the pages with pointers are copied by the fixup
+		void* mapped = mmap(0,size_t(fileStat.st_size),PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+		if (mapped != MAP_FAILED)
+		{
+			buffer = mapped;
+			bufferSize = int(fileStat.st_size);
+			ownership = BUFFER_MAPPED;
+		}
+	}
+	close(fd);
+#else
+	FILE* file = fopen(fileName,"rb");
+	if (!file)
+		return false;
+	fseek(file,0,SEEK_END);
+	long fileSize = ftell(file);
+	fseek(file,0,SEEK_SET);
+	if (fileSize > 0)
+	{
+		buffer = btAlignedAlloc(size_t(fileSize),16);
+		bufferSize = int(fileSize);
+		if (fread(buffer,1,size_t(bufferSize),file) != size_t(bufferSize))
+		{
+			btAlignedFree(buffer);
+			buffer = 0;
+		}
+	}
+	fclose(file);
+#endif //BT_BULLET_FILE_USE_MMAP
+
+	if (!buffer)
+		return false;
+
+	if (!loadBuffer(buffer,bufferSize))
+	{
+		m_buffer = buffer;
+		m_bufferSize = bufferSize;
+		m_bufferOwnership = ownership;
+		releaseBuffer();
+		return false;
+	}
+
+	m_bufferOwnership = ownership;
+	return true;
+}
+
+void	btBulletFileLoader::unload()
+{
+	int i;
+	if (m_dynamicsWorld)
+	{
+		for (i=m_constraints.size()-1;i>=0;i--)
+		{
+			m_dynamicsWorld->removeConstraint(m_constraints[i]);
+		}
+		for (i=m_rigidBodies.size()-1;i>=0;i--)
+		{
+			m_dynamicsWorld->removeRigidBody(m_rigidBodies[i]);
+		}
+		for (i=m_collisionObjects.size()-1;i>=0;i--)
+		{
+			m_dynamicsWorld->removeCollisionObject(m_collisionObjects[i]);
+		}
+	}
+	for (i=0;i<m_constraints.size();i++)
+		delete m_constraints[i];
+	for (i=0;i<m_rigidBodies.size();i++)
+		delete m_rigidBodies[i];
+	for (i=0;i<m_collisionObjects.size();i++)
+		delete m_collisionObjects[i];
+	for (i=0;i<m_collisionShapes.size();i++)
+		delete m_collisionShapes[i];
+	for (i=0;i<m_bvhs.size();i++)
+		delete m_bvhs[i];
+	for (i=0;i<m_triangleInfoMaps.size();i++)
+		delete m_triangleInfoMaps[i];
+	for (i=0;i<m_meshInterfaces.size();i++)
+		delete m_meshInterfaces[i];
+
+	m_constraints.clear();
+	m_rigidBodies.clear();
+	m_collisionObjects.clear();
+	m_collisionShapes.clear();
+	m_bvhs.clear();
+	m_triangleInfoMaps.clear();
+	m_meshInterfaces.clear();
+	m_objectNames.clear();
+	m_shapeMap.clear();
+	m_bodyMap.clear();
+	m_chunks.clear();
+	m_chunkData.clear();
+	m_chunkInfos.clear();
+	m_dnaNames.clear();
+	m_dnaTypes.clear();
+	m_dnaTypeLengths.clear();
+	m_dnaStructs.clear();
+	m_dnaStructOfType.clear();
+	m_dnaStructHasPointers.clear();
+	m_numSkippedChunks = 0;
+
+	releaseBuffer();
+}
+
+void	btBulletFileLoader::releaseBuffer()
+{
+	if (m_buffer)
+	{
+		switch (m_bufferOwnership)
+		{
+		case BUFFER_ALLOCATED:
+			btAlignedFree(m_buffer);
+			break;
+#ifdef BT_BULLET_FILE_USE_MMAP
+		case BUFFER_MAPPED:
+			munmap(m_buffer,size_t(m_bufferSize));
+			break;
+#endif //BT_BULLET_FILE_USE_MMAP
+		default:
+			break;
+		}
+	}
+	m_buffer = 0;
+	m_bufferSize = 0;
+	m_bufferOwnership = BUFFER_EXTERNAL;
+}
+
+const char*	btBulletFileLoader::getNameForPointer(const void* ptr) const
+{
+	const char*const * name = m_objectNames.find(ptr);
+	return name ? *name : 0;
+}
+
+btCollisionShape*	btBulletFileLoader::getCollisionShapeByName(const char* name)
+{
+	for (int i=0;i<m_collisionShapes.size();i++)
+	{
+		const char* shapeName = getNameForPointer(m_collisionShapes[i]);
+		if (shapeName && !strcmp(shapeName,name))
+			return m_collisionShapes[i];
+	}
+	return 0;
+}
+
+btRigidBody*	btBulletFileLoader::getRigidBodyByName(const char* name)
+{
+	for (int i=0;i<m_rigidBodies.size();i++)
+	{
+		const char* bodyName = getNameForPointer(m_rigidBodies[i]);
+		if (bodyName && !strcmp(bodyName,name))
+			return m_rigidBodies[i];
+	}
+	return 0;
+}
@@ -0,0 +1,175 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BULLET_FILE_LOADER_H
+#define BULLET_FILE_LOADER_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btHashMap.h"
+
+class btDynamicsWorld;
+class btCollisionShape;
+class btCollisionObject;
+class btRigidBody;
+class btTypedConstraint;
+class btOptimizedBvh;
+class btTriangleInfoMap;
+class btStridingMeshInterface;
+class btChunk;
+struct btCollisionShapeData;
+struct btCompoundShapeData;
+struct btTriangleMeshShapeData;
+struct btTypedConstraintData;
+
+///The btBulletFileLoader loads a .bullet file written by btDefaultSerializer (for example with btDiscreteDynamicsWorld::serialize) and creates its shapes, rigid bodies, collision objects and constraints.
+///The file is used in place: the pointers in its chunks are fixed up in the buffer using the DNA that is stored in the file, and triangle meshes reference the vertex and index arrays in the buffer directly.
+///Saved bvh trees are loaded instead of rebuilt. Cone shapes, scaled and GImpact meshes are not stored by the serializer and are skipped, objects that use them are skipped as well.
+///Only files of the same platform and precision can be loaded in place, a file from another platform is rejected.
+///The buffer must stay alive and writable while the objects are used, a private (copy on write) file mapping is fine. A buffer can only be loaded once.
+///The layout of the file and the sizes of its arrays are checked, triangle indices are checked against the vertex count and a saved bvh whose nodes don't match the mesh is built again.
+class btBulletFileLoader
+{
+	btDynamicsWorld*	m_dynamicsWorld;
+
+	void*				m_buffer;
+	int					m_bufferSize;
+	int					m_bufferOwnership;
+
+	enum
+	{
+		BUFFER_EXTERNAL = 0,
+		BUFFER_ALLOCATED,
+		BUFFER_MAPPED
+	};
+
+	//the DNA of the file, the names and types point into the DNA chunk
+	btAlignedObjectArray<const char*>	m_dnaNames;
+	btAlignedObjectArray<const char*>	m_dnaTypes;
+	btAlignedObjectArray<short>			m_dnaTypeLengths;
+	btAlignedObjectArray<const short*>	m_dnaStructs;
+	btAlignedObjectArray<int>			m_dnaStructOfType;
+	btAlignedObjectArray<bool>			m_dnaStructHasPointers;
+
+	btAlignedObjectArray<btChunk*>		m_chunks;
+	btHashMap<btHashPtr,void*>			m_chunkData;
+	///btChunkInfo is recorded for the data of each chunk, so the struct of a chunk is checked before its data is cast
+	struct btChunkInfo
+	{
+		int		m_length;
+		int		m_dnaNr;
+	};
+	btHashMap<btHashPtr,btChunkInfo>	m_chunkInfos;
+
+	btHashMap<btHashPtr,btCollisionShape*>	m_shapeMap;
+	btHashMap<btHashPtr,btRigidBody*>		m_bodyMap;
+
+	btAlignedObjectArray<btCollisionShape*>		m_collisionShapes;
+	btAlignedObjectArray<btRigidBody*>			m_rigidBodies;
+	btAlignedObjectArray<btCollisionObject*>	m_collisionObjects;
+	btAlignedObjectArray<btTypedConstraint*>	m_constraints;
+	btAlignedObjectArray<btOptimizedBvh*>		m_bvhs;
+	btAlignedObjectArray<btTriangleInfoMap*>	m_triangleInfoMaps;
+	btAlignedObjectArray<btStridingMeshInterface*>	m_meshInterfaces;
+	btHashMap<btHashPtr,const char*>			m_objectNames;
+
+	int		m_numSkippedChunks;
+
+	bool	parseDNA(char* dna,int dnaLength);
+	bool	checkStructSize(const char* typeName,int size) const;
+	int		getArraySize(const char* name) const;
+	void	fixupPointers(char* data,int structIndex);
+	bool	isArrayInChunk(const void* array,int count,int elementSize) const;
+	bool	isStructInChunk(const void* data,const char* typeName) const;
+
+	btCollisionShape*	convertCollisionShape(btCollisionShapeData* shapeData);
+	btCollisionShape*	convertCompoundShape(btCompoundShapeData* compoundData);
+	btCollisionShape*	convertTriangleMeshShape(btTriangleMeshShapeData* trimeshData);
+	btRigidBody*		convertRigidBody(void* rigidBodyData);
+	btCollisionObject*	convertCollisionObject(void* collisionObjectData);
+	btTypedConstraint*	convertConstraint(btTypedConstraintData* constraintData);
+
+	void	releaseBuffer();
+
+public:
+
+	///the objects are added to the dynamicsWorld when it is not 0
+	btBulletFileLoader(btDynamicsWorld* dynamicsWorld = 0);
+
+	virtual ~btBulletFileLoader();
+
+	///loadBuffer uses the 16 byte aligned buffer in place, the caller keeps ownership of the buffer. Returns false if the file is invalid or was written on a different platform.
+	bool	loadBuffer(void* alignedBuffer,int bufferSize);
+
+	///loadFile maps the file into memory when the platform supports it, otherwise it reads the file into an aligned buffer
+	bool	loadFile(const char* fileName);
+
+	///unload removes the objects from the world, deletes them and releases the buffer
+	void	unload();
+
+	int	getNumCollisionShapes() const
+	{
+		return m_collisionShapes.size();
+	}
+
+	btCollisionShape*	getCollisionShapeByIndex(int index)
+	{
+		return m_collisionShapes[index];
+	}
+
+	int	getNumRigidBodies() const
+	{
+		return m_rigidBodies.size();
+	}
+
+	btRigidBody*	getRigidBodyByIndex(int index)
+	{
+		return m_rigidBodies[index];
+	}
+
+	int	getNumCollisionObjects() const
+	{
+		return m_collisionObjects.size();
+	}
+
+	btCollisionObject*	getCollisionObjectByIndex(int index)
+	{
+		return m_collisionObjects[index];
+	}
+
+	int	getNumConstraints() const
+	{
+		return m_constraints.size();
+	}
+
+	btTypedConstraint*	getConstraintByIndex(int index)
+	{
+		return m_constraints[index];
+	}
+
+	///getNumSkippedChunks returns the number of shapes, objects and constraints that could not be created
+	int	getNumSkippedChunks() const
+	{
+		return m_numSkippedChunks;
+	}
+
+	///the names are the ones registered with btSerializer::registerNameForPointer, they point into the buffer
+	const char*	getNameForPointer(const void* ptr) const;
+
+	btCollisionShape*	getCollisionShapeByName(const char* name);
+
+	btRigidBody*	getRigidBodyByName(const char* name);
+};
+
+#endif //BULLET_FILE_LOADER_H
@@ -66,6 +66,7 @@ void	btContinuousDynamicsWorld::internalSingleStepSimulation( btScalar timeStep)
 	dispatchInfo.m_timeStep = timeStep;
 	dispatchInfo.m_stepCount = 0;
 	dispatchInfo.m_debugDraw = getDebugDrawer();
+	dispatchInfo.m_useSpeculativeContacts = (getSolverInfo().m_solverMode & SOLVER_USE_SPECULATIVE_CONTACTS) != 0;
 
 	///perform collision detection
 	performDiscreteCollisionDetection();
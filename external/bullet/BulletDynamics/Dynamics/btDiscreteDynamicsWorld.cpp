@@ -45,6 +45,8 @@ subject to the following restrictions:
 #include "LinearMath/btMotionState.h"
 
 #include "LinearMath/btSerializer.h"
+#include "LinearMath/btHashMap.h"
+#include "btDynamicsWorldSnapshot.h"
 
 
 
@@ -54,7 +56,10 @@ m_constraintSolver(constraintSolver),
 m_gravity(0,-10,0),
 m_localTime(0),
 m_synchronizeAllMotionStates(false),
-m_profileTimings(0)
+m_profileTimings(0),
+m_batchedCcd(true),
+m_deterministic(false),
+m_snapshotRestore(0)
 {
 	if (!m_constraintSolver)
 	{
@@ -89,6 +94,11 @@ btDiscreteDynamicsWorld::~btDiscreteDynamicsWorld()
 		m_constraintSolver->~btConstraintSolver();
 		btAlignedFree(m_constraintSolver);
 	}
+	if (m_snapshotRestore)
+	{
+		m_snapshotRestore->~btSnapshotManifoldRestore();
+		btAlignedFree(m_snapshotRestore);
+	}
 }
 
 void	btDiscreteDynamicsWorld::saveKinematicState(btScalar timeStep)
@@ -313,14 +323,27 @@ void	btDiscreteDynamicsWorld::internalSingleStepSimulation(btScalar timeStep)
 	dispatchInfo.m_timeStep = timeStep;
 	dispatchInfo.m_stepCount = 0;
 	dispatchInfo.m_debugDraw = getDebugDrawer();
+	dispatchInfo.m_useSpeculativeContacts = (getSolverInfo().m_solverMode & SOLVER_USE_SPECULATIVE_CONTACTS) != 0;
 
 	///perform collision detection
 	performDiscreteCollisionDetection();
 
+	if (m_snapshotRestore && m_snapshotRestore->hasPendingManifolds())
+	{
+		m_snapshotRestore->clear();
+		dispatchInfo.m_manifoldRestoreCallback = 0;
+	}
+
 	calculateSimulationIslands();
 
 	
 	getSolverInfo().m_timeStep = timeStep;
+
+	if (m_deterministic)
+	{
+		///the solver can randomize the constraint order, restart its seed so a step only depends on the world state
+		m_constraintSolver->reset();
+	}
 	
 
 
@@ -554,6 +577,7 @@ class btSortConstraintOnIslandPredicate
 void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 {
 	BT_PROFILE("solveConstraints");
+	BT_ALLOC_TAG(BT_ALLOC_TAG_SOLVER);
 	
 	struct InplaceSolverIslandCallback : public btSimulationIslandManager::IslandCallback
 	{
@@ -566,9 +590,9 @@ void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 		btStackAlloc*			m_stackAlloc;
 		btDispatcher*			m_dispatcher;
 		
-		btAlignedObjectArray<btCollisionObject*> m_bodies;
-		btAlignedObjectArray<btPersistentManifold*> m_manifolds;
-		btAlignedObjectArray<btTypedConstraint*> m_constraints;
+		btAlignedObjectArray<btCollisionObject*>& m_bodies;
+		btAlignedObjectArray<btPersistentManifold*>& m_manifolds;
+		btAlignedObjectArray<btTypedConstraint*>& m_constraints;
 
 
 		InplaceSolverIslandCallback(
@@ -578,14 +602,20 @@ void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 			int	numConstraints,
 			btIDebugDraw*	debugDrawer,
 			btStackAlloc*			stackAlloc,
-			btDispatcher* dispatcher)
+			btDispatcher* dispatcher,
+			btAlignedObjectArray<btCollisionObject*>& islandBodies,
+			btAlignedObjectArray<btPersistentManifold*>& islandManifolds,
+			btAlignedObjectArray<btTypedConstraint*>& islandConstraints)
 			:m_solverInfo(solverInfo),
 			m_solver(solver),
 			m_sortedConstraints(sortedConstraints),
 			m_numConstraints(numConstraints),
 			m_debugDrawer(debugDrawer),
 			m_stackAlloc(stackAlloc),
-			m_dispatcher(dispatcher)
+			m_dispatcher(dispatcher),
+			m_bodies(islandBodies),
+			m_manifolds(islandManifolds),
+			m_constraints(islandConstraints)
 		{
 
 		}
@@ -674,7 +704,7 @@ void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 	
 
 	//sorted version of all btTypedConstraint, based on islandId
-	btAlignedObjectArray<btTypedConstraint*>	sortedConstraints;
+	btAlignedObjectArray<btTypedConstraint*>&	sortedConstraints = m_sortedConstraints;
 	sortedConstraints.resize( m_constraints.size());
 	int i; 
 	for (i=0;i<getNumConstraints();i++)
@@ -690,7 +720,7 @@ void	btDiscreteDynamicsWorld::solveConstraints(btContactSolverInfo& solverInfo)
 	
 	btTypedConstraint** constraintsPtr = getNumConstraints() ? &sortedConstraints[0] : 0;
 	
-	InplaceSolverIslandCallback	solverCallback(	solverInfo,	m_constraintSolver, constraintsPtr,sortedConstraints.size(),	m_debugDrawer,m_stackAlloc,m_dispatcher1);
+	InplaceSolverIslandCallback	solverCallback(	solverInfo,	m_constraintSolver, constraintsPtr,sortedConstraints.size(),	m_debugDrawer,m_stackAlloc,m_dispatcher1,m_islandBodies,m_islandManifolds,m_islandConstraints);
 	
 	m_constraintSolver->prepareSolve(getCollisionWorld()->getNumCollisionObjects(), getCollisionWorld()->getDispatcher()->getNumManifolds());
 	
@@ -828,6 +858,11 @@ int gNumClampedCcdMotions=0;
 void	btDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
 {
 	BT_PROFILE("integrateTransforms");
+	if (m_batchedCcd)
+	{
+		integrateTransformsBatchedCcd(timeStep);
+		return;
+	}
 	btTransform predictedTrans;
 	for ( int i=0;i<m_nonStaticRigidBodies.size();i++)
 	{
@@ -873,6 +908,183 @@ void	btDiscreteDynamicsWorld::integrateTransforms(btScalar timeStep)
 
 
 
+///collects the broadphase proxies overlapping the swept AABB of a fast moving body, with the fraction at which the swept sphere enters each AABB
+struct btCcdCandidateCollector : public btBroadphaseAabbCallback
+{
+	btRigidBody*	m_me;
+	btVector3		m_from;
+	btVector3		m_delta;
+	btScalar		m_radius;
+	btAlignedObjectArray<btCcdSweepCandidate>&	m_candidates;
+
+	btCcdCandidateCollector(btRigidBody* me,const btVector3& from,const btVector3& to,btScalar radius,btAlignedObjectArray<btCcdSweepCandidate>& candidates)
+		:m_me(me),
+		m_from(from),
+		m_delta(to-from),
+		m_radius(radius),
+		m_candidates(candidates)
+	{
+	}
+
+	///slab test of the motion segment against the AABB grown by the sphere radius, returns a value larger than 1 on a miss
+	btScalar	entryFraction(const btVector3& aabbMin,const btVector3& aabbMax) const
+	{
+		btScalar tEnter = btScalar(0.);
+		btScalar tExit = btScalar(1.);
+		for (int i=0;i<3;i++)
+		{
+			btScalar lo = aabbMin[i]-m_radius;
+			btScalar hi = aabbMax[i]+m_radius;
+			if (btFabs(m_delta[i]) < SIMD_EPSILON)
+			{
+				if (m_from[i] < lo || m_from[i] > hi)
+					return btScalar(2.);
+				continue;
+			}
+			btScalar invDelta = btScalar(1.)/m_delta[i];
+			btScalar t0 = (lo-m_from[i])*invDelta;
+			btScalar t1 = (hi-m_from[i])*invDelta;
+			if (t0 > t1)
+				btSwap(t0,t1);
+			tEnter = btMax(tEnter,t0);
+			tExit = btMin(tExit,t1);
+			if (tEnter > tExit)
+				return btScalar(2.);
+		}
+		return tEnter;
+	}
+
+	virtual bool	process(const btBroadphaseProxy* proxy)
+	{
+		btCollisionObject* otherObj = (btCollisionObject*) proxy->m_clientObject;
+		if (otherObj == m_me)
+			return true;
+		if (!otherObj->hasContactResponse())
+			return true;
+
+		const btBroadphaseProxy* meProxy = m_me->getBroadphaseProxy();
+		bool collides = (proxy->m_collisionFilterGroup & meProxy->m_collisionFilterMask) != 0;
+		collides = collides && (meProxy->m_collisionFilterGroup & proxy->m_collisionFilterMask);
+		if (!collides)
+			return true;
+
+		btScalar entry = entryFraction(proxy->m_aabbMin,proxy->m_aabbMax);
+		if (entry <= btScalar(1.))
+		{
+			btCcdSweepCandidate& candidate = m_candidates.expandNonInitializing();
+			candidate.m_collisionObject = otherObj;
+			candidate.m_entryFraction = entry;
+		}
+		return true;
+	}
+};
+
+class btCcdSweepCandidateSortPredicate
+{
+	public:
+
+		bool operator() ( const btCcdSweepCandidate& lhs, const btCcdSweepCandidate& rhs ) const
+		{
+			return lhs.m_entryFraction < rhs.m_entryFraction;
+		}
+};
+
+void	btDiscreteDynamicsWorld::clampCcdMotion(btRigidBody* body, btScalar timeStep, btTransform& predictedTrans)
+{
+	const btVector3& from = body->getWorldTransform().getOrigin();
+	const btVector3& to = predictedTrans.getOrigin();
+	btScalar radius = body->getCcdSweptSphereRadius();
+
+	m_ccdCandidates.resize(0);
+	btVector3 sweptAabbMin = from;
+	btVector3 sweptAabbMax = from;
+	sweptAabbMin.setMin(to);
+	sweptAabbMax.setMax(to);
+	btVector3 extent(radius,radius,radius);
+	btCcdCandidateCollector collector(body,from,to,radius,m_ccdCandidates);
+	getBroadphase()->aabbTest(sweptAabbMin-extent,sweptAabbMax+extent,collector);
+	if (!m_ccdCandidates.size())
+		return;
+
+	//visit candidates front to back, so the sweep stops as soon as the next AABB is entered after the closest hit
+	m_ccdCandidates.quickSort(btCcdSweepCandidateSortPredicate());
+
+	btClosestNotMeConvexResultCallback sweepResults(body,from,to,getBroadphase()->getOverlappingPairCache(),getDispatcher());
+	sweepResults.m_collisionFilterGroup = body->getBroadphaseProxy()->m_collisionFilterGroup;
+	sweepResults.m_collisionFilterMask  = body->getBroadphaseProxy()->m_collisionFilterMask;
+	btSphereShape tmpSphere(radius);
+
+	for (int j=0;j<m_ccdCandidates.size();j++)
+	{
+		const btCcdSweepCandidate& candidate = m_ccdCandidates[j];
+		if (candidate.m_entryFraction >= sweepResults.m_closestHitFraction)
+			break;
+		btCollisionObject* otherObj = candidate.m_collisionObject;
+		if (!sweepResults.needsCollision(otherObj->getBroadphaseHandle()))
+			continue;
+		objectQuerySingle(&tmpSphere,body->getWorldTransform(),predictedTrans,
+			otherObj,otherObj->getCollisionShape(),otherObj->getWorldTransform(),
+			sweepResults,btScalar(0.));
+	}
+
+	if (sweepResults.hasHit() && (sweepResults.m_closestHitFraction < 1.f))
+	{
+		gNumClampedCcdMotions++;
+		body->setHitFraction(sweepResults.m_closestHitFraction);
+		body->predictIntegratedTransform(timeStep*body->getHitFraction(), predictedTrans);
+		body->setHitFraction(0.f);
+	}
+}
+
+///integrateTransformsBatchedCcd predicts all transforms first, then sweeps the fast movers against the start-of-step world, and only then moves the bodies.
+///Each fast mover queries the broadphase with its swept AABB, and the narrowphase sweep only runs on the candidates it enters before the closest hit.
+void	btDiscreteDynamicsWorld::integrateTransformsBatchedCcd(btScalar timeStep)
+{
+	int numBodies = m_nonStaticRigidBodies.size();
+	m_predictedTransforms.resizeNoInitialize(numBodies);
+	m_ccdBodyIndices.resize(0);
+
+	int i;
+	for (i=0;i<numBodies;i++)
+	{
+		btRigidBody* body = m_nonStaticRigidBodies[i];
+		body->setHitFraction(1.f);
+
+		if (body->isActive() && (!body->isStaticOrKinematicObject()))
+		{
+			btTransform& predictedTrans = m_predictedTransforms[i];
+			body->predictIntegratedTransform(timeStep, predictedTrans);
+			btScalar squareMotion = (predictedTrans.getOrigin()-body->getWorldTransform().getOrigin()).length2();
+
+			if (body->getCcdSquareMotionThreshold() && body->getCcdSquareMotionThreshold() < squareMotion && body->getCollisionShape()->isConvex())
+			{
+				m_ccdBodyIndices.push_back(i);
+			}
+		}
+	}
+
+	if (m_ccdBodyIndices.size())
+	{
+		BT_PROFILE("CCD motion clamping");
+		for (i=0;i<m_ccdBodyIndices.size();i++)
+		{
+			int bodyIndex = m_ccdBodyIndices[i];
+			clampCcdMotion(m_nonStaticRigidBodies[bodyIndex],timeStep,m_predictedTransforms[bodyIndex]);
+		}
+	}
+
+	for (i=0;i<numBodies;i++)
+	{
+		btRigidBody* body = m_nonStaticRigidBodies[i];
+		if (body->isActive() && (!body->isStaticOrKinematicObject()))
+		{
+			body->proceedToTransform(m_predictedTransforms[i]);
+		}
+	}
+}
+
+
+
 void	btDiscreteDynamicsWorld::predictUnconstraintMotion(btScalar timeStep)
 {
 	BT_PROFILE("predictUnconstraintMotion");
@@ -1105,6 +1317,158 @@ btConstraintSolver* btDiscreteDynamicsWorld::getConstraintSolver()
 }
 
 
+void	btDiscreteDynamicsWorld::setDeterministic(bool deterministic)
+{
+	m_deterministic = deterministic;
+	m_islandManager->setDeterministicOrder(deterministic);
+	m_dispatchInfo.m_deterministic = deterministic;
+}
+
+
+void	btDiscreteDynamicsWorld::saveSnapshot(btDynamicsWorldSnapshot& snapshot) const
+{
+	BT_PROFILE("saveSnapshot");
+
+	btHashMap<btHashPtr,int> objectIndices;
+
+	//every member of the entries is written below, so they are not default constructed first
+	snapshot.m_objects.resizeNoInitialize(m_collisionObjects.size());
+	for (int i=0;i<m_collisionObjects.size();i++)
+	{
+		const btCollisionObject* colObj = m_collisionObjects[i];
+		btCollisionObjectSnapshot& state = snapshot.m_objects[i];
+		state.m_worldTransform = colObj->getWorldTransform();
+		state.m_interpolationWorldTransform = colObj->getInterpolationWorldTransform();
+		state.m_interpolationLinearVelocity = colObj->getInterpolationLinearVelocity();
+		state.m_interpolationAngularVelocity = colObj->getInterpolationAngularVelocity();
+		state.m_deactivationTime = colObj->getDeactivationTime();
+		state.m_hitFraction = colObj->getHitFraction();
+		state.m_activationState = colObj->getActivationState();
+		state.m_internalType = colObj->getInternalType();
+
+		const btRigidBody* body = btRigidBody::upcast(colObj);
+		if (body)
+		{
+			state.m_linearVelocity = body->getLinearVelocity();
+			state.m_angularVelocity = body->getAngularVelocity();
+		} else
+		{
+			state.m_linearVelocity.setValue(btScalar(0.),btScalar(0.),btScalar(0.));
+			state.m_angularVelocity.setValue(btScalar(0.),btScalar(0.),btScalar(0.));
+		}
+		objectIndices.insert(btHashPtr(colObj),i);
+	}
+
+	snapshot.m_manifolds.resize(0);
+	snapshot.m_points.resize(0);
+	for (int i=0;i<m_dispatcher1->getNumManifolds();i++)
+	{
+		const btPersistentManifold* manifold = m_dispatcher1->getManifoldByIndexInternal(i);
+		if (!manifold->getNumContacts())
+			continue;
+
+		const int* index0 = objectIndices.find(btHashPtr(manifold->getBody0()));
+		const int* index1 = objectIndices.find(btHashPtr(manifold->getBody1()));
+		if (!index0 || !index1)
+			continue;
+
+		btManifoldSnapshot& state = snapshot.m_manifolds.expandNonInitializing();
+		state.m_objectIndex0 = *index0;
+		state.m_objectIndex1 = *index1;
+		state.m_childIndex0 = manifold->m_childIndex0;
+		state.m_childIndex1 = manifold->m_childIndex1;
+		state.m_firstPoint = snapshot.m_points.size();
+		state.m_numPoints = manifold->getNumContacts();
+		state.m_speculativeDistance = manifold->getSpeculativeDistance();
+		state.m_pad = 0;
+
+		for (int p=0;p<manifold->getNumContacts();p++)
+		{
+			btManifoldPoint& point = snapshot.m_points.expand();
+			point = manifold->getContactPoint(p);
+			point.m_userPersistentData = 0;
+		}
+	}
+
+	snapshot.m_constraints.resize(m_constraints.size());
+	for (int i=0;i<m_constraints.size();i++)
+	{
+		snapshot.m_constraints[i].m_appliedImpulse = m_constraints[i]->getAppliedImpulse();
+	}
+
+	snapshot.m_localTime = m_localTime;
+}
+
+
+bool	btDiscreteDynamicsWorld::restoreSnapshot(const btDynamicsWorldSnapshot& snapshot)
+{
+	BT_PROFILE("restoreSnapshot");
+
+	if ((snapshot.m_objects.size() != m_collisionObjects.size()) || (snapshot.m_constraints.size() != m_constraints.size()))
+		return false;
+
+	int i;
+	for (i=0;i<m_collisionObjects.size();i++)
+	{
+		if (snapshot.m_objects[i].m_internalType != m_collisionObjects[i]->getInternalType())
+			return false;
+	}
+
+	for (i=0;i<m_collisionObjects.size();i++)
+	{
+		btCollisionObject* colObj = m_collisionObjects[i];
+		const btCollisionObjectSnapshot& state = snapshot.m_objects[i];
+		colObj->setWorldTransform(state.m_worldTransform);
+		colObj->setInterpolationWorldTransform(state.m_interpolationWorldTransform);
+		colObj->setInterpolationLinearVelocity(state.m_interpolationLinearVelocity);
+		colObj->setInterpolationAngularVelocity(state.m_interpolationAngularVelocity);
+		colObj->setDeactivationTime(state.m_deactivationTime);
+		colObj->setHitFraction(state.m_hitFraction);
+		colObj->forceActivationState(state.m_activationState);
+
+		btRigidBody* body = btRigidBody::upcast(colObj);
+		if (body)
+		{
+			body->setLinearVelocity(state.m_linearVelocity);
+			body->setAngularVelocity(state.m_angularVelocity);
+			body->updateInertiaTensor();
+			body->clearForces();
+		}
+	}
+
+	for (i=0;i<m_constraints.size();i++)
+	{
+		m_constraints[i]->internalSetAppliedImpulse(snapshot.m_constraints[i].m_appliedImpulse);
+	}
+
+	///drop all collision algorithms and their manifolds, the manifolds of the snapshot are recreated by the next collision detection
+	btOverlappingPairCache* pairCache = m_broadphasePairCache->getOverlappingPairCache();
+	btBroadphasePairArray& pairs = pairCache->getOverlappingPairArray();
+	for (i=0;i<pairs.size();i++)
+	{
+		pairCache->cleanOverlappingPair(pairs[i],m_dispatcher1);
+	}
+
+	for (i=0;i<m_collisionObjects.size();i++)
+	{
+		updateSingleAabb(m_collisionObjects[i]);
+	}
+
+	if (!m_snapshotRestore)
+	{
+		void* mem = btAlignedAlloc(sizeof(btSnapshotManifoldRestore),16);
+		m_snapshotRestore = new (mem) btSnapshotManifoldRestore();
+	}
+	m_snapshotRestore->setPendingManifolds(snapshot,m_collisionObjects);
+	m_dispatchInfo.m_manifoldRestoreCallback = m_snapshotRestore->hasPendingManifolds() ? m_snapshotRestore : 0;
+
+	m_localTime = snapshot.m_localTime;
+
+	synchronizeMotionStates();
+	return true;
+}
+
+
 int		btDiscreteDynamicsWorld::getNumConstraints() const
 {
 	return int(m_constraints.size());
@@ -25,10 +25,20 @@ class btConstraintSolver;
 class btSimulationIslandManager;
 class btTypedConstraint;
 class btActionInterface;
+class btDynamicsWorldSnapshot;
+class btSnapshotManifoldRestore;
+class btPersistentManifold;
 
 class btIDebugDraw;
 #include "LinearMath/btAlignedObjectArray.h"
 
+///btCcdSweepCandidate is a broadphase candidate for a fast moving body, sorted by the fraction at which the swept sphere enters its AABB
+struct btCcdSweepCandidate
+{
+	btCollisionObject*	m_collisionObject;
+	btScalar			m_entryFraction;
+};
+
 
 ///btDiscreteDynamicsWorld provides discrete rigid body simulation
 ///those classes replace the obsolete CcdPhysicsEnvironment/CcdPhysicsController
@@ -58,9 +68,31 @@ protected:
 	
 	int	m_profileTimings;
 
+	///m_batchedCcd gathers all fast moving bodies and sweeps them against the broadphase candidates only, instead of one convexSweepTest per body
+	bool	m_batchedCcd;
+	btAlignedObjectArray<btTransform>	m_predictedTransforms;
+	btAlignedObjectArray<int>	m_ccdBodyIndices;
+	btAlignedObjectArray<btCcdSweepCandidate>	m_ccdCandidates;
+
+	bool	m_deterministic;
+
+	///the contact points of a restored snapshot, they are put back into the manifolds by the next collision detection
+	btSnapshotManifoldRestore*	m_snapshotRestore;
+
+	///the constraints sorted by island and the batched islands of solveConstraints, they keep their capacity between steps
+	btAlignedObjectArray<btTypedConstraint*>	m_sortedConstraints;
+	btAlignedObjectArray<btCollisionObject*>	m_islandBodies;
+	btAlignedObjectArray<btPersistentManifold*>	m_islandManifolds;
+	btAlignedObjectArray<btTypedConstraint*>	m_islandConstraints;
+
 	virtual void	predictUnconstraintMotion(btScalar timeStep);
 	
 	virtual void	integrateTransforms(btScalar timeStep);
+
+	void	integrateTransformsBatchedCcd(btScalar timeStep);
+
+	///clamps the predicted transform of a fast moving body to its first time of impact
+	void	clampCcdMotion(btRigidBody* body, btScalar timeStep, btTransform& predictedTrans);
 		
 	virtual void	calculateSimulationIslands();
 
@@ -190,6 +222,33 @@ public:
 		return m_synchronizeAllMotionStates;
 	}
 
+	///when enabled (default), bodies exceeding their ccd motion threshold are swept in one batch after all transforms are predicted
+	///disable to fall back to a separate convexSweepTest per fast moving body
+	void	setBatchedCcd(bool batchedCcd)
+	{
+		m_batchedCcd = batchedCcd;
+	}
+	bool	getBatchedCcd() const
+	{
+		return m_batchedCcd;
+	}
+
+	///in deterministic mode the same world state and input always give bit identical results, independent of the pair cache, manifold and island creation order.
+	///The islands are built from touching objects, manifolds and islands are processed in a fixed order and the random seed of the constraint solver is reset every step.
+	void	setDeterministic(bool deterministic);
+
+	bool	isDeterministic() const
+	{
+		return m_deterministic;
+	}
+
+	///saveSnapshot stores the dynamic state of all collision objects, contact manifolds and constraints
+	void	saveSnapshot(btDynamicsWorldSnapshot& snapshot) const;
+
+	///restoreSnapshot returns the world to a state saved by saveSnapshot, it fails when the objects or constraints were added or removed since.
+	///The contact points are restored by the next collision detection, so in deterministic mode resimulating from the snapshot reproduces the original steps.
+	bool	restoreSnapshot(const btDynamicsWorldSnapshot& snapshot);
+
 	///Preliminary serialization test for Bullet 2.76. Loading those files requires a separate parser (see Bullet/Demos/SerializeDemo)
 	virtual	void	serialize(btSerializer* serializer);
 
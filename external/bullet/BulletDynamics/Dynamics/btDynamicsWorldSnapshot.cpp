@@ -0,0 +1,253 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include "btDynamicsWorldSnapshot.h"
+#include "BulletCollision/NarrowPhaseCollision/btPersistentManifold.h"
+#include <string.h>
+
+#define BT_SNAPSHOT_MAGIC 0x50414e53 //'SNAP'
+
+struct	btSnapshotBufferHeader
+{
+	int		m_magic;
+	int		m_sizeofObject;
+	int		m_sizeofManifold;
+	int		m_sizeofPoint;
+	int		m_sizeofConstraint;
+	int		m_numObjects;
+	int		m_numManifolds;
+	int		m_numPoints;
+	int		m_numConstraints;
+	btScalar	m_localTime;
+};
+
+static SIMD_FORCE_INLINE int	btSnapshotSectionSize(int size)
+{
+	return (size+15)&~15;
+}
+
+void	btDynamicsWorldSnapshot::clear()
+{
+	m_objects.resizeNoInitialize(0);
+	m_manifolds.resizeNoInitialize(0);
+	m_points.resizeNoInitialize(0);
+	m_constraints.resizeNoInitialize(0);
+	m_localTime = btScalar(0.);
+}
+
+int		btDynamicsWorldSnapshot::calculateBufferSize() const
+{
+	return btSnapshotSectionSize(sizeof(btSnapshotBufferHeader))
+		+ btSnapshotSectionSize(m_objects.size()*sizeof(btCollisionObjectSnapshot))
+		+ btSnapshotSectionSize(m_manifolds.size()*sizeof(btManifoldSnapshot))
+		+ btSnapshotSectionSize(m_points.size()*sizeof(btManifoldPoint))
+		+ btSnapshotSectionSize(m_constraints.size()*sizeof(btConstraintSnapshot));
+}
+
+template <typename T>
+static void	btWriteSnapshotSection(unsigned char*& dest,const btAlignedObjectArray<T>& array)
+{
+	int size = array.size()*sizeof(T);
+	if (size)
+	{
+		memcpy(dest,&array[0],size);
+	}
+	dest += btSnapshotSectionSize(size);
+}
+
+///btReadSnapshotSection copies count entries from src into array, it returns false if the section doesn't fit into the remaining bytes
+template <typename T>
+static bool	btReadSnapshotSection(const unsigned char*& src,int& remainingSize,btAlignedObjectArray<T>& array,int count)
+{
+	//the count is checked before it is multiplied, so a corrupt count can't overflow the section size
+	if ((count < 0) || (count > remainingSize/int(sizeof(T))))
+		return false;
+	int size = count*int(sizeof(T));
+	int padding = btSnapshotSectionSize(size&15)-(size&15);
+	if (remainingSize-size < padding)
+		return false;
+
+	//the entries are copied over, so they are not default constructed first
+	array.resizeNoInitialize(count);
+	if (size)
+	{
+		memcpy((void*)&array[0],src,size);
+	}
+	src += size+padding;
+	remainingSize -= size+padding;
+	return true;
+}
+
+void	btDynamicsWorldSnapshot::writeBuffer(void* buffer) const
+{
+	btSnapshotBufferHeader header;
+	memset(&header,0,sizeof(header));
+	header.m_magic = BT_SNAPSHOT_MAGIC;
+	header.m_sizeofObject = sizeof(btCollisionObjectSnapshot);
+	header.m_sizeofManifold = sizeof(btManifoldSnapshot);
+	header.m_sizeofPoint = sizeof(btManifoldPoint);
+	header.m_sizeofConstraint = sizeof(btConstraintSnapshot);
+	header.m_numObjects = m_objects.size();
+	header.m_numManifolds = m_manifolds.size();
+	header.m_numPoints = m_points.size();
+	header.m_numConstraints = m_constraints.size();
+	header.m_localTime = m_localTime;
+
+	unsigned char* dest = (unsigned char*)buffer;
+	memset(dest,0,btSnapshotSectionSize(sizeof(header)));
+	memcpy(dest,&header,sizeof(header));
+	dest += btSnapshotSectionSize(sizeof(header));
+
+	btWriteSnapshotSection(dest,m_objects);
+	btWriteSnapshotSection(dest,m_manifolds);
+	btWriteSnapshotSection(dest,m_points);
+	btWriteSnapshotSection(dest,m_constraints);
+}
+
+bool	btDynamicsWorldSnapshot::readBuffer(const void* buffer, int bufferSize)
+{
+	if (bufferSize < (int)sizeof(btSnapshotBufferHeader))
+		return false;
+
+	btSnapshotBufferHeader header;
+	memcpy(&header,buffer,sizeof(header));
+
+	if ((header.m_magic != BT_SNAPSHOT_MAGIC) ||
+		(header.m_sizeofObject != sizeof(btCollisionObjectSnapshot)) ||
+		(header.m_sizeofManifold != sizeof(btManifoldSnapshot)) ||
+		(header.m_sizeofPoint != sizeof(btManifoldPoint)) ||
+		(header.m_sizeofConstraint != sizeof(btConstraintSnapshot)))
+		return false;
+
+	const unsigned char* src = (const unsigned char*)buffer + btSnapshotSectionSize(sizeof(header));
+	int remainingSize = bufferSize - btSnapshotSectionSize(sizeof(header));
+	if ((remainingSize < 0) ||
+		!btReadSnapshotSection(src,remainingSize,m_objects,header.m_numObjects) ||
+		!btReadSnapshotSection(src,remainingSize,m_manifolds,header.m_numManifolds) ||
+		!btReadSnapshotSection(src,remainingSize,m_points,header.m_numPoints) ||
+		!btReadSnapshotSection(src,remainingSize,m_constraints,header.m_numConstraints))
+	{
+		clear();
+		return false;
+	}
+	m_localTime = header.m_localTime;
+
+	//the manifold ranges are used to index m_points
+	for (int i=0;i<m_manifolds.size();i++)
+	{
+		const btManifoldSnapshot& manifold = m_manifolds[i];
+		if ((manifold.m_objectIndex0 < 0) || (manifold.m_objectIndex0 >= m_objects.size()) ||
+			(manifold.m_objectIndex1 < 0) || (manifold.m_objectIndex1 >= m_objects.size()) ||
+			(manifold.m_numPoints < 0) || (manifold.m_numPoints > MANIFOLD_CACHE_SIZE) ||
+			(manifold.m_firstPoint < 0) || (manifold.m_firstPoint + manifold.m_numPoints > m_points.size()))
+		{
+			clear();
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+class btPendingManifoldSortPredicate
+{
+public:
+	template <typename T>
+	bool operator() ( const T& lhs, const T& rhs ) const
+	{
+		if (lhs.m_body0 != rhs.m_body0)
+			return lhs.m_body0 < rhs.m_body0;
+		return lhs.m_body1 < rhs.m_body1;
+	}
+};
+
+void	btSnapshotManifoldRestore::setPendingManifolds(const btDynamicsWorldSnapshot& snapshot,const btCollisionObjectArray& collisionObjects)
+{
+	m_pendingManifolds.resize(snapshot.m_manifolds.size());
+	for (int i=0;i<snapshot.m_manifolds.size();i++)
+	{
+		const btManifoldSnapshot& manifold = snapshot.m_manifolds[i];
+		btPendingManifold& pending = m_pendingManifolds[i];
+		pending.m_body0 = collisionObjects[manifold.m_objectIndex0];
+		pending.m_body1 = collisionObjects[manifold.m_objectIndex1];
+		pending.m_childIndex0 = manifold.m_childIndex0;
+		pending.m_childIndex1 = manifold.m_childIndex1;
+		pending.m_firstPoint = manifold.m_firstPoint;
+		pending.m_numPoints = manifold.m_numPoints;
+		pending.m_speculativeDistance = manifold.m_speculativeDistance;
+		pending.m_restored = false;
+	}
+	m_pendingManifolds.quickSort(btPendingManifoldSortPredicate());
+	m_points.copyFromArray(snapshot.m_points);
+}
+
+int		btSnapshotManifoldRestore::findFirstPending(const void* body0,const void* body1) const
+{
+	int low = 0;
+	int high = m_pendingManifolds.size();
+	while (low < high)
+	{
+		int mid = (low+high)>>1;
+		const btPendingManifold& pending = m_pendingManifolds[mid];
+		if ((pending.m_body0 < body0) || ((pending.m_body0 == body0) && (pending.m_body1 < body1)))
+		{
+			low = mid+1;
+		} else
+		{
+			high = mid;
+		}
+	}
+	return low;
+}
+
+bool	btSnapshotManifoldRestore::restoreManifold(btPersistentManifold* manifold)
+{
+	const void* body0 = manifold->getBody0();
+	const void* body1 = manifold->getBody1();
+
+	int first = findFirstPending(body0,body1);
+	int last = first;
+	while ((last < m_pendingManifolds.size()) && (m_pendingManifolds[last].m_body0 == body0) && (m_pendingManifolds[last].m_body1 == body1))
+	{
+		last++;
+	}
+	if (first == last)
+		return false;
+
+	int match = -1;
+	for (int i=first;i<last;i++)
+	{
+		const btPendingManifold& pending = m_pendingManifolds[i];
+		if (!pending.m_restored && (pending.m_childIndex0 == manifold->m_childIndex0) && (pending.m_childIndex1 == manifold->m_childIndex1))
+		{
+			match = i;
+			break;
+		}
+	}
+	if (match < 0)
+		return false;
+
+	btPendingManifold& pending = m_pendingManifolds[match];
+	pending.m_restored = true;
+
+	manifold->clearManifold();
+	manifold->setSpeculativeDistance(pending.m_speculativeDistance);
+	for (int i=0;i<pending.m_numPoints;i++)
+	{
+		manifold->addManifoldPoint(m_points[pending.m_firstPoint+i]);
+	}
+	return true;
+}
@@ -0,0 +1,133 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef DYNAMICS_WORLD_SNAPSHOT_H
+#define DYNAMICS_WORLD_SNAPSHOT_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "LinearMath/btTransform.h"
+#include "BulletCollision/NarrowPhaseCollision/btManifoldPoint.h"
+#include "BulletCollision/CollisionDispatch/btManifoldResult.h"
+#include "BulletCollision/CollisionDispatch/btCollisionObject.h"
+
+///btCollisionObjectSnapshot is the dynamic state of one collision object, the velocities are only used for rigid bodies
+ATTRIBUTE_ALIGNED16(struct) btCollisionObjectSnapshot
+{
+	BT_DECLARE_ALIGNED_ALLOCATOR();
+
+	btTransform	m_worldTransform;
+	btTransform	m_interpolationWorldTransform;
+	btVector3	m_interpolationLinearVelocity;
+	btVector3	m_interpolationAngularVelocity;
+	btVector3	m_linearVelocity;
+	btVector3	m_angularVelocity;
+	btScalar	m_deactivationTime;
+	btScalar	m_hitFraction;
+	int			m_activationState;
+	int			m_internalType;
+};
+
+///btManifoldSnapshot refers to its objects by their index in the collision object array, its points are m_numPoints consecutive entries in btDynamicsWorldSnapshot::m_points
+struct btManifoldSnapshot
+{
+	int			m_objectIndex0;
+	int			m_objectIndex1;
+	int			m_childIndex0;
+	int			m_childIndex1;
+	int			m_firstPoint;
+	int			m_numPoints;
+	btScalar	m_speculativeDistance;
+	int			m_pad;
+};
+
+struct btConstraintSnapshot
+{
+	btScalar	m_appliedImpulse;
+};
+
+///btDynamicsWorldSnapshot stores the dynamic state of a btDiscreteDynamicsWorld: transforms, velocities and activation of all collision objects,
+///the contact manifolds including the warm starting impulses of their points, and the applied impulse of the constraints.
+///Take it with btDiscreteDynamicsWorld::saveSnapshot and apply it with restoreSnapshot to the same world, holding the same objects and constraints in the same order.
+///Forces are not part of the snapshot, stepSimulation clears them after each step. Actions and kinematic motion states keep their own state.
+///The arrays keep their capacity, so saving into the same snapshot every frame doesn't allocate once the world has settled.
+class btDynamicsWorldSnapshot
+{
+public:
+
+	btAlignedObjectArray<btCollisionObjectSnapshot>	m_objects;
+	btAlignedObjectArray<btManifoldSnapshot>		m_manifolds;
+	btAlignedObjectArray<btManifoldPoint>			m_points;
+	btAlignedObjectArray<btConstraintSnapshot>		m_constraints;
+	btScalar	m_localTime;
+
+	btDynamicsWorldSnapshot()
+		:m_localTime(btScalar(0.))
+	{
+	}
+
+	void	clear();
+
+	///the binary form is a header followed by the raw arrays, it can only be read back by the same build of the library
+	int		calculateBufferSize() const;
+
+	///writeBuffer writes calculateBufferSize() bytes
+	void	writeBuffer(void* buffer) const;
+
+	///readBuffer returns false when the buffer was not written by writeBuffer of the same build
+	bool	readBuffer(const void* buffer, int bufferSize);
+};
+
+///btSnapshotManifoldRestore puts the contact points of a snapshot back into the manifolds created by the next collision detection.
+///A new manifold receives the points of the saved manifold with the same objects and compound children.
+class btSnapshotManifoldRestore : public btManifoldRestoreCallback
+{
+	struct	btPendingManifold
+	{
+		const void*	m_body0;
+		const void*	m_body1;
+		int			m_childIndex0;
+		int			m_childIndex1;
+		int			m_firstPoint;
+		int			m_numPoints;
+		btScalar	m_speculativeDistance;
+		bool		m_restored;
+	};
+
+	btAlignedObjectArray<btPendingManifold>	m_pendingManifolds;
+	btAlignedObjectArray<btManifoldPoint>	m_points;
+
+	int		findFirstPending(const void* body0,const void* body1) const;
+
+public:
+
+	virtual ~btSnapshotManifoldRestore() {}
+
+	void	setPendingManifolds(const btDynamicsWorldSnapshot& snapshot,const btCollisionObjectArray& collisionObjects);
+
+	void	clear()
+	{
+		m_pendingManifolds.resize(0);
+		m_points.resize(0);
+	}
+
+	bool	hasPendingManifolds() const
+	{
+		return m_pendingManifolds.size() != 0;
+	}
+
+	virtual bool	restoreManifold(btPersistentManifold* manifold);
+};
+
+#endif //DYNAMICS_WORLD_SNAPSHOT_H
@@ -271,20 +271,7 @@ void btRaycastVehicle::updateVehicle( btScalar step )
 		}
 	}
 
-
-	m_currentVehicleSpeedKmHour = btScalar(3.6) * getRigidBody()->getLinearVelocity().length();
-	
-	const btTransform& chassisTrans = getChassisWorldTransform();
-
-	btVector3 forwardW (
-		chassisTrans.getBasis()[0][m_indexForwardAxis],
-		chassisTrans.getBasis()[1][m_indexForwardAxis],
-		chassisTrans.getBasis()[2][m_indexForwardAxis]);
-
-	if (forwardW.dot(getRigidBody()->getLinearVelocity()) < btScalar(0.))
-	{
-		m_currentVehicleSpeedKmHour *= btScalar(-1.);
-	}
+	updateCurrentSpeed();
 
 	//
 	// simulate suspension
@@ -299,8 +286,28 @@ void btRaycastVehicle::updateVehicle( btScalar step )
 
 	updateSuspension(step);
 
+	applySuspensionForces(step);
 	
-	for (i=0;i<m_wheelInfo.size();i++)
+	updateFriction( step);
+
+	updateWheelRotation(step);
+}
+
+
+void	btRaycastVehicle::updateCurrentSpeed()
+{
+	m_currentVehicleSpeedKmHour = btScalar(3.6) * getRigidBody()->getLinearVelocity().length();
+	
+	if (getForwardVector().dot(getRigidBody()->getLinearVelocity()) < btScalar(0.))
+	{
+		m_currentVehicleSpeedKmHour *= btScalar(-1.);
+	}
+}
+
+
+void	btRaycastVehicle::applySuspensionForces(btScalar step)
+{
+	for (int i=0;i<m_wheelInfo.size();i++)
 	{
 		//apply suspension force
 		btWheelInfo& wheel = m_wheelInfo[i];
@@ -317,13 +324,12 @@ void btRaycastVehicle::updateVehicle( btScalar step )
 		getRigidBody()->applyImpulse(impulse, relpos);
 	
 	}
-	
+}
 
-	
-	updateFriction( step);
 
-	
-	for (i=0;i<m_wheelInfo.size();i++)
+void	btRaycastVehicle::updateWheelRotation(btScalar step)
+{
+	for (int i=0;i<m_wheelInfo.size();i++)
 	{
 		btWheelInfo& wheel = m_wheelInfo[i];
 		btVector3 relpos = wheel.m_raycastInfo.m_hardPointWS - getRigidBody()->getCenterOfMassPosition();
@@ -331,12 +337,7 @@ void btRaycastVehicle::updateVehicle( btScalar step )
 
 		if (wheel.m_raycastInfo.m_isInContact)
 		{
-			const btTransform&	chassisWorldTransform = getChassisWorldTransform();
-
-			btVector3 fwd (
-				chassisWorldTransform.getBasis()[0][m_indexForwardAxis],
-				chassisWorldTransform.getBasis()[1][m_indexForwardAxis],
-				chassisWorldTransform.getBasis()[2][m_indexForwardAxis]);
+			btVector3 fwd = getForwardVector();
 
 			btScalar proj = fwd.dot(wheel.m_raycastInfo.m_contactNormalWS);
 			fwd -= wheel.m_raycastInfo.m_contactNormalWS * proj;
@@ -354,9 +355,6 @@ void btRaycastVehicle::updateVehicle( btScalar step )
 		wheel.m_deltaRotation *= btScalar(0.99);//damping of rotation when not in contact
 
 	}
-
-
-
 }
 
 
@@ -97,6 +97,15 @@ public:
 	btScalar rayCast(btWheelInfo& wheel);
 
 	virtual void updateVehicle(btScalar step);
+
+	///updateCurrentSpeed computes the signed speed along the forward vector, see getCurrentSpeedKmHour
+	void	updateCurrentSpeed();
+
+	///applySuspensionForces applies the suspension forces computed by updateSuspension to the chassis
+	void	applySuspensionForces(btScalar step);
+
+	///updateWheelRotation spins the wheels in contact with the ground, the others slowly stop
+	void	updateWheelRotation(btScalar step);
 	
 	
 	void resetSuspension();
@@ -0,0 +1,251 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btRaycastVehicleManager.h"
+#include "btRaycastVehicle.h"
+#include "BulletDynamics/Dynamics/btRigidBody.h"
+
+btRaycastVehicleManager::btRaycastVehicleManager()
+:m_maxThreads(1)
+{
+}
+
+btRaycastVehicleManager::~btRaycastVehicleManager()
+{
+}
+
+void	btRaycastVehicleManager::addVehicle(btRaycastVehicle* vehicle)
+{
+	btAssert(m_vehicles.findLinearSearch(vehicle) == m_vehicles.size());
+	m_vehicles.push_back(vehicle);
+}
+
+void	btRaycastVehicleManager::removeVehicle(btRaycastVehicle* vehicle)
+{
+	m_vehicles.remove(vehicle);
+}
+
+///traceWheelRays does the work of btRaycastVehicle::rayCast for all wheels, the geometry that depends on the hit goes to the arrays used by updateSuspensions
+void	btRaycastVehicleManager::traceWheelRays(btCollisionWorld* collisionWorld)
+{
+	int numWheels = m_wheelOffsets[m_vehicles.size()];
+	int v;
+
+	for (v=0;v<m_vehicles.size();v++)
+	{
+		btRaycastVehicle* vehicle = m_vehicles[v];
+		btScalar chassisMass = btScalar(1.) / vehicle->getRigidBody()->getInvMass();
+		int k = m_wheelOffsets[v];
+		for (int w=0;w<vehicle->getNumWheels();w++,k++)
+		{
+			btWheelInfo& wheel = vehicle->getWheelInfo(w);
+			vehicle->updateWheelTransformsWS(wheel,false);
+
+			btScalar raylen = wheel.getSuspensionRestLength()+wheel.m_wheelsRadius;
+			const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
+			wheel.m_raycastInfo.m_contactPointWS = source + wheel.m_raycastInfo.m_wheelDirectionWS * raylen;
+
+			m_rays[k].m_rayFromWorld = source;
+			m_rays[k].m_rayToWorld = wheel.m_raycastInfo.m_contactPointWS;
+			m_rays[k].m_ignoreObject = vehicle->getRigidBody();
+
+			m_restLength[k] = wheel.getSuspensionRestLength();
+			m_maxTravel[k] = wheel.m_maxSuspensionTravelCm*btScalar(0.01);
+			m_rayLength[k] = raylen;
+			m_wheelRadius[k] = wheel.m_wheelsRadius;
+			m_stiffness[k] = wheel.m_suspensionStiffness;
+			m_dampingCompression[k] = wheel.m_wheelsDampingCompression;
+			m_dampingRelaxation[k] = wheel.m_wheelsDampingRelaxation;
+			m_chassisMass[k] = chassisMass;
+		}
+	}
+
+	if (numWheels)
+	{
+		collisionWorld->rayTestBatch(&m_rays[0],numWheels,&m_rayResults[0],btCollisionWorld::RAY_BATCH_CLOSEST_HIT,m_maxThreads);
+	}
+
+	for (v=0;v<m_vehicles.size();v++)
+	{
+		btRaycastVehicle* vehicle = m_vehicles[v];
+		btRigidBody* chassis = vehicle->getRigidBody();
+		int k = m_wheelOffsets[v];
+		for (int w=0;w<vehicle->getNumWheels();w++,k++)
+		{
+			btWheelInfo& wheel = vehicle->getWheelInfo(w);
+			const btCollisionWorld::BatchedRayResult& result = m_rayResults[k];
+			btRigidBody* body = result.hasHit() ? btRigidBody::upcast(result.m_collisionObject) : 0;
+
+			wheel.m_raycastInfo.m_groundObject = 0;
+
+			if (body && body->hasContactResponse())
+			{
+				btVector3 normal = result.m_hitNormalWorld;
+				normal.normalize();
+
+				wheel.m_raycastInfo.m_contactNormalWS = normal;
+				wheel.m_raycastInfo.m_contactPointWS = result.m_hitPointWorld;
+				wheel.m_raycastInfo.m_isInContact = true;
+				wheel.m_raycastInfo.m_groundObject = &getFixedBody();///@todo for driving on dynamic/movable objects!;
+
+				btVector3 relpos = result.m_hitPointWorld - chassis->getCenterOfMassPosition();
+
+				m_hitFraction[k] = result.m_hitFraction;
+				m_normalDotDirection[k] = normal.dot(wheel.m_raycastInfo.m_wheelDirectionWS);
+				m_projectedVelocity[k] = normal.dot(chassis->getVelocityInLocalPoint(relpos));
+			} else
+			{
+				wheel.m_raycastInfo.m_contactNormalWS = - wheel.m_raycastInfo.m_wheelDirectionWS;
+				m_hitFraction[k] = btScalar(-1.);
+			}
+		}
+	}
+}
+
+///updateSuspensions is btRaycastVehicle::updateSuspension and the suspension part of btRaycastVehicle::rayCast over the arrays of all wheels, a negative hit fraction marks a wheel without ground contact
+void	btRaycastVehicleManager::updateSuspensions()
+{
+	int numWheels = m_wheelOffsets[m_vehicles.size()];
+	if (!numWheels)
+	{
+		return;
+	}
+
+	const btScalar* hitFraction = &m_hitFraction[0];
+	const btScalar* rayLength = &m_rayLength[0];
+	const btScalar* wheelRadius = &m_wheelRadius[0];
+	const btScalar* restLength = &m_restLength[0];
+	const btScalar* maxTravel = &m_maxTravel[0];
+	const btScalar* normalDotDirection = &m_normalDotDirection[0];
+	const btScalar* projectedVelocity = &m_projectedVelocity[0];
+	const btScalar* stiffness = &m_stiffness[0];
+	const btScalar* dampingCompression = &m_dampingCompression[0];
+	const btScalar* dampingRelaxation = &m_dampingRelaxation[0];
+	const btScalar* chassisMass = &m_chassisMass[0];
+	btScalar* suspensionLength = &m_suspensionLength[0];
+	btScalar* relativeVelocity = &m_relativeVelocity[0];
+	btScalar* clippedInv = &m_clippedInvContactDotSuspension[0];
+	btScalar* suspensionForce = &m_suspensionForce[0];
+
+	for (int k=0;k<numWheels;k++)
+	{
+		if (hitFraction[k] < btScalar(0.))
+		{
+			//put wheel info as in rest position
+			suspensionLength[k] = restLength[k];
+			relativeVelocity[k] = btScalar(0.);
+			clippedInv[k] = btScalar(1.);
+			suspensionForce[k] = btScalar(0.);
+			continue;
+		}
+
+		//clamp on max suspension travel
+		btScalar length = hitFraction[k]*rayLength[k] - wheelRadius[k];
+		length = btMax(length,restLength[k]-maxTravel[k]);
+		length = btMin(length,restLength[k]+maxTravel[k]);
+		suspensionLength[k] = length;
+
+		btScalar denominator = normalDotDirection[k];
+		if (denominator >= btScalar(-0.1))
+		{
+			relativeVelocity[k] = btScalar(0.);
+			clippedInv[k] = btScalar(1.) / btScalar(0.1);
+		} else
+		{
+			btScalar inv = btScalar(-1.) / denominator;
+			relativeVelocity[k] = projectedVelocity[k] * inv;
+			clippedInv[k] = inv;
+		}
+
+		//spring and damper
+		btScalar force = stiffness[k] * (restLength[k] - length) * clippedInv[k];
+		btScalar damping = relativeVelocity[k] < btScalar(0.) ? dampingCompression[k] : dampingRelaxation[k];
+		force -= damping * relativeVelocity[k];
+		suspensionForce[k] = btMax(force * chassisMass[k],btScalar(0.));
+	}
+}
+
+void	btRaycastVehicleManager::updateAction(btCollisionWorld* collisionWorld, btScalar step)
+{
+	int v;
+	int numWheels = 0;
+	m_wheelOffsets.resize(m_vehicles.size()+1);
+	for (v=0;v<m_vehicles.size();v++)
+	{
+		m_wheelOffsets[v] = numWheels;
+		numWheels += m_vehicles[v]->getNumWheels();
+	}
+	m_wheelOffsets[m_vehicles.size()] = numWheels;
+
+	m_rays.resize(numWheels);
+	m_rayResults.resize(numWheels);
+	m_restLength.resize(numWheels);
+	m_maxTravel.resize(numWheels);
+	m_rayLength.resize(numWheels);
+	m_wheelRadius.resize(numWheels);
+	m_hitFraction.resize(numWheels);
+	m_normalDotDirection.resize(numWheels);
+	m_projectedVelocity.resize(numWheels);
+	m_stiffness.resize(numWheels);
+	m_dampingCompression.resize(numWheels);
+	m_dampingRelaxation.resize(numWheels);
+	m_chassisMass.resize(numWheels);
+	m_suspensionLength.resize(numWheels);
+	m_relativeVelocity.resize(numWheels);
+	m_clippedInvContactDotSuspension.resize(numWheels);
+	m_suspensionForce.resize(numWheels);
+
+	for (v=0;v<m_vehicles.size();v++)
+	{
+		btRaycastVehicle* vehicle = m_vehicles[v];
+		for (int w=0;w<vehicle->getNumWheels();w++)
+		{
+			vehicle->updateWheelTransform(w,false);
+		}
+		vehicle->updateCurrentSpeed();
+	}
+
+	traceWheelRays(collisionWorld);
+
+	updateSuspensions();
+
+	//the vehicles only push their own chassis and the fixed ground body, so they can finish one after the other
+	for (v=0;v<m_vehicles.size();v++)
+	{
+		btRaycastVehicle* vehicle = m_vehicles[v];
+		int k = m_wheelOffsets[v];
+		for (int w=0;w<vehicle->getNumWheels();w++,k++)
+		{
+			btWheelInfo& wheel = vehicle->getWheelInfo(w);
+			wheel.m_raycastInfo.m_suspensionLength = m_suspensionLength[k];
+			wheel.m_suspensionRelativeVelocity = m_relativeVelocity[k];
+			wheel.m_clippedInvContactDotSuspension = m_clippedInvContactDotSuspension[k];
+			wheel.m_wheelsSuspensionForce = m_suspensionForce[k];
+		}
+
+		vehicle->applySuspensionForces(step);
+		vehicle->updateFriction(step);
+		vehicle->updateWheelRotation(step);
+	}
+}
+
+void	btRaycastVehicleManager::debugDraw(btIDebugDraw* debugDrawer)
+{
+	for (int v=0;v<m_vehicles.size();v++)
+	{
+		m_vehicles[v]->debugDraw(debugDrawer);
+	}
+}
@@ -0,0 +1,105 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef RAYCAST_VEHICLE_MANAGER_H
+#define RAYCAST_VEHICLE_MANAGER_H
+
+#include "LinearMath/btAlignedObjectArray.h"
+#include "BulletDynamics/Dynamics/btActionInterface.h"
+#include "BulletCollision/CollisionDispatch/btCollisionWorld.h"
+
+class btRaycastVehicle;
+
+///btRaycastVehicleManager updates many btRaycastVehicle at once, add it to the dynamics world instead of the vehicles.
+///All wheel rays of all vehicles are traced with one btCollisionWorld::rayTestBatch, and the suspension of all wheels is solved in structure of arrays form.
+///The rays are traced against the world passed to updateAction, so the btVehicleRaycaster of the vehicles is not used and overrides of btRaycastVehicle::updateVehicle are not called.
+///Like btDefaultVehicleRaycaster, a wheel only touches the ground when the closest hit is a btRigidBody with contact response. Unlike it, the wheel rays skip the chassis of their own vehicle.
+class btRaycastVehicleManager : public btActionInterface
+{
+	btAlignedObjectArray<btRaycastVehicle*>	m_vehicles;
+	int	m_maxThreads;
+
+	///one entry per wheel, the wheels of vehicle i start at m_wheelOffsets[i]
+	btAlignedObjectArray<int>	m_wheelOffsets;
+	btAlignedObjectArray<btCollisionWorld::BatchedRay>	m_rays;
+	btAlignedObjectArray<btCollisionWorld::BatchedRayResult>	m_rayResults;
+
+	///suspension state of all wheels in structure of arrays form
+	btAlignedObjectArray<btScalar>	m_restLength;
+	btAlignedObjectArray<btScalar>	m_maxTravel;
+	btAlignedObjectArray<btScalar>	m_rayLength;
+	btAlignedObjectArray<btScalar>	m_wheelRadius;
+	btAlignedObjectArray<btScalar>	m_hitFraction;
+	btAlignedObjectArray<btScalar>	m_normalDotDirection;
+	btAlignedObjectArray<btScalar>	m_projectedVelocity;
+	btAlignedObjectArray<btScalar>	m_stiffness;
+	btAlignedObjectArray<btScalar>	m_dampingCompression;
+	btAlignedObjectArray<btScalar>	m_dampingRelaxation;
+	btAlignedObjectArray<btScalar>	m_chassisMass;
+	btAlignedObjectArray<btScalar>	m_suspensionLength;
+	btAlignedObjectArray<btScalar>	m_relativeVelocity;
+	btAlignedObjectArray<btScalar>	m_clippedInvContactDotSuspension;
+	btAlignedObjectArray<btScalar>	m_suspensionForce;
+
+	void	traceWheelRays(btCollisionWorld* collisionWorld);
+
+	void	updateSuspensions();
+
+public:
+
+	btRaycastVehicleManager();
+
+	virtual ~btRaycastVehicleManager();
+
+	///the manager does not own the vehicles
+	void	addVehicle(btRaycastVehicle* vehicle);
+
+	void	removeVehicle(btRaycastVehicle* vehicle);
+
+	int		getNumVehicles() const
+	{
+		return m_vehicles.size();
+	}
+
+	btRaycastVehicle*	getVehicle(int index)
+	{
+		return m_vehicles[index];
+	}
+
+	const btRaycastVehicle*	getVehicle(int index) const
+	{
+		return m_vehicles[index];
+	}
+
+	///setMaxThreads is passed on to rayTestBatch, the suspension and friction updates stay on the calling thread
+	void	setMaxThreads(int maxThreads)
+	{
+		m_maxThreads = maxThreads;
+	}
+
+	int		getMaxThreads() const
+	{
+		return m_maxThreads;
+	}
+
+	///btActionInterface interface
+	virtual void	updateAction(btCollisionWorld* collisionWorld, btScalar step);
+
+	///btActionInterface interface
+	virtual void	debugDraw(btIDebugDraw* debugDrawer);
+};
+
+#endif //RAYCAST_VEHICLE_MANAGER_H
@@ -102,6 +102,18 @@ void btAlignedAllocSetCustom(btAllocFunc *allocFunc, btFreeFunc *freeFunc)
   sFreeFunc = freeFunc ? freeFunc : btFreeDefault;
 }
 
+static btSetAllocTagFunc *sSetAllocTagFunc = 0;
+
+void btAlignedAllocSetTagFunc(btSetAllocTagFunc *setTagFunc)
+{
+  sSetAllocTagFunc = setTagFunc;
+}
+
+int btSetAllocTag(int tag)
+{
+  return sSetAllocTagFunc ? sSetAllocTagFunc(tag) : BT_ALLOC_TAG_DEFAULT;
+}
+
 #ifdef BT_DEBUG_MEMORY_ALLOCATIONS
 //this generic allocator provides the total allocated number of bytes
 #include <stdio.h>
@@ -159,7 +171,7 @@ void    btAlignedFreeInternal   (void* ptr,int line,char* filename)
 
 void*	btAlignedAllocInternal	(size_t size, int alignment)
 {
-	gNumAlignedAllocs++;
+	btAtomicIncrement(&gNumAlignedAllocs);
 	void* ptr;
 	ptr = sAlignedAllocFunc(size, alignment);
 //	printf("btAlignedAllocInternal %d, %x\n",size,ptr);
@@ -173,7 +185,7 @@ void	btAlignedFreeInternal	(void* ptr)
 		return;
 	}
 
-	gNumAlignedFree++;
+	btAtomicIncrement(&gNumAlignedFree);
 //	printf("btAlignedFreeInternal %x\n",ptr);
 	sAlignedFreeFunc(ptr);
 }
@@ -54,6 +54,63 @@ void btAlignedAllocSetCustom(btAllocFunc *allocFunc, btFreeFunc *freeFunc);
 ///If the developer has already an custom aligned allocator, then btAlignedAllocSetCustomAligned can be used. The default aligned allocator pre-allocates extra memory using the non-aligned allocator, and instruments it.
 void btAlignedAllocSetCustomAligned(btAlignedAllocFunc *allocFunc, btAlignedFreeFunc *freeFunc);
 
+///btAllocTag tells an allocator which part of the library made an allocation, so it can report where the memory goes (see btSizeClassAllocator.h)
+enum btAllocTag
+{
+	BT_ALLOC_TAG_DEFAULT = 0,
+	BT_ALLOC_TAG_SHAPES,
+	BT_ALLOC_TAG_BROADPHASE,
+	BT_ALLOC_TAG_MANIFOLDS,
+	BT_ALLOC_TAG_SOLVER,
+	BT_MAX_ALLOC_TAGS
+};
+
+typedef int (btSetAllocTagFunc)(int tag);
+
+///btAlignedAllocSetTagFunc installs the function that records the tag of the calling thread, it is 0 when the allocator doesn't use tags
+void btAlignedAllocSetTagFunc(btSetAllocTagFunc *setTagFunc);
+
+///btSetAllocTag sets the tag of the following allocations of the calling thread and returns the previous tag
+int btSetAllocTag(int tag);
+
+///btAllocTagScope tags the allocations of the calling thread until the scope is left, use the BT_ALLOC_TAG macro
+class btAllocTagScope
+{
+	int	m_previousTag;
+
+	btAllocTagScope(const btAllocTagScope&);
+	btAllocTagScope& operator=(const btAllocTagScope&);
+
+public:
+
+	btAllocTagScope(int tag)
+		:m_previousTag(btSetAllocTag(tag))
+	{
+	}
+
+	~btAllocTagScope()
+	{
+		btSetAllocTag(m_previousTag);
+	}
+};
+
+#define BT_ALLOC_TAG_CONCAT_INNER(a,b) a##b
+#define BT_ALLOC_TAG_CONCAT(a,b) BT_ALLOC_TAG_CONCAT_INNER(a,b)
+///BT_ALLOC_TAG names its scope object after the line, so a function can use it more than once
+#define BT_ALLOC_TAG(tag) btAllocTagScope BT_ALLOC_TAG_CONCAT(allocTagScope,__LINE__)(tag)
+
+///BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR is BT_DECLARE_ALIGNED_ALLOCATOR for classes whose instances belong to one tag, such as the collision shapes
+#define BT_DECLARE_TAGGED_ALIGNED_ALLOCATOR(tag) \
+   SIMD_FORCE_INLINE void* operator new(size_t sizeInBytes)   { BT_ALLOC_TAG(tag); return btAlignedAlloc(sizeInBytes,16); }   \
+   SIMD_FORCE_INLINE void  operator delete(void* ptr)         { btAlignedFree(ptr); }   \
+   SIMD_FORCE_INLINE void* operator new(size_t, void* ptr)   { return ptr; }   \
+   SIMD_FORCE_INLINE void  operator delete(void*, void*)      { }   \
+   SIMD_FORCE_INLINE void* operator new[](size_t sizeInBytes)   { BT_ALLOC_TAG(tag); return btAlignedAlloc(sizeInBytes,16); }   \
+   SIMD_FORCE_INLINE void  operator delete[](void* ptr)         { btAlignedFree(ptr); }   \
+   SIMD_FORCE_INLINE void* operator new[](size_t, void* ptr)   { return ptr; }   \
+   SIMD_FORCE_INLINE void  operator delete[](void*, void*)      { }   \
+
+
 
 ///The btAlignedAllocator is a portable class for aligned memory allocations.
 ///Default implementations for unaligned and aligned allocations can be overridden by a custom allocator using btAlignedAllocSetCustom and btAlignedAllocSetCustomAligned.
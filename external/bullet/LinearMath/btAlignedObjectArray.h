@@ -205,6 +205,16 @@ class btAlignedObjectArray
 			m_size = newsize;
 		}
 	
+		///resizeNoInitialize changes the number of elements like resize, but leaves new elements uninitialized, use it for data that is written right after
+		SIMD_FORCE_INLINE	void	resizeNoInitialize(int newsize)
+		{
+			if (newsize > size())
+			{
+				reserve(newsize);
+			}
+			m_size = newsize;
+		}
+	
 		SIMD_FORCE_INLINE	T&  expandNonInitializing( )
 		{	
 			int sz = size();
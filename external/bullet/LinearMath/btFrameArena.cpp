@@ -0,0 +1,183 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btFrameArena.h"
+#include "btAlignedAllocator.h"
+#include "btMinMax.h"
+
+#if !defined (_WIN32) && !defined (__SPU__) && !defined (BT_NO_FRAME_ARENA_THREADS)
+#define BT_FRAME_ARENA_THREADS
+#include <pthread.h>
+#endif //BT_NO_FRAME_ARENA_THREADS
+
+
+btFrameArena::btFrameArena()
+:m_currentBlock(0),
+m_offset(0),
+m_highWaterMark(0)
+{
+}
+
+btFrameArena::~btFrameArena()
+{
+	release();
+}
+
+size_t	btFrameArena::getUsedSize() const
+{
+	size_t used = m_offset;
+	for (int i=0;i<m_currentBlock;i++)
+	{
+		used += m_blocks[i].m_size;
+	}
+	return used;
+}
+
+size_t	btFrameArena::getCapacity() const
+{
+	size_t capacity = 0;
+	for (int i=0;i<m_blocks.size();i++)
+	{
+		capacity += m_blocks[i].m_size;
+	}
+	return capacity;
+}
+
+void	btFrameArena::addBlock(size_t minSize)
+{
+	//grow geometrically, so a query that needs a lot of memory only allocates a few blocks
+	size_t size = btMax(size_t(BT_FRAME_ARENA_MIN_BLOCK_SIZE),getCapacity());
+	while (size < minSize)
+	{
+		size *= 2;
+	}
+	btArenaBlock block;
+	block.m_data = (char*)btAlignedAlloc(size,BT_FRAME_ARENA_ALIGNMENT);
+	block.m_size = size;
+	m_blocks.push_back(block);
+}
+
+void	btFrameArena::coalesceBlocks()
+{
+	size_t capacity = getCapacity();
+	release();
+	addBlock(capacity);
+}
+
+void*	btFrameArena::allocate(size_t size)
+{
+	size = (size + BT_FRAME_ARENA_ALIGNMENT-1) & ~size_t(BT_FRAME_ARENA_ALIGNMENT-1);
+
+	if (m_currentBlock >= m_blocks.size() || m_offset+size > m_blocks[m_currentBlock].m_size)
+	{
+		if (m_currentBlock < m_blocks.size())
+		{
+			m_currentBlock++;
+		}
+		//the blocks after the current one are unused, keep the next one if it is large enough
+		if (m_currentBlock >= m_blocks.size() || size > m_blocks[m_currentBlock].m_size)
+		{
+			while (m_blocks.size() > m_currentBlock)
+			{
+				btAlignedFree(m_blocks[m_blocks.size()-1].m_data);
+				m_blocks.pop_back();
+			}
+			addBlock(size);
+		}
+		m_offset = 0;
+	}
+
+	void* ptr = m_blocks[m_currentBlock].m_data + m_offset;
+	m_offset += size;
+
+	size_t used = getUsedSize();
+	if (used > m_highWaterMark)
+	{
+		m_highWaterMark = used;
+	}
+	return ptr;
+}
+
+void	btFrameArena::rewind(const btFrameArenaMarker& marker)
+{
+	btAssert(marker.m_block < m_currentBlock || (marker.m_block == m_currentBlock && marker.m_offset <= m_offset));
+	m_currentBlock = marker.m_block;
+	m_offset = marker.m_offset;
+	if (m_currentBlock == 0 && m_offset == 0 && m_blocks.size() > 1)
+	{
+		coalesceBlocks();
+	}
+}
+
+void	btFrameArena::reset()
+{
+	btFrameArenaMarker start;
+	start.m_block = 0;
+	start.m_offset = 0;
+	rewind(start);
+}
+
+void	btFrameArena::release()
+{
+	for (int i=0;i<m_blocks.size();i++)
+	{
+		btAlignedFree(m_blocks[i].m_data);
+	}
+	m_blocks.clear();
+	m_currentBlock = 0;
+	m_offset = 0;
+}
+
+
+#ifdef BT_FRAME_ARENA_THREADS
+
+static pthread_key_t	gThreadArenaKey;
+static pthread_once_t	gThreadArenaKeyOnce = PTHREAD_ONCE_INIT;
+
+static void	btDeleteThreadArena(void* arena)
+{
+	btFrameArena* frameArena = (btFrameArena*)arena;
+	frameArena->~btFrameArena();
+	btAlignedFree(frameArena);
+}
+
+static void	btCreateThreadArenaKey()
+{
+	pthread_key_create(&gThreadArenaKey,btDeleteThreadArena);
+}
+
+btFrameArena*	btFrameArena::getThreadArena()
+{
+	pthread_once(&gThreadArenaKeyOnce,btCreateThreadArenaKey);
+	btFrameArena* arena = (btFrameArena*)pthread_getspecific(gThreadArenaKey);
+	if (!arena)
+	{
+		void* mem = btAlignedAlloc(sizeof(btFrameArena),16);
+		arena = new (mem) btFrameArena();
+		pthread_setspecific(gThreadArenaKey,arena);
+	}
+	return arena;
+}
+
+#else
+
+btFrameArena*	btFrameArena::getThreadArena()
+{
+	static btFrameArena gFrameArena;
+	return &gFrameArena;
+}
+
+#endif //BT_FRAME_ARENA_THREADS
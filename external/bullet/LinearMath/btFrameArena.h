@@ -0,0 +1,125 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef BT_FRAME_ARENA_H
+#define BT_FRAME_ARENA_H
+
+#include "btAlignedObjectArray.h"
+
+#define BT_FRAME_ARENA_ALIGNMENT 16
+#define BT_FRAME_ARENA_MIN_BLOCK_SIZE (64*1024)
+
+///btFrameArenaMarker is a position in a btFrameArena, see getMarker and rewind
+struct btFrameArenaMarker
+{
+	int		m_block;
+	size_t	m_offset;
+};
+
+///The btFrameArena is a linear allocator for temporary arrays that only live for one query or simulation step, such as the GImpact pair sets and the constraint rows of the btSequentialImpulseConstraintSolver.
+///Memory is never freed individually, a query takes a marker and rewinds to it when done (see btFrameArenaScope), or the owner resets the arena once per step.
+///When the arena is rewound to its start after it needed more than one block, the blocks are merged into a single block of the total size, so in steady state it does no heap allocation.
+class btFrameArena
+{
+	struct btArenaBlock
+	{
+		char*	m_data;
+		size_t	m_size;
+	};
+
+	btAlignedObjectArray<btArenaBlock>	m_blocks;
+	int		m_currentBlock;
+	size_t	m_offset;
+	size_t	m_highWaterMark;
+
+	size_t	getUsedSize() const;
+
+	void	addBlock(size_t minSize);
+
+	void	coalesceBlocks();
+
+public:
+
+	btFrameArena();
+
+	virtual ~btFrameArena();
+
+	///allocate returns 16 byte aligned memory that stays valid until the arena is rewound past it
+	void*	allocate(size_t size);
+
+	template <typename T>
+	T*	allocateArray(int count)
+	{
+		return (T*)allocate(sizeof(T)*size_t(count));
+	}
+
+	btFrameArenaMarker	getMarker() const
+	{
+		btFrameArenaMarker marker;
+		marker.m_block = m_currentBlock;
+		marker.m_offset = m_offset;
+		return marker;
+	}
+
+	void	rewind(const btFrameArenaMarker& marker);
+
+	///reset rewinds the whole arena, call it once per simulation step if allocations are not scoped
+	void	reset();
+
+	///release frees all blocks
+	void	release();
+
+	size_t	getCapacity() const;
+
+	///getHighWaterMark returns the largest number of bytes in use since the arena was created
+	size_t	getHighWaterMark() const
+	{
+		return m_highWaterMark;
+	}
+
+	///getThreadArena returns the arena of the calling thread, it is created on first use and deleted when the thread exits
+	static btFrameArena*	getThreadArena();
+};
+
+///btFrameArenaScope rewinds the arena to the position it had when the scope was entered
+class btFrameArenaScope
+{
+	btFrameArena*	m_arena;
+	btFrameArenaMarker	m_marker;
+
+	btFrameArenaScope(const btFrameArenaScope&);
+	btFrameArenaScope& operator=(const btFrameArenaScope&);
+
+public:
+
+	btFrameArenaScope(btFrameArena* arena)
+		:m_arena(arena),
+		m_marker(arena->getMarker())
+	{
+	}
+
+	~btFrameArenaScope()
+	{
+		m_arena->rewind(m_marker);
+	}
+
+	btFrameArena*	getArena()
+	{
+		return m_arena;
+	}
+};
+
+#endif //BT_FRAME_ARENA_H
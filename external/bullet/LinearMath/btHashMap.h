@@ -379,6 +379,13 @@ protected:
 		return &m_valueArray[index];
 	}
 
+	const Key&	getKeyAtIndex(int index) const
+	{
+		btAssert(index < m_keyArray.size());
+
+		return m_keyArray[index];
+	}
+
 	Value* operator[](const Key& key) {
 		return find(key);
 	}
@@ -431,4 +438,246 @@ protected:
 
 };
 
+///The btOpenHashMap has the interface of btHashMap, but finds the keys by open addressing (Robin Hood linear probing) instead of chaining.
+///A slot holds the hash of its key and the index of the pair, so a lookup reads a few neighbouring slots instead of following the chain through m_next,
+///and compares a key only when the full hash matches. A lookup that fails stops at the first slot that is closer to its home slot than the searched key would be.
+///Like btHashMap the keys and values are stored densely in insertion order, getAtIndex can be used to iterate and remove moves the last pair into the gap.
+template <class Key, class Value>
+class btOpenHashMap
+{
+
+protected:
+
+	struct	btOpenHashSlot
+	{
+		unsigned int	m_hash;
+		int				m_index;
+	};
+
+	btAlignedObjectArray<btOpenHashSlot>	m_slots;
+
+	btAlignedObjectArray<Value>		m_valueArray;
+	btAlignedObjectArray<Key>		m_keyArray;
+
+	///getProbeDistance returns how far the slot is from the home slot of the key it holds
+	SIMD_FORCE_INLINE	int	getProbeDistance(int slotIndex) const
+	{
+		int mask = m_slots.size()-1;
+		return (slotIndex - int(m_slots[slotIndex].m_hash & unsigned(mask))) & mask;
+	}
+
+	///findSlot returns the slot that holds the key, or -1
+	int	findSlot(const Key& key,unsigned int hash) const
+	{
+		int mask = m_slots.size()-1;
+		if (mask < 0)
+		{
+			return -1;
+		}
+		int slotIndex = int(hash & unsigned(mask));
+		for (int distance=0;;distance++)
+		{
+			const btOpenHashSlot& slot = m_slots[slotIndex];
+			//a key is never stored further from its home slot than the keys it passed
+			if (slot.m_index == BT_HASH_NULL || getProbeDistance(slotIndex) < distance)
+			{
+				return -1;
+			}
+			if (slot.m_hash == hash && key.equals(m_keyArray[slot.m_index]))
+			{
+				return slotIndex;
+			}
+			slotIndex = (slotIndex+1) & mask;
+		}
+	}
+
+	///insertSlot stores the slot at slotIndex, which is distance away from its home slot, and moves the slots it displaces further along
+	void	insertSlot(btOpenHashSlot carry,int slotIndex,int distance)
+	{
+		int mask = m_slots.size()-1;
+		for (;;distance++)
+		{
+			btOpenHashSlot& slot = m_slots[slotIndex];
+			if (slot.m_index == BT_HASH_NULL)
+			{
+				slot = carry;
+				return;
+			}
+			int slotDistance = getProbeDistance(slotIndex);
+			if (slotDistance < distance)
+			{
+				btSwap(slot,carry);
+				distance = slotDistance;
+			}
+			slotIndex = (slotIndex+1) & mask;
+		}
+	}
+
+	///growTables keeps the table at most 3/4 full
+	void	growTables()
+	{
+		int numSlots = m_slots.size();
+		int needed = m_keyArray.size() + 1;
+		if (needed*4 <= numSlots*3)
+		{
+			return;
+		}
+		int newNumSlots = numSlots ? numSlots*2 : 16;
+		btOpenHashSlot empty;
+		empty.m_hash = 0;
+		empty.m_index = BT_HASH_NULL;
+		btAlignedObjectArray<btOpenHashSlot> oldSlots(m_slots);
+		m_slots.resize(0);
+		m_slots.resize(newNumSlots,empty);
+		//the slots keep the hashes, so the keys are not hashed again
+		int mask = newNumSlots-1;
+		for (int i=0;i<numSlots;i++)
+		{
+			if (oldSlots[i].m_index != BT_HASH_NULL)
+			{
+				insertSlot(oldSlots[i],int(oldSlots[i].m_hash & unsigned(mask)),0);
+			}
+		}
+	}
+
+	public:
+
+	void insert(const Key& key, const Value& value) {
+		growTables();
+
+		unsigned int hash = key.getHash();
+		int mask = m_slots.size()-1;
+		int slotIndex = int(hash & unsigned(mask));
+		int distance = 0;
+		//find the key, or the first slot that it may take
+		for (;;distance++)
+		{
+			const btOpenHashSlot& slot = m_slots[slotIndex];
+			if (slot.m_index == BT_HASH_NULL || getProbeDistance(slotIndex) < distance)
+			{
+				break;
+			}
+			//replace value if the key is already there
+			if (slot.m_hash == hash && key.equals(m_keyArray[slot.m_index]))
+			{
+				m_valueArray[slot.m_index] = value;
+				return;
+			}
+			slotIndex = (slotIndex+1) & mask;
+		}
+
+		btOpenHashSlot carry;
+		carry.m_hash = hash;
+		carry.m_index = m_keyArray.size();
+		insertSlot(carry,slotIndex,distance);
+		m_valueArray.push_back(value);
+		m_keyArray.push_back(key);
+	}
+
+	void remove(const Key& key) {
+
+		int slot = findSlot(key,key.getHash());
+		if (slot < 0)
+		{
+			return;
+		}
+
+		int pairIndex = m_slots[slot].m_index;
+
+		//shift the following slots back until an empty slot or a slot at its home, so no tombstones are needed
+		int mask = m_slots.size()-1;
+		int next = (slot+1) & mask;
+		while (m_slots[next].m_index != BT_HASH_NULL && getProbeDistance(next) > 0)
+		{
+			m_slots[slot] = m_slots[next];
+			slot = next;
+			next = (next+1) & mask;
+		}
+		m_slots[slot].m_index = BT_HASH_NULL;
+
+		// Move the last pair into the spot of the removed pair and point its slot there.
+		int lastPairIndex = m_valueArray.size() - 1;
+		if (lastPairIndex != pairIndex)
+		{
+			int lastSlot = int(m_keyArray[lastPairIndex].getHash() & unsigned(mask));
+			while (m_slots[lastSlot].m_index != lastPairIndex)
+			{
+				lastSlot = (lastSlot+1) & mask;
+			}
+			m_slots[lastSlot].m_index = pairIndex;
+			m_valueArray[pairIndex] = m_valueArray[lastPairIndex];
+			m_keyArray[pairIndex] = m_keyArray[lastPairIndex];
+		}
+
+		m_valueArray.pop_back();
+		m_keyArray.pop_back();
+	}
+
+
+	int size() const
+	{
+		return m_valueArray.size();
+	}
+
+	const Value* getAtIndex(int index) const
+	{
+		btAssert(index < m_valueArray.size());
+
+		return &m_valueArray[index];
+	}
+
+	Value* getAtIndex(int index)
+	{
+		btAssert(index < m_valueArray.size());
+
+		return &m_valueArray[index];
+	}
+
+	const Key&	getKeyAtIndex(int index) const
+	{
+		btAssert(index < m_keyArray.size());
+
+		return m_keyArray[index];
+	}
+
+	Value* operator[](const Key& key) {
+		return find(key);
+	}
+
+	const Value*	find(const Key& key) const
+	{
+		int slot = findSlot(key,key.getHash());
+		if (slot < 0)
+		{
+			return NULL;
+		}
+		return &m_valueArray[m_slots[slot].m_index];
+	}
+
+	Value*	find(const Key& key)
+	{
+		int slot = findSlot(key,key.getHash());
+		if (slot < 0)
+		{
+			return NULL;
+		}
+		return &m_valueArray[m_slots[slot].m_index];
+	}
+
+
+	int	findIndex(const Key& key) const
+	{
+		int slot = findSlot(key,key.getHash());
+		return slot < 0 ? BT_HASH_NULL : m_slots[slot].m_index;
+	}
+
+	void	clear()
+	{
+		m_slots.clear();
+		m_valueArray.clear();
+		m_keyArray.clear();
+	}
+
+};
+
 #endif //BT_HASH_MAP_H
@@ -18,9 +18,6 @@
 #ifndef BT_NO_PROFILE
 
 
-static btClock gProfileClock;
-
-
 #ifdef __CELLOS_LV2__
 #include <sys/sys_time.h>
 #include <sys/time_util.h>
@@ -50,8 +47,19 @@ static btClock gProfileClock;
 
 #else //_WIN32
 #include <sys/time.h>
+#include <time.h>
+#ifdef __APPLE__
+#include <mach/mach_time.h>
+#endif //__APPLE__
 #endif //_WIN32
 
+#if !defined (_WIN32) && !defined (__SPU__) && !defined (__CELLOS_LV2__) && !defined (BT_NO_PROFILE_THREADS)
+#define BT_PROFILE_THREADS
+#include <pthread.h>
+#endif //BT_NO_PROFILE_THREADS
+
+#include <string.h>
+
 #define mymin(a,b) (a > b ? a : b)
 
 struct btClockData
@@ -63,14 +71,38 @@ struct btClockData
 	LONGLONG mPrevElapsedTime;
 	LARGE_INTEGER mStartTime;
 #else
+	unsigned long long int	mStartTime;
+#endif //BT_USE_WINDOWS_TIMERS
+
+};
+
+#ifndef BT_USE_WINDOWS_TIMERS
+///btGetMonotonicNanoseconds reads the monotonic clock, the start of the count is unspecified
+static unsigned long long int btGetMonotonicNanoseconds()
+{
 #ifdef __CELLOS_LV2__
-	uint64_t	mStartTime;
+	static uint64_t freq = sys_time_get_timebase_frequency();
+	uint64_t newTime;
+	SYS_TIMEBASE_GET( newTime );
+	return (unsigned long long int)((newTime / freq) * 1000000000 + ((newTime % freq) * 1000000000) / freq);
+#elif defined (__APPLE__)
+	static mach_timebase_info_data_t timebase;
+	if (!timebase.denom)
+	{
+		mach_timebase_info(&timebase);
+	}
+	return mach_absolute_time() * timebase.numer / timebase.denom;
+#elif defined (CLOCK_MONOTONIC)
+	struct timespec currentTime;
+	clock_gettime(CLOCK_MONOTONIC, &currentTime);
+	return (unsigned long long int)currentTime.tv_sec * 1000000000ULL + currentTime.tv_nsec;
 #else
-	struct timeval mStartTime;
+	struct timeval currentTime;
+	gettimeofday(&currentTime, 0);
+	return (unsigned long long int)currentTime.tv_sec * 1000000000ULL + currentTime.tv_usec * 1000ULL;
 #endif
-#endif //__CELLOS_LV2__
-
-};
+}
+#endif //BT_USE_WINDOWS_TIMERS
 
 ///The btClock is a portable basic clock that measures accurate time in seconds, use for profiling.
 btClock::btClock()
@@ -108,16 +140,7 @@ void btClock::reset()
 	m_data->mStartTick = GetTickCount();
 	m_data->mPrevElapsedTime = 0;
 #else
-#ifdef __CELLOS_LV2__
-
-	typedef uint64_t  ClockSize;
-	ClockSize newTime;
-	//__asm __volatile__( "mftb %0" : "=r" (newTime) : : "memory");
-	SYS_TIMEBASE_GET( newTime );
-	m_data->mStartTime = newTime;
-#else
-	gettimeofday(&m_data->mStartTime, 0);
-#endif
+	m_data->mStartTime = btGetMonotonicNanoseconds();
 #endif
 }
 
@@ -157,23 +180,7 @@ unsigned long int btClock::getTimeMilliseconds()
 
 		return msecTicks;
 #else
-
-#ifdef __CELLOS_LV2__
-		uint64_t freq=sys_time_get_timebase_frequency();
-		double dFreq=((double) freq) / 1000.0;
-		typedef uint64_t  ClockSize;
-		ClockSize newTime;
-		SYS_TIMEBASE_GET( newTime );
-		//__asm __volatile__( "mftb %0" : "=r" (newTime) : : "memory");
-
-		return (unsigned long int)((double(newTime-m_data->mStartTime)) / dFreq);
-#else
-
-		struct timeval currentTime;
-		gettimeofday(&currentTime, 0);
-		return (currentTime.tv_sec - m_data->mStartTime.tv_sec) * 1000 + 
-			(currentTime.tv_usec - m_data->mStartTime.tv_usec) / 1000;
-#endif //__CELLOS_LV2__
+		return (unsigned long int)(getTimeNanoseconds() / 1000000);
 #endif
 }
 
@@ -215,39 +222,52 @@ unsigned long int btClock::getTimeMicroseconds()
 
 		return usecTicks;
 #else
+		return (unsigned long int)(getTimeNanoseconds() / 1000);
+#endif 
+}
 
-#ifdef __CELLOS_LV2__
-		uint64_t freq=sys_time_get_timebase_frequency();
-		double dFreq=((double) freq)/ 1000000.0;
-		typedef uint64_t  ClockSize;
-		ClockSize newTime;
-		//__asm __volatile__( "mftb %0" : "=r" (newTime) : : "memory");
-		SYS_TIMEBASE_GET( newTime );
-
-		return (unsigned long int)((double(newTime-m_data->mStartTime)) / dFreq);
+	/// Returns the time in ns since the last call to reset or since 
+	/// the Clock was created.
+unsigned long long int btClock::getTimeNanoseconds()
+{
+#ifdef BT_USE_WINDOWS_TIMERS
+		LARGE_INTEGER currentTime;
+		QueryPerformanceCounter(&currentTime);
+		LONGLONG elapsedTime = currentTime.QuadPart - m_data->mStartTime.QuadPart;
+		LONGLONG frequency = m_data->mClockFrequency.QuadPart;
+		return (unsigned long long int)((elapsedTime / frequency) * 1000000000 + ((elapsedTime % frequency) * 1000000000) / frequency);
 #else
-
-		struct timeval currentTime;
-		gettimeofday(&currentTime, 0);
-		return (currentTime.tv_sec - m_data->mStartTime.tv_sec) * 1000000 + 
-			(currentTime.tv_usec - m_data->mStartTime.tv_usec);
-#endif//__CELLOS_LV2__
-#endif 
+		return btGetMonotonicNanoseconds() - m_data->mStartTime;
+#endif
 }
 
 
 
 
+#ifdef BT_USE_WINDOWS_TIMERS
+static unsigned long long int btGetMonotonicNanoseconds()
+{
+	static LARGE_INTEGER frequency;
+	if (!frequency.QuadPart)
+	{
+		QueryPerformanceFrequency(&frequency);
+	}
+	LARGE_INTEGER currentTime;
+	QueryPerformanceCounter(&currentTime);
+	return (unsigned long long int)((currentTime.QuadPart / frequency.QuadPart) * 1000000000 + ((currentTime.QuadPart % frequency.QuadPart) * 1000000000) / frequency.QuadPart);
+}
+#endif //BT_USE_WINDOWS_TIMERS
 
-inline void Profile_Get_Ticks(unsigned long int * ticks)
+// The profile ticks are ns of the monotonic clock, they are not reset so recorded events keep a common time base
+inline void Profile_Get_Ticks(unsigned long long int * ticks)
 {
-	*ticks = gProfileClock.getTimeMicroseconds();
+	*ticks = btGetMonotonicNanoseconds();
 }
 
 inline float Profile_Get_Tick_Rate(void)
 {
-//	return 1000000.f;
-	return 1000.f;
+	// ticks per ms
+	return 1000000.f;
 
 }
 
@@ -341,19 +361,33 @@ void	CProfileNode::Reset( void )
 
 
 void	CProfileNode::Call( void )
+{
+	unsigned long long int time;
+	Profile_Get_Ticks(&time);
+	Call( time );
+}
+
+
+bool	CProfileNode::Return( void )
+{
+	unsigned long long int time;
+	Profile_Get_Ticks(&time);
+	return Return( time );
+}
+
+
+void	CProfileNode::Call( unsigned long long int time )
 {
 	TotalCalls++;
 	if (RecursionCounter++ == 0) {
-		Profile_Get_Ticks(&StartTime);
+		StartTime = time;
 	}
 }
 
 
-bool	CProfileNode::Return( void )
+bool	CProfileNode::Return( unsigned long long int time )
 {
 	if ( --RecursionCounter == 0 && TotalCalls != 0 ) { 
-		unsigned long int time;
-		Profile_Get_Ticks(&time);
 		time-=StartTime;
 		TotalTime += (float)time / Profile_Get_Tick_Rate();
 	}
@@ -421,17 +455,142 @@ void	CProfileIterator::Enter_Parent( void )
 **
 ***************************************************************************************************/
 
+#define BT_PROFILE_MAX_THREADS 16
+#define BT_PROFILE_MAX_DEPTH 64
+
+///CProfileThread is the profile tree of one thread and the ring buffer of its recorded scopes
+struct	CProfileThread
+{
+	CProfileNode *				Root;
+	CProfileNode *				CurrentNode;
+	const char *				Name;
+	bool						Active;
+
+	CProfileEvent *				Events;
+	int							EventCapacity;
+	int							NumEvents;
+	int							NextEvent;
+
+	int							Depth;
+	unsigned long long int		ScopeStart[BT_PROFILE_MAX_DEPTH];
+};
+
+static CProfileThread	gProfileThreads[BT_PROFILE_MAX_THREADS];
+static int				gNumProfileThreads = 0;
+static int				gProfileEventCapacity = 0;
+
 CProfileNode	CProfileManager::Root( "Root", NULL );
-CProfileNode *	CProfileManager::CurrentNode = &CProfileManager::Root;
 int				CProfileManager::FrameCounter = 0;
-unsigned long int			CProfileManager::ResetTime = 0;
+unsigned long long int			CProfileManager::ResetTime = 0;
+bool			CProfileManager::RecordEvents = false;
+
+
+static CProfileThread *	Profile_Acquire_Thread( CProfileNode * mainRoot )
+{
+	// reuse the tree of a thread that has exited
+	int i;
+	for (i=0;i<gNumProfileThreads;i++) {
+		if (!gProfileThreads[i].Active) {
+			break;
+		}
+	}
+	if (i == BT_PROFILE_MAX_THREADS) {
+		return NULL;
+	}
+	CProfileThread * thread = &gProfileThreads[i];
+	if (i == gNumProfileThreads) {
+		thread->Root = i ? new CProfileNode( "Root", NULL ) : mainRoot;
+		thread->Events = NULL;
+		thread->EventCapacity = 0;
+		thread->NumEvents = 0;
+		thread->NextEvent = 0;
+		gNumProfileThreads++;
+	}
+	thread->CurrentNode = thread->Root;
+	thread->Name = NULL;
+	thread->Active = true;
+	thread->Depth = 0;
+	return thread;
+}
+
+#ifdef BT_PROFILE_THREADS
+
+static pthread_key_t	gProfileThreadKey;
+static pthread_once_t	gProfileThreadKeyOnce = PTHREAD_ONCE_INIT;
+static pthread_mutex_t	gProfileThreadMutex = PTHREAD_MUTEX_INITIALIZER;
+// marks the threads that didn't get a tree because all of them are in use
+static CProfileThread	gProfileNoThread;
+
+static void	Profile_Release_Thread( void * userPtr )
+{
+	CProfileThread * thread = (CProfileThread*)userPtr;
+	if (thread != &gProfileNoThread) {
+		pthread_mutex_lock(&gProfileThreadMutex);
+		thread->Active = false;
+		pthread_mutex_unlock(&gProfileThreadMutex);
+	}
+}
+
+static void	Profile_Create_Thread_Key( void )
+{
+	pthread_key_create(&gProfileThreadKey,Profile_Release_Thread);
+}
+
+static CProfileThread *	Profile_Get_Thread( CProfileNode * mainRoot )
+{
+	pthread_once(&gProfileThreadKeyOnce,Profile_Create_Thread_Key);
+	CProfileThread * thread = (CProfileThread*)pthread_getspecific(gProfileThreadKey);
+	if (!thread) {
+		pthread_mutex_lock(&gProfileThreadMutex);
+		thread = Profile_Acquire_Thread( mainRoot );
+		pthread_mutex_unlock(&gProfileThreadMutex);
+		if (!thread) {
+			thread = &gProfileNoThread;
+		}
+		pthread_setspecific(gProfileThreadKey,thread);
+	}
+	return (thread != &gProfileNoThread) ? thread : NULL;
+}
+
+#else
+
+static CProfileThread *	Profile_Get_Thread( CProfileNode * mainRoot )
+{
+	if (!gNumProfileThreads) {
+		Profile_Acquire_Thread( mainRoot );
+	}
+	return &gProfileThreads[0];
+}
+
+#endif //BT_PROFILE_THREADS
+
+
+static void	Profile_Record_Event( CProfileThread * thread, const char * name, unsigned long long int startTime, unsigned long long int endTime )
+{
+	if (thread->EventCapacity != gProfileEventCapacity) {
+		btAlignedFree(thread->Events);
+		thread->Events = (CProfileEvent*)btAlignedAlloc(sizeof(CProfileEvent)*gProfileEventCapacity,16);
+		thread->EventCapacity = gProfileEventCapacity;
+		thread->NumEvents = 0;
+		thread->NextEvent = 0;
+	}
+	CProfileEvent & event = thread->Events[thread->NextEvent];
+	event.Name = name;
+	event.StartTime = startTime;
+	event.EndTime = endTime;
+	thread->NextEvent = (thread->NextEvent + 1) & (thread->EventCapacity - 1);
+	if (thread->NumEvents < thread->EventCapacity) {
+		thread->NumEvents++;
+	}
+}
 
 
 /***********************************************************************************************
  * CProfileManager::Start_Profile -- Begin a named profile                                    *
  *                                                                                             *
- * Steps one level deeper into the tree, if a child already exists with the specified name     *
- * then it accumulates the profiling; otherwise a new child node is added to the profile tree. *
+ * Steps one level deeper into the tree of the calling thread, if a child already exists with  *
+ * the specified name then it accumulates the profiling; otherwise a new child node is added   *
+ * to the profile tree.                                                                        *
  *                                                                                             *
  * INPUT:                                                                                      *
  * name - name of this profiling record                                                        *
@@ -442,11 +601,24 @@ unsigned long int			CProfileManager::ResetTime = 0;
  *=============================================================================================*/
 void	CProfileManager::Start_Profile( const char * name )
 {
-	if (name != CurrentNode->Get_Name()) {
-		CurrentNode = CurrentNode->Get_Sub_Node( name );
+	CProfileThread * thread = Profile_Get_Thread( &Root );
+	if (!thread) {
+		return;
+	}
+
+	unsigned long long int time;
+	Profile_Get_Ticks(&time);
+
+	if (name != thread->CurrentNode->Get_Name()) {
+		thread->CurrentNode = thread->CurrentNode->Get_Sub_Node( name );
 	} 
 	
-	CurrentNode->Call();
+	thread->CurrentNode->Call( time );
+
+	if (thread->Depth < BT_PROFILE_MAX_DEPTH) {
+		thread->ScopeStart[thread->Depth] = time;
+	}
+	thread->Depth++;
 }
 
 
@@ -455,11 +627,41 @@ void	CProfileManager::Start_Profile( const char * name )
  *=============================================================================================*/
 void	CProfileManager::Stop_Profile( void )
 {
+	CProfileThread * thread = Profile_Get_Thread( &Root );
+	if (!thread || (thread->Depth == 0)) {
+		return;
+	}
+
+	unsigned long long int time;
+	Profile_Get_Ticks(&time);
+
+	thread->Depth--;
+	if (RecordEvents && (thread->Depth < BT_PROFILE_MAX_DEPTH)) {
+		Profile_Record_Event( thread, thread->CurrentNode->Get_Name(), thread->ScopeStart[thread->Depth], time );
+	}
+
 	// Return will indicate whether we should back up to our parent (we may
 	// be profiling a recursive function)
-	if (CurrentNode->Return()) {
-		CurrentNode = CurrentNode->Get_Parent();
+	if (thread->CurrentNode->Return( time )) {
+		thread->CurrentNode = thread->CurrentNode->Get_Parent();
+	}
+}
+
+
+void	CProfileManager::CleanupMemory( void )
+{
+	for (int i=0;i<gNumProfileThreads;i++) {
+		CProfileThread & thread = gProfileThreads[i];
+		thread.Root->CleanupMemory();
+		thread.CurrentNode = thread.Root;
+		thread.Depth = 0;
+		btAlignedFree(thread.Events);
+		thread.Events = NULL;
+		thread.EventCapacity = 0;
+		thread.NumEvents = 0;
+		thread.NextEvent = 0;
 	}
+	Root.CleanupMemory();
 }
 
 
@@ -467,12 +669,17 @@ void	CProfileManager::Stop_Profile( void )
  * CProfileManager::Reset -- Reset the contents of the profiling system                       *
  *                                                                                             *
  *    This resets everything except for the tree structure.  All of the timing data is reset.  *
+ *    The recorded events are kept, they are removed by CleanupMemory.                         *
  *=============================================================================================*/
 void	CProfileManager::Reset( void )
 { 
-	gProfileClock.reset();
-	Root.Reset();
-    Root.Call();
+	// the thread that steps the world normally resets first, so it gets the Root tree
+	Profile_Get_Thread( &Root );
+
+	for (int i=0;i<gNumProfileThreads;i++) {
+		gProfileThreads[i].Root->Reset();
+		gProfileThreads[i].Root->Call();
+	}
 	FrameCounter = 0;
 	Profile_Get_Ticks(&ResetTime);
 }
@@ -492,15 +699,142 @@ void CProfileManager::Increment_Frame_Counter( void )
  *=============================================================================================*/
 float CProfileManager::Get_Time_Since_Reset( void )
 {
-	unsigned long int time;
+	unsigned long long int time;
 	Profile_Get_Ticks(&time);
 	time -= ResetTime;
 	return (float)time / Profile_Get_Tick_Rate();
 }
 
-#include <stdio.h>
 
-void	CProfileManager::dumpRecursive(CProfileIterator* profileIterator, int spacing)
+int		CProfileManager::getNumThreads( void )
+{
+	return gNumProfileThreads;
+}
+
+
+CProfileIterator *	CProfileManager::getThreadIterator( int threadIndex )
+{
+	btAssert((threadIndex >= 0) && (threadIndex < gNumProfileThreads));
+	return new CProfileIterator( gProfileThreads[threadIndex].Root );
+}
+
+
+const char *	CProfileManager::getThreadName( int threadIndex )
+{
+	btAssert((threadIndex >= 0) && (threadIndex < gNumProfileThreads));
+	if (gProfileThreads[threadIndex].Name) {
+		return gProfileThreads[threadIndex].Name;
+	}
+	return threadIndex ? "Worker" : "Main";
+}
+
+
+void	CProfileManager::setThreadName( const char * name )
+{
+	CProfileThread * thread = Profile_Get_Thread( &Root );
+	if (thread) {
+		thread->Name = name;
+	}
+}
+
+
+void	CProfileManager::setEventRecording( bool enable, int eventsPerThread )
+{
+	if (enable) {
+		int capacity = 16;
+		while (capacity < eventsPerThread) {
+			capacity <<= 1;
+		}
+		gProfileEventCapacity = capacity;
+	}
+	RecordEvents = enable;
+}
+
+
+int		CProfileManager::getThreadEvents( int threadIndex, CProfileEvent * events, int maxEvents )
+{
+	btAssert((threadIndex >= 0) && (threadIndex < gNumProfileThreads));
+	const CProfileThread & thread = gProfileThreads[threadIndex];
+	int numEvents = (thread.NumEvents < maxEvents) ? thread.NumEvents : maxEvents;
+	int index = (thread.NextEvent - numEvents) & (thread.EventCapacity - 1);
+	for (int i=0;i<numEvents;i++) {
+		events[i] = thread.Events[index];
+		index = (index + 1) & (thread.EventCapacity - 1);
+	}
+	return numEvents;
+}
+
+
+static void	Profile_Write_Json_String( FILE * file, const char * string )
+{
+	fputc('"',file);
+	for (const char * c = string; *c; c++) {
+		if ((*c == '"') || (*c == '\\')) {
+			fputc('\\',file);
+			fputc(*c,file);
+		} else if ((unsigned char)*c < 0x20) {
+			fprintf(file,"\\u%04x",(unsigned char)*c);
+		} else {
+			fputc(*c,file);
+		}
+	}
+	fputc('"',file);
+}
+
+
+bool	CProfileManager::writeChromeTrace( FILE * file )
+{
+	int i;
+
+	// the timeline starts at the oldest recorded scope
+	unsigned long long int baseTime = 0;
+	bool haveBaseTime = false;
+	for (i=0;i<gNumProfileThreads;i++) {
+		const CProfileThread & thread = gProfileThreads[i];
+		for (int e=0;e<thread.NumEvents;e++) {
+			if (!haveBaseTime || (thread.Events[e].StartTime < baseTime)) {
+				baseTime = thread.Events[e].StartTime;
+				haveBaseTime = true;
+			}
+		}
+	}
+
+	fprintf(file,"{\"traceEvents\":[");
+	const char * separator = "\n";
+	for (i=0;i<gNumProfileThreads;i++) {
+		const CProfileThread & thread = gProfileThreads[i];
+		fprintf(file,"%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":%d,\"args\":{\"name\":",separator,i);
+		Profile_Write_Json_String(file,getThreadName(i));
+		fprintf(file,"}}");
+		separator = ",\n";
+
+		int index = (thread.NextEvent - thread.NumEvents) & (thread.EventCapacity - 1);
+		for (int e=0;e<thread.NumEvents;e++) {
+			const CProfileEvent & event = thread.Events[index];
+			index = (index + 1) & (thread.EventCapacity - 1);
+			fprintf(file,"%s{\"name\":",separator);
+			Profile_Write_Json_String(file,event.Name);
+			fprintf(file,",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",i,
+				double(event.StartTime - baseTime) / 1000.0,double(event.EndTime - event.StartTime) / 1000.0);
+		}
+	}
+	fprintf(file,"\n],\"displayTimeUnit\":\"ms\"}\n");
+	return !ferror(file);
+}
+
+
+bool	CProfileManager::writeChromeTrace( const char * fileName )
+{
+	FILE * file = fopen(fileName,"w");
+	if (!file) {
+		return false;
+	}
+	bool ok = writeChromeTrace( file );
+	return (fclose(file) == 0) && ok;
+}
+
+
+void	CProfileManager::dumpRecursive(CProfileIterator* profileIterator, int spacing, FILE * file)
 {
 	profileIterator->First();
 	if (profileIterator->Is_Done())
@@ -509,10 +843,10 @@ void	CProfileManager::dumpRecursive(CProfileIterator* profileIterator, int spaci
 	float accumulated_time=0,parent_time = profileIterator->Is_Root() ? CProfileManager::Get_Time_Since_Reset() : profileIterator->Get_Current_Parent_Total_Time();
 	int i;
 	int frames_since_reset = CProfileManager::Get_Frame_Count_Since_Reset();
-	for (i=0;i<spacing;i++)	printf(".");
-	printf("----------------------------------\n");
-	for (i=0;i<spacing;i++)	printf(".");
-	printf("Profiling: %s (total running time: %.3f ms) ---\n",	profileIterator->Get_Current_Parent_Name(), parent_time );
+	for (i=0;i<spacing;i++)	fprintf(file,".");
+	fprintf(file,"----------------------------------\n");
+	for (i=0;i<spacing;i++)	fprintf(file,".");
+	fprintf(file,"Profiling: %s (total running time: %.3f ms) ---\n",	profileIterator->Get_Current_Parent_Name(), parent_time );
 	float totalTime = 0.f;
 
 	
@@ -525,41 +859,50 @@ void	CProfileManager::dumpRecursive(CProfileIterator* profileIterator, int spaci
 		accumulated_time += current_total_time;
 		float fraction = parent_time > SIMD_EPSILON ? (current_total_time / parent_time) * 100 : 0.f;
 		{
-			int i;	for (i=0;i<spacing;i++)	printf(".");
+			int i;	for (i=0;i<spacing;i++)	fprintf(file,".");
 		}
-		printf("%d -- %s (%.2f %%) :: %.3f ms / frame (%d calls)\n",i, profileIterator->Get_Current_Name(), fraction,(current_total_time / (double)frames_since_reset),profileIterator->Get_Current_Total_Calls());
+		fprintf(file,"%d -- %s (%.2f %%) :: %.3f ms / frame (%d calls)\n",i, profileIterator->Get_Current_Name(), fraction,(current_total_time / (double)frames_since_reset),profileIterator->Get_Current_Total_Calls());
 		totalTime += current_total_time;
 		//recurse into children
 	}
 
 	if (parent_time < accumulated_time)
 	{
-		printf("what's wrong\n");
+		fprintf(file,"what's wrong\n");
 	}
-	for (i=0;i<spacing;i++)	printf(".");
-	printf("%s (%.3f %%) :: %.3f ms\n", "Unaccounted:",parent_time > SIMD_EPSILON ? ((parent_time - accumulated_time) / parent_time) * 100 : 0.f, parent_time - accumulated_time);
+	for (i=0;i<spacing;i++)	fprintf(file,".");
+	fprintf(file,"%s (%.3f %%) :: %.3f ms\n", "Unaccounted:",parent_time > SIMD_EPSILON ? ((parent_time - accumulated_time) / parent_time) * 100 : 0.f, parent_time - accumulated_time);
 	
 	for (i=0;i<numChildren;i++)
 	{
 		profileIterator->Enter_Child(i);
-		dumpRecursive(profileIterator,spacing+3);
+		dumpRecursive(profileIterator,spacing+3,file);
 		profileIterator->Enter_Parent();
 	}
 }
 
 
 
-void	CProfileManager::dumpAll()
+void	CProfileManager::dumpAll( FILE * file )
 {
 	CProfileIterator* profileIterator = 0;
 	profileIterator = CProfileManager::Get_Iterator();
 
-	dumpRecursive(profileIterator,0);
+	dumpRecursive(profileIterator,0,file);
 
 	CProfileManager::Release_Iterator(profileIterator);
+
+	for (int i=1;i<gNumProfileThreads;i++)
+	{
+		fprintf(file,"Thread %d (%s)\n",i,getThreadName(i));
+		profileIterator = CProfileManager::getThreadIterator(i);
+		dumpRecursive(profileIterator,0,file);
+		CProfileManager::Release_Iterator(profileIterator);
+	}
 }
 
 
 
 
+
 #endif //BT_NO_PROFILE
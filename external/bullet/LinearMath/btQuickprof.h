@@ -18,7 +18,7 @@
 //To disable built-in profiling, please comment out next line
 //#define BT_NO_PROFILE 1
 #ifndef BT_NO_PROFILE
-#include <stdio.h>//@todo remove this, backwards compatibility
+#include <stdio.h>
 #include "btScalar.h"
 #include "btAlignedAllocator.h"
 #include <new>
@@ -32,6 +32,7 @@
 #ifdef USE_BT_CLOCK
 
 ///The btClock is a portable basic clock that measures accurate time in seconds, use for profiling.
+///It uses a monotonic high resolution timer (mach_absolute_time on Apple platforms, CLOCK_MONOTONIC elsewhere), so it doesn't jump when the system time is changed.
 class btClock
 {
 public:
@@ -52,6 +53,10 @@ public:
 	/// Returns the time in us since the last call to reset or since 
 	/// the Clock was created.
 	unsigned long int getTimeMicroseconds();
+
+	/// Returns the time in ns since the last call to reset or since 
+	/// the Clock was created.
+	unsigned long long int getTimeNanoseconds();
 private:
 	struct btClockData* m_data;
 };
@@ -79,6 +84,10 @@ public:
 	void				Call( void );
 	bool				Return( void );
 
+	// Call and Return with a time in ns that was already read by the caller
+	void				Call( unsigned long long int time );
+	bool				Return( unsigned long long int time );
+
 	const char *	Get_Name( void )				{ return Name; }
 	int				Get_Total_Calls( void )		{ return TotalCalls; }
 	float				Get_Total_Time( void )		{ return TotalTime; }
@@ -88,7 +97,7 @@ protected:
 	const char *	Name;
 	int				TotalCalls;
 	float				TotalTime;
-	unsigned long int			StartTime;
+	unsigned long long int			StartTime;
 	int				RecursionCounter;
 
 	CProfileNode *	Parent;
@@ -130,16 +139,25 @@ protected:
 };
 
 
+///A profile scope that was recorded in the event buffer of a thread, the times are in ns of the monotonic clock
+struct	CProfileEvent
+{
+	const char *				Name;
+	unsigned long long int		StartTime;
+	unsigned long long int		EndTime;
+};
+
 ///The Manager for the Profile system
+///Every thread that profiles gets its own tree, the first thread uses the Root tree that is returned by Get_Iterator.
+///The trees of threads that have exited are kept and reused by the next thread that starts profiling.
+///When event recording is enabled each thread also keeps its last scopes in a ring buffer, writeChromeTrace exports them
+///as a timeline that can be opened in chrome://tracing. Reset, the dump and the export should be called while no other thread is profiling.
 class	CProfileManager {
 public:
 	static	void						Start_Profile( const char * name );
 	static	void						Stop_Profile( void );
 
-	static	void						CleanupMemory(void)
-	{
-		Root.CleanupMemory();
-	}
+	static	void						CleanupMemory(void);
 
 	static	void						Reset( void );
 	static	void						Increment_Frame_Counter( void );
@@ -153,15 +171,35 @@ public:
 	}
 	static	void						Release_Iterator( CProfileIterator * iterator ) { delete ( iterator); }
 
-	static void	dumpRecursive(CProfileIterator* profileIterator, int spacing);
+	///the threads are numbered in the order in which they started profiling, thread 0 uses the Root tree
+	static	int							getNumThreads( void );
+	static	CProfileIterator *			getThreadIterator( int threadIndex );
+	static	const char *				getThreadName( int threadIndex );
+
+	///setThreadName names the tree of the calling thread in the dump and the exported timeline, the name should be a static string
+	static	void						setThreadName( const char * name );
+
+	///each thread allocates its ring buffer when it records its first scope, it holds the last eventsPerThread scopes (rounded up to a power of two)
+	static	void						setEventRecording( bool enable, int eventsPerThread = 16384 );
+	static	bool						getEventRecording( void )	{ return RecordEvents; }
+
+	///getThreadEvents returns the recorded scopes of a thread, oldest first, in the order in which they ended
+	static	int							getThreadEvents( int threadIndex, CProfileEvent * events, int maxEvents );
+
+	///writeChromeTrace writes the recorded scopes of all threads in the Chrome trace event format (JSON)
+	static	bool						writeChromeTrace( FILE * file );
+	static	bool						writeChromeTrace( const char * fileName );
+
+	static void	dumpRecursive(CProfileIterator* profileIterator, int spacing, FILE * file = stdout);
 
-	static void	dumpAll();
+	///dumpAll prints the tree of every thread
+	static void	dumpAll( FILE * file = stdout );
 
 private:
 	static	CProfileNode			Root;
-	static	CProfileNode *			CurrentNode;
 	static	int						FrameCounter;
-	static	unsigned long int					ResetTime;
+	static	unsigned long long int	ResetTime;
+	static	bool					RecordEvents;
 };
 
 
@@ -508,6 +508,16 @@ SIMD_FORCE_INLINE btScalar btNormalizeAngle(btScalar angleInRadians)
 	}
 }
 
+///btAtomicIncrement updates the global statistics counters, such as gNumAlignedAllocs, which can be touched by the batched query and bvh build threads
+SIMD_FORCE_INLINE void btAtomicIncrement(int* counter)
+{
+#if defined (__GNUC__) && !defined (__SPU__) && !defined (_WIN32)
+	__sync_fetch_and_add(counter,1);
+#else
+	(*counter)++;
+#endif
+}
+
 ///rudimentary class to provide type info
 struct btTypedObject
 {
@@ -140,15 +140,15 @@ class btDefaultSerializer	:	public btSerializer
 	btAlignedObjectArray<char*>			mTypes;
 	btAlignedObjectArray<short*>			mStructs;
 	btAlignedObjectArray<short>			mTlens;
-	btHashMap<btHashInt, int>			mStructReverse;
-	btHashMap<btHashString,int>	mTypeLookup;
+	btOpenHashMap<btHashInt, int>			mStructReverse;
+	btOpenHashMap<btHashString,int>	mTypeLookup;
 
 	
-	btHashMap<btHashPtr,void*>	m_chunkP;
+	btOpenHashMap<btHashPtr,void*>	m_chunkP;
 	
-	btHashMap<btHashPtr,const char*>	m_nameMap;
+	btOpenHashMap<btHashPtr,const char*>	m_nameMap;
 
-	btHashMap<btHashPtr,btPointerUid>	m_uniquePointers;
+	btOpenHashMap<btHashPtr,btPointerUid>	m_uniquePointers;
 	int	m_uniqueIdGenerator;
 
 	int					m_totalSize;
@@ -159,9 +159,15 @@ class btDefaultSerializer	:	public btSerializer
 
 	int					m_serializationFlags;
 
-
-	btAlignedObjectArray<btChunk*>	m_chunkPtrs;
+	///chunks are never moved while serializing, nested serialize calls keep pointers into their parent chunk.
+	///When m_buffer is full, the following chunks go into extra pages, finishSerialization copies them into a larger m_buffer.
+	unsigned char*		m_page;
+	int					m_pageSize;
+	int					m_pageCapacity;
+	btAlignedObjectArray<unsigned char*>	m_fullPages;
+	btAlignedObjectArray<int>				m_fullPageSizes;
 	
+
 protected:
 
 	virtual	void*	findPointer(void* oldPtr) 
@@ -176,6 +182,57 @@ protected:
 
 
 
+		void	startPage(int minimumSize)
+		{
+			m_fullPages.push_back(m_page);
+			m_fullPageSizes.push_back(m_pageSize);
+
+			m_pageCapacity = minimumSize > m_totalSize ? minimumSize : m_totalSize;
+			m_page = (unsigned char*)btAlignedAlloc(m_pageCapacity,16);
+			m_pageSize = 0;
+		}
+
+		///pages are only left behind when a serialization was not finished
+		void	releasePages()
+		{
+			for (int i=1;i<m_fullPages.size();i++)
+				btAlignedFree(m_fullPages[i]);
+			if (m_page != m_buffer)
+				btAlignedFree(m_page);
+			m_fullPages.clear();
+			m_fullPageSizes.clear();
+			m_page = m_buffer;
+		}
+
+		///linearizePages copies the pages into a single buffer, it is sized with some headroom so the next serialization of a similar world fits
+		void	linearizePages()
+		{
+			if (!m_fullPages.size())
+				return;
+
+			m_fullPages.push_back(m_page);
+			m_fullPageSizes.push_back(m_pageSize);
+
+			int newTotalSize = m_currentSize + (m_currentSize>>2);
+			unsigned char* newBuffer = (unsigned char*)btAlignedAlloc(newTotalSize,16);
+			unsigned char* dest = newBuffer;
+			for (int i=0;i<m_fullPages.size();i++)
+			{
+				memcpy(dest,m_fullPages[i],m_fullPageSizes[i]);
+				dest += m_fullPageSizes[i];
+				btAlignedFree(m_fullPages[i]);
+			}
+			btAssert(dest == newBuffer+m_currentSize);
+
+			m_fullPages.clear();
+			m_fullPageSizes.clear();
+			m_buffer = newBuffer;
+			m_totalSize = newTotalSize;
+			m_page = m_buffer;
+			m_pageSize = m_currentSize;
+			m_pageCapacity = m_totalSize;
+		}
+
 		void	writeDNA()
 		{
 			btChunk* dnaChunk = allocate(m_dnaLength,1);
@@ -371,14 +428,18 @@ public:
 
 	
 
-		btDefaultSerializer(int totalSize)
-			:m_totalSize(totalSize),
+		///totalSize is the initial size of the buffer, it grows when a world doesn't fit
+		btDefaultSerializer(int totalSize = 0)
+			:m_totalSize(totalSize > BT_HEADER_LENGTH ? totalSize : 64*1024),
 			m_currentSize(0),
 			m_dna(0),
 			m_dnaLength(0),
 			m_serializationFlags(0)
 		{
-			m_buffer = (unsigned char*)btAlignedAlloc(totalSize, 16);
+			m_buffer = (unsigned char*)btAlignedAlloc(m_totalSize, 16);
+			m_page = m_buffer;
+			m_pageSize = 0;
+			m_pageCapacity = m_totalSize;
 			
 			const bool VOID_IS_8 = ((sizeof(void*)==8));
 
@@ -413,6 +474,7 @@ public:
 
 		virtual ~btDefaultSerializer() 
 		{
+			releasePages();
 			if (m_buffer)
 				btAlignedFree(m_buffer);
 			if (m_dna)
@@ -423,7 +485,13 @@ public:
 		{
 			m_uniqueIdGenerator= 1;
 
+			m_chunkP.clear();
+			m_uniquePointers.clear();
+
+			releasePages();
 			m_currentSize = BT_HEADER_LENGTH;
+			m_pageSize = BT_HEADER_LENGTH;
+			m_pageCapacity = m_totalSize;
 
 #ifdef  BT_USE_DOUBLE_PRECISION
 			memcpy(m_buffer, "BULLETd", 7);
@@ -462,12 +530,9 @@ public:
 		{
 			writeDNA();
 
+			linearizePages();
 
-			mTypes.clear();
-			mStructs.clear();
-			mTlens.clear();
-			mStructReverse.clear();
-			mTypeLookup.clear();
+			//the type tables point into m_dna and stay valid, so the serializer can be used again
 			m_chunkP.clear();
 			m_nameMap.clear();
 			m_uniquePointers.clear();
@@ -528,9 +593,15 @@ public:
 		virtual	btChunk*	allocate(size_t size, int numElements)
 		{
 
-			unsigned char* ptr = m_buffer+m_currentSize;
-			m_currentSize += int(size)*numElements+sizeof(btChunk);
-			btAssert(m_currentSize<m_totalSize);
+			int chunkSize = int(size)*numElements+int(sizeof(btChunk));
+			if (m_pageSize+chunkSize > m_pageCapacity)
+			{
+				startPage(chunkSize);
+			}
+
+			unsigned char* ptr = m_page+m_pageSize;
+			m_pageSize += chunkSize;
+			m_currentSize += chunkSize;
 
 			unsigned char* data = ptr + sizeof(btChunk);
 			
@@ -540,8 +611,6 @@ public:
 			chunk->m_length = int(size)*numElements;
 			chunk->m_number = numElements;
 			
-			m_chunkPtrs.push_back(chunk);
-			
 
 			return chunk;
 		}
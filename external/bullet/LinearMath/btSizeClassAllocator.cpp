@@ -0,0 +1,531 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btSizeClassAllocator.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined (_WIN32) && !defined (__SPU__) && !defined (BT_NO_SIZE_CLASS_ALLOCATOR_THREADS)
+#define BT_SIZE_CLASS_ALLOCATOR_THREADS
+#include <pthread.h>
+#endif //BT_NO_SIZE_CLASS_ALLOCATOR_THREADS
+
+#define BT_SIZE_CLASS_ALIGNMENT 16
+#define BT_SIZE_CLASS_MAX_SIZE (16*1024)
+#define BT_SIZE_CLASS_SLAB_SIZE (64*1024)
+#define BT_SIZE_CLASS_BATCH_BYTES (32*1024)
+#define BT_NUM_SIZE_CLASSES 40
+#define BT_LARGE_BLOCK -1
+
+///btBlockHeader precedes every block, its size keeps the blocks 16 byte aligned
+struct btBlockHeader
+{
+	int				m_sizeClass;
+	int				m_tag;
+	unsigned int	m_size;
+	int				m_offset;
+};
+
+///a free block links to the next free block in place of its header
+struct btFreeBlock
+{
+	btFreeBlock*	m_next;
+};
+
+struct btTagCounters
+{
+	long long int	m_bytesInUse;
+	int				m_numAllocations;
+	int				m_totalAllocations;
+};
+
+struct btSizeClassThreadCache
+{
+	btFreeBlock*	m_freeBlocks[BT_NUM_SIZE_CLASSES];
+	int				m_numFreeBlocks[BT_NUM_SIZE_CLASSES];
+	int				m_tag;
+	//the counters of a thread only change in that thread, a block freed by another thread is subtracted there
+	btTagCounters	m_counters[BT_MAX_ALLOC_TAGS];
+	btSizeClassThreadCache*	m_next;
+};
+
+///btSizeClass is the central free list of a size class, the thread caches exchange batches of blocks with it
+struct btSizeClass
+{
+	int				m_blockSize;
+	int				m_batchSize;
+	btFreeBlock*	m_freeBlocks;
+	int				m_numFreeBlocks;
+	size_t			m_slabBytes;
+#ifdef BT_SIZE_CLASS_ALLOCATOR_THREADS
+	pthread_mutex_t	m_mutex;
+#endif //BT_SIZE_CLASS_ALLOCATOR_THREADS
+};
+
+static btSizeClass		gSizeClasses[BT_NUM_SIZE_CLASSES];
+//the size class of the sizes above 256 bytes, in steps of 64 bytes
+static unsigned char	gClassOfSize[BT_SIZE_CLASS_MAX_SIZE/64+1];
+static bool				gSizeClassAllocatorInstalled = false;
+
+static btSizeClassThreadCache*	gThreadCaches = 0;
+//the counters of the threads that have exited
+static btTagCounters	gRetiredCounters[BT_MAX_ALLOC_TAGS];
+
+static const char*	gAllocTagNames[BT_MAX_ALLOC_TAGS] =
+{
+	"default",
+	"shapes",
+	"broadphase",
+	"manifolds",
+	"solver"
+};
+
+#ifdef BT_SIZE_CLASS_ALLOCATOR_THREADS
+
+static pthread_key_t	gThreadCacheKey;
+static pthread_mutex_t	gThreadCacheMutex = PTHREAD_MUTEX_INITIALIZER;
+
+static inline void	btLockSizeClass(btSizeClass& sizeClass)
+{
+	pthread_mutex_lock(&sizeClass.m_mutex);
+}
+
+static inline void	btUnlockSizeClass(btSizeClass& sizeClass)
+{
+	pthread_mutex_unlock(&sizeClass.m_mutex);
+}
+
+static inline void	btLockThreadCaches()
+{
+	pthread_mutex_lock(&gThreadCacheMutex);
+}
+
+static inline void	btUnlockThreadCaches()
+{
+	pthread_mutex_unlock(&gThreadCacheMutex);
+}
+
+#else
+
+static inline void	btLockSizeClass(btSizeClass&)
+{
+}
+
+static inline void	btUnlockSizeClass(btSizeClass&)
+{
+}
+
+static inline void	btLockThreadCaches()
+{
+}
+
+static inline void	btUnlockThreadCaches()
+{
+}
+
+#endif //BT_SIZE_CLASS_ALLOCATOR_THREADS
+
+//the counters of a thread are only changed by that thread, but btSizeClassAllocatorGetTagStats reads them from other threads.
+//With a single writer, relaxed atomic loads and stores are enough and avoid a locked instruction per allocation.
+#if defined (BT_SIZE_CLASS_ALLOCATOR_THREADS) && defined (__ATOMIC_RELAXED)
+
+template <typename T>
+static inline void	btAddCounter(T& counter,T value)
+{
+	__atomic_store_n(&counter,__atomic_load_n(&counter,__ATOMIC_RELAXED)+value,__ATOMIC_RELAXED);
+}
+
+template <typename T>
+static inline T	btLoadCounter(T& counter)
+{
+	return __atomic_load_n(&counter,__ATOMIC_RELAXED);
+}
+
+#elif defined (BT_SIZE_CLASS_ALLOCATOR_THREADS) && defined (__GNUC__)
+
+template <typename T>
+static inline void	btAddCounter(T& counter,T value)
+{
+	__sync_fetch_and_add(&counter,value);
+}
+
+template <typename T>
+static inline T	btLoadCounter(T& counter)
+{
+	return __sync_fetch_and_add(&counter,T(0));
+}
+
+#else
+
+template <typename T>
+static inline void	btAddCounter(T& counter,T value)
+{
+	counter += value;
+}
+
+template <typename T>
+static inline T	btLoadCounter(T& counter)
+{
+	return counter;
+}
+
+#endif //BT_SIZE_CLASS_ALLOCATOR_THREADS && __ATOMIC_RELAXED
+
+
+static inline int	btSizeClassOfSize(size_t size)
+{
+	if (size <= 256)
+	{
+		return size ? int((size+15)>>4)-1 : 0;
+	}
+	return gClassOfSize[(size+63)>>6];
+}
+
+static void	btInitSizeClasses()
+{
+	//16 byte steps up to 256 bytes, then four classes per power of two up to 16KB
+	int sizes[BT_NUM_SIZE_CLASSES];
+	int numSizes = 0;
+	int size;
+	for (size=16;size<=256;size+=16)
+	{
+		sizes[numSizes++] = size;
+	}
+	for (int base=256;base<BT_SIZE_CLASS_MAX_SIZE;base*=2)
+	{
+		for (int step=1;step<=4;step++)
+		{
+			sizes[numSizes++] = base + step*(base/4);
+		}
+	}
+	btAssert(numSizes == BT_NUM_SIZE_CLASSES);
+
+	int sizeClass = 0;
+	for (int i=0;i<=BT_SIZE_CLASS_MAX_SIZE/64;i++)
+	{
+		while (sizes[sizeClass] < i*64)
+		{
+			sizeClass++;
+		}
+		gClassOfSize[i] = (unsigned char)sizeClass;
+	}
+
+	for (int i=0;i<BT_NUM_SIZE_CLASSES;i++)
+	{
+		btSizeClass& sc = gSizeClasses[i];
+		sc.m_blockSize = sizes[i] + int(sizeof(btBlockHeader));
+		sc.m_batchSize = BT_SIZE_CLASS_BATCH_BYTES / sc.m_blockSize;
+		if (sc.m_batchSize < 2)
+		{
+			sc.m_batchSize = 2;
+		}
+		if (sc.m_batchSize > 64)
+		{
+			sc.m_batchSize = 64;
+		}
+		sc.m_freeBlocks = 0;
+		sc.m_numFreeBlocks = 0;
+		sc.m_slabBytes = 0;
+#ifdef BT_SIZE_CLASS_ALLOCATOR_THREADS
+		pthread_mutex_init(&sc.m_mutex,0);
+#endif //BT_SIZE_CLASS_ALLOCATOR_THREADS
+	}
+}
+
+///btAddSlab carves a new slab into free blocks, the lock of the size class is held
+static bool	btAddSlab(btSizeClass& sc)
+{
+	size_t slabSize = BT_SIZE_CLASS_SLAB_SIZE;
+	if (slabSize < size_t(4*sc.m_blockSize))
+	{
+		slabSize = size_t(4*sc.m_blockSize);
+	}
+	char* real = (char*)malloc(slabSize + BT_SIZE_CLASS_ALIGNMENT-1);
+	if (!real)
+	{
+		return false;
+	}
+	char* slab = (char*)(((size_t)real + BT_SIZE_CLASS_ALIGNMENT-1) & ~size_t(BT_SIZE_CLASS_ALIGNMENT-1));
+	int numBlocks = int(slabSize / sc.m_blockSize);
+	for (int i=numBlocks-1;i>=0;i--)
+	{
+		btFreeBlock* block = (btFreeBlock*)(slab + i*sc.m_blockSize);
+		block->m_next = sc.m_freeBlocks;
+		sc.m_freeBlocks = block;
+	}
+	sc.m_numFreeBlocks += numBlocks;
+	sc.m_slabBytes += slabSize;
+	return true;
+}
+
+static void	btRefillThreadCache(btSizeClassThreadCache* cache,int sizeClass)
+{
+	btSizeClass& sc = gSizeClasses[sizeClass];
+	btLockSizeClass(sc);
+	if (sc.m_numFreeBlocks < sc.m_batchSize)
+	{
+		btAddSlab(sc);
+	}
+	for (int i=0;i<sc.m_batchSize && sc.m_freeBlocks;i++)
+	{
+		btFreeBlock* block = sc.m_freeBlocks;
+		sc.m_freeBlocks = block->m_next;
+		sc.m_numFreeBlocks--;
+		block->m_next = cache->m_freeBlocks[sizeClass];
+		cache->m_freeBlocks[sizeClass] = block;
+		cache->m_numFreeBlocks[sizeClass]++;
+	}
+	btUnlockSizeClass(sc);
+}
+
+static void	btFlushThreadCache(btSizeClassThreadCache* cache,int sizeClass,int numBlocks)
+{
+	btSizeClass& sc = gSizeClasses[sizeClass];
+	btLockSizeClass(sc);
+	for (int i=0;i<numBlocks && cache->m_freeBlocks[sizeClass];i++)
+	{
+		btFreeBlock* block = cache->m_freeBlocks[sizeClass];
+		cache->m_freeBlocks[sizeClass] = block->m_next;
+		cache->m_numFreeBlocks[sizeClass]--;
+		block->m_next = sc.m_freeBlocks;
+		sc.m_freeBlocks = block;
+		sc.m_numFreeBlocks++;
+	}
+	btUnlockSizeClass(sc);
+}
+
+static btSizeClassThreadCache*	btCreateThreadCache()
+{
+	btSizeClassThreadCache* cache = (btSizeClassThreadCache*)malloc(sizeof(btSizeClassThreadCache));
+	memset(cache,0,sizeof(btSizeClassThreadCache));
+	btLockThreadCaches();
+	cache->m_next = gThreadCaches;
+	gThreadCaches = cache;
+	btUnlockThreadCaches();
+	return cache;
+}
+
+#ifdef BT_SIZE_CLASS_ALLOCATOR_THREADS
+
+static void	btReleaseThreadCache(void* userPtr)
+{
+	btSizeClassThreadCache* cache = (btSizeClassThreadCache*)userPtr;
+	for (int i=0;i<BT_NUM_SIZE_CLASSES;i++)
+	{
+		btFlushThreadCache(cache,i,cache->m_numFreeBlocks[i]);
+	}
+	btLockThreadCaches();
+	for (int i=0;i<BT_MAX_ALLOC_TAGS;i++)
+	{
+		gRetiredCounters[i].m_bytesInUse += cache->m_counters[i].m_bytesInUse;
+		gRetiredCounters[i].m_numAllocations += cache->m_counters[i].m_numAllocations;
+		gRetiredCounters[i].m_totalAllocations += cache->m_counters[i].m_totalAllocations;
+	}
+	btSizeClassThreadCache** link = &gThreadCaches;
+	while (*link != cache)
+	{
+		link = &(*link)->m_next;
+	}
+	*link = cache->m_next;
+	btUnlockThreadCaches();
+	free(cache);
+}
+
+static inline btSizeClassThreadCache*	btGetThreadCache()
+{
+	btSizeClassThreadCache* cache = (btSizeClassThreadCache*)pthread_getspecific(gThreadCacheKey);
+	if (!cache)
+	{
+		cache = btCreateThreadCache();
+		pthread_setspecific(gThreadCacheKey,cache);
+	}
+	return cache;
+}
+
+#else
+
+static btSizeClassThreadCache*	gMainThreadCache = 0;
+
+static inline btSizeClassThreadCache*	btGetThreadCache()
+{
+	if (!gMainThreadCache)
+	{
+		gMainThreadCache = btCreateThreadCache();
+	}
+	return gMainThreadCache;
+}
+
+#endif //BT_SIZE_CLASS_ALLOCATOR_THREADS
+
+
+static void*	btSizeClassAlloc(size_t size,int alignment)
+{
+	btSizeClassThreadCache* cache = btGetThreadCache();
+	btBlockHeader* header;
+
+	if (size <= BT_SIZE_CLASS_MAX_SIZE && alignment <= BT_SIZE_CLASS_ALIGNMENT)
+	{
+		int sizeClass = btSizeClassOfSize(size);
+		if (!cache->m_freeBlocks[sizeClass])
+		{
+			btRefillThreadCache(cache,sizeClass);
+			if (!cache->m_freeBlocks[sizeClass])
+			{
+				return 0;
+			}
+		}
+		btFreeBlock* block = cache->m_freeBlocks[sizeClass];
+		cache->m_freeBlocks[sizeClass] = block->m_next;
+		cache->m_numFreeBlocks[sizeClass]--;
+		header = (btBlockHeader*)block;
+		header->m_sizeClass = sizeClass;
+		header->m_offset = 0;
+	} else
+	{
+		if (alignment < BT_SIZE_CLASS_ALIGNMENT)
+		{
+			alignment = BT_SIZE_CLASS_ALIGNMENT;
+		}
+		char* real = (char*)malloc(size + sizeof(btBlockHeader) + (alignment-1));
+		if (!real)
+		{
+			return 0;
+		}
+		char* ptr = (char*)(((size_t)(real + sizeof(btBlockHeader)) + (alignment-1)) & ~size_t(alignment-1));
+		header = (btBlockHeader*)ptr - 1;
+		header->m_sizeClass = BT_LARGE_BLOCK;
+		header->m_offset = int(ptr - real);
+	}
+
+	header->m_tag = cache->m_tag;
+	header->m_size = (unsigned int)size;
+	btTagCounters& counters = cache->m_counters[cache->m_tag];
+	btAddCounter(counters.m_bytesInUse,(long long int)size);
+	btAddCounter(counters.m_numAllocations,1);
+	btAddCounter(counters.m_totalAllocations,1);
+	return header + 1;
+}
+
+static void	btSizeClassFree(void* ptr)
+{
+	btSizeClassThreadCache* cache = btGetThreadCache();
+	btBlockHeader* header = (btBlockHeader*)ptr - 1;
+
+	btTagCounters& counters = cache->m_counters[header->m_tag];
+	btAddCounter(counters.m_bytesInUse,-(long long int)header->m_size);
+	btAddCounter(counters.m_numAllocations,-1);
+
+	int sizeClass = header->m_sizeClass;
+	if (sizeClass == BT_LARGE_BLOCK)
+	{
+		free((char*)ptr - header->m_offset);
+		return;
+	}
+
+	btFreeBlock* block = (btFreeBlock*)header;
+	block->m_next = cache->m_freeBlocks[sizeClass];
+	cache->m_freeBlocks[sizeClass] = block;
+	cache->m_numFreeBlocks[sizeClass]++;
+
+	//give a batch back when the thread frees more than it allocates, a thread that only frees would keep the blocks forever
+	int batchSize = gSizeClasses[sizeClass].m_batchSize;
+	if (cache->m_numFreeBlocks[sizeClass] > 2*batchSize)
+	{
+		btFlushThreadCache(cache,sizeClass,batchSize);
+	}
+}
+
+static int	btSizeClassSetTag(int tag)
+{
+	btAssert(tag >= 0 && tag < BT_MAX_ALLOC_TAGS);
+	btSizeClassThreadCache* cache = btGetThreadCache();
+	int previousTag = cache->m_tag;
+	cache->m_tag = tag;
+	return previousTag;
+}
+
+
+void	btSizeClassAllocatorInstall()
+{
+	if (gSizeClassAllocatorInstalled)
+	{
+		return;
+	}
+	btInitSizeClasses();
+#ifdef BT_SIZE_CLASS_ALLOCATOR_THREADS
+	pthread_key_create(&gThreadCacheKey,btReleaseThreadCache);
+#endif //BT_SIZE_CLASS_ALLOCATOR_THREADS
+	btAlignedAllocSetCustomAligned(btSizeClassAlloc,btSizeClassFree);
+	btAlignedAllocSetTagFunc(btSizeClassSetTag);
+	gSizeClassAllocatorInstalled = true;
+}
+
+bool	btSizeClassAllocatorIsInstalled()
+{
+	return gSizeClassAllocatorInstalled;
+}
+
+void	btSizeClassAllocatorGetTagStats(int tag,btAllocTagStats& stats)
+{
+	btAssert(tag >= 0 && tag < BT_MAX_ALLOC_TAGS);
+	btLockThreadCaches();
+	long long int bytesInUse = gRetiredCounters[tag].m_bytesInUse;
+	int numAllocations = gRetiredCounters[tag].m_numAllocations;
+	int totalAllocations = gRetiredCounters[tag].m_totalAllocations;
+	for (btSizeClassThreadCache* cache = gThreadCaches;cache;cache = cache->m_next)
+	{
+		btTagCounters& counters = cache->m_counters[tag];
+		bytesInUse += btLoadCounter(counters.m_bytesInUse);
+		numAllocations += btLoadCounter(counters.m_numAllocations);
+		totalAllocations += btLoadCounter(counters.m_totalAllocations);
+	}
+	btUnlockThreadCaches();
+	stats.m_bytesInUse = bytesInUse > 0 ? size_t(bytesInUse) : 0;
+	stats.m_numAllocations = numAllocations > 0 ? numAllocations : 0;
+	stats.m_totalAllocations = totalAllocations;
+}
+
+size_t	btSizeClassAllocatorGetSlabBytes()
+{
+	size_t slabBytes = 0;
+	if (gSizeClassAllocatorInstalled)
+	{
+		for (int i=0;i<BT_NUM_SIZE_CLASSES;i++)
+		{
+			btLockSizeClass(gSizeClasses[i]);
+			slabBytes += gSizeClasses[i].m_slabBytes;
+			btUnlockSizeClass(gSizeClasses[i]);
+		}
+	}
+	return slabBytes;
+}
+
+const char*	btGetAllocTagName(int tag)
+{
+	return (tag >= 0 && tag < BT_MAX_ALLOC_TAGS) ? gAllocTagNames[tag] : "unknown";
+}
+
+void	btSizeClassAllocatorDumpStats(FILE* file)
+{
+	fprintf(file,"%-12s %14s %12s %12s\n","tag","bytes in use","live","total");
+	for (int i=0;i<BT_MAX_ALLOC_TAGS;i++)
+	{
+		btAllocTagStats stats;
+		btSizeClassAllocatorGetTagStats(i,stats);
+		fprintf(file,"%-12s %14lu %12d %12d\n",btGetAllocTagName(i),(unsigned long)stats.m_bytesInUse,stats.m_numAllocations,stats.m_totalAllocations);
+	}
+	fprintf(file,"slab memory %lu bytes\n",(unsigned long)btSizeClassAllocatorGetSlabBytes());
+}
@@ -0,0 +1,49 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef BT_SIZE_CLASS_ALLOCATOR_H
+#define BT_SIZE_CLASS_ALLOCATOR_H
+
+#include "btAlignedAllocator.h"
+#include <stdio.h>
+
+///btAllocTagStats is the memory of one btAllocTag, m_bytesInUse counts the requested sizes
+struct btAllocTagStats
+{
+	size_t	m_bytesInUse;
+	int		m_numAllocations;
+	int		m_totalAllocations;
+};
+
+///The size class allocator is an optional backend for btAlignedAlloc that replaces the padded malloc of the default allocator.
+///Small blocks are carved from 16 byte aligned slabs, each thread keeps a cache of free blocks per size class and only takes the lock of the size class to exchange a batch of blocks.
+///Blocks above 16KB and alignments above 16 bytes go to malloc. Slabs are kept for reuse and not returned to the system.
+///Every block records the btAllocTag that was active in its thread (see BT_ALLOC_TAG), btSizeClassAllocatorGetTagStats reports the memory of each tag.
+///btSizeClassAllocatorInstall must be called before the library allocates anything, because a block can only be freed by the allocator that created it.
+void	btSizeClassAllocatorInstall();
+
+bool	btSizeClassAllocatorIsInstalled();
+
+///the statistics of other threads are read without stopping them, so they are approximate while other threads allocate
+void	btSizeClassAllocatorGetTagStats(int tag,btAllocTagStats& stats);
+
+///btSizeClassAllocatorGetSlabBytes returns the memory taken by slabs, used or cached
+size_t	btSizeClassAllocatorGetSlabBytes();
+
+const char*	btGetAllocTagName(int tag);
+
+void	btSizeClassAllocatorDumpStats(FILE* file = stdout);
+
+#endif //BT_SIZE_CLASS_ALLOCATOR_H
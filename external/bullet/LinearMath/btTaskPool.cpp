@@ -0,0 +1,177 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include "btTaskPool.h"
+#include "btMinMax.h"
+
+#if defined (__GNUC__) && !defined (_WIN32) && !defined (__SPU__) && !defined (BT_NO_TASK_THREADS)
+#define BT_TASK_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif //BT_NO_TASK_THREADS
+
+
+#ifdef BT_TASK_THREADS
+
+///btTaskPool holds the job that is currently handed out, all members are guarded by m_mutex except m_nextTask, which is taken with an atomic add
+struct btTaskPool
+{
+	pthread_mutex_t	m_callMutex;
+	pthread_mutex_t	m_mutex;
+	pthread_cond_t	m_workCondition;
+	pthread_cond_t	m_doneCondition;
+
+	btTaskFunc	m_func;
+	void*		m_userPtr;
+	int			m_numTasks;
+	int			m_nextTask;
+
+	///m_jobId changes for every job, the workers compare it with the last job they have seen
+	int			m_jobId;
+	bool		m_jobOpen;
+	int			m_maxWorkers;
+	int			m_numJoinedWorkers;
+	int			m_numBusyWorkers;
+};
+
+static btTaskPool		gTaskPool = {PTHREAD_MUTEX_INITIALIZER,PTHREAD_MUTEX_INITIALIZER,PTHREAD_COND_INITIALIZER,PTHREAD_COND_INITIALIZER,0,0,0,0,0,false,0,0,0};
+static pthread_once_t	gTaskPoolOnce = PTHREAD_ONCE_INIT;
+static pthread_once_t	gTaskThreadCountOnce = PTHREAD_ONCE_INIT;
+static int				gTaskThreadCount = 1;
+
+static void	btRunTasks(btTaskFunc func, void* userPtr, int numTasks, int* nextTask)
+{
+	for (;;)
+	{
+		int taskIndex = __sync_fetch_and_add(nextTask,1);
+		if (taskIndex >= numTasks)
+			break;
+		func(userPtr,taskIndex);
+	}
+}
+
+static void*	btTaskPoolThreadFunc(void*)
+{
+	btTaskPool& pool = gTaskPool;
+	int lastJobId = 0;
+	pthread_mutex_lock(&pool.m_mutex);
+	for (;;)
+	{
+		while (pool.m_jobId == lastJobId)
+		{
+			pthread_cond_wait(&pool.m_workCondition,&pool.m_mutex);
+		}
+		lastJobId = pool.m_jobId;
+		//a worker that wakes up after the job was closed, or when the job has enough workers, waits for the next one
+		if (!pool.m_jobOpen || pool.m_numJoinedWorkers >= pool.m_maxWorkers)
+			continue;
+		pool.m_numJoinedWorkers++;
+		pool.m_numBusyWorkers++;
+		btTaskFunc func = pool.m_func;
+		void* userPtr = pool.m_userPtr;
+		int numTasks = pool.m_numTasks;
+		pthread_mutex_unlock(&pool.m_mutex);
+
+		btRunTasks(func,userPtr,numTasks,&pool.m_nextTask);
+
+		pthread_mutex_lock(&pool.m_mutex);
+		pool.m_numBusyWorkers--;
+		if (!pool.m_numBusyWorkers)
+		{
+			pthread_cond_signal(&pool.m_doneCondition);
+		}
+	}
+	return 0;
+}
+
+static void	btStartTaskPool()
+{
+	int numWorkers = btGetTaskThreadCount()-1;
+	for (int i=0;i<numWorkers;i++)
+	{
+		pthread_t thread;
+		if (pthread_create(&thread,0,btTaskPoolThreadFunc,0)==0)
+		{
+			pthread_detach(thread);
+		}
+	}
+}
+
+static void	btCountTaskThreads()
+{
+	gTaskThreadCount = btMax(btMin(int(sysconf(_SC_NPROCESSORS_ONLN)),BT_TASK_POOL_MAX_THREADS),1);
+}
+
+int		btGetTaskThreadCount()
+{
+	pthread_once(&gTaskThreadCountOnce,btCountTaskThreads);
+	return gTaskThreadCount;
+}
+
+void	btParallelFor(int numTasks, btTaskFunc func, void* userPtr, int maxThreads)
+{
+	btTaskPool& pool = gTaskPool;
+	int numThreads = btMin(btMin(maxThreads,numTasks),btGetTaskThreadCount());
+	if (numThreads <= 1 || pthread_mutex_trylock(&pool.m_callMutex)!=0)
+	{
+		int nextTask = 0;
+		btRunTasks(func,userPtr,numTasks,&nextTask);
+		return;
+	}
+	pthread_once(&gTaskPoolOnce,btStartTaskPool);
+
+	pthread_mutex_lock(&pool.m_mutex);
+	pool.m_func = func;
+	pool.m_userPtr = userPtr;
+	pool.m_numTasks = numTasks;
+	pool.m_nextTask = 0;
+	pool.m_jobId++;
+	pool.m_jobOpen = true;
+	pool.m_maxWorkers = numThreads-1;
+	pool.m_numJoinedWorkers = 0;
+	pthread_cond_broadcast(&pool.m_workCondition);
+	pthread_mutex_unlock(&pool.m_mutex);
+
+	//the calling thread takes tasks too, so the job completes even if no worker could be started
+	btRunTasks(func,userPtr,numTasks,&pool.m_nextTask);
+
+	pthread_mutex_lock(&pool.m_mutex);
+	pool.m_jobOpen = false;
+	while (pool.m_numBusyWorkers)
+	{
+		pthread_cond_wait(&pool.m_doneCondition,&pool.m_mutex);
+	}
+	pthread_mutex_unlock(&pool.m_mutex);
+	pthread_mutex_unlock(&pool.m_callMutex);
+}
+
+#else
+
+int		btGetTaskThreadCount()
+{
+	return 1;
+}
+
+void	btParallelFor(int numTasks, btTaskFunc func, void* userPtr, int maxThreads)
+{
+	(void)maxThreads;
+	for (int i=0;i<numTasks;i++)
+	{
+		func(userPtr,i);
+	}
+}
+
+#endif //BT_TASK_THREADS
@@ -0,0 +1,36 @@
+/*
+Bullet Continuous Collision Detection and Physics Library
+Copyright (c) 2003-2009 Erwin Coumans  http://bulletphysics.org
+
+This software is provided 'as-is', without any express or implied warranty.
+In no event will the authors be held liable for any damages arising from the use of this software.
+Permission is granted to anyone to use this software for any purpose,
+including commercial applications, and to alter it and redistribute it freely,
+subject to the following restrictions:
+
+1. The origin of this software must not be misrepresented; you must not claim that you wrote the original software. If you use this software in a product, an acknowledgment in the product documentation would be appreciated but is not required.
+2. Altered source versions must be plainly marked as such, and must not be misrepresented as being the original software.
+3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef BT_TASK_POOL_H
+#define BT_TASK_POOL_H
+
+///the task pool uses at most this many threads, including the thread that calls btParallelFor
+#define BT_TASK_POOL_MAX_THREADS 8
+
+///btTaskFunc runs task taskIndex of a btParallelFor call
+typedef void (*btTaskFunc)(void* userPtr, int taskIndex);
+
+///btGetTaskThreadCount returns the number of threads btParallelFor can use, including the calling thread.
+///It is 1 when the task threads are compiled out, define BT_NO_TASK_THREADS to do that.
+int		btGetTaskThreadCount();
+
+///btParallelFor calls func for every task in [0,numTasks), on the calling thread and on at most maxThreads-1 threads of the task pool, and returns when all tasks are done.
+///Tasks are handed out one at a time in index order, so put the largest tasks first.
+///The pool threads are started on first use and kept for the rest of the run, so their thread local data, such as btFrameArena::getThreadArena, is reused between calls.
+///Only one btParallelFor runs on the pool at a time. A call made while the pool is busy, for example from inside a task, runs its tasks on the calling thread.
+void	btParallelFor(int numTasks, btTaskFunc func, void* userPtr, int maxThreads = BT_TASK_POOL_MAX_THREADS);
+
+#endif //BT_TASK_POOL_H
@@ -41,7 +41,9 @@
 #import <isgl3d/btOverlappingPairCache.h>
 #import <isgl3d/btOverlappingPairCallback.h>
 #import <isgl3d/btQuantizedBvh.h>
+#import <isgl3d/btRayPacket.h>
 #import <isgl3d/btSimpleBroadphase.h>
+#import <isgl3d/btWideQuantizedBvh.h>
 #import <isgl3d/btActivatingCollisionAlgorithm.h>
 #import <isgl3d/btBox2dBox2dCollisionAlgorithm.h>
 #import <isgl3d/btBoxBoxCollisionAlgorithm.h>
@@ -52,6 +54,7 @@
 #import <isgl3d/btCollisionObject.h>
 #import <isgl3d/btCollisionWorld.h>
 #import <isgl3d/btCompoundCollisionAlgorithm.h>
+#import <isgl3d/btCompoundCompoundCollisionAlgorithm.h>
 #import <isgl3d/btConvex2dConvex2dAlgorithm.h>
 #import <isgl3d/btConvexConcaveCollisionAlgorithm.h>
 #import <isgl3d/btConvexConvexAlgorithm.h>
@@ -69,6 +72,7 @@
 #import <isgl3d/SphereTriangleDetector.h>
 #import <isgl3d/btBox2dShape.h>
 #import <isgl3d/btBoxShape.h>
+#import <isgl3d/btBvhTriangleMeshBlob.h>
 #import <isgl3d/btBvhTriangleMeshShape.h>
 #import <isgl3d/btCapsuleShape.h>
 #import <isgl3d/btCollisionMargin.h>
@@ -83,6 +87,7 @@
 #import <isgl3d/btConvexShape.h>
 #import <isgl3d/btConvexTriangleMeshShape.h>
 #import <isgl3d/btCylinderShape.h>
+#import <isgl3d/btDeformableBvhTriangleMeshShape.h>
 #import <isgl3d/btEmptyShape.h>
 #import <isgl3d/btHeightfieldTerrainShape.h>
 #import <isgl3d/btMaterial.h>
@@ -97,6 +102,7 @@
 #import <isgl3d/btStaticPlaneShape.h>
 #import <isgl3d/btStridingMeshInterface.h>
 #import <isgl3d/btTetrahedronShape.h>
+#import <isgl3d/btTiledHeightfieldTerrainShape.h>
 #import <isgl3d/btTriangleBuffer.h>
 #import <isgl3d/btTriangleCallback.h>
 #import <isgl3d/btTriangleIndexVertexArray.h>
@@ -150,6 +156,7 @@
 #import <isgl3d/btSubSimplexConvexCast.h>
 #import <isgl3d/btVoronoiSimplexSolver.h>
 #import <isgl3d/btCharacterControllerInterface.h>
+#import <isgl3d/btCharacterCrowd.h>
 #import <isgl3d/btKinematicCharacterController.h>
 #import <isgl3d/btConeTwistConstraint.h>
 #import <isgl3d/btConstraintSolver.h>
@@ -169,12 +176,15 @@
 #import <isgl3d/btTypedConstraint.h>
 #import <isgl3d/btUniversalConstraint.h>
 #import <isgl3d/btActionInterface.h>
+#import <isgl3d/btBulletFileLoader.h>
 #import <isgl3d/btContinuousDynamicsWorld.h>
 #import <isgl3d/btDiscreteDynamicsWorld.h>
 #import <isgl3d/btDynamicsWorld.h>
+#import <isgl3d/btDynamicsWorldSnapshot.h>
 #import <isgl3d/btRigidBody.h>
 #import <isgl3d/btSimpleDynamicsWorld.h>
 #import <isgl3d/btRaycastVehicle.h>
+#import <isgl3d/btRaycastVehicleManager.h>
 #import <isgl3d/btVehicleRaycaster.h>
 #import <isgl3d/btWheelInfo.h>
 #import <isgl3d/btAabbUtil2.h>
@@ -182,6 +192,7 @@
 #import <isgl3d/btAlignedObjectArray.h>
 #import <isgl3d/btConvexHull.h>
 #import <isgl3d/btDefaultMotionState.h>
+#import <isgl3d/btFrameArena.h>
 #import <isgl3d/btGeometryUtil.h>
 #import <isgl3d/btHashMap.h>
 #import <isgl3d/btIDebugDraw.h>
@@ -196,7 +207,9 @@
 #import <isgl3d/btRandom.h>
 #import <isgl3d/btScalar.h>
 #import <isgl3d/btSerializer.h>
+#import <isgl3d/btSizeClassAllocator.h>
 #import <isgl3d/btStackAlloc.h>
+#import <isgl3d/btTaskPool.h>
 #import <isgl3d/btTransform.h>
 #import <isgl3d/btTransformUtil.h>
 #import <isgl3d/btVector3.h>